@@ -0,0 +1,188 @@
+#include "config.h"
+
+#include "dht/dht_announce_scheduler.h"
+
+#include <algorithm>
+
+#include "torrent/exceptions.h"
+#include "torrent/net/socket_address.h"
+#include "tracker/tracker_dht.h"
+
+namespace torrent {
+
+namespace {
+
+bool
+same_tracker(const std::weak_ptr<TrackerDht>& one, const std::weak_ptr<TrackerDht>& two) {
+  return !one.owner_before(two) && !two.owner_before(one);
+}
+
+} // namespace
+
+DhtAnnounceScheduler::DhtAnnounceScheduler()
+  : m_last_refill(this_thread::cached_seconds().count()) {
+
+  m_cursor.clear();
+}
+
+DhtAnnounceScheduler::~DhtAnnounceScheduler() {
+  clear();
+}
+
+void
+DhtAnnounceScheduler::push(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker, bool report_status) {
+  auto [first, last] = m_pending.equal_range(info_hash);
+
+  for (auto itr = first; itr != last; ++itr) {
+    if (!same_tracker(itr->second.tracker, tracker))
+      continue;
+
+    itr->second.report_status |= report_status;
+    return;
+  }
+
+  m_pending.emplace_hint(last, info_hash, request_type{info_hash, std::move(tracker), report_status});
+}
+
+void
+DhtAnnounceScheduler::erase(const HashString& info_hash, const std::weak_ptr<TrackerDht>& tracker) {
+  auto [first, last] = m_pending.equal_range(info_hash);
+
+  while (first != last) {
+    if (tracker.expired() || same_tracker(first->second.tracker, tracker))
+      first = m_pending.erase(first);
+    else
+      ++first;
+  }
+}
+
+void
+DhtAnnounceScheduler::clear() {
+  for (auto& [_, request] : m_pending) {
+    if (!request.report_status)
+      continue;
+
+    TrackerDht::add_event(request.tracker, [](TrackerDht* tracker) {
+        tracker->receive_failed("DHT announce cancelled.");
+      });
+  }
+
+  m_pending.clear();
+}
+
+bool
+DhtAnnounceScheduler::can_start(unsigned int active) {
+  if (m_pending.empty() || active >= m_max_active)
+    return false;
+
+  update_budget();
+  return m_tokens > 0;
+}
+
+// Continue from the info hash after the last one started, wrapping around at the end of the
+// keyspace.
+DhtAnnounceScheduler::request_type
+DhtAnnounceScheduler::pop() {
+  if (m_pending.empty())
+    throw internal_error("DhtAnnounceScheduler::pop() called with no pending announces.");
+
+  auto itr = m_pending.upper_bound(m_cursor);
+
+  if (itr == m_pending.end())
+    itr = m_pending.begin();
+
+  auto request = std::move(itr->second);
+  m_cursor = request.info_hash;
+  m_pending.erase(itr);
+
+  return request;
+}
+
+void
+DhtAnnounceScheduler::set_query_limit(unsigned int rate, unsigned int burst) {
+  if (rate == 0 || burst == 0)
+    throw input_error("DhtAnnounceScheduler: invalid query rate or burst.");
+
+  m_rate   = rate;
+  m_burst  = burst;
+  m_tokens = std::min<int64_t>(m_tokens, burst);
+}
+
+void
+DhtAnnounceScheduler::set_max_active(unsigned int max_active) {
+  if (max_active == 0)
+    throw input_error("DhtAnnounceScheduler: invalid maximum active announces.");
+
+  m_max_active = max_active;
+}
+
+void
+DhtAnnounceScheduler::add_result(const HashString& target, dht::DhtSearch::const_accessor first, dht::DhtSearch::const_accessor last) {
+  result_type result{static_cast<uint32_t>(this_thread::cached_seconds().count()), 0, {}};
+
+  for (; first != last && result.size != DhtBucket::num_nodes; ++first) {
+    auto& node = result.nodes[result.size++];
+
+    node.id = first.node()->id();
+    sa_copy_to_inet_union(first.node()->address(), node.address);
+  }
+
+  if (result.size == 0)
+    return;
+
+  m_results.insert_or_assign(target, result);
+  m_result_order.emplace_back(target, result.time);
+
+  // Entries replaced by a later result are skipped, their time no longer matches.
+  while (m_results.size() > max_results) {
+    auto [hash, time] = m_result_order.front();
+    m_result_order.pop_front();
+
+    auto itr = m_results.find(hash);
+
+    if (itr != m_results.end() && itr->second.time == time)
+      m_results.erase(itr);
+  }
+}
+
+void
+DhtAnnounceScheduler::seed(dht::DhtSearch* search) {
+  if (m_results.empty())
+    return;
+
+  // Clamped, as the uptime in seconds is less than 'result_timeout' shortly after startup.
+  uint32_t now      = this_thread::cached_seconds().count();
+  uint32_t min_time = now > result_timeout ? now - result_timeout : 0;
+  auto     next     = m_results.lower_bound(search->target());
+
+  if (next != m_results.end() && seed_from(search, next, min_time))
+    next = m_results.erase(next);
+
+  if (next != m_results.begin() && seed_from(search, std::prev(next), min_time))
+    m_results.erase(std::prev(next));
+}
+
+void
+DhtAnnounceScheduler::update_budget() {
+  int64_t now = this_thread::cached_seconds().count();
+
+  if (now <= m_last_refill)
+    return;
+
+  m_tokens      = std::min<int64_t>(m_tokens + (now - m_last_refill) * m_rate, m_burst);
+  m_last_refill = now;
+}
+
+// Returns true if the result has expired and should be erased.
+bool
+DhtAnnounceScheduler::seed_from(dht::DhtSearch* search, result_map::iterator itr, uint32_t min_time) {
+  if (itr->second.time < min_time)
+    return true;
+
+  for (unsigned int i = 0; i != itr->second.size; i++)
+    search->add_contact(itr->second.nodes[i].id, &itr->second.nodes[i].address.sa);
+
+  return false;
+}
+
+} // namespace torrent
@@ -0,0 +1,117 @@
+#ifndef LIBTORRENT_DHT_ANNOUNCE_SCHEDULER_H
+#define LIBTORRENT_DHT_ANNOUNCE_SCHEDULER_H
+
+#include <deque>
+#include <map>
+#include <memory>
+
+#include "dht/dht_bucket.h"
+#include "dht/transactions/dht_search.h"
+#include "torrent/hash_string.h"
+#include "torrent/net/types.h"
+
+namespace torrent {
+
+class TrackerDht;
+
+// Pending DHT announces, started in info hash order against a global query budget.
+//
+// Announces wait in a map sorted by info hash and are taken from a cursor that moves through the
+// keyspace, so consecutive lookups target nearby regions. The nodes each lookup ends up
+// announcing to are kept for a while, and seed later lookups for targets that share a prefix
+// with it so those skip the first hops of the iterative search.
+//
+// The budget is a token bucket charged for the queries of announce lookups. Bootstrapping,
+// bucket refreshes and pings are not charged, so they never hold back announces.
+
+class DhtAnnounceScheduler {
+public:
+  // Sustained queries per second, burst size and lookups running at once. Lookups take about 26
+  // queries and a few seconds, so the defaults start 20k announces in about 22 of the 30 minute
+  // reannounce interval.
+  static constexpr unsigned int default_query_rate  = 400;
+  static constexpr unsigned int default_query_burst = 2000;
+  static constexpr unsigned int default_max_active  = 64;
+
+  // Number of recent lookup results kept for seeding, and for how long.
+  static constexpr unsigned int max_results    = 1024;
+  static constexpr unsigned int result_timeout = 15 * 60;
+
+  struct request_type {
+    HashString                info_hash;
+    std::weak_ptr<TrackerDht> tracker;
+    bool                      report_status;
+  };
+
+  DhtAnnounceScheduler();
+  ~DhtAnnounceScheduler();
+
+  bool                empty() const                  { return m_pending.empty(); }
+  size_t              size() const                   { return m_pending.size(); }
+
+  // An announce for a torrent and tracker that is already pending is merged with it.
+  void                push(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker, bool report_status);
+
+  // Removes pending announces for the info hash, only those of 'tracker' unless it is expired.
+  void                erase(const HashString& info_hash, const std::weak_ptr<TrackerDht>& tracker);
+
+  // Pending announces that report their status are told they failed.
+  void                clear();
+
+  bool                can_start(unsigned int active);
+  request_type        pop();
+
+  void                use_query()                    { m_tokens--; }
+
+  unsigned int        query_rate() const             { return m_rate; }
+  unsigned int        query_burst() const            { return m_burst; }
+  unsigned int        max_active() const             { return m_max_active; }
+
+  // Throws input_error if any of the limits is zero.
+  void                set_query_limit(unsigned int rate, unsigned int burst);
+  void                set_max_active(unsigned int max_active);
+
+  // Remember the nodes a lookup announced to.
+  void                add_result(const HashString& target, dht::DhtSearch::const_accessor first, dht::DhtSearch::const_accessor last);
+
+  // Adds the nodes of the unexpired results adjacent to the target in key order, i.e. those with
+  // the longest common prefix, as contacts to the search.
+  void                seed(dht::DhtSearch* search);
+
+private:
+  DhtAnnounceScheduler(const DhtAnnounceScheduler&) = delete;
+  DhtAnnounceScheduler& operator=(const DhtAnnounceScheduler&) = delete;
+
+  struct node_type {
+    HashString        id;
+    sa_inet_union     address;
+  };
+
+  struct result_type {
+    uint32_t          time;
+    unsigned int      size;
+    node_type         nodes[DhtBucket::num_nodes];
+  };
+
+  using pending_map = std::multimap<HashString, request_type>;
+  using result_map  = std::map<HashString, result_type>;
+
+  void                update_budget();
+  bool                seed_from(dht::DhtSearch* search, result_map::iterator itr, uint32_t min_time);
+
+  pending_map         m_pending;
+  HashString          m_cursor;
+
+  unsigned int        m_rate{default_query_rate};
+  unsigned int        m_burst{default_query_burst};
+  int64_t             m_tokens{default_query_burst};
+  int64_t             m_last_refill;
+  unsigned int        m_max_active{default_max_active};
+
+  result_map          m_results;
+  std::deque<std::pair<HashString, uint32_t>> m_result_order;
+};
+
+} // namespace torrent
+
+#endif
@@ -3,6 +3,9 @@
 #include "dht_bucket.h"
 
 #include <algorithm>
+#include <cstring>
+#include <functional>
+#include <arpa/inet.h>
 
 #include "dht_node.h"
 #include "torrent/exceptions.h"
@@ -12,37 +15,46 @@ namespace torrent {
 DhtBucket::DhtBucket(const HashString& begin, const HashString& end) :
   m_begin(begin),
   m_end(end) {
+}
 
-  reserve(num_nodes);
+DhtBucket::iterator
+DhtBucket::find(const HashString& id) {
+  return std::find_if(begin(), end(), [&id](const DhtNode& node) { return node.id() == id; });
 }
 
-void
-DhtBucket::add_node(DhtNode* n) {
-  push_back(n);
+DhtNode*
+DhtBucket::add_node(const DhtNode& n) {
+  if (is_full())
+    throw internal_error("DhtBucket::add_node called on a full bucket.");
+
+  DhtNode* node = &m_nodes[m_size++];
+
+  *node = n;
+  node->set_bucket(this);
   touch();
 
-  if (n->is_good())
+  if (node->is_good())
     m_good++;
-  else if (n->is_bad())
+  else if (node->is_bad())
     m_bad++;
 
-  m_fullCacheLength = 0;
+  return node;
 }
 
 void
-DhtBucket::remove_node(DhtNode* n) {
-  auto itr = std::find(begin(), end(), n);
-  if (itr == end())
+DhtBucket::remove_node(iterator itr) {
+  if (itr < begin() || itr >= end())
     throw internal_error("DhtBucket::remove_node called for node not in bucket.");
 
-  erase(itr);
-
-  if (n->is_good())
+  if (itr->is_good())
     m_good--;
-  else if (n->is_bad())
+  else if (itr->is_bad())
     m_bad--;
 
-  m_fullCacheLength = 0;
+  if (itr != end() - 1)
+    *itr = *(end() - 1);
+
+  m_size--;
 }
 
 void
@@ -55,10 +67,6 @@ DhtBucket::count() {
 void
 DhtBucket::update() {
   count();
-
-  // In case adjacent buckets whose nodes we borrowed have changed,
-  // we force an update of the cache.
-  m_fullCacheLength = 0;
 }
 
 DhtBucket::iterator
@@ -67,11 +75,11 @@ DhtBucket::find_replacement_candidate(bool onlyOldest) {
   auto oldestTime = std::numeric_limits<unsigned int>::max();
 
   for (auto itr = begin(); itr != end(); ++itr) {
-    if ((*itr)->is_bad() && !onlyOldest)
+    if (itr->is_bad() && !onlyOldest)
       return itr;
 
-    if ((*itr)->last_seen() < oldestTime) {
-      oldestTime = (*itr)->last_seen();
+    if (itr->last_seen() < oldestTime) {
+      oldestTime = itr->last_seen();
       oldest = itr;
     }
   }
@@ -121,12 +129,12 @@ DhtBucket::split(const HashString& id) {
 
   // Move nodes over to other bucket if they fall in its range, then
   // delete them from this one.
-  auto split = std::partition(begin(), end(), [this](auto dht) { return dht->is_in_range(this); });
-  other->insert(other->end(), split, end());
-  for (auto& dht : *other) {
-    dht->set_bucket(other);
-  }
-  erase(split, end());
+  auto split = std::partition(begin(), end(), [this](const DhtNode& node) { return is_in_range(node.id()); });
+
+  for (auto itr = split; itr != end(); ++itr)
+    other->add_node(*itr);
+
+  m_size = std::distance(begin(), split);
 
   other->set_time(m_last_changed);
   other->count();
@@ -154,24 +162,19 @@ DhtBucket::split(const HashString& id) {
   return other;
 }
 
-void
-DhtBucket::build_full_cache() {
-  DhtBucketChain chain(this);
+unsigned int
+dht_prefix_length(const HashString& one, const HashString& two) {
+  for (unsigned int i = 0; i != HashString::size_data; i += sizeof(uint32_t)) {
+    uint32_t a, b;
 
-  char* pos = m_fullCache;
+    std::memcpy(&a, one.data() + i, sizeof(uint32_t));
+    std::memcpy(&b, two.data() + i, sizeof(uint32_t));
 
-  do {
-    for (auto itr = chain.bucket()->begin(); itr != chain.bucket()->end() && pos < m_fullCache + sizeof(m_fullCache); ++itr) {
-      if (!(*itr)->is_bad()) {
-        pos = (*itr)->store_compact(pos);
-
-        if (pos > m_fullCache + sizeof(m_fullCache))
-          throw internal_error("DhtRouter::store_closest_nodes wrote past buffer end.");
-      }
-    }
-  } while (pos < m_fullCache + sizeof(m_fullCache) && chain.next() != NULL);
+    if (a != b)
+      return i * 8 + __builtin_clz(ntohl(a ^ b));
+  }
 
-  m_fullCacheLength = pos - m_fullCache;
+  return HashString::size_data * 8;
 }
 
 } // namespace torrent
@@ -1,40 +1,46 @@
 #ifndef LIBTORRENT_DHT_BUCKET_H
 #define LIBTORRENT_DHT_BUCKET_H
 
-#include <list>
-#include <vector>
-
+#include "dht/dht_node.h"
 #include "torrent/hash_string.h"
-#include "torrent/object_raw_bencode.h"
 
 namespace torrent {
 
-class DhtNode;
-
 // A container holding a small number of nodes that fall in a given binary
 // partition of the 160-bit ID space (i.e. the range ID1..ID2 where ID2-ID1+1 is
 // a power of 2.)
-class DhtBucket : private std::vector<DhtNode*> {
+//
+// Only the bucket holding our own ID is ever split, so every other bucket
+// holds exactly the nodes sharing a given number of leading bits with our ID.
+// The router indexes buckets by that common prefix length, see
+// dht_prefix_length().
+//
+// Nodes are stored inline, removing a node moves the last node into its slot.
+class DhtBucket {
 public:
   static constexpr unsigned int num_nodes = 8;
 
-  using base_type = std::vector<DhtNode*>;
+  using iterator       = DhtNode*;
+  using const_iterator = const DhtNode*;
 
-  using base_type::const_iterator;
-  using base_type::iterator;
+  DhtBucket(const HashString& begin, const HashString& end);
 
-  using base_type::begin;
-  using base_type::end;
-  using base_type::size;
-  using base_type::empty;
+  iterator            begin()                                 { return m_nodes; }
+  iterator            end()                                   { return m_nodes + m_size; }
+  const_iterator      begin() const                           { return m_nodes; }
+  const_iterator      end() const                             { return m_nodes + m_size; }
 
-  DhtBucket(const HashString& begin, const HashString& end);
+  unsigned int        size() const                            { return m_size; }
+  bool                empty() const                           { return m_size == 0; }
 
-  // Add new node. Does NOT set node's bucket automatically (to allow adding a
-  // node to multiple buckets, with only one "main" bucket.)
-  void                add_node(DhtNode* n);
+  iterator            find(const HashString& id);
 
-  void                remove_node(DhtNode* n);
+  // Copies the node into the bucket and sets its bucket, the bucket must not
+  // be full.
+  DhtNode*            add_node(const DhtNode& n);
+
+  // Invalidates pointers to the last node in the bucket.
+  void                remove_node(iterator itr);
 
   // Bucket's ID range functions.
   const HashString&   id_range_begin() const                  { return m_begin; }
@@ -76,18 +82,15 @@ public:
   DhtBucket*          parent() const                          { return m_parent; }
   DhtBucket*          child() const                           { return m_child; }
 
-  // Return a full bucket's worth of compact node data. If this bucket is not
-  // full, it uses nodes from the child/parent buckets until we have enough.
-  raw_string          full_bucket();
-
   // Called by the DhtNode on its bucket to update good/bad node counts.
   void                node_now_good(bool was_bad);
   void                node_now_bad(bool was_good);
 
 private:
-  void                count();
+  DhtBucket(const DhtBucket&) = delete;
+  DhtBucket& operator=(const DhtBucket&) = delete;
 
-  void                build_full_cache();
+  void                count();
 
   DhtBucket*          m_parent{};
   DhtBucket*          m_child{};
@@ -96,18 +99,17 @@ private:
 
   unsigned int        m_good{0};
   unsigned int        m_bad{0};
+  unsigned int        m_size{0};
 
-  size_t              m_fullCacheLength{0};
-
-  // These are 40 bytes together, so might as well put them last.
-  // m_end is const because it is used as key for the DhtRouter routing table
-  // map, which would be inconsistent if m_end were changed carelessly.
   HashString          m_begin;
   HashString          m_end;
 
-  char                m_fullCache[num_nodes * 26];
+  DhtNode             m_nodes[num_nodes];
 };
 
+// Number of leading bits the two IDs have in common, 160 if equal.
+unsigned int        dht_prefix_length(const HashString& one, const HashString& two);
+
 // Helper class to recursively follow a chain of buckets.  It first recurses
 // into the bucket's children since they are by definition closer to the bucket,
 // then continues with the bucket's parents.
@@ -135,14 +137,6 @@ DhtBucket::node_now_bad(bool was_good) {
   m_bad++;
 }
 
-inline raw_string
-DhtBucket::full_bucket() {
-  if (!m_fullCacheLength)
-    build_full_cache();
-
-  return raw_string(m_fullCache, m_fullCacheLength);
-}
-
 inline const DhtBucket*
 DhtBucketChain::next() {
   // m_restart is clear when we're done recursing into the children and
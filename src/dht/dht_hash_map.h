@@ -42,13 +42,11 @@
 #include <cstring>
 #include <unordered_map>
 
-#include "dht_node.h"
-#include "dht_tracker.h"
 #include "torrent/hash_string.h"
 
 namespace torrent {
 
-// Hash functions for HashString keys, and dereferencing HashString pointers.
+// Hash function for HashString keys.
 
 // Since the first few bits are very similar if not identical (since the IDs
 // will be close to our own node ID), we use an offset of 64 bits in the hash
@@ -59,16 +57,6 @@ namespace torrent {
 // aligned 64-bit access.
 static constexpr unsigned int hashstring_hash_ofs = 8;
 
-struct hashstring_ptr_hash {
-  size_t operator () (const HashString* n) const {
-    size_t result;
-
-    std::memcpy(&result, n->data() + hashstring_hash_ofs, sizeof(result));
-
-    return result;
-  }
-};
-
 struct hashstring_hash {
   size_t operator () (const HashString& n) const {
     size_t result;
@@ -79,41 +67,6 @@ struct hashstring_hash {
   }
 };
 
-// Compare HashString pointers by dereferencing them.
-struct hashstring_ptr_equal {
-  size_t operator () (const HashString* one, const HashString* two) const 
-  { return *one == *two; }
-};
-
-class DhtNodeList : public std::unordered_map<const HashString*, DhtNode*, hashstring_ptr_hash, hashstring_ptr_equal> {
-public:
-  using base_type = std::unordered_map<const HashString*, DhtNode*, hashstring_ptr_hash, hashstring_ptr_equal>;
-
-  // Define accessor iterator with more convenient access to the key and
-  // element values.  Allows changing the map definition more easily if needed.
-  template<typename T>
-  struct accessor_wrapper : public T {
-    accessor_wrapper(const T& itr) : T(itr) { }
-
-    const HashString&    id() const    { return *(**this).first; }
-    DhtNode*             node() const  { return (**this).second; }
-  };
-
-  using const_accessor = accessor_wrapper<const_iterator>;
-  using accessor       = accessor_wrapper<iterator>;
-
-  DhtNode*            add_node(DhtNode* n);
-
-};
-
-using DhtTrackerList = std::unordered_map<HashString, DhtTracker*, hashstring_hash>;
-
-inline
-DhtNode* DhtNodeList::add_node(DhtNode* n) {
-  emplace(reinterpret_cast<const HashString*>(n), n);
-  return n;
-}
-
 } // namespace torrent
 
 #endif
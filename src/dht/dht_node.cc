@@ -2,6 +2,10 @@
 
 #include "dht/dht_node.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "dht/dht_bucket.h"
 #include "torrent/object.h"
 #include "torrent/net/socket_address.h"
 #include "torrent/utils/log.h"
@@ -13,8 +17,9 @@
 namespace torrent {
 
 DhtNode::DhtNode(const HashString& id, const sockaddr* sa)
-  : HashString(id),
-    m_socket_address(sa_copy(sa)) {
+  : HashString(id) {
+
+  sa_copy_to_inet_union(sa, m_address);
 
   // TODO: Change this to use the id hash similar to how peer info
   // hash'es are logged.
@@ -25,59 +30,146 @@ DhtNode::DhtNode(const HashString& id, const sockaddr* sa)
   //   throw resource_error("Address not af_inet or in6addr_any");
 }
 
+// IPv4 nodes are cached with the address as an integer in "i", IPv6 nodes with the raw address
+// in "a".
 DhtNode::DhtNode(const std::string& id, const Object& cache)
   : HashString(*HashString::cast_from(id.c_str())),
     m_last_seen(cache.get_key_value("t")) {
 
-  // TODO: Check how DHT handles inet6.
-  m_socket_address = sa_make_inet_h(cache.get_key_value("i"), cache.get_key_value("p"));
+  if (cache.has_key_string("a")) {
+    const std::string& addr = cache.get_key_string("a");
+
+    if (addr.size() != sizeof(in6_addr))
+      throw bencode_error("Loading cache: Invalid node address.");
+
+    m_address.inet6.sin6_family = AF_INET6;
+    m_address.inet6.sin6_port   = htons(cache.get_key_value("p"));
+    std::memcpy(&m_address.inet6.sin6_addr, addr.data(), sizeof(in6_addr));
+
+  } else {
+    sa_copy_to_inet_union(sa_make_inet_h(cache.get_key_value("i"), cache.get_key_value("p")).get(), m_address);
+  }
+
+  LT_LOG_THIS("initializing node : %s", sa_pretty_str(address()).c_str());
+
+  update();
+}
+
+// Reads a node stored by store_cache(char*), 'cache' must hold size_cache or size_cache6 bytes
+// depending on the family.
+DhtNode::DhtNode(const char* cache, int family)
+  : HashString(*HashString::cast_from(cache)) {
+
+  const char* itr = cache + HashString::size_data;
+
+  if (family == AF_INET6) {
+    m_address.inet6.sin6_family = AF_INET6;
+    std::memcpy(&m_address.inet6.sin6_addr, itr, sizeof(in6_addr));
+    std::memcpy(&m_address.inet6.sin6_port, itr + sizeof(in6_addr), sizeof(uint16_t));
+    itr += sizeof(in6_addr) + sizeof(uint16_t);
 
-  LT_LOG_THIS("initializing node : %s", sap_pretty_str(m_socket_address).c_str());
+  } else if (family == AF_INET) {
+    m_address.inet.sin_family = AF_INET;
+    std::memcpy(&m_address.inet.sin_addr, itr, sizeof(in_addr));
+    std::memcpy(&m_address.inet.sin_port, itr + sizeof(in_addr), sizeof(uint16_t));
+    itr += sizeof(in_addr) + sizeof(uint16_t);
+
+  } else {
+    throw internal_error("DhtNode::DhtNode called with non-inet/inet6 family.");
+  }
+
+  uint32_t last_seen;
+  uint16_t rtt;
+
+  std::memcpy(&last_seen, itr, sizeof(last_seen));
+  std::memcpy(&rtt, itr + sizeof(last_seen), sizeof(rtt));
+
+  m_last_seen = ntohl(last_seen);
+  m_rtt       = ntohs(rtt);
+
+  LT_LOG_THIS("initializing node : %s", sa_pretty_str(address()).c_str());
 
   update();
 }
 
 void
 DhtNode::set_address(const sockaddr* sa) {
-  m_socket_address = sa_copy(sa);
+  m_address = sa_inet_union{};
+  sa_copy_to_inet_union(sa, m_address);
+}
+
+// Exponentially weighted as for TCP's smoothed round trip time, kept at one millisecond or more
+// so that zero means unknown.
+void
+DhtNode::add_rtt_sample(std::chrono::microseconds rtt) {
+  auto sample = std::clamp<int64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(rtt).count(), 1, UINT16_MAX);
+
+  if (m_rtt == 0)
+    m_rtt = sample;
+  else
+    m_rtt = (m_rtt * 7 + sample) / 8;
+}
+
+void
+DhtNode::set_good() {
+  if (m_bucket != NULL && !is_good())
+    m_bucket->node_now_good(is_bad());
+
+  m_last_seen = this_thread::cached_seconds().count();
+  m_recently_inactive = 0;
+  m_recently_active = true;
+}
+
+void
+DhtNode::set_bad() {
+  if (m_bucket != NULL && !is_bad())
+    m_bucket->node_now_bad(is_good());
+
+  m_recently_inactive = max_failed_replies;
+  m_recently_active = false;
 }
 
 char*
 DhtNode::store_compact(char* buffer) const {
   HashString::cast_from(buffer)->assign(data());
 
-  if (m_socket_address->sa_family != AF_INET)
-    throw internal_error("DhtNode::store_compact called with non-inet address.");
+  switch (m_address.sa.sa_family) {
+  case AF_INET: {
+    SocketAddressCompact compact(&m_address.inet);
+    std::memcpy(buffer + 20, compact.c_str(), sizeof(compact));
+    return buffer + size_compact;
+  }
+  case AF_INET6: {
+    SocketAddressCompact6 compact(m_address.inet6.sin6_addr, m_address.inet6.sin6_port);
+    std::memcpy(buffer + 20, compact.c_str(), sizeof(compact));
+    return buffer + size_compact6;
+  }
+  default:
+    throw internal_error("DhtNode::store_compact called with non-inet/inet6 address.");
+  }
+}
+
+char*
+DhtNode::store_cache(char* buffer) const {
+  buffer = store_compact(buffer);
 
-  auto sin = reinterpret_cast<sockaddr_in*>(m_socket_address.get());
+  uint32_t last_seen = htonl(m_last_seen);
+  uint16_t rtt       = htons(m_rtt);
 
-  SocketAddressCompact compact(sin);
-  std::memcpy(buffer + 20, compact.c_str(), 6);
+  std::memcpy(buffer, &last_seen, sizeof(last_seen));
+  std::memcpy(buffer + sizeof(last_seen), &rtt, sizeof(rtt));
 
-  return buffer + 26;
+  return buffer + sizeof(last_seen) + sizeof(rtt);
 }
 
 Object*
-DhtNode::store_cache(Object* container) const {
-  if (m_socket_address->sa_family == AF_INET6) {
-    // Currently, all we support is in6addr_any (checked in the constructor),
-    // which is effectively equivalent to this. Note that we need to specify
-    // int64_t explicitly here because a zero constant is special in C++ and
-    // thus we need an explicit match.
-    container->insert_key("i", int64_t{0});
-    container->insert_key("p", sap_port(m_socket_address));
-
-  } else if (m_socket_address->sa_family == AF_INET) {
-    auto sin = reinterpret_cast<sockaddr_in*>(m_socket_address.get());
-
-    container->insert_key("i", ntohl(sin->sin_addr.s_addr));
-    container->insert_key("p", ntohs(sin->sin_port));
-
-  } else {
-    throw internal_error("DhtNode::store_cache called with non-inet/inet6 address.");
-  }
+DhtNode::store_cache_legacy(Object* container) const {
+  if (m_address.sa.sa_family != AF_INET)
+    throw internal_error("DhtNode::store_cache_legacy called with non-inet address.");
 
-  container->insert_key("t", m_last_seen);
+  container->insert_key("i", int64_t{ntohl(m_address.inet.sin_addr.s_addr)});
+  container->insert_key("p", int64_t{ntohs(m_address.inet.sin_port)});
+  container->insert_key("t", int64_t{m_last_seen});
   return container;
 }
 
@@ -1,7 +1,7 @@
 #ifndef LIBTORRENT_DHT_NODE_H
 #define LIBTORRENT_DHT_NODE_H
 
-#include "dht/dht_bucket.h"
+#include "torrent/common.h"
 #include "torrent/hash_string.h"
 #include "torrent/object_raw_bencode.h"
 #include "torrent/net/types.h"
@@ -21,14 +21,20 @@ public:
   // A node is considered bad if it failed to reply to this many queries.
   static constexpr unsigned int max_failed_replies = 5;
 
+  DhtNode() = default;
   DhtNode(const HashString& id, const sockaddr* sa);
   DhtNode(const std::string& id, const Object& cache);
+  DhtNode(const char* cache, int family);
   ~DhtNode() = default;
 
+  // Nodes are stored by value in their bucket and copied when buckets split.
+  DhtNode(const DhtNode&) = default;
+  DhtNode& operator=(const DhtNode&) = default;
+
   const HashString&   id() const                 { return *this; }
   raw_string          id_raw_string() const      { return raw_string(data(), size_data); }
 
-  const sockaddr*     address() const            { return m_socket_address.get(); }
+  const sockaddr*     address() const            { return &m_address.sa; }
   void                set_address(const sockaddr* sa);
 
   // For determining node quality.
@@ -39,6 +45,10 @@ public:
   bool                is_bad() const             { return m_recently_inactive >= max_failed_replies; }
   bool                is_active() const          { return m_last_seen; }
 
+  // Smoothed round trip time of our queries in milliseconds, zero if unknown.
+  unsigned int        rtt() const                { return m_rtt; }
+  void                add_rtt_sample(std::chrono::microseconds rtt);
+
   // Update is called once every 15 minutes.
   void                update()                   { m_recently_active = age() < 15 * 60; }
 
@@ -50,19 +60,26 @@ public:
   DhtBucket*          bucket() const             { return m_bucket; }
   DhtBucket*          set_bucket(DhtBucket* b)   { m_bucket = b; return b; }
 
-  bool                is_in_range(const DhtBucket* b) { return b->is_in_range(*this); }
+  // Store compact node information (ID, address and port, 26 bytes for IPv4 and
+  // 38 bytes for IPv6) in the given buffer and return pointer to end of stored
+  // information.
+  static constexpr unsigned int size_compact  = 26;
+  static constexpr unsigned int size_compact6 = 38;
 
-  // Store compact node information (26 bytes address, port and ID) in the given
-  // buffer and return pointer to end of stored information.
   char*               store_compact(char* buffer) const;
 
-  // Store node cache in the given container object and return it.
-  Object*             store_cache(Object* container) const;
+  // Store the node in the binary routing table cache, the compact node information followed by
+  // the last seen time and round trip time, and return pointer to end of stored information.
+  static constexpr unsigned int size_cache  = size_compact + 6;
+  static constexpr unsigned int size_cache6 = size_compact6 + 6;
 
-protected:
-  DhtNode(const DhtNode&) = delete;
-  DhtNode& operator=(const DhtNode&) = delete;
+  char*               store_cache(char* buffer) const;
+
+  // Store the IPv4 node in the map format of the "nodes" cache key used before the binary
+  // routing table.
+  Object*             store_cache_legacy(Object* container) const;
 
+protected:
   friend class dht::DhtSearch;
 
   void                set_good();
@@ -70,32 +87,14 @@ protected:
 
 private:
 
-  sa_unique_ptr       m_socket_address;
+  sa_inet_union       m_address{};
   unsigned int        m_last_seen{};
   bool                m_recently_active{};
   unsigned int        m_recently_inactive{};
+  uint16_t            m_rtt{};
   DhtBucket*          m_bucket{};
 };
 
-inline void
-DhtNode::set_good() {
-  if (m_bucket != NULL && !is_good())
-    m_bucket->node_now_good(is_bad());
-
-  m_last_seen = this_thread::cached_seconds().count();
-  m_recently_inactive = 0;
-  m_recently_active = true;
-}
-
-inline void
-DhtNode::set_bad() {
-  if (m_bucket != NULL && !is_bad())
-    m_bucket->node_now_bad(is_good());
-
-  m_recently_inactive = max_failed_replies;
-  m_recently_active = false;
-}
-
 inline void
 DhtNode::inactive() {
   if (m_recently_inactive + 1 == max_failed_replies)
@@ -0,0 +1,122 @@
+#include "config.h"
+
+#include "dht/dht_peer_store.h"
+
+#include "torrent/exceptions.h"
+
+namespace torrent {
+
+DhtPeerStore::~DhtPeerStore() {
+  clear();
+}
+
+DhtTracker*
+DhtPeerStore::find(const HashString& hash) {
+  auto itr = m_trackers.find(hash);
+
+  return itr != m_trackers.end() ? itr->second.get() : nullptr;
+}
+
+size_t
+DhtPeerStore::memory_usage() const {
+  // Roughly one node and bucket per tracker in the hash map.
+  size_t usage = m_trackers.size() * (sizeof(DhtTracker) + sizeof(tracker_map::value_type) + 3 * sizeof(void*));
+
+  for (const auto& [_, tracker] : m_trackers)
+    usage += tracker->memory_usage();
+
+  return usage;
+}
+
+void
+DhtPeerStore::add_peer(const HashString& hash, const sockaddr* sa, uint16_t port, bool seed) {
+  auto [itr, inserted] = m_trackers.try_emplace(hash);
+
+  if (inserted)
+    itr->second = std::make_unique<DhtTracker>(hash, sa->sa_family);
+  else
+    lru_unlink(itr->second.get());
+
+  auto tracker = itr->second.get();
+  lru_push_front(tracker);
+
+  m_num_peers += tracker->add_peer(sa, port, seed, m_max_peers);
+
+  if (tracker->empty()) {
+    erase(tracker);
+    return;
+  }
+
+  if (m_num_peers > m_max_total)
+    evict(tracker);
+}
+
+void
+DhtPeerStore::prune(uint32_t max_age) {
+  for (auto tracker = m_lru_first; tracker != nullptr; ) {
+    auto next = tracker->m_lru_next;
+
+    m_num_peers -= tracker->prune(max_age);
+
+    if (tracker->empty())
+      erase(tracker);
+
+    tracker = next;
+  }
+}
+
+void
+DhtPeerStore::clear() {
+  m_trackers.clear();
+  m_lru_first = nullptr;
+  m_lru_last  = nullptr;
+  m_num_peers = 0;
+}
+
+void
+DhtPeerStore::erase(DhtTracker* tracker) {
+  lru_unlink(tracker);
+  m_num_peers -= tracker->size();
+
+  if (m_trackers.erase(tracker->hash()) != 1)
+    throw internal_error("DhtPeerStore::erase() tracker not found.");
+}
+
+// Drops the least recently announced torrents until within the total, except for 'keep' which
+// just received an announce.
+void
+DhtPeerStore::evict(DhtTracker* keep) {
+  while (m_num_peers > m_max_total && m_lru_last != nullptr && m_lru_last != keep)
+    erase(m_lru_last);
+}
+
+void
+DhtPeerStore::lru_unlink(DhtTracker* tracker) {
+  if (tracker->m_lru_prev != nullptr)
+    tracker->m_lru_prev->m_lru_next = tracker->m_lru_next;
+  else
+    m_lru_first = tracker->m_lru_next;
+
+  if (tracker->m_lru_next != nullptr)
+    tracker->m_lru_next->m_lru_prev = tracker->m_lru_prev;
+  else
+    m_lru_last = tracker->m_lru_prev;
+
+  tracker->m_lru_prev = nullptr;
+  tracker->m_lru_next = nullptr;
+}
+
+void
+DhtPeerStore::lru_push_front(DhtTracker* tracker) {
+  tracker->m_lru_prev = nullptr;
+  tracker->m_lru_next = m_lru_first;
+
+  if (m_lru_first != nullptr)
+    m_lru_first->m_lru_prev = tracker;
+  else
+    m_lru_last = tracker;
+
+  m_lru_first = tracker;
+}
+
+} // namespace torrent
@@ -0,0 +1,81 @@
+#ifndef LIBTORRENT_DHT_PEER_STORE_H
+#define LIBTORRENT_DHT_PEER_STORE_H
+
+#include <memory>
+#include <unordered_map>
+
+#include "dht/dht_hash_map.h"
+#include "dht/dht_tracker.h"
+
+namespace torrent {
+
+// Peers announced to us, for all torrents we track.
+//
+// Both the number of peers per torrent and the total number of peers are limited. Torrents are
+// kept in least recently announced order, and when the total is exceeded the least recently
+// announced torrents are dropped.
+
+class DhtPeerStore {
+public:
+  static constexpr size_t default_max_total = size_t{1} << 20;
+
+  DhtPeerStore() = default;
+  ~DhtPeerStore();
+
+  bool                empty() const                  { return m_trackers.empty(); }
+  size_t              size() const                   { return m_trackers.size(); }
+  size_t              num_peers() const              { return m_num_peers; }
+
+  // Approximate heap memory used by the trackers and their peers.
+  size_t              memory_usage() const;
+
+  // Lowering the limits does not drop existing peers. The total is enforced on the next announce,
+  // while a torrent above 'max_peers' replaces its oldest peers and only shrinks when pruned.
+  unsigned int        max_peers() const              { return m_max_peers; }
+  size_t              max_total() const              { return m_max_total; }
+  void                set_max_peers(unsigned int max) { m_max_peers = max; }
+  void                set_max_total(size_t max)      { m_max_total = max; }
+
+  DhtTracker*         find(const HashString& hash);
+
+  // Only the address of 'sa' is used.
+  void                add_peer(const HashString& hash, const sockaddr* sa, uint16_t port, bool seed);
+
+  // Removes peers that have not reannounced for 'max_age' seconds and empty torrents.
+  void                prune(uint32_t max_age);
+  void                clear();
+
+  template <typename Func>
+  void                for_each(Func func) const;
+
+private:
+  DhtPeerStore(const DhtPeerStore&) = delete;
+  DhtPeerStore& operator=(const DhtPeerStore&) = delete;
+
+  using tracker_map = std::unordered_map<HashString, std::unique_ptr<DhtTracker>, hashstring_hash>;
+
+  void                erase(DhtTracker* tracker);
+  void                evict(DhtTracker* keep);
+
+  void                lru_unlink(DhtTracker* tracker);
+  void                lru_push_front(DhtTracker* tracker);
+
+  tracker_map         m_trackers;
+  DhtTracker*         m_lru_first{};
+  DhtTracker*         m_lru_last{};
+
+  size_t              m_num_peers{};
+  unsigned int        m_max_peers{DhtTracker::max_size};
+  size_t              m_max_total{default_max_total};
+};
+
+template <typename Func>
+void
+DhtPeerStore::for_each(Func func) const {
+  for (const auto& [_, tracker] : m_trackers)
+    func(*tracker);
+}
+
+} // namespace torrent
+
+#endif
@@ -0,0 +1,139 @@
+#include "config.h"
+
+#include "dht/dht_rate_limiter.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+#include "torrent/exceptions.h"
+
+namespace torrent {
+
+DhtRateLimiter::DhtRateLimiter()
+  : m_last_drain(this_thread::cached_seconds().count()) {
+}
+
+bool
+DhtRateLimiter::admit(const sockaddr* sa) {
+  uint64_t host;
+  uint64_t prefix;
+
+  // The family is mixed into the keys so IPv4 and IPv6 sources do not share buckets.
+  if (sa->sa_family == AF_INET) {
+    uint32_t addr = ntohl(reinterpret_cast<const sockaddr_in*>(sa)->sin_addr.s_addr);
+
+    host   = uint64_t{AF_INET} << 32 | addr;
+    prefix = uint64_t{AF_INET} << 32 | (addr & 0xffffff00);
+
+  } else if (sa->sa_family == AF_INET6) {
+    auto addr = reinterpret_cast<const sockaddr_in6*>(sa)->sin6_addr.s6_addr;
+
+    host   = 0;
+    prefix = 0;
+    std::memcpy(&host, addr, 8);
+    std::memcpy(&prefix, addr, 6);
+
+    host   ^= AF_INET6;
+    prefix ^= AF_INET6;
+
+  } else {
+    throw internal_error("DhtRateLimiter::admit() called with non-inet/inet6 address.");
+  }
+
+  update_time();
+
+  // Tokens are only used when both limits admit the query, so a host over its own limit does
+  // not use up the tokens of its prefix.
+  if (!m_host.has_token(host) || !m_prefix.has_token(prefix))
+    return false;
+
+  m_host.use_token(host);
+  m_prefix.use_token(prefix);
+  return true;
+}
+
+void
+DhtRateLimiter::clear() {
+  m_host.clear();
+  m_prefix.clear();
+}
+
+void
+DhtRateLimiter::update_time() {
+  auto now = this_thread::cached_seconds().count();
+
+  if (now <= m_last_drain)
+    return;
+
+  m_host.drain(now - m_last_drain);
+  m_prefix.drain(now - m_last_drain);
+
+  m_last_drain = now;
+}
+
+DhtRateLimiter::sketch::sketch(unsigned int rate, unsigned int burst) {
+  set_limit(rate, burst);
+
+  for (auto& seed : m_seeds)
+    seed = static_cast<uint64_t>(random()) << 32 | static_cast<uint32_t>(random()) | 1;
+}
+
+void
+DhtRateLimiter::sketch::set_limit(unsigned int rate, unsigned int burst) {
+  if (rate == 0 || burst == 0 || burst > UINT16_MAX)
+    throw input_error("DhtRateLimiter: invalid rate or burst.");
+
+  m_rate  = rate;
+  m_burst = burst;
+}
+
+unsigned int
+DhtRateLimiter::sketch::position(unsigned int row, uint64_t key) const {
+  constexpr unsigned int shift = 64 - std::countr_zero(sketch_width);
+
+  return ((key ^ m_seeds[row]) * UINT64_C(0x9e3779b97f4a7c15)) >> shift;
+}
+
+bool
+DhtRateLimiter::sketch::has_token(uint64_t key) const {
+  for (unsigned int i = 0; i != sketch_depth; i++)
+    if (m_cells[i][position(i, key)] < m_burst)
+      return true;
+
+  return false;
+}
+
+// Conservative update, only the cells holding the minimum are incremented as the others already
+// overestimate the count.
+void
+DhtRateLimiter::sketch::use_token(uint64_t key) {
+  uint16_t* cells[sketch_depth];
+  uint16_t  count = UINT16_MAX;
+
+  for (unsigned int i = 0; i != sketch_depth; i++) {
+    cells[i] = &m_cells[i][position(i, key)];
+    count    = std::min(count, *cells[i]);
+  }
+
+  for (auto cell : cells)
+    if (*cell == count)
+      *cell = count + 1;
+}
+
+void
+DhtRateLimiter::sketch::drain(int64_t seconds) {
+  if (seconds * m_rate >= m_burst) {
+    clear();
+    return;
+  }
+
+  auto amount = static_cast<uint16_t>(seconds * m_rate);
+
+  for (auto& row : m_cells)
+    for (auto& cell : row)
+      cell = cell > amount ? cell - amount : 0;
+}
+
+} // namespace torrent
@@ -0,0 +1,76 @@
+#ifndef LIBTORRENT_DHT_RATE_LIMITER_H
+#define LIBTORRENT_DHT_RATE_LIMITER_H
+
+#include <array>
+#include <cstdint>
+
+#include "torrent/net/types.h"
+
+namespace torrent {
+
+// Admission control for incoming DHT queries, a token bucket per source host and per source
+// prefix.
+//
+// The buckets are kept in count-min sketches, so memory use is fixed no matter how many sources
+// there are. Each cell counts the tokens used by the sources hashed to it, and once a second
+// every cell is drained by the refill rate. Collisions only make the limit stricter for the
+// colliding sources, and the rows are seeded randomly so they cannot be aimed at.
+//
+// IPv4 hosts are single addresses and prefixes /24, IPv6 hosts are /64 and prefixes /48.
+
+class DhtRateLimiter {
+public:
+  static constexpr unsigned int sketch_depth = 4;
+  static constexpr unsigned int sketch_width = 1024;
+
+  // Sustained queries per second and burst size.
+  static constexpr unsigned int default_host_rate    = 10;
+  static constexpr unsigned int default_host_burst   = 50;
+  static constexpr unsigned int default_prefix_rate  = 50;
+  static constexpr unsigned int default_prefix_burst = 250;
+
+  DhtRateLimiter();
+
+  // Returns false if the source is over its limit, otherwise uses a token.
+  bool                admit(const sockaddr* sa);
+
+  void                set_host_limit(unsigned int rate, unsigned int burst)   { m_host.set_limit(rate, burst); }
+  void                set_prefix_limit(unsigned int rate, unsigned int burst) { m_prefix.set_limit(rate, burst); }
+
+  void                clear();
+
+private:
+  class sketch {
+  public:
+    sketch(unsigned int rate, unsigned int burst);
+
+    void              set_limit(unsigned int rate, unsigned int burst);
+
+    bool              has_token(uint64_t key) const;
+    void              use_token(uint64_t key);
+    void              drain(int64_t seconds);
+    void              clear()                    { m_cells = {}; }
+
+  private:
+    using row_type = std::array<uint16_t, sketch_width>;
+
+    unsigned int      position(unsigned int row, uint64_t key) const;
+
+    unsigned int      m_rate;
+    unsigned int      m_burst;
+
+    std::array<uint64_t, sketch_depth> m_seeds;
+    std::array<row_type, sketch_depth> m_cells{};
+  };
+
+  void                update_time();
+
+  sketch              m_host{default_host_rate, default_host_burst};
+  sketch              m_prefix{default_prefix_rate, default_prefix_burst};
+
+  int64_t             m_last_drain;
+};
+
+} // namespace torrent
+
+#endif
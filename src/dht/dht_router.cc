@@ -2,7 +2,9 @@
 
 #include "dht_router.h"
 
+#include <algorithm>
 #include <cassert>
+#include <tuple>
 
 #include "dht_bucket.h"
 #include "dht_tracker.h"
@@ -20,13 +22,24 @@
 
 namespace torrent {
 
+namespace {
+
+// Good nodes first, then by round trip time with unknown ones last.
+bool
+cache_order(const DhtNode* a, const DhtNode* b) {
+  return std::make_tuple(!a->is_good(), a->rtt() == 0, a->rtt()) < std::make_tuple(!b->is_good(), b->rtt() == 0, b->rtt());
+}
+
+} // namespace
+
 HashString DhtRouter::zero_id;
 
-DhtRouter::DhtRouter(const Object& cache)
-  : DhtNode(zero_id, sa_make_inet_any().get()), // actual ID is set later
+DhtRouter::DhtRouter(const Object& cache, int family, const HashString* self_id)
+  : DhtNode(zero_id, (family == AF_INET6 ? sa_make_inet6_any() : sa_make_inet_any()).get()), // actual ID is set later
+    m_family(family),
     m_server(this),
-    m_curToken(random()),
-    m_prevToken(random()),
+    m_curToken(random_token_key()),
+    m_prevToken(random_token_key()),
     m_resolver_callback_id(system::make_callback_id()) {
 
   HashString ones_id;
@@ -34,7 +47,13 @@ DhtRouter::DhtRouter(const Object& cache)
   zero_id.clear();
   ones_id.clear(0xFF);
 
-  if (cache.has_key("self_id")) {
+  if (family != AF_INET && family != AF_INET6)
+    throw internal_error("DhtRouter::DhtRouter() called with non-inet/inet6 family.");
+
+  if (self_id != nullptr) {
+    assign(self_id->data());
+
+  } else if (cache.has_key("self_id")) {
     const std::string& id = cache.get_key_string("self_id");
 
     if (id.length() != HashString::size_data)
@@ -58,26 +77,29 @@ DhtRouter::DhtRouter(const Object& cache)
 
   set_bucket(new DhtBucket(zero_id, ones_id));
 
-  m_routingTable.emplace(bucket()->id_range_end(), bucket());
+  m_routingTable.push_back(bucket());
 
-  if (cache.has_key("nodes")) {
-    const Object::map_type& nodes = cache.get_key_map("nodes");
+  if (cache.has_key_string(cache_key_routing_table()))
+    load_routing_table(cache.get_key_string(cache_key_routing_table()));
+  else if (cache.has_key(cache_key_nodes()))
+    load_nodes(cache.get_key_map(cache_key_nodes()));
 
-    LT_LOG_THIS("adding nodes : size:%zu", nodes.size());
+  // Cached nodes are pinged when starting, in cache order.
+  std::vector<const DhtNode*> cached;
 
-    for (const auto& [id, node] : nodes) {
-      if (id.length() != HashString::size_data)
-        throw bencode_error("Loading cache: Invalid node hash.");
+  for (auto b : m_routingTable)
+    for (const auto& node : *b)
+      cached.push_back(&node);
 
-      add_node_to_bucket(m_nodes.add_node(new DhtNode(id, node)));
-    }
-  }
+  std::sort(cached.begin(), cached.end(), cache_order);
+
+  std::for_each(cached.rbegin(), cached.rend(), [this](const DhtNode* node) { m_warm_start.push_back(node->id()); });
 
-  if (m_nodes.size() < num_bootstrap_complete) {
+  if (num_nodes() < num_bootstrap_complete) {
     m_contacts.emplace();
 
-    if (cache.has_key("contacts")) {
-      for (const auto& contact : cache.get_key_list("contacts")) {
+    if (cache.has_key(cache_key_contacts())) {
+      for (const auto& contact : cache.get_key_list(cache_key_contacts())) {
         auto litr = contact.as_list().begin();
         auto host = litr->as_string();
         auto port = std::next(litr)->as_value();
@@ -91,14 +113,8 @@ DhtRouter::DhtRouter(const Object& cache)
 DhtRouter::~DhtRouter() {
   assert(!is_active() && "DhtRouter::~DhtRouter() called while still active.");
 
-  for (auto& route : m_routingTable)
-    delete route.second;
-
-  for (auto& tracker : m_trackers)
-    delete tracker.second;
-
-  for (auto& node : m_nodes)
-    delete node.second;
+  for (auto bucket : m_routingTable)
+    delete bucket;
 }
 
 void
@@ -107,6 +123,14 @@ DhtRouter::start(int port) {
 
   m_server.start(port);
 
+  // Nodes loaded from the cache are pinged right away, in batches, before bootstrapping.
+  if (!m_warm_start.empty()) {
+    m_task_timeout.slot() = [this] { receive_timeout_warm_start(); };
+
+    this_thread::scheduler()->wait_for(&m_task_timeout, 0s);
+    return;
+  }
+
   // Set timeout slot and schedule it to be called immediately for initial bootstrapping if
   // necessary.
   m_task_timeout.slot() = [this] { receive_timeout_bootstrap(); };
@@ -129,8 +153,8 @@ DhtRouter::stop() {
 
 // Start a DHT get_peers and announce_peer request.
 void
-DhtRouter::announce(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker) {
-  m_server.announce(*find_bucket(info_hash)->second, info_hash, tracker);
+DhtRouter::announce(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker, bool report_status) {
+  m_server.announce(info_hash, tracker, report_status);
 }
 
 // Cancel any running requests from the given tracker.
@@ -140,22 +164,9 @@ DhtRouter::cancel_announce(const HashString& info_hash, std::weak_ptr<TrackerDht
   m_server.cancel_announce(info_hash, tracker);
 }
 
-DhtTracker*
-DhtRouter::get_tracker(const HashString& hash, bool create) {
-  auto itr = m_trackers.find(hash);
-
-  if (itr != m_trackers.end())
-    return itr->second;
-
-  if (!create)
-    return NULL;
-
-  auto [tr, inserted] = m_trackers.emplace(hash, new DhtTracker());
-
-  if (!inserted)
-    throw internal_error("DhtRouter::get_tracker did not actually insert tracker.");
-
-  return tr->second;
+void
+DhtRouter::add_peer(const HashString& hash, const sockaddr* sa, uint16_t port, bool seed) {
+  m_peerStore.add_peer(hash, sa, port, seed);
 }
 
 bool
@@ -167,37 +178,41 @@ DhtRouter::want_node(const HashString& id) {
 
   // We are always interested in more nodes for our own bucket (causing it
   // to be split if full); in other buckets only if there's space.
-  DhtBucket* b = find_bucket(id)->second;
+  DhtBucket* b = find_bucket(id);
   return b == bucket() || b->has_space();
 }
 
 DhtNode*
 DhtRouter::get_node(const HashString& id) {
-  DhtNodeList::accessor itr = m_nodes.find(&id);
+  if (id == this->id())
+    return this;
 
-  if (itr == m_nodes.end()) {
-    if (id == this->id())
-      return this;
-    else
-      return NULL;
-  }
+  DhtBucket* b   = find_bucket(id);
+  auto       itr = b->find(id);
 
-  return itr.node();
+  return itr != b->end() ? itr : NULL;
 }
 
-DhtRouter::DhtBucketList::iterator
-DhtRouter::find_bucket(const HashString& id) {
-  auto itr = m_routingTable.lower_bound(id);
+unsigned int
+DhtRouter::bucket_index(const HashString& id) const {
+  unsigned int index = std::min<size_t>(dht_prefix_length(id, this->id()), m_routingTable.size() - 1);
 
 #ifdef USE_EXTRA_DEBUG
-  if (itr == m_routingTable.end())
-    throw internal_error("DHT Buckets not covering entire ID space.");
-
-  if (!itr->second->is_in_range(id))
-    throw internal_error("DhtRouter::find_bucket, m_routingTable.lower_bound did not find correct bucket.");
+  if (!m_routingTable[index]->is_in_range(id))
+    throw internal_error("DhtRouter::bucket_index did not find correct bucket.");
 #endif
 
-  return itr;
+  return index;
+}
+
+size_t
+DhtRouter::num_nodes() const {
+  size_t count = 0;
+
+  for (auto b : m_routingTable)
+    count += b->size();
+
+  return count;
 }
 
 void
@@ -227,8 +242,8 @@ DhtRouter::contact(const sockaddr* sa, int port) {
   if (sa_tmp->sa_family != AF_INET && sa_tmp->sa_family != AF_INET6)
     throw input_error("DhtRouter::contact() called with non-inet/inet6 address.");
 
-  // Currently only IPv4 is supported.
-  if (sa_tmp->sa_family != AF_INET)
+  // Nodes of the other family are contacted by the other router.
+  if (sa_tmp->sa_family != m_family)
     return;
 
   if (sap_is_any(sa_tmp)) {
@@ -283,9 +298,9 @@ DhtRouter::node_replied(const HashString& id, const sockaddr* sa) {
       return NULL;
 
     // New node, create it. It's a good node (it replied!) so add it to a bucket.
-    node = m_nodes.add_node(new DhtNode(id, sa));
+    node = insert_node(DhtNode(id, sa));
 
-    if (!add_node_to_bucket(node))   // deletes the node if it fails
+    if (node == NULL)
       return NULL;
   }
 
@@ -301,30 +316,31 @@ DhtRouter::node_replied(const HashString& id, const sockaddr* sa) {
 // A node has not replied to one of our queries.
 DhtNode*
 DhtRouter::node_inactive(const HashString& id, const sockaddr* sa) {
-  DhtNodeList::accessor itr = m_nodes.find(&id);
+  DhtBucket* b   = find_bucket(id);
+  auto       itr = b->find(id);
 
   // If not found add it to some blacklist so we won't try contacting it again immediately?
-  if (itr == m_nodes.end())
+  if (itr == b->end())
     return NULL;
 
   // Check source address. Normally node_inactive is called if we DON'T receive a reply,
   // however it can also be called if a node replied with an malformed response packet,
   // so check that the address matches so that a rogue node cannot cause other nodes
   // to be considered bad by sending malformed packets.
-  if (!sa_equal_addr(itr.node()->address(), sa))
+  if (!sa_equal_addr(itr->address(), sa))
     return NULL;
 
-  itr.node()->inactive();
+  itr->inactive();
 
   // Old node age normally implies no replies for many consecutive queries, however
   // after loading the node cache after a day or more we want to give each node a few
   // chances to reply again instead of removing all nodes instantly.
-  if (itr.node()->is_bad() && itr.node()->age() >= timeout_remove_node) {
-    delete_node(itr);
+  if (itr->is_bad() && itr->age() >= timeout_remove_node) {
+    b->remove_node(itr);
     return NULL;
   }
 
-  return itr.node();
+  return itr;
 }
 
 // We sent a query to the given node ID, but received a reply from a different
@@ -336,7 +352,7 @@ DhtRouter::node_invalid(const HashString& id) {
   if (node == NULL || node == this)
     return;
 
-  delete_node(m_nodes.find(&node->id()));
+  node->bucket()->remove_node(node);
 }
 
 Object*
@@ -344,15 +360,42 @@ DhtRouter::store_cache(Object* container) const {
   container->insert_key("self_id", str());
 
   // Insert all nodes.
-  Object& nodes = container->insert_key("nodes", Object::create_map());
-  for (const auto& [id, node] : m_nodes) {
-    if (!node->is_bad())
-      node->store_cache(&nodes.insert_key(id->str(), Object::create_map()));
+  char        buffer[DhtNode::size_cache6];
+  std::string table(1, routing_table_version);
+
+  table.reserve(1 + num_nodes() * (m_family == AF_INET6 ? DhtNode::size_cache6 : DhtNode::size_cache));
+
+  for (auto b : m_routingTable) {
+    for (const auto& node : *b) {
+      if (!node.is_bad())
+        table.append(buffer, node.store_cache(buffer));
+    }
+  }
+
+  container->insert_key(cache_key_routing_table(), std::move(table));
+
+  // Older releases only read IPv4 nodes from "nodes", and newer ones prefer the routing table.
+  if (m_family == AF_INET) {
+    std::vector<const DhtNode*> legacy;
+
+    for (auto b : m_routingTable)
+      for (const auto& node : *b)
+        if (!node.is_bad())
+          legacy.push_back(&node);
+
+    auto last = legacy.begin() + std::min<size_t>(legacy.size(), num_legacy_cache_nodes);
+    std::partial_sort(legacy.begin(), last, legacy.end(), cache_order);
+
+    Object& nodes = container->insert_key(cache_key_nodes(), Object::create_map());
+
+    std::for_each(legacy.begin(), last, [&nodes](const DhtNode* node) {
+        node->store_cache_legacy(&nodes.insert_key(node->str(), Object::create_map()));
+      });
   }
 
   // Insert contacts, if we have any.
   if (m_contacts.has_value()) {
-    Object& contacts = container->insert_key("contacts", Object::create_list());
+    Object& contacts = container->insert_key(cache_key_contacts(), Object::create_list());
 
     for (const auto& m_contact : *m_contacts) {
       Object::list_type& list = contacts.insert_back(Object::create_list()).as_list();
@@ -364,6 +407,45 @@ DhtRouter::store_cache(Object* container) const {
   return container;
 }
 
+// A routing table of an unknown version is ignored, as if there was no cache.
+void
+DhtRouter::load_routing_table(const std::string& table) {
+  unsigned int node_size = m_family == AF_INET6 ? DhtNode::size_cache6 : DhtNode::size_cache;
+
+  if (table.empty() || table[0] != routing_table_version) {
+    LT_LOG_THIS("ignoring routing table : key:%s unknown version", cache_key_routing_table());
+    return;
+  }
+
+  if ((table.size() - 1) % node_size != 0)
+    throw bencode_error("Loading cache: Invalid routing table size.");
+
+  LT_LOG_THIS("adding nodes : key:%s size:%zu", cache_key_routing_table(), (table.size() - 1) / node_size);
+
+  for (const char* itr = table.data() + 1; itr != table.data() + table.size(); itr += node_size)
+    insert_node(DhtNode(itr, m_family));
+}
+
+void
+DhtRouter::load_nodes(const Object::map_type& nodes) {
+  LT_LOG_THIS("adding nodes : key:%s size:%zu", cache_key_nodes(), nodes.size());
+
+  for (const auto& [id, node] : nodes) {
+    if (id.length() != HashString::size_data)
+      throw bencode_error("Loading cache: Invalid node hash.");
+
+    DhtNode cached(id, node);
+
+    if (cached.address()->sa_family == m_family)
+      insert_node(cached);
+  }
+}
+
+size_t
+DhtRouter::memory_usage() const {
+  return m_routingTable.capacity() * sizeof(DhtBucket*) + m_routingTable.size() * sizeof(DhtBucket) + m_peerStore.memory_usage();
+}
+
 tracker::DhtController::statistics_type
 DhtRouter::get_statistics() const {
   tracker::DhtController::statistics_type stats;
@@ -380,19 +462,20 @@ DhtRouter::get_statistics() const {
   stats.replies_received = m_server.replies_received();
   stats.errors_received  = m_server.errors_received();
   stats.errors_caught    = m_server.errors_caught();
+  stats.queries_dropped  = m_server.queries_dropped();
+  stats.peers_received   = m_server.peers_received();
 
-  stats.num_nodes        = m_nodes.size();
+  stats.num_nodes        = num_nodes();
   stats.num_buckets      = m_routingTable.size();
 
-  stats.num_peers        = 0;
+  stats.num_peers        = m_peerStore.num_peers();
   stats.max_peers        = 0;
-  stats.num_trackers     = m_trackers.size();
+  stats.num_trackers     = m_peerStore.size();
+  stats.memory_usage     = memory_usage();
 
-  for (const auto& [_, tracker] : m_trackers) {
-    unsigned int peers = tracker->size();
-    stats.num_peers += peers;
-    stats.max_peers = std::max(peers, stats.max_peers);
-  }
+  m_peerStore.for_each([&stats](const DhtTracker& tracker) {
+      stats.max_peers = std::max<unsigned int>(tracker.size(), stats.max_peers);
+    });
 
   return stats;
 }
@@ -403,11 +486,11 @@ DhtRouter::receive_timeout_bootstrap() {
   // we have enough nodes in our routing table. After we have 32 nodes, we switch
   // to a less aggressive non-bootstrap mode of collecting nodes that contact us
   // and through doing normal torrent announces.
-  if (m_nodes.size() < num_bootstrap_complete) {
+  if (num_nodes() < num_bootstrap_complete) {
     if (!m_contacts.has_value())
       throw internal_error("DhtRouter::receive_timeout_bootstrap called without contact list.");
 
-    if (!m_nodes.empty() || !m_contacts->empty())
+    if (num_nodes() != 0 || !m_contacts->empty())
       bootstrap();
 
     // Retry in 60 seconds.
@@ -434,72 +517,89 @@ DhtRouter::receive_timeout_bootstrap() {
   }
 }
 
+void
+DhtRouter::receive_timeout_warm_start() {
+  unsigned int count = 0;
+
+  while (count != num_warm_start_batch && !m_warm_start.empty()) {
+    DhtNode* node = get_node(m_warm_start.back());
+    m_warm_start.pop_back();
+
+    // The node may have been replaced since the cache was loaded.
+    if (node == nullptr || node == this)
+      continue;
+
+    m_server.ping(node->id(), node->address());
+    count++;
+  }
+
+  if (!m_warm_start.empty()) {
+    this_thread::scheduler()->wait_for(&m_task_timeout, warm_start_interval);
+    return;
+  }
+
+  m_task_timeout.slot() = [this] { receive_timeout_bootstrap(); };
+
+  this_thread::scheduler()->wait_for_ceil_seconds(&m_task_timeout, 1s);
+}
+
 void
 DhtRouter::receive_timeout() {
   this_thread::scheduler()->wait_for_ceil_seconds(&m_task_timeout, std::chrono::seconds(timeout_update));
 
   m_prevToken = m_curToken;
-  m_curToken = random();
+  m_curToken = random_token_key();
 
   // Do some periodic accounting, refreshing buckets and marking
   // bad nodes.
 
   // Update nodes.
-  for (const auto& [id, node] : m_nodes) {
-    if (!node->bucket())
-      throw internal_error("DhtRouter::receive_timeout has node without bucket.");
-
-    node->update();
-
-    // Try contacting nodes we haven't received anything from for a while.
-    // Don't contact repeatedly unresponsive nodes; we keep them in case they
-    // do send a query, until we find a better node. However, give it a last
-    // chance just before deleting it.
-    if (node->is_questionable() && (!node->is_bad() || node->age() >= timeout_remove_node))
-      m_server.ping(node->id(), node->address());
+  for (auto b : m_routingTable) {
+    for (auto& node : *b) {
+      node.update();
+
+      // Try contacting nodes we haven't received anything from for a while.
+      // Don't contact repeatedly unresponsive nodes; we keep them in case they
+      // do send a query, until we find a better node. However, give it a last
+      // chance just before deleting it.
+      if (node.is_questionable() && (!node.is_bad() || node.age() >= timeout_remove_node))
+        m_server.ping(node.id(), node.address());
+    }
   }
 
   // If bucket isn't full yet or hasn't received replies/queries from
   // its nodes for a while, try to find new nodes now.
-  for (const auto& route : m_routingTable) {
-    route.second->update();
+  for (auto b : m_routingTable) {
+    b->update();
 
-    if (!route.second->is_full() || route.second == bucket() || route.second->age() > timeout_bucket_bootstrap)
-      bootstrap_bucket(route.second);
+    if (!b->is_full() || b == bucket() || b->age() > timeout_bucket_bootstrap)
+      bootstrap_bucket(b);
   }
 
   // Remove old peers and empty torrents from the tracker.
-  for (auto itr = m_trackers.begin(); itr != m_trackers.end();) {
-    auto tracker = itr->second;
-    tracker->prune(timeout_peer_announce);
-
-    if (tracker->empty()) {
-      delete tracker;
-      itr = m_trackers.erase(itr);
-      continue;
-    }
-    ++itr;
-  }
+  m_peerStore.prune(timeout_peer_announce);
 
   m_server.update();
 
   m_numRefresh++;
 }
 
-char*
-DhtRouter::generate_token(const sockaddr* sa, int token, char buffer[20]) {
-  if (!sa_is_inet(sa))
-    throw internal_error("DhtRouter::generate_token called with non-inet address.");
+uint64_t
+DhtRouter::generate_token(const sockaddr* sa, const siphash_key& key) {
+  if (sa_is_inet(sa))
+    return siphash24(key, &reinterpret_cast<const sockaddr_in*>(sa)->sin_addr, sizeof(in_addr));
 
-  uint32_t key = reinterpret_cast<const sockaddr_in*>(sa)->sin_addr.s_addr;
+  if (sa_is_inet6(sa))
+    return siphash24(key, &reinterpret_cast<const sockaddr_in6*>(sa)->sin6_addr, sizeof(in6_addr));
+
+  throw internal_error("DhtRouter::generate_token called with non-inet/inet6 address.");
+}
 
-  Sha1 sha;
-  sha.init();
-  sha.update(&token, sizeof(token));
-  sha.update(&key, 4);
-  sha.final_c(buffer);
+siphash_key
+DhtRouter::random_token_key() {
+  auto random_word = [] { return static_cast<uint64_t>(random()) << 32 ^ static_cast<uint64_t>(random()); };
 
-  return buffer;
+  return siphash_key{random_word(), random_word()};
 }
 
 bool
@@ -507,100 +607,138 @@ DhtRouter::token_valid(raw_string token, const sockaddr* sa) const {
   if (token.size() != size_token)
     return false;
 
-  // Compare given token to the reference token.
-  char reference[20];
+  uint64_t value;
+  std::memcpy(&value, token.data(), size_token);
 
   // First try current token.
   //
   // Else if token recently changed, some clients may be using the older one.
   // That way a token is valid for 15-30 minutes, instead of 0-15.
-  return
-    token == raw_string(generate_token(sa, m_curToken, reference), size_token) ||
-    token == raw_string(generate_token(sa, m_prevToken, reference), size_token);
+  return value == generate_token(sa, m_curToken) || value == generate_token(sa, m_prevToken);
 }
 
 DhtNode*
 DhtRouter::find_node(const sockaddr* sa) {
-  for (const auto& [id, node] : m_nodes) {
-    if (sa_equal_addr(node->address(), sa))
-      return node;
+  for (auto b : m_routingTable) {
+    for (auto& node : *b) {
+      if (sa_equal_addr(node.address(), sa))
+        return &node;
+    }
   }
 
   return nullptr;
 }
 
-DhtRouter::DhtBucketList::iterator
-DhtRouter::split_bucket(const DhtBucketList::iterator& itr, DhtNode* node) {
-  // Split bucket. Current bucket keeps the upper half thus keeping the
-  // map key valid, new bucket is the lower half of the original bucket.
-  DhtBucket* newBucket = itr->second->split(id());
+// Nodes in the bucket of the ID share more leading bits with it than any
+// other node. Nodes in the deeper buckets all first differ from the ID at the
+// same bit, and each bucket before it is farther away than the next, so only
+// the buckets needed to fill the result have to be looked at.
+raw_string
+DhtRouter::get_closest_nodes(const HashString& id, char* buffer) const {
+  const DhtNode* closest[DhtBucket::num_nodes];
+  unsigned int   size = 0;
+
+  auto add_bucket = [&](const DhtBucket* b) {
+    for (const auto& node : *b) {
+      if (node.is_bad())
+        continue;
+
+      unsigned int pos = size;
+
+      while (pos != 0 && dht::DhtSearch::is_closer(node.id(), closest[pos - 1]->id(), id))
+        pos--;
+
+      if (pos == DhtBucket::num_nodes)
+        continue;
+
+      if (size != DhtBucket::num_nodes)
+        size++;
+
+      std::move_backward(closest + pos, closest + size - 1, closest + size);
+      closest[pos] = &node;
+    }
+  };
+
+  unsigned int index = bucket_index(id);
+
+  add_bucket(m_routingTable[index]);
+
+  // The deeper buckets are not ordered relative to each other.
+  if (size != DhtBucket::num_nodes) {
+    for (unsigned int i = index + 1; i < m_routingTable.size(); i++)
+      add_bucket(m_routingTable[i]);
+  }
+
+  for (unsigned int i = index; i-- != 0 && size != DhtBucket::num_nodes; )
+    add_bucket(m_routingTable[i]);
+
+  char* pos = buffer;
+
+  for (unsigned int i = 0; i != size; i++)
+    pos = closest[i]->store_compact(pos);
+
+  return raw_string(buffer, pos - buffer);
+}
+
+DhtBucket*
+DhtRouter::split_bucket(const HashString& id) {
+  // Split bucket. Current bucket keeps the upper half, new bucket is the
+  // lower half of the original bucket.
+  bucket()->split(this->id());
 
   // If our bucket has a child now (the new bucket), move ourself into it.
   if (bucket()->child() != NULL)
     set_bucket(bucket()->child());
 
-  if (!bucket()->is_in_range(id()))
+  if (!bucket()->is_in_range(this->id()))
     throw internal_error("DhtRouter::split_bucket router ID ended up in wrong bucket.");
 
-  // Insert new bucket with iterator hint = just before current bucket.
-  auto other = m_routingTable.emplace_hint(itr, newBucket->id_range_end(), newBucket);
+  // The half without our ID keeps the prefix length of the old bucket, and
+  // our own bucket moves one level deeper.
+  DhtBucket* other = bucket()->parent();
 
-  // Check that the bucket we're not adding the node to isn't empty.
-  if (other->second->is_in_range(node->id())) {
-    if (itr->second->empty())
-      bootstrap_bucket(itr->second);
+  m_routingTable.back() = other;
+  m_routingTable.push_back(bucket());
 
-  } else {
-    if (other->second->empty())
-      bootstrap_bucket(other->second);
+  // Check that the bucket we're not adding the node to isn't empty.
+  if (other->is_in_range(id)) {
+    if (bucket()->empty())
+      bootstrap_bucket(bucket());
 
-    other = itr;
+    return other;
   }
 
-  return other;
+  if (other->empty())
+    bootstrap_bucket(other);
+
+  return bucket();
 }
 
-bool
-DhtRouter::add_node_to_bucket(DhtNode* node) {
-  auto itr = find_bucket(node->id());
+DhtNode*
+DhtRouter::insert_node(const DhtNode& node) {
+  DhtBucket* b = find_bucket(node.id());
 
-  while (itr->second->is_full()) {
+  while (b->is_full()) {
     // Bucket is full. If there are any bad nodes, remove the oldest.
-    DhtBucket::iterator nodeItr = itr->second->find_replacement_candidate();
-    if (nodeItr == itr->second->end())
+    auto candidate = b->find_replacement_candidate();
+
+    if (candidate == b->end())
       throw internal_error("DhtBucket::find_candidate returned no node.");
 
-    if ((*nodeItr)->is_bad()) {
-      delete_node(m_nodes.find(&(*nodeItr)->id()));
+    if (candidate->is_bad()) {
+      b->remove_node(candidate);
 
     } else {
       // Bucket is full of good nodes; if our own ID falls in
       // range then split the bucket else discard new node.
-      if (itr->second != bucket()) {
-        delete_node(m_nodes.find(&node->id()));
-        return false;
-      }
+      if (b != bucket())
+        return NULL;
 
-      itr = split_bucket(itr, node);
+      b = split_bucket(node.id());
     }
   }
 
-  itr->second->add_node(node);
-  node->set_bucket(itr->second);
-  return true;
-}
-
-void
-DhtRouter::delete_node(const DhtNodeList::accessor& itr) {
-  if (itr == m_nodes.end())
-    throw internal_error("DhtRouter::delete_node called with invalid iterator.");
-
-  if (itr.node()->bucket() != NULL)
-    itr.node()->bucket()->remove_node(itr.node());
-
-  delete itr.node();
-
-  m_nodes.erase(itr);
+  return b->add_node(node);
 }
 
 void
@@ -618,33 +756,32 @@ DhtRouter::bootstrap() {
         contact(sa.get(), port);
     };
 
-    this_thread::resolver()->resolve_specific(m_resolver_callback_id, m_contacts->back().first, AF_INET, f);
+    this_thread::resolver()->resolve_specific(m_resolver_callback_id, m_contacts->back().first, m_family, f);
 
     m_contacts->pop_back();
   }
 
   // Abort unless we already found some nodes for a search.
-  if (m_nodes.empty())
+  if (num_nodes() == 0)
     return;
 
   bootstrap_bucket(bucket());
 
   // Aggressively ping all questionable nodes in our own bucket to weed
   // out bad nodes as early as possible and make room for fresh nodes.
-  for (auto node : *bucket()) {
-    if (!node->is_good())
-      m_server.ping(node->id(), node->address());
+  for (const auto& node : *bucket()) {
+    if (!node.is_good())
+      m_server.ping(node.id(), node.address());
   }
 
   // Also bootstrap a random bucket, if there are others.
   if (m_routingTable.size() < 2)
     return;
 
-  auto itr = m_routingTable.begin();
-  std::advance(itr, random() % m_routingTable.size());
+  DhtBucket* b = m_routingTable[random() % m_routingTable.size()];
 
-  if (itr->second != bucket() && itr != m_routingTable.end())
-    bootstrap_bucket(itr->second);
+  if (b != bucket())
+    bootstrap_bucket(b);
 }
 
 void
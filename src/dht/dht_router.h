@@ -1,29 +1,48 @@
 #ifndef LIBTORRENT_DHT_DHT_ROUTER_H
 #define LIBTORRENT_DHT_DHT_ROUTER_H
 
+#include "dht/dht_bucket.h"
 #include "dht/dht_node.h"
-#include "dht/dht_hash_map.h"
+#include "dht/dht_peer_store.h"
 #include "dht/dht_server.h"
 #include "torrent/hash_string.h"
 #include "torrent/object.h"
 #include "torrent/net/types.h"
 #include "torrent/system/scheduler.h"
 #include "torrent/tracker/dht_controller.h"
+#include "utils/siphash.h"
 
+#include <chrono>
+#include <cstring>
 #include <optional>
+#include <vector>
 
 namespace torrent {
 
-class DhtBucket;
 class DhtTracker;
 class TrackerDht;
 
 // Main DHT class, maintains the routing table of known nodes and talks to the
 // DhtServer object that handles the actual communication.
+//
+// Each router handles a single address family. For BEP 32 the IPv6 DHT is a
+// second router with the same node ID, its own routing table, peer store and
+// server socket, caching its nodes under "routing_table6" and "contacts6".
+//
+// The routing table is a vector of buckets indexed by the length of the prefix
+// a node ID has in common with ours, the last bucket being our own bucket
+// which holds all nodes with longer prefixes. Finding the bucket of an ID is a
+// single XOR and count of leading zeros.
+//
+// The routing table is cached as a single binary string of fixed size records,
+// holding each node's compact info, last seen time and round trip time. The
+// per node "nodes" map of older versions is still read. Cached nodes are pinged
+// in paced batches when starting, lowest round trip time first.
 
 class DhtRouter : public DhtNode {
 public:
-  // How many bytes to return and verify from the 20-byte SHA token.
+  // Tokens are the 8-byte SipHash-2-4 of the node's address, keyed by a secret
+  // that is replaced every 15 minutes.
   static constexpr unsigned int size_token = 8;
 
   static constexpr unsigned int timeout_bootstrap_retry  =          60;  // Retry initial bootstrapping every minute.
@@ -32,23 +51,39 @@ public:
   static constexpr unsigned int timeout_remove_node      = 4 * 60 * 60;  // Remove unresponsive nodes after 4 hours.
   static constexpr unsigned int timeout_peer_announce    =     30 * 60;  // Remove peers which haven't reannounced for 30 minutes.
 
+  // Cached nodes pinged per batch when starting, and the time between batches.
+  static constexpr unsigned int              num_warm_start_batch = 16;
+  static constexpr std::chrono::milliseconds warm_start_interval{100};
+
   // A node ID of all zero.
   static HashString zero_id;
 
-  DhtRouter(const Object& cache);
+  // If 'self_id' is not NULL it overrides the ID in the cache, used to give the
+  // IPv6 router the same ID as the IPv4 router.
+  DhtRouter(const Object& cache, int family = AF_INET, const HashString* self_id = nullptr);
   ~DhtRouter();
 
+  int                 family() const                     { return m_family; }
+
   void                start(int port);
   void                stop();
 
   bool                is_active()                        { return m_server.is_active(); }
 
+  DhtServer*          server()                           { return &m_server; }
+
   // Pass NULL to cancel_announce to cancel all announces for the tracker.
-  void                announce(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker);
+  //
+  // Only announces with 'report_status' set report progress and the result to
+  // the tracker, found peers are always passed on.
+  void                announce(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker, bool report_status = true);
   void                cancel_announce(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker);
 
-  // Returns NULL if not tracking the torrent unless create is true.
-  DhtTracker*         get_tracker(const HashString& hash, bool create);
+  // Returns NULL if not tracking the torrent.
+  DhtTracker*         get_tracker(const HashString& hash)  { return m_peerStore.find(hash); }
+  void                add_peer(const HashString& hash, const sockaddr* sa, uint16_t port, bool seed);
+
+  DhtPeerStore*       peer_store()                       { return &m_peerStore; }
 
   // Check if we are interested in inserting a new node of the given ID
   // into our table (i.e. if we have space or bad nodes in the corresponding bucket).
@@ -64,11 +99,17 @@ public:
 
   // Retrieve node of given ID in constant time. Return NULL if not found, unless
   // it's our own ID in which case it returns the DhtRouter object.
+  //
+  // Nodes are stored in their bucket, so the pointer is only valid until the
+  // routing table is next modified.
   DhtNode*            get_node(const HashString& id);
 
   // Search for node with given address in O(n), disregarding the port.
   DhtNode*            find_node(const sockaddr* sa);
 
+  // The bucket the given ID falls in.
+  DhtBucket*          find_bucket(const HashString& id) const  { return m_routingTable[bucket_index(id)]; }
+
   // Whenever a node queries us, replies, or is confirmed inactive (no reply) or
   // invalid (reply with wrong ID), we need to update its status.
   DhtNode*            node_queried(const HashString& id, const sockaddr* sa);
@@ -76,14 +117,22 @@ public:
   DhtNode*            node_inactive(const HashString& id, const sockaddr* sa);
   void                node_invalid(const HashString& id);
 
-  // Store compact node information (26 bytes) for nodes closest to the
-  // given ID in the given buffer, return new buffer end.
-  raw_string          get_closest_nodes(const HashString& id)  { return find_bucket(id)->second->full_bucket(); }
+  // Store compact node information (26 bytes, or 38 bytes for IPv6) for the up
+  // to 8 good or questionable nodes closest to the given ID in the buffer, which
+  // must hold size_closest_nodes, or size_closest_nodes6, bytes.
+  static constexpr unsigned int size_closest_nodes  = DhtBucket::num_nodes * DhtNode::size_compact;
+  static constexpr unsigned int size_closest_nodes6 = DhtBucket::num_nodes * DhtNode::size_compact6;
+
+  raw_string          get_closest_nodes(const HashString& id, char* buffer) const;
 
   // Store DHT cache in the given container.
   Object*             store_cache(Object* container) const;
 
-  // Create and verify a token. Tokens are valid between 15-30 minutes from creation.
+  // Approximate heap memory used by the routing table and peer store.
+  size_t              memory_usage() const;
+
+  // Create and verify a token. Tokens are valid between 15-30 minutes from
+  // creation. The buffer must hold size_token bytes.
   raw_string          make_token(const sockaddr* sa, char* buffer) const;
   bool                token_valid(raw_string token, const sockaddr* sa) const;
 
@@ -100,50 +149,73 @@ private:
   // Maximum number of potential contacts to keep until bootstrap complete.
   static constexpr unsigned int num_bootstrap_contacts = 64;
 
-  using DhtBucketList = std::map<const HashString, DhtBucket*>;
+  // Format version, the first byte of the cached routing table.
+  static constexpr char routing_table_version = 1;
 
-  DhtBucketList::iterator find_bucket(const HashString& id);
+  // Nodes also cached under the old "nodes" key, so that downgrading to a release without the
+  // binary routing table keeps part of it. To be removed in the next release.
+  static constexpr unsigned int num_legacy_cache_nodes = 64;
 
-  bool                add_node_to_bucket(DhtNode* node);
-  void                delete_node(const DhtNodeList::accessor& itr);
+  using DhtBucketList = std::vector<DhtBucket*>;
 
-  void                store_closest_nodes(const HashString& id, DhtBucket* bucket);
+  unsigned int        bucket_index(const HashString& id) const;
 
-  DhtBucketList::iterator split_bucket(const DhtBucketList::iterator& itr, DhtNode* node);
+  size_t              num_nodes() const;
+
+  const char*         cache_key_routing_table() const { return m_family == AF_INET6 ? "routing_table6" : "routing_table"; }
+  const char*         cache_key_nodes() const     { return m_family == AF_INET6 ? "nodes6" : "nodes"; }
+  const char*         cache_key_contacts() const  { return m_family == AF_INET6 ? "contacts6" : "contacts"; }
+
+  void                load_routing_table(const std::string& table);
+  void                load_nodes(const Object::map_type& nodes);
+
+  // Returns the node as stored in its bucket, or NULL if there was no room.
+  DhtNode*            insert_node(const DhtNode& node);
+
+  // Splits our own bucket and returns the half the given ID falls in.
+  DhtBucket*          split_bucket(const HashString& id);
 
   void                bootstrap();
   void                bootstrap_bucket(const DhtBucket* bucket);
 
   void                receive_timeout();
   void                receive_timeout_bootstrap();
+  void                receive_timeout_warm_start();
 
-  // buffer needs to hold an SHA1 hash (20 bytes), not just the token (8 bytes)
-  static char*        generate_token(const sockaddr* sa, int token, char buffer[20]);
+  static uint64_t     generate_token(const sockaddr* sa, const siphash_key& key);
+  static siphash_key  random_token_key();
 
   system::SchedulerEntry m_task_timeout;
 
+  int                 m_family;
+
   DhtServer           m_server{nullptr};
-  DhtNodeList         m_nodes;
   DhtBucketList       m_routingTable;
-  DhtTrackerList      m_trackers;
+  DhtPeerStore        m_peerStore;
   HashString          m_contactId;
 
   std::optional<std::deque<contact_t>> m_contacts;
 
+  // Cached nodes not yet pinged, the next to ping last.
+  std::vector<HashString> m_warm_start;
+
   int                 m_numRefresh{0};
 
   bool                m_networkUp;
 
   // Secret keys used for generating announce tokens.
-  int                 m_curToken;
-  int                 m_prevToken;
+  siphash_key         m_curToken;
+  siphash_key         m_prevToken;
 
   system::callback_id m_resolver_callback_id;
 };
 
 inline raw_string
 DhtRouter::make_token(const sockaddr* sa, char* buffer) const {
-  return raw_string(generate_token(sa, m_curToken, buffer), size_token);
+  uint64_t token = generate_token(sa, m_curToken);
+  std::memcpy(buffer, &token, size_token);
+
+  return raw_string(buffer, size_token);
 }
 
 } // namespace torrent
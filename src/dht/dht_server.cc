@@ -20,6 +20,7 @@
 #include "torrent/runtime/runtime.h"
 #include "torrent/runtime/socket_manager.h"
 #include "torrent/system/poll.h"
+#include "torrent/utils/chrono.h"
 #include "torrent/utils/log.h"
 #include "tracker/tracker_dht.h"
 
@@ -54,6 +55,8 @@ const DhtMessage::key_list_type DhtMessage::base_type::keys = {
   { key_a_id,       "a::id*S" },
   { key_a_infoHash, "a::info_hash*S" },
   { key_a_port,     "a::port", },
+  { key_a_scrape,   "a::scrape" },
+  { key_a_seed,     "a::seed" },
   { key_a_target,   "a::target*S" },
   { key_a_token,    "a::token*S" },
 
@@ -62,8 +65,11 @@ const DhtMessage::key_list_type DhtMessage::base_type::keys = {
 
   { key_q,          "q*S" },
 
+  { key_r_BFpe,     "r::BFpe*S" },
+  { key_r_BFsd,     "r::BFsd*S" },
   { key_r_id,       "r::id*S" },
   { key_r_nodes,    "r::nodes*S" },
+  { key_r_nodes6,   "r::nodes6*S" },
   { key_r_token,    "r::token*S" },
   { key_r_values,   "r::values*L" },
 
@@ -79,33 +85,34 @@ DhtServer::DhtServer(DhtRouter* router)
   reset_statistics();
 
   m_task_timeout.slot() = [this] { receive_timeout(); };
+  m_task_announce.slot() = [this] { start_announces(); };
 }
 
 DhtServer::~DhtServer() {
   stop();
+
+  if (m_task_announce.is_scheduled())
+    this_thread::scheduler()->erase(&m_task_announce);
 }
 
 void
 DhtServer::start(int port) {
   auto [bind_inet_address, bind_inet6_address] = runtime::network_config()->bind_udp_addresses_or_null();
+  auto bind_family_address = is_inet6() ? bind_inet6_address : bind_inet_address;
 
-  if (bind_inet_address == nullptr)
+  if (bind_family_address == nullptr)
     throw resource_error("no valid bind address for DHT server");
 
   sa_unique_ptr bind_address;
 
-  switch (bind_inet_address->sa_family) {
-  case AF_INET:
-    bind_address = sa_copy(bind_inet_address.get());
-    break;
-  case AF_UNSPEC:
-    bind_address = sa_make_inet_any();
-    break;
-  default:
+  if (bind_family_address->sa_family == m_router->family())
+    bind_address = sa_copy(bind_family_address.get());
+  else if (bind_family_address->sa_family == AF_UNSPEC)
+    bind_address = is_inet6() ? sa_make_inet6_any() : sa_make_inet_any();
+  else
     throw resource_error("invalid address family for DHT server");
-  }
 
-  m_router->set_address(bind_inet_address.get());
+  m_router->set_address(bind_family_address.get());
   sap_set_port(bind_address, port);
 
   LT_LOG_THIS("starting server : %s", sap_pretty_str(bind_address).c_str());
@@ -114,6 +121,8 @@ DhtServer::start(int port) {
 
   if (bind_address->sa_family == AF_INET)
     open_flags |= fd_flag_v4;
+  else
+    open_flags |= fd_flag_v6only;
 
   int fd = fd_open(open_flags);
 
@@ -148,9 +157,12 @@ DhtServer::stop() {
 
   LT_LOG_THIS("searches : count:%zu", m_searches.size());
 
-  clear_transactions();
+  m_transactions.clear();
+  m_announceScheduler.clear();
+  clear_packets();
 
   this_thread::scheduler()->erase(&m_task_timeout);
+  this_thread::scheduler()->erase(&m_task_announce);
 
   runtime::socket_manager()->close_event_or_throw(this, [this]() {
       this_thread::poll()->remove_and_close(this);
@@ -169,6 +181,8 @@ DhtServer::reset_statistics() {
   m_repliesReceived = 0;
   m_errorsReceived = 0;
   m_errorsCaught = 0;
+  m_queriesDropped = 0;
+  m_peersReceived = 0;
 }
 
 // Ping a node whose ID we know.
@@ -178,10 +192,8 @@ DhtServer::ping(const HashString& id, const sockaddr* sa) {
     return;
 
   // No point pinging a node that we're already contacting otherwise.
-  auto itr = m_transactions.lower_bound(DhtTransaction::key(sa, 0));
-
-  if (itr == m_transactions.end() || !DhtTransaction::key_match(itr->first, sa))
-    add_transaction(std::unique_ptr<DhtTransaction>(new DhtTransactionPing(id, sa)), packet_prio_low);
+  if (!m_transactions.has_address(sa))
+    add_transaction<DhtTransactionPing>(packet_prio_low, id, sa);
 }
 
 // Contact nodes in given bucket and ask for their nodes closest to target.
@@ -193,7 +205,7 @@ DhtServer::find_node(const DhtBucket& contacts, const HashString& target) {
   auto n = search->get_contact();
 
   while (n != search->end()) {
-    add_transaction(std::unique_ptr<DhtTransaction>(new DhtTransactionFindNode(n)), packet_prio_low);
+    add_transaction<DhtTransactionFindNode>(packet_prio_low, n);
     n = search->get_contact();
   }
 
@@ -206,50 +218,71 @@ DhtServer::find_node(const DhtBucket& contacts, const HashString& target) {
 }
 
 void
-DhtServer::announce(const DhtBucket& contacts, const HashString& infoHash, std::weak_ptr<TrackerDht> tracker) {
-  auto announce = std::make_shared<dht::DhtAnnounce>(this, infoHash, tracker);
-  announce->add_contacts(contacts);
+DhtServer::announce(const HashString& infoHash, std::weak_ptr<TrackerDht> tracker, bool report_status) {
+  m_announceScheduler.push(infoHash, std::move(tracker), report_status);
+  start_announces();
+}
+
+// Start pending announces while the scheduler allows, checking again each second until the
+// queue is empty or a running announce completes.
+void
+DhtServer::start_announces() {
+  unsigned int active = num_active_announces();
+
+  while (m_announceScheduler.can_start(active))
+    active += start_announce(m_announceScheduler.pop());
+
+  if (!m_announceScheduler.empty() && !m_task_announce.is_scheduled())
+    this_thread::scheduler()->wait_for_ceil_seconds(&m_task_announce, 1s);
+}
+
+bool
+DhtServer::start_announce(DhtAnnounceScheduler::request_type request) {
+  auto announce = std::make_shared<dht::DhtAnnounce>(this, request.info_hash, std::move(request.tracker), request.report_status);
+  announce->add_contacts(*m_router->find_bucket(request.info_hash));
+
+  m_announceScheduler.seed(announce.get());
 
   auto n = announce->get_contact();
 
   while (n != announce->end()) {
-    add_transaction(std::unique_ptr<DhtTransaction>(new DhtTransactionFindNode(n)), packet_prio_high);
+    add_transaction<DhtTransactionFindNode>(packet_prio_high, n);
     n = announce->get_contact();
   }
 
   // This can only happen if all nodes we know are bad.
   if (!announce->start())
-    return;
-    // throw internal_error("DhtServer::announce search start failed, no contactable nodes.");  ///////////////// TMP
+    return false;
 
   m_searches.insert(announce);
   announce->update_status();
+  return true;
+}
+
+unsigned int
+DhtServer::num_active_announces() const {
+  return std::count_if(m_searches.begin(), m_searches.end(), [](const auto& search) { return search->is_announce(); });
 }
 
 void
 DhtServer::cancel_announce(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker) {
-  auto itr = m_transactions.begin();
+  m_announceScheduler.erase(info_hash, tracker);
 
   // TODO: Verify this removes us from m_searches.
 
-  while (itr != m_transactions.end()) {
-    if (itr->second->is_search() && itr->second->as_search()->search()->is_announce()) {
-      auto announce = dynamic_cast<dht::DhtAnnounce*>(itr->second->as_search()->search().get());
+  m_transactions.erase_if([&](DhtTransaction* transaction) {
+      if (!transaction->is_search() || !transaction->as_search()->search()->is_announce())
+        return false;
+
+      auto announce = dynamic_cast<dht::DhtAnnounce*>(transaction->as_search()->search().get());
 
       if (announce == nullptr)
         throw internal_error("DhtServer::cancel_announce dynamic_cast to DhtAnnounce failed.");
 
       bool tracker_match = !tracker.owner_before(announce->tracker()) && !announce->tracker().owner_before(tracker);
 
-      if (announce->target() == info_hash && (tracker.expired() || tracker_match)) {
-        drop_packet(itr->second->packet().get());
-        m_transactions.erase(itr++);
-        continue;
-      }
-    }
-
-    ++itr;
-  }
+      return announce->target() == info_hash && (tracker.expired() || tracker_match);
+    });
 }
 
 void
@@ -275,6 +308,11 @@ DhtServer::check_search_completed(std::shared_ptr<dht::DhtSearch> search) {
   // TODO: Verify we got ref_count == 2.
 
   m_searches.erase(itr);
+
+  // Called while the transaction table is being modified, so pending announces are started
+  // from the scheduler.
+  if (search->is_announce() && !m_announceScheduler.empty())
+    this_thread::scheduler()->update_wait_for(&m_task_announce, 0s);
 }
 
 void
@@ -327,10 +365,13 @@ DhtServer::create_find_node_response(const DhtMessage& req, DhtMessage& reply) {
   if (target.size() < HashString::size_data)
     throw dht_error(dht_error_protocol, "target string too short");
 
-  reply[key_r_nodes] = m_router->get_closest_nodes(*HashString::cast_from(target.data()));
+  raw_string nodes = m_router->get_closest_nodes(*HashString::cast_from(target.data()), reply.data_end);
+  reply.data_end += nodes.size();
 
-  if (reply[key_r_nodes].as_raw_string().empty())
+  if (nodes.empty())
     throw dht_error(dht_error_generic, "No nodes");
+
+  reply[is_inet6() ? key_r_nodes6 : key_r_nodes] = nodes;
 }
 
 void
@@ -345,20 +386,33 @@ DhtServer::create_get_peers_response(const DhtMessage& req, const sockaddr* sa,
 
   const HashString* info_hash = HashString::cast_from(info_hash_str.data());
 
-  DhtTracker* tracker = m_router->get_tracker(*info_hash, false);
+  DhtTracker* tracker = m_router->get_tracker(*info_hash);
 
   // If we're not tracking or have no peers, send closest nodes.
   if (!tracker || tracker->empty()) {
-    raw_string nodes = m_router->get_closest_nodes(*info_hash);
+    raw_string nodes = m_router->get_closest_nodes(*info_hash, reply.data_end);
+    reply.data_end += nodes.size();
 
     if (nodes.empty())
       throw dht_error(dht_error_generic, "No peers nor nodes");
 
-    reply[key_r_nodes] = nodes;
+    reply[is_inet6() ? key_r_nodes6 : key_r_nodes] = nodes;
 
   } else {
     reply[key_r_values] = tracker->get_peers();
   }
+
+  // BEP 33 scrape, filters of the seeds and peers we track.
+  if (tracker != nullptr && req[key_a_scrape].is_value() && req[key_a_scrape].as_value() == 1) {
+    char* seeds = reply.data_end;
+    char* peers = reply.data_end + DhtTracker::size_bloom;
+
+    tracker->get_bloom_filters(seeds, peers);
+    reply.data_end += 2 * DhtTracker::size_bloom;
+
+    reply[key_r_BFsd] = raw_string(seeds, DhtTracker::size_bloom);
+    reply[key_r_BFpe] = raw_string(peers, DhtTracker::size_bloom);
+  }
 }
 
 void
@@ -371,25 +425,27 @@ DhtServer::create_announce_peer_response(const DhtMessage& req, const sockaddr*
   if (!m_router->token_valid(req[key_a_token].as_raw_string(), sa))
     throw dht_error(dht_error_protocol, "Token invalid.");
 
-  if (!sa_is_inet(sa))
-    throw internal_error("DhtServer::create_announce_peer_response called with non-inet address.");
+  if (sa->sa_family != m_router->family())
+    throw internal_error("DhtServer::create_announce_peer_response called with address of wrong family.");
 
-  DhtTracker* tracker = m_router->get_tracker(*HashString::cast_from(info_hash.data()), true);
+  bool seed = req[key_a_seed].is_value() && req[key_a_seed].as_value() == 1;
 
-  tracker->add_peer(reinterpret_cast<const sockaddr_in*>(sa)->sin_addr.s_addr, req[key_a_port].as_value());
+  m_router->add_peer(*HashString::cast_from(info_hash.data()), sa, req[key_a_port].as_value(), seed);
 }
 
 void
 DhtServer::process_response(const HashString& id, const sockaddr* sa, const DhtMessage& response) {
   int  transactionId = static_cast<unsigned char>(response[key_t].as_raw_string().data()[0]);
-  auto itr = m_transactions.find(DhtTransaction::key(sa, transactionId));
+  auto transaction = m_transactions.find(DhtTransaction::key(sa, transactionId));
 
   // Response to a transaction we don't have in our table. At this point it's
   // impossible to tell whether it used to be a valid transaction but timed out
   // the node did not return the ID we sent it, or it returned it with a
   // different address than we sent it o. Best we can do is ignore the reply,
   // since the protocol doesn't call for returning errors in responses.
-  if (itr == m_transactions.end())
+  //
+  // IPv6 keys only hold a hash of the address, so check the address too.
+  if (transaction == nullptr || !sa_equal_addr(transaction->address(), sa))
     return;
 
   m_repliesReceived++;
@@ -397,10 +453,8 @@ DhtServer::process_response(const HashString& id, const sockaddr* sa, const DhtM
 
   // Make sure transaction is erased even if an exception is thrown.
   try {
-    auto& transaction = itr->second;
-
 #ifdef USE_EXTRA_DEBUG
-    if (DhtTransaction::key(sa, transactionId) != transaction->key(transactionId))
+    if (DhtTransaction::key(sa, transactionId) != transaction->key())
       throw internal_error("DhtServer::process_response key mismatch.");
 #endif
 
@@ -411,7 +465,7 @@ DhtServer::process_response(const HashString& id, const sockaddr* sa, const DhtM
 
     switch (transaction->type()) {
       case DhtTransaction::DHT_FIND_NODE:
-        parse_find_node_reply(transaction->as_find_node(), response[key_r_nodes].as_raw_string());
+        parse_find_node_reply(transaction->as_find_node(), response);
         break;
 
       case DhtTransaction::DHT_GET_PEERS:
@@ -424,26 +478,29 @@ DhtServer::process_response(const HashString& id, const sockaddr* sa, const DhtM
     }
 
     // Mark node responsive only if all processing was successful, without errors.
-    m_router->node_replied(id, sa);
+    DhtNode* node = m_router->node_replied(id, sa);
+
+    // The cached time only advances once per poll iteration, so the round-trip time is measured
+    // with fresh clock reads.
+    if (node != nullptr && transaction->sent_time() != std::chrono::microseconds())
+      node->add_rtt_sample(utils::time_since_epoch() - transaction->sent_time());
 
   } catch (const std::exception&) {
-    drop_packet(itr->second->packet().get());
-    m_transactions.erase(itr);
+    m_transactions.erase(transaction);
 
     m_errorsCaught++;
     throw;
   }
 
-  drop_packet(itr->second->packet().get());
-  m_transactions.erase(itr);
+  m_transactions.erase(transaction);
 }
 
 void
 DhtServer::process_error(const sockaddr* sa, const DhtMessage& error) {
   int  transactionId = static_cast<unsigned char>(error[key_t].as_raw_string().data()[0]);
-  auto itr = m_transactions.find(DhtTransaction::key(sa, transactionId));
+  auto transaction = m_transactions.find(DhtTransaction::key(sa, transactionId));
 
-  if (itr == m_transactions.end())
+  if (transaction == nullptr || !sa_equal_addr(transaction->address(), sa))
     return;
 
   m_repliesReceived++;
@@ -454,28 +511,43 @@ DhtServer::process_error(const sockaddr* sa, const DhtMessage& error) {
   // If it consistently returns errors for valid queries it's probably broken.  But a
   // few error messages are acceptable. So we do nothing and pretend the query never happened.
 
-  drop_packet(itr->second->packet().get());
-  m_transactions.erase(itr);
+  m_transactions.erase(transaction);
+}
+
+bool
+DhtServer::is_inet6() const {
+  return m_router->family() == AF_INET6;
 }
 
 void
-DhtServer::parse_find_node_reply(DhtTransactionSearch* transaction, raw_string nodes) {
+DhtServer::parse_find_node_reply(DhtTransactionSearch* transaction, const DhtMessage& response) {
   transaction->complete(true);
 
-  if (sizeof(const compact_node_info) != 26)
-    throw internal_error("DhtServer::parse_find_node_reply(...) bad struct size.");
+  if (is_inet6())
+    parse_compact_nodes<SocketAddressCompact6>(transaction, response[key_r_nodes6].as_raw_string());
+  else
+    parse_compact_nodes<SocketAddressCompact>(transaction, response[key_r_nodes].as_raw_string());
 
-  node_info_list list;
-  std::copy(reinterpret_cast<const compact_node_info*>(nodes.data()),
-            reinterpret_cast<const compact_node_info*>(nodes.data() + nodes.size() - nodes.size() % sizeof(compact_node_info)),
-            std::back_inserter(list));
+  find_node_next(transaction);
+}
 
-  for (auto& node : list) {
-    if (node.id() != m_router->id())
-      transaction->search()->add_contact(node.id(), sa_make_inet_n(node._addr.addr, node._addr.port).get());
-  }
+template <typename Address>
+void
+DhtServer::parse_compact_nodes(DhtTransactionSearch* transaction, raw_string nodes) {
+  static_assert(sizeof(compact_node_info<SocketAddressCompact>) == DhtNode::size_compact);
+  static_assert(sizeof(compact_node_info<SocketAddressCompact6>) == DhtNode::size_compact6);
 
-  find_node_next(transaction);
+  // Read the packed records in place rather than copying them out first.
+  auto first = reinterpret_cast<const compact_node_info<Address>*>(nodes.data());
+  auto last  = first + nodes.size() / sizeof(compact_node_info<Address>);
+
+  for (auto node = first; node != last; node++) {
+    if (node->id() == m_router->id())
+      continue;
+
+    sa_inet_union address = node->_addr;
+    transaction->search()->add_contact(node->id(), &address.sa);
+  }
 }
 
 void
@@ -488,7 +560,7 @@ DhtServer::parse_get_peers_reply(DhtTransactionGetPeers* transaction, const DhtM
   transaction->complete(true);
 
   if (response[key_r_values].is_raw_list())
-    announce->receive_peers(response[key_r_values].as_raw_list());
+    m_peersReceived += announce->receive_peers(response[key_r_values].as_raw_list());
 
   // Restrict the length of tokens. We echo them back in announce_peer, and the
   // query has to fit in a single packet.
@@ -496,11 +568,11 @@ DhtServer::parse_get_peers_reply(DhtTransactionGetPeers* transaction, const DhtM
     throw dht_error(dht_error_protocol, "Token length too long");
 
   if (response[key_r_token].is_raw_string())
-    add_transaction(std::unique_ptr<DhtTransaction>(new DhtTransactionAnnouncePeer(transaction->id(),
-                                                                                   transaction->address(),
-                                                                                   announce->target(),
-                                                                                   response[key_r_token].as_raw_string())),
-                    packet_prio_low);
+    add_transaction<DhtTransactionAnnouncePeer>(packet_prio_low,
+                                                transaction->id(),
+                                                transaction->address(),
+                                                announce->target(),
+                                                response[key_r_token].as_raw_string());
 
   announce->update_status();
 }
@@ -515,7 +587,7 @@ DhtServer::find_node_next(DhtTransactionSearch* transaction) {
   auto node = transaction->search()->get_contact();
 
   while (node != transaction->search()->end()) {
-    add_transaction(std::unique_ptr<DhtTransaction>(new DhtTransactionFindNode(node)), priority);
+    add_transaction<DhtTransactionFindNode>(priority, node);
     node = transaction->search()->get_contact();
   }
 
@@ -529,16 +601,36 @@ DhtServer::find_node_next(DhtTransactionSearch* transaction) {
 
   if (announce->complete()) {
     // We have found the 8 closest nodes to the info hash. Retrieve peers
-    // from them and announce to them.
+    // from them and announce to them, and keep them to seed lookups of
+    // nearby info hashes.
     for (node = announce->start_announce(); node != announce->end(); ++node)
-      add_transaction(std::unique_ptr<DhtTransaction>(new DhtTransactionGetPeers(node)), packet_prio_high);
+      add_transaction<DhtTransactionGetPeers>(packet_prio_high, node);
+
+    m_announceScheduler.add_result(announce->target(), announce->begin(), announce->end());
   }
 
   announce->update_status();
 }
 
+DhtServer::packet_ptr
+DhtServer::acquire_packet() {
+  if (m_packetPool.empty())
+    return std::make_unique_for_overwrite<DhtTransactionPacket>();
+
+  auto packet = std::move(m_packetPool.back());
+  m_packetPool.pop_back();
+
+  return packet;
+}
+
 void
-DhtServer::add_packet(std::shared_ptr<DhtTransactionPacket> packet, int priority) {
+DhtServer::release_packet(packet_ptr packet) {
+  if (m_packetPool.size() < max_pooled_packets)
+    m_packetPool.push_back(std::move(packet));
+}
+
+void
+DhtServer::add_packet(packet_ptr packet, int priority) {
   switch (priority) {
     // High priority packets are for important queries, and quite small.
     // They're added to front of high priority queue and thus will be the
@@ -557,6 +649,8 @@ DhtServer::add_packet(std::shared_ptr<DhtTransactionPacket> packet, int priority
     case packet_prio_reply:
       if (m_lowQueue.size() < max_reply_packets)
         m_lowQueue.push_back(std::move(packet));
+      else
+        release_packet(std::move(packet));
       break;
 
     default:
@@ -565,19 +659,20 @@ DhtServer::add_packet(std::shared_ptr<DhtTransactionPacket> packet, int priority
 }
 
 void
-DhtServer::drop_packet(const DhtTransactionPacket* packet) {
-  m_highQueue.erase(std::remove_if(m_highQueue.begin(), m_highQueue.end(), [packet](auto& p) { return p.get() == packet; }),
-                    m_highQueue.end());
-  m_lowQueue.erase(std::remove_if(m_lowQueue.begin(), m_lowQueue.end(), [packet](auto& p) { return p.get() == packet; }),
-                   m_lowQueue.end());
+DhtServer::clear_packets() {
+  for (auto& packet : m_highQueue)
+    release_packet(std::move(packet));
 
-  if (m_highQueue.empty() && m_lowQueue.empty())
-    this_thread::poll()->remove_write(this);
+  for (auto& packet : m_lowQueue)
+    release_packet(std::move(packet));
+
+  m_highQueue.clear();
+  m_lowQueue.clear();
 }
 
 void
-DhtServer::create_query(transaction_itr itr, int tID, [[maybe_unused]] const sockaddr* sa, int priority) {
-  if (itr->second->id() == m_router->id())
+DhtServer::create_query(DhtTransaction* transaction, int priority) {
+  if (transaction->id() == m_router->id())
     throw internal_error("DhtServer::create_query trying to send to itself.");
 
   DhtMessage query;
@@ -586,9 +681,7 @@ DhtServer::create_query(transaction_itr itr, int tID, [[maybe_unused]] const soc
   query[key_t] = raw_bencode(query.data_end, 3);
   *query.data_end++ = '1';
   *query.data_end++ = ':';
-  *query.data_end++ = tID;
-
-  auto& transaction = itr->second;
+  *query.data_end++ = transaction->transaction_id();
 
   query[key_q] = raw_string::from_c_str(queries[transaction->type()]);
   query[key_y] = raw_bencode::from_c_str("1:q");
@@ -615,10 +708,15 @@ DhtServer::create_query(transaction_itr itr, int tID, [[maybe_unused]] const soc
       break;
   }
 
-  auto packet = std::make_shared<DhtTransactionPacket>(transaction->address(), query, tID, transaction);
+  auto packet = acquire_packet();
+  packet->set_query(transaction->address(), query, transaction->key());
+
+  transaction->set_packet(packet.get());
+  add_packet(std::move(packet), priority);
 
-  transaction->set_packet(packet);
-  add_packet(packet, priority);
+  if (transaction->type() == DhtTransaction::DHT_ANNOUNCE_PEER ||
+      (transaction->is_search() && transaction->as_search()->search()->is_announce()))
+    m_announceScheduler.use_query();
 
   m_queriesSent++;
 }
@@ -630,7 +728,10 @@ DhtServer::create_response(const DhtMessage& req, const sockaddr* sa, DhtMessage
   reply[key_y] = raw_bencode::from_c_str("1:r");
   reply[key_v] = raw_bencode("4:" PEER_VERSION, 6);
 
-  add_packet(std::make_shared<DhtTransactionPacket>(sa, reply), packet_prio_reply);
+  auto packet = acquire_packet();
+  packet->set_reply(sa, reply);
+
+  add_packet(std::move(packet), packet_prio_reply);
 }
 
 void
@@ -645,54 +746,37 @@ DhtServer::create_error(const DhtMessage& req, const sockaddr* sa, int num, cons
   error[key_e_0] = num;
   error[key_e_1] = raw_string::from_c_str(msg);
 
-  add_packet(std::make_shared<DhtTransactionPacket>(sa, error), packet_prio_reply);
+  auto packet = acquire_packet();
+  packet->set_reply(sa, error);
+
+  add_packet(std::move(packet), packet_prio_reply);
 }
 
+template <typename T, typename... Args>
 int
-DhtServer::add_transaction(std::shared_ptr<DhtTransaction> transaction, int priority) {
+DhtServer::add_transaction(int priority, Args&&... args) {
   // Try random transaction ID. This is to make it less likely that we reuse
   // a transaction ID from an earlier transaction which timed out and we forgot
   // about it, so that if the node replies after the timeout it's less likely
   // that we match the reply to the wrong transaction.
   //
-  // If there's an existing transaction with the random ID we search for the next
-  // unused one. Since normally only one or two transactions will be active per
-  // node, a collision is extremely unlikely, and a linear search for the first
-  // open one is the most efficient.
-  unsigned int rnd = static_cast<uint8_t>(random());
-  unsigned int id = rnd;
-
-  auto insertItr = m_transactions.lower_bound(transaction->key(rnd));
-
-  // If key matches, keep trying successive IDs.
-  while (insertItr != m_transactions.end() && insertItr->first == transaction->key(id)) {
-    ++insertItr;
-    id = static_cast<uint8_t>(id + 1);
-
-    // Give up after trying all possible IDs. This should never happen.
-    if (id == rnd)
-      return -1;
-
-    // Transaction ID wrapped around, reset iterator.
-    if (id == 0)
-      insertItr = m_transactions.lower_bound(transaction->key(id));
-  }
+  // If there's an existing transaction with the random ID the table picks the
+  // next unused one, and fails only if all IDs are in use with the node.
+  auto transaction = m_transactions.emplace<T>(static_cast<uint8_t>(random()), std::forward<Args>(args)...);
 
-  // We know where to insert it, so pass that as hint.
-  insertItr = m_transactions.insert(insertItr, std::make_pair(transaction->key(id), transaction));
+  if (transaction == nullptr)
+    return -1;
 
-  create_query(insertItr, id, transaction->address(), priority);
+  create_query(transaction, priority);
   start_write();
 
-  return id;
+  return transaction->transaction_id();
 }
 
 // Transaction received no reply and timed out. Mark node as bad and remove
 // transaction (except if it was only the quick timeout).
-DhtServer::transaction_itr
-DhtServer::failed_transaction(transaction_itr itr, bool quick) {
-  auto transaction = itr->second;
-
+void
+DhtServer::failed_transaction(DhtTransaction* transaction, bool quick) {
   // If it was a known node, remember that it didn't reply, unless the transaction
   // is only stalled (had quick timeout, but not full timeout).  Also if the
   // transaction still has an associated packet, the packet never got sent due to
@@ -702,6 +786,9 @@ DhtServer::failed_transaction(transaction_itr itr, bool quick) {
   if (!quick && m_networkUp && transaction->packet() == NULL && transaction->id() != torrent::DhtRouter::zero_id)
     m_router->node_inactive(transaction->id(), transaction->address());
 
+  if (quick)
+    m_transactions.remove_quick_timeout(transaction);
+
   if (transaction->type() == DhtTransaction::DHT_FIND_NODE) {
     if (quick)
       transaction->as_find_node()->set_stalled();
@@ -712,10 +799,8 @@ DhtServer::failed_transaction(transaction_itr itr, bool quick) {
       find_node_next(transaction->as_find_node());
 
     } catch (const std::exception&) {
-      if (!quick) {
-        drop_packet(transaction->packet().get());
-        m_transactions.erase(itr);
-      }
+      if (!quick)
+        m_transactions.erase(transaction);
 
       throw;
     }
@@ -723,20 +808,9 @@ DhtServer::failed_transaction(transaction_itr itr, bool quick) {
 
   // don't actually delete the transaction until the final timeout
   if (quick)
-    return ++itr;
-
-  drop_packet(transaction->packet().get());
+    return;
 
-  m_transactions.erase(itr++);
-  return itr;
-}
-
-void
-DhtServer::clear_transactions() {
-  for (auto& transaction : m_transactions)
-    drop_packet(transaction.second->packet().get());
-
-  m_transactions.clear();
+  m_transactions.erase(transaction);
 }
 
 void
@@ -758,16 +832,23 @@ DhtServer::event_read() {
       if (read < 0)
         break;
 
-      // We can currently only process mapped-IPv4 addresses, not real IPv6.
-      // Translate them to an af_inet socket_address.
+      // Translate mapped-IPv4 addresses to an af_inet socket_address, each
+      // server only handles nodes of its router's address family.
       if (sa_is_v4mapped(sa)) {
         auto sa_unmapped = sin_from_v4mapped_in6(&sa_raw);
         *reinterpret_cast<sockaddr_in*>(&sa_raw) = *sa_unmapped.get();
       }
 
-      if (sa->sa_family != AF_INET)
+      if (sa->sa_family != m_router->family())
         continue;
 
+      // Drop packets from sources over their rate limit before parsing. Replies to our
+      // queries come from nodes we have transactions with, and are always accepted.
+      if (!m_transactions.has_address(sa) && !m_rateLimiter.admit(sa)) {
+        m_queriesDropped++;
+        continue;
+      }
+
       // If it's not a valid bencode dictionary at all, it's probably not a DHT
       // packet at all, so we don't throw an error to prevent bounce loops.
       try {
@@ -859,21 +940,22 @@ DhtServer::event_read() {
 void
 DhtServer::process_queue(packet_queue& queue) {
   while (!queue.empty()) {
-    auto packet = queue.front();
-    DhtTransaction::key_type transactionKey = 0;
-
-    if(packet->has_transaction())
-      transactionKey = packet->transaction()->key(packet->id());
+    auto packet = std::move(queue.front());
+    queue.pop_front();
 
     // Make sure its transaction hasn't timed out yet, if it has/had one
     // and don't bother sending non-transaction packets (replies) after
     // more than 15 seconds in the queue.
     if (packet->has_failed() || packet->age() > 15) {
-      queue.pop_front();
+      release_packet(std::move(packet));
       continue;
     }
 
-    queue.pop_front();
+    // Erasing a transaction marks its packet as failed, so the transaction must still exist.
+    DhtTransaction* transaction = nullptr;
+
+    if (packet->has_transaction() && (transaction = m_transactions.find(packet->transaction_key())) == nullptr)
+      throw internal_error("DhtServer::process_queue could not find transaction.");
 
     try {
       int written = write_datagram_sa(packet->c_str(), packet->length(), packet->address());
@@ -886,22 +968,19 @@ DhtServer::process_queue(packet_queue& queue) {
 
     } catch (const network_error&) {
       // Couldn't write packet, maybe something wrong with node address or routing, so mark node as bad.
-      if (packet->has_transaction()) {
-        auto itr = m_transactions.find(transactionKey);
-        if (itr == m_transactions.end())
-          throw internal_error("DhtServer::process_queue could not find transaction.");
+      if (transaction != nullptr)
+        failed_transaction(transaction, false);
 
-        failed_transaction(itr, false);
-      }
+      release_packet(std::move(packet));
+      continue;
     }
 
-    if (packet->has_transaction()) {
-      // here transaction can be already deleted by failed_transaction.
-      auto itr = m_transactions.find(transactionKey);
-
-      if (itr != m_transactions.end())
-        packet->transaction()->reset_packet();
+    if (transaction != nullptr) {
+      transaction->reset_packet();
+      transaction->set_sent_time(utils::time_since_epoch());
     }
+
+    release_packet(std::move(packet));
   }
 }
 
@@ -932,19 +1011,14 @@ DhtServer::start_write() {
 
 void
 DhtServer::receive_timeout() {
-  auto itr = m_transactions.begin();
-
-  while (itr != m_transactions.end()) {
-    if (itr->second->has_quick_timeout() && itr->second->quick_timeout() < this_thread::cached_seconds().count()) {
-      itr = failed_transaction(itr, true);
+  auto            now = this_thread::cached_seconds().count();
+  DhtTransaction* transaction;
 
-    } else if (itr->second->timeout() < this_thread::cached_seconds().count()) {
-      itr = failed_transaction(itr, false);
+  while ((transaction = m_transactions.front_quick_timeout()) != nullptr && transaction->quick_timeout() < now)
+    failed_transaction(transaction, true);
 
-    } else {
-      ++itr;
-    }
-  }
+  while ((transaction = m_transactions.front_timeout()) != nullptr && transaction->timeout() < now)
+    failed_transaction(transaction, false);
 
   start_write();
 }
@@ -3,10 +3,14 @@
 
 #include <array>
 #include <deque>
-#include <map>
+#include <memory>
 #include <set>
+#include <vector>
 
+#include "dht/dht_announce_scheduler.h"
+#include "dht/dht_rate_limiter.h"
 #include "dht/dht_transaction.h"
+#include "dht/dht_transaction_table.h"
 #include "net/socket_datagram.h"
 #include "torrent/hash_string.h"
 #include "torrent/object_raw_bencode.h"
@@ -25,7 +29,9 @@ class DownloadInfo;
 class DhtMessage;
 class TrackerDht;
 
-// UDP server that handles the DHT node communications.
+// UDP server that handles the DHT node communications, for the address family of its router.
+// With BEP 32 an IPv6 router has its own server on a separate socket, sending and expecting
+// IPv6 compact node info in "nodes6".
 
 class DhtServer : public SocketDatagram {
 public:
@@ -44,8 +50,13 @@ public:
   unsigned int        replies_received() const           { return m_repliesReceived; }
   unsigned int        errors_received() const            { return m_errorsReceived; }
   unsigned int        errors_caught() const              { return m_errorsCaught; }
+  unsigned int        queries_dropped() const            { return m_queriesDropped; }
+  uint64_t            peers_received() const             { return m_peersReceived; }
   void                reset_statistics();
 
+  DhtAnnounceScheduler* announce_scheduler()             { return &m_announceScheduler; }
+  DhtRateLimiter*     rate_limiter()                     { return &m_rateLimiter; }
+
   // Contact a node to see if it replies. Set id=0 if unknown.
   void                ping(const HashString& id, const sockaddr* sa);
 
@@ -53,8 +64,8 @@ public:
   // search.
   void                find_node(const DhtBucket& contacts, const HashString& target);
 
-  // Do DHT announce, starting with the given contacts.
-  void                announce(const DhtBucket& contacts, const HashString& infoHash, std::weak_ptr<TrackerDht> tracker);
+  // Queue a DHT announce, started once the announce scheduler allows it.
+  void                announce(const HashString& infoHash, std::weak_ptr<TrackerDht> tracker, bool report_status);
 
   // Cancel given announce for given tracker, or all matching announces if info/tracker NULL.
   void                cancel_announce(const HashString& info_hash, std::weak_ptr<TrackerDht> tracker);
@@ -80,23 +91,25 @@ private:
   static constexpr unsigned int max_read_datagrams = 64;
   static constexpr size_t       max_reply_packets  = 1024;
   static constexpr size_t       max_transactions   = 1024;
+  static constexpr size_t       max_pooled_packets = 64;
 
+  template <typename Address>
   struct [[gnu::packed]] compact_node_info {
     char                 _id[20];
-    SocketAddressCompact _addr;
+    Address              _addr;
 
     HashString&          id()            { return *HashString::cast_from(_id); }
+    const HashString&    id() const      { return *HashString::cast_from(_id); }
   };
 
-  using packet_queue   = std::deque<std::shared_ptr<DhtTransactionPacket>>;
-  using node_info_list = std::list<compact_node_info>;
+  // Packets are owned by the queues until sent, then returned to the pool. Dropped packets
+  // are only marked as failed and skipped when reached.
+  using packet_ptr      = std::unique_ptr<DhtTransactionPacket>;
+  using packet_queue    = std::deque<packet_ptr>;
+  using packet_pool     = std::vector<packet_ptr>;
 
   using search_set      = std::set<std::shared_ptr<dht::DhtSearch>>;
 
-  // Pending transactions.
-  using transaction_map = std::map<DhtTransaction::key_type, std::shared_ptr<DhtTransaction>>;
-  using transaction_itr = transaction_map::iterator;
-
   // DHT transaction names for given transaction type.
   static constexpr std::array queries{
     "ping",
@@ -112,19 +125,31 @@ private:
 
   void                start_write();
 
+  void                start_announces();
+  bool                start_announce(DhtAnnounceScheduler::request_type request);
+  unsigned int        num_active_announces() const;
+
   void                process_query(const HashString& id, const sockaddr* sa, const DhtMessage& req);
   void                process_response(const HashString& id, const sockaddr* sa, const DhtMessage& req);
   void                process_error(const sockaddr* sa, const DhtMessage& error);
 
-  void                parse_find_node_reply(DhtTransactionSearch* t, raw_string nodes);
+  bool                is_inet6() const;
+
+  void                parse_find_node_reply(DhtTransactionSearch* t, const DhtMessage& res);
+
+  template <typename Address>
+  void                parse_compact_nodes(DhtTransactionSearch* t, raw_string nodes);
   void                parse_get_peers_reply(DhtTransactionGetPeers* t, const DhtMessage& res);
 
   void                find_node_next(DhtTransactionSearch* t);
 
-  void                add_packet(std::shared_ptr<DhtTransactionPacket> packet, int priority);
-  void                drop_packet(const DhtTransactionPacket* packet);
+  packet_ptr          acquire_packet();
+  void                release_packet(packet_ptr packet);
+
+  void                add_packet(packet_ptr packet, int priority);
+  void                clear_packets();
 
-  void                create_query(transaction_itr itr, int tID, const sockaddr* sa, int priority);
+  void                create_query(DhtTransaction* transaction, int priority);
   void                create_response(const DhtMessage& req, const sockaddr* sa, DhtMessage& reply);
   void                create_error(const DhtMessage& req, const sockaddr* sa, int num, const char* msg);
 
@@ -132,12 +157,10 @@ private:
   void                create_get_peers_response(const DhtMessage& arg, const sockaddr* sa, DhtMessage& reply);
   void                create_announce_peer_response(const DhtMessage& arg, const sockaddr* sa, DhtMessage& reply);
 
-  int                 add_transaction(std::shared_ptr<DhtTransaction> transaction, int priority);
+  template <typename T, typename... Args>
+  int                 add_transaction(int priority, Args&&... args);
 
-  // This returns the iterator after the given one or end()
-  transaction_itr     failed_transaction(transaction_itr itr, bool quick);
-
-  void                clear_transactions();
+  void                failed_transaction(DhtTransaction* transaction, bool quick);
 
   void                process_queue(packet_queue& queue);
   void                receive_timeout();
@@ -148,15 +171,22 @@ private:
 
   packet_queue        m_highQueue;
   packet_queue        m_lowQueue;
-  transaction_map     m_transactions;
+  packet_pool         m_packetPool;
+
+  DhtTransactionTable m_transactions;
+  DhtRateLimiter      m_rateLimiter;
+  DhtAnnounceScheduler m_announceScheduler;
 
   system::SchedulerEntry m_task_timeout;
+  system::SchedulerEntry m_task_announce;
 
   unsigned int        m_queriesReceived{};
   unsigned int        m_queriesSent{};
   unsigned int        m_repliesReceived{};
   unsigned int        m_errorsReceived{};
   unsigned int        m_errorsCaught{};
+  unsigned int        m_queriesDropped{};
+  uint64_t            m_peersReceived{};
 
   bool                m_networkUp{false};
 };
@@ -2,87 +2,297 @@
 
 #include "dht_tracker.h"
 
+#include <bit>
+#include <cstring>
+
+#include "torrent/exceptions.h"
+#include "utils/sha1.h"
+
 namespace torrent {
 
-void
-DhtTracker::add_peer(uint32_t addr_n, uint16_t port) {
+DhtTracker::DhtTracker(const HashString& hash, int family)
+  : m_hash(hash),
+    m_family(family),
+    m_oldest_bucket(time_bucket(this_thread::cached_seconds().count())) {
+
+  switch (family) {
+  case AF_INET:
+    m_header_size  = 2;
+    m_address_size = sizeof(in_addr);
+    break;
+  case AF_INET6:
+    m_header_size  = 3;
+    m_address_size = sizeof(in6_addr);
+    break;
+  default:
+    throw internal_error("DhtTracker::DhtTracker() called with non-inet/inet6 family.");
+  }
+
+  m_entry_size = m_header_size + m_address_size + sizeof(uint16_t);
+}
+
+size_t
+DhtTracker::memory_usage() const {
+  return m_peers.capacity() + m_info.capacity() * sizeof(peer_info) + m_index.capacity() * sizeof(uint32_t);
+}
+
+int
+DhtTracker::add_peer(const sockaddr* sa, uint16_t port, bool seed, unsigned int max_size) {
   if (port == 0)
-    return;
+    return 0;
 
-  SocketAddressCompact compact(addr_n, port);
+  if (sa->sa_family != m_family)
+    throw internal_error("DhtTracker::add_peer() called with wrong address family.");
 
-  unsigned int oldest = 0;
-  uint32_t minSeen = ~uint32_t();
-
-  // Check if peer exists. If not, find oldest peer.
-  for (unsigned int i = 0; i < size(); i++) {
-    if (m_peers[i].peer.addr == compact.addr) {
-      m_peers[i].peer.port = compact.port;
-      m_lastSeen[i] = this_thread::cached_seconds().count();
-      return;
-    }
+  const char* addr = m_family == AF_INET
+    ? reinterpret_cast<const char*>(&reinterpret_cast<const sockaddr_in*>(sa)->sin_addr)
+    : reinterpret_cast<const char*>(&reinterpret_cast<const sockaddr_in6*>(sa)->sin6_addr);
 
-    if (m_lastSeen[i] < minSeen) {
-      minSeen = m_lastSeen[i];
-      oldest = i;
-    }
+  uint32_t index = find_index(addr);
+
+  if (index != npos) {
+    set_peer(index, addr, port, seed);
+    return 0;
   }
 
   // If peer doesn't exist, append to list if the table is not full.
   if (size() < max_size) {
-    m_peers.emplace_back(compact);
-    m_lastSeen.push_back(this_thread::cached_seconds().count());
-    return;
+    index = size();
+
+    m_peers.resize(m_peers.size() + m_entry_size);
+    std::memcpy(entry(index), m_family == AF_INET ? "6:" : "18:", m_header_size);
+
+    m_info.push_back(peer_info{static_cast<uint32_t>(this_thread::cached_seconds().count()), {}, seed});
+    m_bucket_count[time_bucket(m_info.back().last_seen) % time_buckets]++;
+
+    std::memcpy(entry(index) + m_header_size, addr, m_address_size);
+    std::memcpy(entry(index) + m_header_size + m_address_size, &port, sizeof(port));
+
+    set_bloom(m_info.back(), addr);
+
+    if (size() * 2 > m_index.size())
+      rebuild_index(std::bit_ceil(std::max<size_t>(size() * 4, 16)));
+    else
+      insert_index(addr, index);
+
+    return 1;
   }
 
   // Peer doesn't exist and table is full: replace oldest peer.
-  m_peers[oldest] = compact;
-  m_lastSeen[oldest] = this_thread::cached_seconds().count();
+  unsigned int oldest = 0;
+
+  for (unsigned int i = 1; i < size(); i++)
+    if (m_info[i].last_seen < m_info[oldest].last_seen)
+      oldest = i;
+
+  erase_index(address(oldest));
+
+  set_peer(oldest, addr, port, seed);
+  set_bloom(m_info[oldest], addr);
+  insert_index(addr, oldest);
+
+  return 0;
 }
 
-// Return compact info as bencoded string (8 bytes per peer) for up to 30 peers,
+// Return compact info as bencoded strings for up to 'maxPeers' peers,
 // returning different peers for each call if there are more.
 raw_list
 DhtTracker::get_peers(unsigned int maxPeers) {
-  if (sizeof(BencodeAddress) != 8)
-    throw internal_error("DhtTracker::BencodeAddress is packed incorrectly.");
-
-  auto first = m_peers.begin();
-  auto last  = m_peers.end();
+  size_t first = 0;
+  size_t last  = size();
 
   // If we have more than max_peers, randomly return block of peers.
   // The peers in overlapping blocks get picked twice as often, but
   // that's better than returning fewer peers.
-  if (m_peers.size() > maxPeers) {
-    unsigned int blocks = (m_peers.size() + maxPeers - 1) / maxPeers;
+  if (size() > maxPeers) {
+    unsigned int blocks = (size() + maxPeers - 1) / maxPeers;
 
-    first += (random() % blocks) * (m_peers.size() - maxPeers) / (blocks - 1);
-    last = first + maxPeers;
+    first = (random() % blocks) * (size() - maxPeers) / (blocks - 1);
+    last  = first + maxPeers;
   }
 
-  return raw_list(first->bencode(), last->bencode() - first->bencode());
+  return raw_list(entry(first), (last - first) * m_entry_size);
 }
 
-// Remove old announces.
 void
+DhtTracker::get_bloom_filters(char* seeds, char* peers) const {
+  std::memset(seeds, 0, size_bloom);
+  std::memset(peers, 0, size_bloom);
+
+  for (const auto& info : m_info) {
+    char* filter = info.seed ? seeds : peers;
+
+    for (auto bit : info.bloom)
+      filter[bit / 8] |= 1 << (bit % 8);
+  }
+}
+
+// Remove old announces. The per time bucket counts tell whether any peer can
+// have expired, so only torrents that do have expired peers are scanned.
+unsigned int
 DhtTracker::prune(uint32_t maxAge) {
-  uint32_t minSeen = this_thread::cached_seconds().count() - maxAge;
+  uint32_t minSeen      = this_thread::cached_seconds().count() - maxAge;
+  uint32_t cutoffBucket = time_bucket(minSeen);
+  bool     expired      = false;
+
+  for (uint32_t b = m_oldest_bucket; b <= cutoffBucket && b - m_oldest_bucket < time_buckets; b++)
+    if (m_bucket_count[b % time_buckets] != 0) {
+      expired = true;
+      break;
+    }
+
+  m_oldest_bucket = std::max(m_oldest_bucket, cutoffBucket);
 
-  for (unsigned int i = 0; i < m_lastSeen.size(); i++)
-    if (m_lastSeen[i] < minSeen) m_peers[i].peer.port = 0;
+  if (!expired)
+    return 0;
 
-  m_peers.erase(std::remove_if(m_peers.begin(),
-                               m_peers.end(),
-                               std::mem_fn(&BencodeAddress::empty)),
-                m_peers.end());
+  unsigned int removed = 0;
+
+  for (unsigned int i = 0; i < size(); ) {
+    if (m_info[i].last_seen >= minSeen) {
+      i++;
+      continue;
+    }
+
+    remove_peer(i);
+    removed++;
+  }
+
+  return removed;
+}
+
+bool
+DhtTracker::equal_address(uint32_t index, const char* addr) const {
+  return std::memcmp(address(index), addr, m_address_size) == 0;
+}
+
+// IPv6 addresses are folded into 32 bits before the multiplicative hash.
+size_t
+DhtTracker::home(const char* addr) const {
+  uint32_t key = 0;
+
+  for (unsigned int i = 0; i != m_address_size; i += sizeof(uint32_t)) {
+    uint32_t word;
+    std::memcpy(&word, addr + i, sizeof(word));
+    key ^= word;
+  }
 
-  m_lastSeen.erase(std::remove_if(m_lastSeen.begin(),
-                                  m_lastSeen.end(),
-                                  [minSeen](auto seen) { return seen < minSeen; }),
-                   m_lastSeen.end());
+  return (key * UINT32_C(0x9e3779b1)) & (m_index.size() - 1);
+}
+
+uint32_t
+DhtTracker::find_index(const char* addr) const {
+  if (m_index.empty())
+    return npos;
+
+  size_t mask = m_index.size() - 1;
+
+  for (size_t pos = home(addr); m_index[pos] != 0; pos = (pos + 1) & mask)
+    if (equal_address(m_index[pos] - 1, addr))
+      return m_index[pos] - 1;
+
+  return npos;
+}
+
+void
+DhtTracker::insert_index(const char* addr, uint32_t index) {
+  size_t mask = m_index.size() - 1;
+  size_t pos  = home(addr);
+
+  while (m_index[pos] != 0)
+    pos = (pos + 1) & mask;
+
+  m_index[pos] = index + 1;
+}
+
+// Points the index entry of 'addr' to a new peer index, used when peers are moved.
+void
+DhtTracker::replace_index(const char* addr, uint32_t index) {
+  size_t mask = m_index.size() - 1;
+  size_t pos  = home(addr);
+
+  while (!equal_address(m_index[pos] - 1, addr))
+    pos = (pos + 1) & mask;
+
+  m_index[pos] = index + 1;
+}
+
+// Backward shift deletion, the peer must still be in the list.
+void
+DhtTracker::erase_index(const char* addr) {
+  size_t mask = m_index.size() - 1;
+  size_t hole = home(addr);
+
+  while (!equal_address(m_index[hole] - 1, addr))
+    hole = (hole + 1) & mask;
+
+  for (size_t pos = (hole + 1) & mask; m_index[pos] != 0; pos = (pos + 1) & mask) {
+    size_t target = home(address(m_index[pos] - 1));
+
+    if (hole <= pos ? (hole < target && target <= pos) : (hole < target || target <= pos))
+      continue;
+
+    m_index[hole] = m_index[pos];
+    hole = pos;
+  }
+
+  m_index[hole] = 0;
+}
+
+void
+DhtTracker::rebuild_index(size_t size) {
+  m_index.assign(size, 0);
+
+  for (uint32_t i = 0; i != this->size(); i++)
+    insert_index(address(i), i);
+}
+
+void
+DhtTracker::set_peer(uint32_t index, const char* addr, uint16_t port, bool seed) {
+  auto& info = m_info[index];
+  auto  now  = static_cast<uint32_t>(this_thread::cached_seconds().count());
+
+  m_bucket_count[time_bucket(info.last_seen) % time_buckets]--;
+  m_bucket_count[time_bucket(now) % time_buckets]++;
+
+  std::memcpy(entry(index) + m_header_size, addr, m_address_size);
+  std::memcpy(entry(index) + m_header_size + m_address_size, &port, sizeof(port));
+
+  info.last_seen = now;
+  info.seed      = seed;
+}
+
+// BEP 33: the first two pairs of bytes of the SHA-1 of the address, little endian, are the bit
+// positions in the filter.
+void
+DhtTracker::set_bloom(peer_info& info, const char* addr) const {
+  unsigned char hash[20];
+
+  Sha1 sha1;
+  sha1.init();
+  sha1.update(addr, m_address_size);
+  sha1.final_c(hash);
+
+  info.bloom[0] = (hash[0] | hash[1] << 8) % (size_bloom * 8);
+  info.bloom[1] = (hash[2] | hash[3] << 8) % (size_bloom * 8);
+}
+
+void
+DhtTracker::remove_peer(uint32_t index) {
+  uint32_t last = size() - 1;
+
+  erase_index(address(index));
+  m_bucket_count[time_bucket(m_info[index].last_seen) % time_buckets]--;
+
+  if (index != last) {
+    replace_index(address(last), index);
+
+    std::memcpy(entry(index), entry(last), m_entry_size);
+    m_info[index] = m_info[last];
+  }
 
-  if (m_peers.size() != m_lastSeen.size())
-    throw internal_error("DhtTracker::prune did inconsistent peer pruning.");
+  m_peers.resize(m_peers.size() - m_entry_size);
+  m_info.pop_back();
 }
 
 } // namespace torrent
@@ -1,55 +1,118 @@
 #ifndef LIBTORRENT_DHT_TRACKER_H
 #define LIBTORRENT_DHT_TRACKER_H
 
+#include <array>
 #include <vector>
 
-#include "net/address_list.h" // For SA.
+#include "torrent/net/types.h"
+#include "torrent/hash_string.h"
 #include "torrent/object_raw_bencode.h"
 
 namespace torrent {
 
-// Container for peers tracked in a torrent.
+// Container for peers tracked in a torrent, all of the same address family.
+//
+// Peers are kept as bencoded compact addresses, "6:" followed by six bytes for IPv4 and "18:"
+// followed by eighteen bytes for IPv6, so a range of them is a valid bencoded list that
+// get_peers() returns as is. Peers are looked up by address through an open addressed index, and
+// counted per five minute time bucket so that pruning a torrent without expired peers does not
+// scan its peer list.
+//
+// Each peer also keeps the two bit positions it sets in the BEP 33 bloom filters, so the scrape
+// filters are built without hashing.
 
 class DhtTracker {
 public:
-  // Maximum number of peers we return for a GET_PEERS query (default value only). 
-  // Needs to be small enough so that a packet with a payload of num_peers*6 bytes 
+  // Maximum number of peers we return for a GET_PEERS query (default value only).
+  // Needs to be small enough so that a packet with a payload of num_peers*6 bytes
   // does not need fragmentation. Value chosen so that the size is approximately
   // equal to a FIND_NODE reply (8*26 bytes).
   static constexpr unsigned int max_peers = 32;
 
-  // Maximum number of peers we keep track of. For torrents with more peers,
-  // we replace the oldest peer with each new announce to avoid excessively
+  // Default maximum number of peers we keep track of. For torrents with more
+  // peers, we replace the oldest peer with each new announce to avoid excessively
   // large peer tables for very active torrents.
   static constexpr unsigned int max_size = 128;
 
-  bool                empty() const                { return m_peers.empty(); }
-  size_t              size() const                 { return m_peers.size(); }
+  static constexpr unsigned int time_bucket_seconds = 5 * 60;
+  static constexpr unsigned int time_buckets        = 16;
 
-  void                add_peer(uint32_t addr_n, uint16_t port);
+  // BEP 33 bloom filter size in bytes.
+  static constexpr unsigned int size_bloom = 256;
+
+  DhtTracker(const HashString& hash, int family);
+
+  const HashString&   hash() const                 { return m_hash; }
+  int                 family() const               { return m_family; }
+
+  bool                empty() const                { return m_info.empty(); }
+  size_t              size() const                 { return m_info.size(); }
+
+  size_t              memory_usage() const;
+
+  // Only the address of 'sa' is used, it must be of the tracker's family. Returns the change in
+  // the number of peers, i.e. 1 or 0.
+  int                 add_peer(const sockaddr* sa, uint16_t port, bool seed, unsigned int max_size = DhtTracker::max_size);
   raw_list            get_peers(unsigned int maxPeers = max_peers);
 
+  // Writes the seed and peer bloom filters, 'size_bloom' bytes each.
+  void                get_bloom_filters(char* seeds, char* peers) const;
+
   // Remove old announces from the tracker that have not reannounced for
-  // more than the given number of seconds.
-  void                prune(uint32_t maxAge);
+  // more than the given number of seconds. Returns the number of removed peers.
+  unsigned int        prune(uint32_t maxAge);
 
 private:
-  // We need to store the address as a bencoded string.
-  struct [[gnu::packed]] BencodeAddress {
-    char                 header[2];
-    SocketAddressCompact peer;
+  friend class DhtPeerStore;
+
+  struct peer_info {
+    uint32_t             last_seen;
+    uint16_t             bloom[2];
+    bool                 seed;
+  };
 
-    BencodeAddress(const SocketAddressCompact& p) : peer(p) { header[0] = '6'; header[1] = ':'; }
+  static constexpr uint32_t npos = ~uint32_t();
 
-    const char*  bencode() const { return header; }
+  using InfoList = std::vector<peer_info>;
 
-    bool         empty() const   { return !peer.port; }
-  };
+  static uint32_t     time_bucket(uint32_t seen)   { return seen / time_bucket_seconds; }
+
+  char*               entry(uint32_t index)         { return m_peers.data() + index * m_entry_size; }
+  const char*         entry(uint32_t index) const   { return m_peers.data() + index * m_entry_size; }
+  const char*         address(uint32_t index) const { return entry(index) + m_header_size; }
+
+  bool                equal_address(uint32_t index, const char* addr) const;
+
+  size_t              home(const char* addr) const;
+  uint32_t            find_index(const char* addr) const;
+  void                insert_index(const char* addr, uint32_t index);
+  void                replace_index(const char* addr, uint32_t index);
+  void                erase_index(const char* addr);
+  void                rebuild_index(size_t size);
+
+  void                set_peer(uint32_t index, const char* addr, uint16_t port, bool seed);
+  void                set_bloom(peer_info& info, const char* addr) const;
+  void                remove_peer(uint32_t index);
+
+  HashString             m_hash;
+  int                    m_family;
+
+  unsigned int           m_header_size;
+  unsigned int           m_address_size;
+  unsigned int           m_entry_size;
+
+  std::vector<char>      m_peers;
+  InfoList               m_info;
+
+  // Peer index plus one, zero if unused.
+  std::vector<uint32_t>  m_index;
 
-  using PeerList = std::vector<BencodeAddress>;
+  std::array<uint32_t, time_buckets> m_bucket_count{};
+  uint32_t               m_oldest_bucket;
 
-  PeerList               m_peers;
-  std::vector<uint32_t>  m_lastSeen;
+  // Intrusive least recently announced list, maintained by DhtPeerStore.
+  DhtTracker*            m_lru_prev{};
+  DhtTracker*            m_lru_next{};
 };
 
 } // namespace torrent
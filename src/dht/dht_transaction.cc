@@ -3,6 +3,7 @@
 #include "dht/dht_transaction.h"
 
 #include <cassert>
+#include <cstring>
 
 #include "dht/dht_bucket.h"
 #include "dht/dht_server.h"
@@ -20,38 +21,42 @@ const DhtMessage::key_list_type DhtMessage::base_type::keys;
 // DhtTransactionPacket:
 //
 
-DhtTransactionPacket::DhtTransactionPacket(const sockaddr* s, const DhtMessage& d, unsigned int id, std::shared_ptr<DhtTransaction> t)
-  : m_socket_address(sa_copy(s)),
-    m_id(id),
-    m_transaction(std::move(t)) {
+void
+DhtTransactionPacket::set_query(const sockaddr* sa, const DhtMessage& msg, uint64_t key) {
+  m_key             = key;
+  m_timestamp       = 0;
+  m_has_transaction = true;
+  m_failed          = false;
 
-  build_buffer(d);
+  build_buffer(sa, msg);
 }
 
-DhtTransactionPacket::DhtTransactionPacket(const sockaddr* s, const DhtMessage& d)
-  : m_socket_address(sa_copy(s)),
-    m_id(-this_thread::cached_seconds().count()) {
+void
+DhtTransactionPacket::set_reply(const sockaddr* sa, const DhtMessage& msg) {
+  m_key             = 0;
+  m_timestamp       = this_thread::cached_seconds().count();
+  m_has_transaction = false;
+  m_failed          = false;
 
-  build_buffer(d);
+  build_buffer(sa, msg);
 }
 
 void
-DhtTransactionPacket::build_buffer(const DhtMessage& msg) {
-  char buffer[1500];  // If the message would exceed an Ethernet frame, something went very wrong.
-  object_buffer_t result = static_map_write_bencode_c(object_write_to_buffer, NULL, std::make_pair(buffer, buffer + sizeof(buffer)), msg);
+DhtTransactionPacket::build_buffer(const sockaddr* sa, const DhtMessage& msg) {
+  sa_copy_to_inet_union(sa, m_address);
 
-  m_length = result.second - buffer;
-  m_data   = std::make_unique<char[]>(m_length);
+  object_buffer_t result = static_map_write_bencode_c(object_write_to_buffer, NULL, std::make_pair(m_data, m_data + max_size), msg);
 
-  memcpy(m_data.get(), buffer, m_length);
+  m_length = result.second - m_data;
 }
 
 DhtTransaction::DhtTransaction(int quick_timeout, int timeout, const HashString& id, const sockaddr* sa)
   : m_id(id),
     m_hasQuickTimeout(quick_timeout > 0),
-    m_socket_address(sa_copy(sa)),
     m_timeout(this_thread::cached_seconds().count() + timeout),
     m_quickTimeout(this_thread::cached_seconds().count() + quick_timeout) {
+
+  sa_copy_to_inet_union(sa, m_address);
 }
 
 DhtTransaction::~DhtTransaction() {
@@ -59,24 +64,30 @@ DhtTransaction::~DhtTransaction() {
     m_packet->set_failed();
 }
 
+// IPv6 addresses are hashed to 32 bits, so keys of different nodes may collide and replies
+// must also be checked against the transaction's address.
+static uint32_t
+address_key(const sockaddr* sa) {
+  if (sa_is_inet(sa))
+    return reinterpret_cast<const sockaddr_in*>(sa)->sin_addr.s_addr;
+
+  if (!sa_is_inet6(sa))
+    throw internal_error("DhtTransaction::key() called with non-inet/inet6 address.");
+
+  uint64_t words[2];
+  std::memcpy(words, &reinterpret_cast<const sockaddr_in6*>(sa)->sin6_addr, sizeof(words));
+
+  return ((words[0] * UINT64_C(0x9e3779b97f4a7c15)) ^ words[1]) * UINT64_C(0x9e3779b97f4a7c15) >> 32;
+}
+
 DhtTransaction::key_type
 DhtTransaction::key(const sockaddr* sa, int id) {
-  if (sa_is_inet(sa))
-    return (static_cast<uint64_t>(reinterpret_cast<const sockaddr_in*>(sa)->sin_addr.s_addr) << 32) + id;
-  else if (sa_is_inet6(sa))
-    throw internal_error("DhtTransaction::key() called with inet6 address.");
-  else
-    throw internal_error("DhtTransaction::key() called with non-inet address.");
+  return (static_cast<uint64_t>(address_key(sa)) << 32) + id;
 }
 
 bool
 DhtTransaction::key_match(key_type key, const sockaddr* sa) {
-  if (sa_is_inet(sa))
-    return (key >> 32) == static_cast<uint64_t>(reinterpret_cast<const sockaddr_in*>(sa)->sin_addr.s_addr);
-  else if (sa_is_inet6(sa))
-    throw internal_error("DhtTransaction::key_match() called with inet6 address.");
-  else
-    throw internal_error("DhtTransaction::key_match() called with non-inet address.");
+  return (key >> 32) == address_key(sa);
 }
 
 //
@@ -86,7 +97,7 @@ DhtTransaction::key_match(key_type key, const sockaddr* sa) {
 DhtTransactionSearch::DhtTransactionSearch(int quick_timeout, int timeout, dht::DhtSearch::const_accessor& node)
   : DhtTransaction(quick_timeout, timeout, node.node()->id(), node.node()->address()),
     m_node(node),
-    m_search(node.search()) {
+    m_search(node.search()->shared_from_this()) {
 
   if (!m_hasQuickTimeout)
     m_search->m_concurrency++;
@@ -113,7 +124,7 @@ DhtTransactionSearch::complete(bool success) {
   if (m_node == m_search->end())
     throw internal_error("DhtTransactionSearch::complete() called multiple times.");
 
-  if (m_node.search() != m_search)
+  if (m_node.search() != m_search.get())
     throw internal_error("DhtTransactionSearch::complete() called for node from wrong search.");
 
   if (!m_hasQuickTimeout)
@@ -37,6 +37,8 @@ enum dht_keys {
   key_a_id,
   key_a_infoHash,
   key_a_port,
+  key_a_scrape,
+  key_a_seed,
   key_a_target,
   key_a_token,
 
@@ -45,8 +47,11 @@ enum dht_keys {
 
   key_q,
 
+  key_r_BFpe,
+  key_r_BFsd,
   key_r_id,
   key_r_nodes,
+  key_r_nodes6,
   key_r_token,
   key_r_values,
 
@@ -61,55 +66,57 @@ class DhtMessage : public static_map_type<dht_keys, key_LAST> {
 public:
   using base_type = static_map_type<dht_keys, key_LAST>;
 
-  // Must be big enough to hold one of the possible variable-sized reply data.
-  // Currently either:
+  // Must be big enough to hold the variable-sized reply data. Currently:
   // - error message (size doesn't really matter, it'll be truncated at worst)
-  // - announce token (8 bytes, needs 20 bytes buffer to build)
-  // Never more than one of the above.
+  // - announce token (8 bytes)
+  // - closest nodes (8 * 26 bytes, or 8 * 38 bytes for IPv6), following the token in get_peers replies
+  // - BEP 33 seed and peer bloom filters (2 * 256 bytes) in get_peers scrape replies
   // And additionally for queries we send:
   // - transaction ID (3 bytes)
-  static constexpr size_t data_size = 64;
+  static constexpr size_t data_size = 1024;
   char data[data_size];
   char* data_end{data};
 };
 
-// Class holding transaction data to be transmitted.
+// Class holding transaction data to be transmitted. Packets are pooled by DhtServer and reused
+// once sent or dropped, with the encoded message kept inline.
 class DhtTransactionPacket {
 public:
-  // transaction packet
-  DhtTransactionPacket(const sockaddr* s, const DhtMessage& d, unsigned int id, std::shared_ptr<DhtTransaction> t);
-  // non-transaction packet
-  DhtTransactionPacket(const sockaddr* s, const DhtMessage& d);
+  // If the message would exceed an Ethernet frame, something went very wrong.
+  static constexpr size_t max_size = 1500;
+
+  DhtTransactionPacket() = default;
   ~DhtTransactionPacket() = default;
 
-  bool                has_transaction() const   { return m_id >= -1; }
-  bool                has_failed() const        { return m_id == -1; }
-  void                set_failed()              { m_id = -1; }
+  void                set_query(const sockaddr* sa, const DhtMessage& msg, uint64_t key);
+  void                set_reply(const sockaddr* sa, const DhtMessage& msg);
 
-  const auto*         address() const           { return m_socket_address.get(); }
-  auto*               address()                 { return m_socket_address.get(); }
+  bool                has_transaction() const   { return m_has_transaction; }
+  bool                has_failed() const        { return m_failed; }
+  void                set_failed()              { m_failed = true; }
 
-  const char*         c_str() const             { return m_data.get(); }
-  size_t              length() const            { return m_length; }
+  const sockaddr*     address() const           { return &m_address.sa; }
 
-  int                 id() const                { return m_id; }
-  int                 age() const               { return has_transaction() ? 0 : this_thread::cached_seconds().count() + m_id; }
+  const char*         c_str() const             { return m_data; }
+  size_t              length() const            { return m_length; }
 
-  const auto*         transaction() const       { return m_transaction.get(); }
-  auto*               transaction()             { return m_transaction.get(); }
+  uint64_t            transaction_key() const   { return m_key; }
+  int                 age() const               { return has_transaction() ? 0 : this_thread::cached_seconds().count() - m_timestamp; }
 
 private:
   DhtTransactionPacket(const DhtTransactionPacket&) = delete;
   DhtTransactionPacket& operator=(const DhtTransactionPacket&) = delete;
 
-  void                build_buffer(const DhtMessage& data);
+  void                build_buffer(const sockaddr* sa, const DhtMessage& msg);
 
-  sa_unique_ptr           m_socket_address;
-  std::unique_ptr<char[]> m_data;
-  size_t                  m_length{};
-  int                     m_id{};
+  sa_inet_union       m_address{};
+  uint64_t            m_key{};
+  int64_t             m_timestamp{};
+  bool                m_has_transaction{};
+  bool                m_failed{};
 
-  std::shared_ptr<DhtTransaction> m_transaction;
+  size_t              m_length{};
+  char                m_data[max_size];
 };
 
 // DHT Transaction classes. DhtTransaction and DhtTransactionSearch
@@ -133,20 +140,28 @@ public:
 
   virtual bool        is_search()               { return false; }
 
-  key_type            key(int id) const         { return key(m_socket_address.get(), id); }
+  // The key is assigned when the transaction is added to DhtTransactionTable.
+  key_type            key() const               { return m_key; }
+  int                 transaction_id() const    { return m_key & 0xff; }
+
   static key_type     key(const sockaddr* sa, int id);
   static bool         key_match(key_type key, const sockaddr* sa);
 
   const HashString&   id()                      { return m_id; }
-  const auto*         address()                 { return m_socket_address.get(); }
+  const sockaddr*     address() const           { return &m_address.sa; }
 
   int                 timeout() const           { return m_timeout; }
   int                 quick_timeout() const     { return m_quickTimeout; }
   bool                has_quick_timeout() const { return m_hasQuickTimeout; }
 
-  auto&               packet() const                                       { return m_packet; }
-  void                set_packet(std::shared_ptr<DhtTransactionPacket>& p) { m_packet = p; }
-  void                reset_packet()                                       { m_packet.reset(); }
+  // Wall clock time when the query was written to the socket, zero while still queued.
+  auto                sent_time() const         { return m_sent_time; }
+  void                set_sent_time(std::chrono::microseconds t) { m_sent_time = t; }
+
+  // The queued packet, if not yet sent. Owned by DhtServer.
+  DhtTransactionPacket* packet() const                       { return m_packet; }
+  void                  set_packet(DhtTransactionPacket* p)  { m_packet = p; }
+  void                  reset_packet()                       { m_packet = nullptr; }
 
   DhtTransactionSearch*       as_search();
   DhtTransactionPing*         as_ping();
@@ -163,14 +178,18 @@ protected:
   bool                   m_hasQuickTimeout;
 
 private:
+  friend class DhtTransactionTable;
+
   DhtTransaction(const DhtTransaction&) = delete;
   DhtTransaction& operator=(const DhtTransaction&) = delete;
 
-  sa_unique_ptr          m_socket_address;
+  sa_inet_union          m_address{};
+  key_type               m_key{};
   int                    m_timeout;
   int                    m_quickTimeout;
+  std::chrono::microseconds m_sent_time{};
 
-  std::shared_ptr<DhtTransactionPacket> m_packet;
+  DhtTransactionPacket*  m_packet{};
 };
 
 class DhtTransactionSearch : public DhtTransaction {
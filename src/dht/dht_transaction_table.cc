@@ -0,0 +1,251 @@
+#include "config.h"
+
+#include "dht/dht_transaction_table.h"
+
+#include <bit>
+
+#include "torrent/exceptions.h"
+
+namespace torrent {
+
+DhtTransactionTable::~DhtTransactionTable() {
+  clear();
+}
+
+DhtTransaction*
+DhtTransactionTable::find(key_type key) {
+  uint32_t index = find_index(key);
+
+  return index != npos ? slot(index).transaction : nullptr;
+}
+
+bool
+DhtTransactionTable::has_address(const sockaddr* sa) const {
+  if (m_size == 0)
+    return false;
+
+  size_t mask = m_index.size() - 1;
+
+  for (size_t pos = home(DhtTransaction::key(sa, 0)); m_index[pos].slot != npos; pos = (pos + 1) & mask)
+    if (DhtTransaction::key_match(m_index[pos].key, sa))
+      return true;
+
+  return false;
+}
+
+void
+DhtTransactionTable::erase(DhtTransaction* transaction) {
+  uint32_t index = find_index(transaction->key());
+
+  if (index == npos || slot(index).transaction != transaction)
+    throw internal_error("DhtTransactionTable::erase() transaction not found.");
+
+  if (is_linked(m_quick, &slot_type::quick, index))
+    unlink(m_quick, &slot_type::quick, index);
+
+  unlink(m_timeout, &slot_type::timeout, index);
+  erase_index(transaction->key());
+  m_size--;
+
+  destroy_slot(index);
+}
+
+void
+DhtTransactionTable::clear() {
+  while (!empty())
+    erase(front_timeout());
+}
+
+void
+DhtTransactionTable::remove_quick_timeout(DhtTransaction* transaction) {
+  uint32_t index = find_index(transaction->key());
+
+  if (index == npos || slot(index).transaction != transaction)
+    throw internal_error("DhtTransactionTable::remove_quick_timeout() transaction not found.");
+
+  if (is_linked(m_quick, &slot_type::quick, index))
+    unlink(m_quick, &slot_type::quick, index);
+}
+
+// Slabs are only added, never freed, so the table keeps the capacity of its busiest moment.
+uint32_t
+DhtTransactionTable::allocate_slot() {
+  if (m_free == npos) {
+    auto first = static_cast<uint32_t>(capacity());
+
+    m_slabs.push_back(std::make_unique<slot_type[]>(slab_size));
+
+    for (uint32_t i = slab_size; i != 0; i--) {
+      slot(first + i - 1).timeout.next = m_free;
+      m_free = first + i - 1;
+    }
+
+    rebuild_index(std::bit_ceil(capacity() * 2));
+  }
+
+  uint32_t index = m_free;
+  m_free = slot(index).timeout.next;
+
+  slot(index).timeout = link_type{};
+  slot(index).quick   = link_type{};
+  return index;
+}
+
+void
+DhtTransactionTable::destroy_slot(uint32_t index) {
+  auto& s = slot(index);
+
+  s.transaction->~DhtTransaction();
+  s.transaction = nullptr;
+
+  s.timeout.next = m_free;
+  m_free = index;
+}
+
+bool
+DhtTransactionTable::insert(uint32_t index, unsigned int id) {
+  auto         transaction = slot(index).transaction;
+  unsigned int first       = static_cast<uint8_t>(id);
+
+  id = first;
+
+  // Normally only one or two transactions are active per node, so the first unused id is
+  // found right away.
+  while (find_index(DhtTransaction::key(transaction->address(), id)) != npos) {
+    id = static_cast<uint8_t>(id + 1);
+
+    if (id == first)
+      return false;
+  }
+
+  transaction->m_key = DhtTransaction::key(transaction->address(), id);
+
+  insert_index(transaction->m_key, index);
+  m_size++;
+
+  link_sorted(m_timeout, &slot_type::timeout, &DhtTransaction::timeout, index);
+
+  if (transaction->has_quick_timeout())
+    link_sorted(m_quick, &slot_type::quick, &DhtTransaction::quick_timeout, index);
+
+  return true;
+}
+
+size_t
+DhtTransactionTable::home(key_type key) const {
+  return ((key >> 32) * UINT64_C(0x9e3779b97f4a7c15)) >> m_index_shift;
+}
+
+uint32_t
+DhtTransactionTable::find_index(key_type key) const {
+  if (m_size == 0)
+    return npos;
+
+  size_t mask = m_index.size() - 1;
+
+  for (size_t pos = home(key); m_index[pos].slot != npos; pos = (pos + 1) & mask)
+    if (m_index[pos].key == key)
+      return m_index[pos].slot;
+
+  return npos;
+}
+
+void
+DhtTransactionTable::insert_index(key_type key, uint32_t index) {
+  size_t mask = m_index.size() - 1;
+  size_t pos  = home(key);
+
+  while (m_index[pos].slot != npos)
+    pos = (pos + 1) & mask;
+
+  m_index[pos] = index_entry{key, index};
+}
+
+// Backward shift deletion, moving later entries of the probe sequence into the hole so that
+// lookups never need tombstones.
+void
+DhtTransactionTable::erase_index(key_type key) {
+  size_t mask = m_index.size() - 1;
+  size_t hole = home(key);
+
+  while (m_index[hole].key != key || m_index[hole].slot == npos) {
+    if (m_index[hole].slot == npos)
+      throw internal_error("DhtTransactionTable::erase_index() key not found.");
+
+    hole = (hole + 1) & mask;
+  }
+
+  for (size_t pos = (hole + 1) & mask; m_index[pos].slot != npos; pos = (pos + 1) & mask) {
+    size_t target = home(m_index[pos].key);
+
+    // Entries whose home lies cyclically in (hole, pos] must stay.
+    if (hole <= pos ? (hole < target && target <= pos) : (hole < target || target <= pos))
+      continue;
+
+    m_index[hole] = m_index[pos];
+    hole = pos;
+  }
+
+  m_index[hole] = index_entry{};
+}
+
+void
+DhtTransactionTable::rebuild_index(size_t size) {
+  std::vector<index_entry> old_index(size);
+  old_index.swap(m_index);
+
+  m_index_shift = 64 - std::countr_zero(size);
+
+  for (auto& entry : old_index)
+    if (entry.slot != npos)
+      insert_index(entry.key, entry.slot);
+}
+
+bool
+DhtTransactionTable::is_linked(const list_type& list, link_type slot_type::*link, uint32_t index) {
+  return (slot(index).*link).prev != npos || list.first == index;
+}
+
+// Deadlines are set at creation with a fixed delay per transaction type, so new transactions
+// almost always go at the back.
+void
+DhtTransactionTable::link_sorted(list_type& list, link_type slot_type::*link, deadline_func deadline, uint32_t index) {
+  int      value = (slot(index).transaction->*deadline)();
+  uint32_t prev  = list.last;
+
+  while (prev != npos && (slot(prev).transaction->*deadline)() > value)
+    prev = (slot(prev).*link).prev;
+
+  uint32_t next = prev != npos ? (slot(prev).*link).next : list.first;
+
+  (slot(index).*link) = link_type{prev, next};
+
+  if (prev != npos)
+    (slot(prev).*link).next = index;
+  else
+    list.first = index;
+
+  if (next != npos)
+    (slot(next).*link).prev = index;
+  else
+    list.last = index;
+}
+
+void
+DhtTransactionTable::unlink(list_type& list, link_type slot_type::*link, uint32_t index) {
+  auto [prev, next] = slot(index).*link;
+
+  if (prev != npos)
+    (slot(prev).*link).next = next;
+  else
+    list.first = next;
+
+  if (next != npos)
+    (slot(next).*link).prev = prev;
+  else
+    list.last = prev;
+
+  (slot(index).*link) = link_type{};
+}
+
+} // namespace torrent
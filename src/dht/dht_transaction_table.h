@@ -0,0 +1,163 @@
+#ifndef LIBTORRENT_DHT_TRANSACTION_TABLE_H
+#define LIBTORRENT_DHT_TRANSACTION_TABLE_H
+
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "dht/dht_transaction.h"
+
+namespace torrent {
+
+// Pending DHT transactions, constructed in place in slab allocated slots that are reused once
+// the transaction is erased, so a steady number of transactions does not allocate.
+//
+// Transactions are indexed by key in an open addressed hash table with linear probing. Only the
+// address part of the key is hashed, so all transactions with a node are in one probe sequence.
+// Each transaction is also linked into a list sorted by timeout, and those with a pending quick
+// timeout into a second list, so expired transactions are found without scanning the table.
+
+class DhtTransactionTable {
+public:
+  using key_type = DhtTransaction::key_type;
+
+  static constexpr uint32_t slab_size = 64;
+
+  DhtTransactionTable() = default;
+  ~DhtTransactionTable();
+
+  bool                empty() const     { return m_size == 0; }
+  size_t              size() const      { return m_size; }
+  size_t              capacity() const  { return m_slabs.size() * slab_size; }
+
+  DhtTransaction*     find(key_type key);
+  bool                has_address(const sockaddr* sa) const;
+
+  // Constructs the transaction and assigns it the first transaction id from 'id' onwards that
+  // is unused with its node. If all ids are in use the transaction is destroyed and nullptr
+  // returned.
+  template <typename T, typename... Args>
+  T*                  emplace(unsigned int id, Args&&... args);
+
+  // The transaction is removed from the table before it is destroyed.
+  void                erase(DhtTransaction* transaction);
+  void                clear();
+
+  template <typename Pred>
+  void                erase_if(Pred pred);
+
+  // Transactions with the earliest deadlines, or nullptr if none.
+  DhtTransaction*     front_timeout()        { return m_timeout.first != npos ? slot(m_timeout.first).transaction : nullptr; }
+  DhtTransaction*     front_quick_timeout()  { return m_quick.first != npos ? slot(m_quick.first).transaction : nullptr; }
+
+  void                remove_quick_timeout(DhtTransaction* transaction);
+
+private:
+  DhtTransactionTable(const DhtTransactionTable&) = delete;
+  DhtTransactionTable& operator=(const DhtTransactionTable&) = delete;
+
+  static constexpr uint32_t npos = ~uint32_t();
+
+  static constexpr size_t storage_size = std::max({sizeof(DhtTransactionPing), sizeof(DhtTransactionFindNode),
+                                                   sizeof(DhtTransactionGetPeers), sizeof(DhtTransactionAnnouncePeer)});
+  static constexpr size_t storage_align = std::max({alignof(DhtTransactionPing), alignof(DhtTransactionFindNode),
+                                                    alignof(DhtTransactionGetPeers), alignof(DhtTransactionAnnouncePeer)});
+
+  struct link_type {
+    uint32_t          prev{npos};
+    uint32_t          next{npos};
+  };
+
+  struct list_type {
+    uint32_t          first{npos};
+    uint32_t          last{npos};
+  };
+
+  // Free slots are chained through 'timeout.next'.
+  struct slot_type {
+    alignas(storage_align) char storage[storage_size];
+
+    DhtTransaction*   transaction{};
+    link_type         timeout;
+    link_type         quick;
+  };
+
+  struct index_entry {
+    key_type          key{};
+    uint32_t          slot{npos};
+  };
+
+  using deadline_func = int (DhtTransaction::*)() const;
+
+  slot_type&          slot(uint32_t index) { return m_slabs[index / slab_size][index % slab_size]; }
+
+  uint32_t            allocate_slot();
+  void                destroy_slot(uint32_t index);
+
+  bool                insert(uint32_t index, unsigned int id);
+
+  size_t              home(key_type key) const;
+  uint32_t            find_index(key_type key) const;
+  void                insert_index(key_type key, uint32_t index);
+  void                erase_index(key_type key);
+  void                rebuild_index(size_t size);
+
+  bool                is_linked(const list_type& list, link_type slot_type::*link, uint32_t index);
+  void                link_sorted(list_type& list, link_type slot_type::*link, deadline_func deadline, uint32_t index);
+  void                unlink(list_type& list, link_type slot_type::*link, uint32_t index);
+
+  std::vector<std::unique_ptr<slot_type[]>> m_slabs;
+  uint32_t            m_free{npos};
+  size_t              m_size{};
+
+  std::vector<index_entry> m_index;
+  unsigned int        m_index_shift{};
+
+  list_type           m_timeout;
+  list_type           m_quick;
+};
+
+template <typename T, typename... Args>
+T*
+DhtTransactionTable::emplace(unsigned int id, Args&&... args) {
+  static_assert(sizeof(T) <= storage_size && alignof(T) <= storage_align);
+
+  uint32_t index = allocate_slot();
+  T*       transaction;
+
+  try {
+    transaction = new (slot(index).storage) T(std::forward<Args>(args)...);
+  } catch (...) {
+    slot(index).timeout.next = m_free;
+    m_free = index;
+    throw;
+  }
+
+  slot(index).transaction = transaction;
+
+  if (!insert(index, id)) {
+    destroy_slot(index);
+    return nullptr;
+  }
+
+  return transaction;
+}
+
+template <typename Pred>
+void
+DhtTransactionTable::erase_if(Pred pred) {
+  uint32_t index = m_timeout.first;
+
+  while (index != npos) {
+    auto transaction = slot(index).transaction;
+    index = slot(index).timeout.next;
+
+    if (pred(transaction))
+      erase(transaction);
+  }
+}
+
+} // namespace torrent
+
+#endif
@@ -11,14 +11,18 @@
 
 namespace torrent::dht {
 
-DhtAnnounce::DhtAnnounce(DhtServer* server, const HashString& infoHash, std::weak_ptr<TrackerDht> tracker)
+DhtAnnounce::DhtAnnounce(DhtServer* server, const HashString& infoHash, std::weak_ptr<TrackerDht> tracker, bool report_status)
   : DhtSearch(server, infoHash),
-    m_tracker(tracker) {
+    m_tracker(tracker),
+    m_report_status(report_status) {
 }
 
 DhtAnnounce::~DhtAnnounce() {
   assert(complete() && "DhtAnnounce::~DhtAnnounce called while announce not complete.");
 
+  if (!m_report_status)
+    return;
+
   TrackerDht::add_event(m_tracker, [contacted = m_contacted, replied = m_replied](TrackerDht* tracker) {
       const char* failure = nullptr;
 
@@ -55,28 +59,36 @@ DhtAnnounce::start_announce() {
   m_contacted = m_pending = size();
   m_replied = 0;
 
-  TrackerDht::add_event(m_tracker, [](TrackerDht* tracker) {
+  if (m_report_status)
+    TrackerDht::add_event(m_tracker, [](TrackerDht* tracker) {
       tracker->set_dht_announce_state();
     });
 
-  for (const auto& [node, _] : *this)
-    set_node_active(node, true);
+  for (unsigned int position = 0; position != size(); position++)
+    set_node_active(node_at(position), true);
 
-  return const_accessor(begin());
+  return begin();
 }
 
-void
+size_t
 DhtAnnounce::receive_peers(raw_list peers) {
   AddressList address_list;
   address_list.parse_address_bencode(peers);
 
+  size_t count = address_list.size();
+
   TrackerDht::add_event(m_tracker, [address_list = std::move(address_list)](TrackerDht* tracker) mutable {
       tracker->receive_peers(std::move(address_list));
     });
+
+  return count;
 }
 
 void
 DhtAnnounce::update_status() {
+  if (!m_report_status)
+    return;
+
   TrackerDht::add_event(m_tracker, [contacted = m_contacted, replied = m_replied](TrackerDht* tracker) {
       tracker->receive_progress(replied, contacted);
     });
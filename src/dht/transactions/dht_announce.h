@@ -8,6 +8,9 @@
 
 // DhtAnnounce is a derived class used for searches that will eventually lead to an announce to the
 // closest nodes.
+//
+// When the torrent is announced on both the IPv4 and IPv6 DHT, only one of the announces reports
+// progress and the final result to the tracker, while both pass on the peers they find.
 
 namespace torrent {
 
@@ -20,7 +23,7 @@ namespace torrent::dht {
 
 class DhtAnnounce : public DhtSearch {
 public:
-  DhtAnnounce(DhtServer* server, const HashString& infoHash, std::weak_ptr<TrackerDht> tracker);
+  DhtAnnounce(DhtServer* server, const HashString& infoHash, std::weak_ptr<TrackerDht> tracker, bool report_status = true);
   ~DhtAnnounce() override;
 
   bool                 is_announce() const override      { return true; }
@@ -32,11 +35,13 @@ public:
   // counts announces instead.
   const_accessor       start_announce();
 
-  void                 receive_peers(raw_list peers);
+  // Returns the number of peers received.
+  size_t               receive_peers(raw_list peers);
   void                 update_status();
 
 private:
   std::weak_ptr<TrackerDht> m_tracker;
+  bool                      m_report_status;
 };
 
 } // namespace torrent::dht
@@ -2,26 +2,22 @@
 
 #include "dht/transactions/dht_search.h"
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cstring>
 
+#include "dht/dht_bucket.h"
 #include "dht/dht_node.h"
 #include "dht/dht_server.h"
 
 namespace torrent::dht {
 
-bool
-dht_compare_closer::operator () (const std::unique_ptr<DhtNode>& one, const std::unique_ptr<DhtNode>& two) const {
-  return DhtSearch::is_closer(one->id(), two->id(), m_target);
-}
-
 DhtSearch::DhtSearch(DhtServer* server, const HashString& target)
-  : base_type(dht_compare_closer(target)),
-    m_next(end()),
-    m_server(server),
+  : m_server(server),
     m_target(target) {
 
-  // TODO: Must be done manually to ensure we got a shared_ptr.
-  // add_contacts(contacts);
+  m_next = end();
 }
 
 DhtSearch::~DhtSearch() {
@@ -30,28 +26,34 @@ DhtSearch::~DhtSearch() {
   // case.
   assert(!m_pending && "DhtSearch::~DhtSearch called with pending transactions.");
   assert(m_concurrency == 3 && "DhtSearch::~DhtSearch called with invalid concurrency limit.");
-
-  // TODO: Hack.
-  // for (auto& itr : *this)
-  //   itr.second->server()->check_search_trimming(itr.second);
 }
 
-// TODO: Check if DhtSearch gets stored somewhere, and DhtBucket seems the most likely candidate.
-//
-// This seems to be storing self in the map.
-
-//
-// TODO: Remove self stored in the map, and when getting accessor from map, also pass the (self) DhtSearch.
-//
-
 bool
 DhtSearch::add_contact(const HashString& id, const sockaddr* sa) {
-  auto [itr, added] = emplace(std::make_unique<DhtNode>(id, sa), shared_from_this());
+  auto distance = make_distance(id, m_target);
+  auto position = static_cast<unsigned int>(std::lower_bound(m_order, m_order + m_size, distance, [this](uint8_t slot, const distance_type& d) {
+      return m_distance[slot] < d;
+    }) - m_order);
+
+  // Equal distance means equal id.
+  if (position != m_size && m_distance[m_order[position]] == distance)
+    return false;
+
+  if (m_size == max_candidates && !evict_farther(position))
+    return false;
 
-  if (added)
-    m_restart = true;
+  auto slot = static_cast<unsigned int>(std::countr_one(m_used));
 
-  return added;
+  m_nodes[slot]    = DhtNode(id, sa);
+  m_distance[slot] = distance;
+  m_used          |= uint64_t{1} << slot;
+
+  std::memmove(m_order + position + 1, m_order + position, m_size - position);
+  m_order[position] = slot;
+  m_size++;
+
+  m_restart = true;
+  return true;
 }
 
 void
@@ -70,8 +72,8 @@ DhtSearch::add_contacts(const DhtBucket& contacts) {
       itr = chain.bucket()->begin();
     }
 
-    if ((!(*itr)->is_bad() || needClosest > 0) && add_contact((*itr)->id(), (*itr)->address())) {
-      needGood -= !(*itr)->is_bad();
+    if ((!itr->is_bad() || needClosest > 0) && add_contact(itr->id(), itr->address())) {
+      needGood -= !itr->is_bad();
       needClosest--;
     }
   }
@@ -80,8 +82,8 @@ DhtSearch::add_contacts(const DhtBucket& contacts) {
 // Check if a node has been contacted yet.  This is the case if it is not currently
 // being contacted, nor has it been found to be good or bad.
 bool
-DhtSearch::node_uncontacted(const std::unique_ptr<DhtNode>& node) {
-  return !node->is_active() && !node->is_good() && !node->is_bad();
+DhtSearch::node_uncontacted(const DhtNode& node) {
+  return !node.is_active() && !node.is_good() && !node.is_bad();
 }
 
 // After more contacts have been added, discard least closest nodes
@@ -109,33 +111,31 @@ DhtSearch::trim(bool is_final) {
   // We're done if we can't find any more nodes to contact.
   m_next = end();
 
-  for (accessor itr = base_type::begin(); itr != end(); ) {
-    // If we have all we need, delete current node unless it is
-    // currently being contacted.
-    if (!itr.node()->is_active() && needClosest <= 0 && (!itr.node()->is_good() || needGood <= 0)) {
-      // TODO: Temporary hack.
-        // TODO: Add server function to add it to m_search if not complete.
-        // TODO: We should replace m_pending with a vector of txs.
-
-      // TODO: We're somehow storying self in the map, and erasing causes crash as m_pending == 2.
+  unsigned int kept = 0;
 
-      // itr.search()->server()->check_search_trimming(itr.search());
+  for (unsigned int position = 0; position != m_size; position++) {
+    unsigned int slot = m_order[position];
+    DhtNode&     node = m_nodes[slot];
 
-      erase(itr++);
+    // If we have all we need, delete current node unless it is
+    // currently being contacted.
+    if (!node.is_active() && needClosest <= 0 && (!node.is_good() || needGood <= 0)) {
+      m_used &= ~(uint64_t{1} << slot);
       continue;
     }
 
     // Otherwise adjust needed counts appropriately.
     needClosest--;
-    needGood -= itr.node()->is_good();
+    needGood -= node.is_good();
 
     // Remember the first uncontacted node as the closest one to contact next.
-    if (m_next == end() && node_uncontacted(itr.node()))
-      m_next = const_accessor(itr);
+    if (m_next == end() && node_uncontacted(node))
+      m_next = const_accessor(this, slot);
 
-    ++itr;
+    m_order[kept++] = slot;
   }
 
+  m_size = kept;
   m_restart = false;
 }
 
@@ -170,7 +170,7 @@ DhtSearch::get_contact() {
 
   // Find next node to contact: any node we haven't contacted yet.
   while (++m_next != end()) {
-    if (node_uncontacted(m_next.node()))
+    if (node_uncontacted(*m_next.node()))
       break;
   }
 
@@ -178,7 +178,7 @@ DhtSearch::get_contact() {
 }
 
 void
-DhtSearch::node_status(const std::unique_ptr<DhtNode>& n, bool success) {
+DhtSearch::node_status(DhtNode* n, bool success) {
   if (!n->is_active())
     throw internal_error("DhtSearch::node_status called for invalid/inactive node.");
 
@@ -195,8 +195,75 @@ DhtSearch::node_status(const std::unique_ptr<DhtNode>& n, bool success) {
 }
 
 void
-DhtSearch::set_node_active(const std::unique_ptr<DhtNode>& n, bool active) {
+DhtSearch::set_node_active(DhtNode* n, bool active) {
   n->m_last_seen = active;
 }
 
+DhtSearch::distance_type
+DhtSearch::make_distance(const HashString& id, const HashString& target) {
+  uint8_t buffer[HashString::size_data];
+
+  for (unsigned int i = 0; i != HashString::size_data; i++)
+    buffer[i] = id[i] ^ target[i];
+
+  distance_type distance{};
+
+  for (unsigned int i = 0; i != 8; i++) {
+    distance.high   = (distance.high << 8) | buffer[i];
+    distance.middle = (distance.middle << 8) | buffer[i + 8];
+  }
+
+  for (unsigned int i = 16; i != HashString::size_data; i++)
+    distance.low = (distance.low << 8) | buffer[i];
+
+  return distance;
+}
+
+unsigned int
+DhtSearch::position_of(unsigned int slot) const {
+  auto itr = std::find(m_order, m_order + m_size, slot);
+
+  if (itr == m_order + m_size)
+    throw internal_error("DhtSearch::position_of() slot not found.");
+
+  return itr - m_order;
+}
+
+unsigned int
+DhtSearch::next_slot(unsigned int slot) const {
+  unsigned int position = position_of(slot) + 1;
+
+  return position != m_size ? m_order[position] : npos;
+}
+
+// Makes room for a node to be inserted at 'position' by erasing the farthest node beyond it that
+// isn't being contacted or known good.
+bool
+DhtSearch::evict_farther(unsigned int position) {
+  for (unsigned int i = m_size; i-- > position; ) {
+    const DhtNode& node = m_nodes[m_order[i]];
+
+    if (node.is_active() || node.is_good())
+      continue;
+
+    erase_position(i);
+    return true;
+  }
+
+  return false;
+}
+
+void
+DhtSearch::erase_position(unsigned int position) {
+  unsigned int slot = m_order[position];
+
+  if (m_next.m_slot == slot)
+    m_next = end();
+
+  m_used &= ~(uint64_t{1} << slot);
+
+  std::memmove(m_order + position, m_order + position + 1, m_size - position - 1);
+  m_size--;
+}
+
 } // namespace torrent::dht
@@ -1,8 +1,10 @@
 #ifndef LIBTORRENT_DHT_TRANSACTIONS_DHT_SEARCH_H
 #define LIBTORRENT_DHT_TRANSACTIONS_DHT_SEARCH_H
 
+#include <compare>
 #include <memory>
 
+#include "dht/dht_node.h"
 #include "torrent/common.h"
 #include "torrent/hash_string.h"
 #include "torrent/object_static_map.h"
@@ -13,15 +15,15 @@
 // DhtSearch contains a list of nodes sorted by closeness to the given target, and returns what
 // nodes to contact with up to three concurrent transactions pending.
 //
-// The map element is the DhtSearch object itself to allow the returned accessors to know which
-// search a given node belongs to.
+// Candidate nodes are stored inline in fixed slots, with a separate array of slot indices kept
+// sorted by XOR distance to the target. When all slots are used a new node replaces the farthest
+// node that is neither pending nor good, if it is closer.
 
 // TODO: Consider moving this to dht/
 
 namespace torrent {
 
 class DhtBucket;
-class DhtNode;
 class DhtServer;
 class DhtTransactionSearch;
 class TrackerDht;
@@ -30,47 +32,40 @@ class TrackerDht;
 
 namespace torrent::dht {
 
-// Compare predicate for ID closeness.
-struct dht_compare_closer {
-  dht_compare_closer(const HashString& target) : m_target(target) { }
-
-  const HashString&   target() const            { return m_target; }
-  raw_string          target_raw_string() const { return raw_string(m_target.data(), HashString::size_data); }
-
-  bool operator () (const std::unique_ptr<DhtNode>& one, const std::unique_ptr<DhtNode>& two) const;
-
-private:
-  const HashString    m_target;
-};
-
 // Use std::enable_shared_from_this as a temporary hack.
 
-class DhtSearch : public std::enable_shared_from_this<DhtSearch>, protected std::map<std::unique_ptr<DhtNode>, std::shared_ptr<DhtSearch>, dht_compare_closer> {
+class DhtSearch : public std::enable_shared_from_this<DhtSearch> {
 public:
-  using base_type = std::map<std::unique_ptr<DhtNode>, std::shared_ptr<DhtSearch>, dht_compare_closer>;
-
-  // max_contacts: Number of closest potential contact nodes to keep.
-  // max_announce: Number of closest nodes we actually announce to.
-  static constexpr unsigned int max_contacts = 18;
-  static constexpr unsigned int max_announce = 3;
+  // max_contacts:   Number of closest potential contact nodes to keep.
+  // max_announce:   Number of closest nodes we actually announce to.
+  // max_candidates: Number of nodes that can be held between trims.
+  static constexpr unsigned int max_contacts   = 18;
+  static constexpr unsigned int max_announce   = 3;
+  static constexpr unsigned int max_candidates = 64;
 
   DhtSearch(DhtServer* server, const HashString& target);
   virtual ~DhtSearch();
 
-  // Wrapper for iterators, allowing more convenient access to the key
-  // and element values, which also makes it easier to change the container
-  // without having to modify much code using iterators.
-  template <typename T>
-  struct accessor_wrapper : public T {
-    accessor_wrapper() = default;
-    accessor_wrapper(const T& itr) : T(itr) { }
+  // Handle to a candidate node, stays valid until the node is trimmed. Incrementing moves to the
+  // next closest node.
+  class const_accessor {
+  public:
+    const_accessor() = default;
+    const_accessor(DhtSearch* search, unsigned int slot) : m_search(search), m_slot(slot) { }
 
-    const auto&                       node() const     { return (**this).first; }
-    const std::shared_ptr<DhtSearch>& search() const   { return (**this).second; }
-  };
+    DhtNode*            node() const    { return &m_search->m_nodes[m_slot]; }
+    DhtSearch*          search() const  { return m_search; }
+
+    const_accessor&     operator++()    { m_slot = m_search->next_slot(m_slot); return *this; }
+
+    bool                operator==(const const_accessor&) const = default;
+
+  private:
+    friend class DhtSearch;
 
-  using const_accessor = accessor_wrapper<base_type::const_iterator>;
-  using accessor       = accessor_wrapper<base_type::iterator>;
+    DhtSearch*          m_search{};
+    unsigned int        m_slot{npos};
+  };
 
   // Add a potential node to contact for the search.
   bool                 add_contact(const HashString& id, const sockaddr* sa);
@@ -80,6 +75,9 @@ public:
   // and end() after that. Don't advance the accessor to get further contacts!
   const_accessor       get_contact();
 
+  bool                 empty() const                     { return m_size == 0; }
+  unsigned int         size() const                      { return m_size; }
+
   // Search statistics.
   int                  num_contacted() const             { return m_contacted; }
   int                  num_replied() const               { return m_replied; }
@@ -92,9 +90,8 @@ public:
 
   virtual bool         is_announce() const               { return false; }
 
-  // Expose the otherwise private end() function but return an accessor,
-  // to allow code checking whether get_contact returned a valid accessor.
-  const_accessor       end() const                       { return base_type::end(); }
+  const_accessor       begin()                           { return const_accessor(this, m_size != 0 ? m_order[0] : npos); }
+  const_accessor       end()                             { return const_accessor(this, npos); }
 
   // Used by the sorting/comparison predicate to see which node is closer.
   static bool          is_closer(const HashString& one, const HashString& two, const HashString& target);
@@ -104,10 +101,12 @@ protected:
 
   DhtServer*           server() const                    { return m_server; }
 
+  DhtNode*             node_at(unsigned int position)    { return &m_nodes[m_order[position]]; }
+
   void                 trim(bool is_final);
 
-  void                 node_status(const std::unique_ptr<DhtNode>& n, bool success);
-  static void          set_node_active(const std::unique_ptr<DhtNode>& n, bool active);
+  void                 node_status(DhtNode* n, bool success);
+  static void          set_node_active(DhtNode* n, bool active);
 
   // Statistics about contacted nodes.
   unsigned int         m_pending{0};
@@ -125,10 +124,36 @@ private:
   DhtSearch(const DhtSearch&) = delete;
   DhtSearch& operator=(const DhtSearch&) = delete;
 
-  static bool          node_uncontacted(const std::unique_ptr<DhtNode>& node);
+  static constexpr unsigned int npos = ~0u;
+
+  // XOR distance to the target as big-endian words, so distances compare as integers.
+  struct distance_type {
+    uint64_t           high;
+    uint64_t           middle;
+    uint32_t           low;
+
+    auto operator<=>(const distance_type&) const = default;
+  };
+
+  static distance_type make_distance(const HashString& id, const HashString& target);
+  static bool          node_uncontacted(const DhtNode& node);
+
+  unsigned int         position_of(unsigned int slot) const;
+  unsigned int         next_slot(unsigned int slot) const;
+
+  bool                 evict_farther(unsigned int position);
+  void                 erase_position(unsigned int position);
 
   DhtServer*           m_server;
   HashString           m_target;
+
+  unsigned int         m_size{};
+  uint64_t             m_used{};
+  uint8_t              m_order[max_candidates];
+  distance_type        m_distance[max_candidates];
+  DhtNode              m_nodes[max_candidates];
+
+  static_assert(max_candidates <= 64, "m_used is a 64-bit mask");
 };
 
 } // namespace torrent::dht
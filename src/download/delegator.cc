@@ -10,6 +10,19 @@
 
 namespace torrent {
 
+// The endgame index only follows the transfer list while in aggressive
+// mode, it is rebuilt when entering it.
+Delegator::Delegator() {
+  m_transfers.slot_inserted() = [this](BlockList* block_list) {
+      if (m_aggressive)
+        m_endgame.insert(block_list);
+    };
+  m_transfers.slot_erased() = [this](BlockList* block_list) {
+      if (m_aggressive)
+        m_endgame.erase(block_list);
+    };
+}
+
 std::vector<BlockTransfer*>
 Delegator::delegate(PeerChunks* peerChunks, std::optional<uint32_t> affinity, uint32_t maxPieces) {
   // TODO: Make sure we don't queue the same piece several time on the same peer when
@@ -78,33 +91,24 @@ Delegator::delegate(PeerChunks* peerChunks, std::optional<uint32_t> affinity, ui
   if (!m_aggressive)
     return new_transfers;
 
-  // In aggressive mode, look for possible downloads that already have
-  // one or more transfers queued.
+  // In aggressive mode, request blocks that already have transfers
+  // queued if this peer is expected to finish them sooner.
+  m_endgame.delegate(new_transfers, maxPieces, peerChunks);
 
-  // No more than 4 per piece.
-  uint16_t overlapped = 5;
+  return new_transfers;
+}
 
-  for (BlockList* itr : m_transfers) {
-    if (new_transfers.size() >= maxPieces)
-      return new_transfers;
+void
+Delegator::set_aggressive(bool a) {
+  if (a == m_aggressive)
+    return;
 
-    if (peerChunks->bitfield()->get(itr->index()) && itr->priority() != PRIORITY_OFF) {
-      for (auto bl_itr = itr->begin(); bl_itr != itr->end() && overlapped != 0; bl_itr++) {
-        if (new_transfers.size() >= maxPieces || bl_itr->size_not_stalled() >= overlapped)
-          break;
-
-        if (!bl_itr->is_finished()) {
-          BlockTransfer* inserted_info = bl_itr->insert(peerInfo);
-          if (inserted_info != NULL) {
-            new_transfers.push_back(inserted_info);
-            overlapped = bl_itr->size_not_stalled();
-          }
-        }
-      }
-    }
-  }
+  m_aggressive = a;
 
-  return new_transfers;
+  if (m_aggressive)
+    m_endgame.rebuild(&m_transfers);
+  else
+    m_endgame.clear();
 }
 
 void
@@ -6,6 +6,7 @@
 #include <string>
 #include <vector>
 
+#include "download/endgame.h"
 #include "torrent/data/transfer_list.h"
 
 namespace torrent {
@@ -24,13 +25,18 @@ public:
 
   static constexpr unsigned int block_size = 1 << 14;
 
+  Delegator();
+
   TransferList*       transfer_list()                     { return &m_transfers; }
   const TransferList* transfer_list() const               { return &m_transfers; }
 
   std::vector<BlockTransfer*> delegate(PeerChunks* peerChunks, std::optional<uint32_t> affinity, uint32_t maxPieces);
 
   bool               get_aggressive() const               { return m_aggressive; }
-  void               set_aggressive(bool a)               { m_aggressive = a; }
+  void               set_aggressive(bool a);
+
+  Endgame*           endgame()                            { return &m_endgame; }
+  const Endgame*     endgame() const                      { return &m_endgame; }
 
   slot_peer_chunk&   slot_chunk_find()                    { return m_slot_chunk_find; }
   slot_size&         slot_chunk_size()                    { return m_slot_chunk_size; }
@@ -43,6 +49,7 @@ private:
   TransferList       m_transfers;
 
   bool               m_aggressive{false};
+  Endgame            m_endgame;
 
   // Propably should add a m_slotChunkStart thing, which will take
   // care of enabling etc, and will be possible to listen to.
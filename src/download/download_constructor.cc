@@ -12,11 +12,22 @@
 #include "torrent/exceptions.h"
 #include "torrent/data/file.h"
 #include "torrent/data/file_list.h"
+#include "torrent/object_stream.h"
+#include "torrent/utils/codec.h"
 #include "torrent/utils/string_manip.h"
 #include "tracker/tracker_list.h"
 
 namespace torrent {
 
+// Strings in the info dictionary may be raw views into the retained source buffer.
+static std::string_view
+object_string_view(const Object& b) {
+  if (b.is_raw_string())
+    return std::string_view(b.as_raw_string().data(), b.as_raw_string().size());
+
+  return b.as_string();
+}
+
 void
 DownloadConstructor::initialize(Object& b) {
   if (!b.has_key_map("info") && b.has_key_string("magnet-uri"))
@@ -38,7 +49,7 @@ DownloadConstructor::parse_name(const Object& b) {
   if (is_invalid_path_element(b.get_key("name")))
     throw input_error("Bad torrent file, \"name\" is an invalid path name.");
 
-  m_download->info()->set_name(b.get_key_string("name"));
+  m_download->info()->set_name(std::string(object_string_view(b.get_key("name"))));
 }
 
 void
@@ -60,7 +71,7 @@ DownloadConstructor::parse_info(const Object& b) {
     if (b.has_key("length") || b.has_key("files"))
       throw input_error("Meta-download has file entries.");
 
-    if (b.get_key_string("pieces").length() != HashString::size_data)
+    if (object_string_view(b.get_key("pieces")).size() != HashString::size_data)
       throw input_error("Meta-download has invalid piece data.");
 
     chunkSize = 1;
@@ -92,7 +103,12 @@ DownloadConstructor::parse_info(const Object& b) {
 
   // Set chunksize before adding files to make sure the index range is
   // correct.
-  m_download->set_complete_hash(b.get_key_string("pieces"));
+  const auto& pieces = b.get_key("pieces");
+
+  if (pieces.is_raw_string())
+    m_download->set_complete_hash_view(object_string_view(pieces));
+  else
+    m_download->set_complete_hash(pieces.as_string());
 
   if (m_download->complete_hash().size() / 20 < fileList->size_chunks())
     throw bencode_error("Torrent size and 'info:pieces' length does not match.");
@@ -150,13 +166,17 @@ DownloadConstructor::add_tracker_single(const Object& b, int group) {
 
 bool
 DownloadConstructor::is_valid_path_element(const Object& b) {
+  return (b.is_string() || b.is_raw_string()) && is_valid_path_element(object_string_view(b));
+}
+
+bool
+DownloadConstructor::is_valid_path_element(std::string_view str) {
   return
-    b.is_string() &&
-    !b.as_string().empty() &&
-    b.as_string() != "." &&
-    b.as_string() != ".." &&
-    std::find(b.as_string().begin(), b.as_string().end(), '/') == b.as_string().end() &&
-    std::find(b.as_string().begin(), b.as_string().end(), '\0') == b.as_string().end();
+    !str.empty() &&
+    str != "." &&
+    str != ".." &&
+    str.find('/') == std::string_view::npos &&
+    str.find('\0') == std::string_view::npos;
 }
 
 void
@@ -174,7 +194,7 @@ DownloadConstructor::parse_single_file(const Object& b, uint32_t chunkSize) {
   fileList->set_multi_file(false);
 
   Path path;
-  path.push_back(b.get_key_string("name"));
+  path.push_back(std::string(object_string_view(b.get_key("name"))));
 
   if (path.empty())
     throw input_error("Bad torrent file, an entry has no valid filename.");
@@ -185,42 +205,26 @@ DownloadConstructor::parse_single_file(const Object& b, uint32_t chunkSize) {
 
 void
 DownloadConstructor::parse_multi_files(const Object& b, uint32_t chunk_size) {
-  const Object::list_type& object_list = b.as_list();
-
-  // Multi file torrent
-  if (object_list.empty())
-    throw input_error("Bad torrent file, entry has no files.");
-
   int64_t torrent_size = 0;
   std::vector<FileList::split_type> split_list;
-  split_list.reserve(object_list.size());
-
-  for (const auto& object : object_list) {
-    Path path;
-
-    if (object.has_key_list("path"))
-      path = create_path(object.get_key_list("path"));
-
-    if (path.empty())
-      throw input_error("Bad torrent file, an entry has no valid filename.");
 
-    int64_t length = object.get_key_value("length");
+  // File entries of zero-copy parsed torrents are read directly from the raw list.
+  if (b.is_raw_list()) {
+    raw_list_for_each(b.as_raw_list(), [&](const raw_bencode& entry) {
+        parse_file_entry_raw(entry, split_list, torrent_size);
+      });
 
-    if (length < 0 || length > std::numeric_limits<int64_t>::max() - torrent_size)
-      throw input_error("Bad torrent file, invalid length for file.");
-
-    torrent_size += length;
-
-    int attr_flags = 0;
-
-    if (object.has_key_string("attr")) {
-      if (object.get_key_string("attr").find('p') != std::string::npos)
-        attr_flags |= File::flag_attr_padding;
-    }
+  } else {
+    split_list.reserve(b.as_list().size());
 
-    split_list.emplace_back(length, path, attr_flags);
+    for (const auto& object : b.as_list())
+      parse_file_entry(object, split_list, torrent_size);
   }
 
+  // Multi file torrent
+  if (split_list.empty())
+    throw input_error("Bad torrent file, entry has no files.");
+
   std::vector<const Path*> sorted_paths;
   sorted_paths.reserve(split_list.size());
 
@@ -240,7 +244,71 @@ DownloadConstructor::parse_multi_files(const Object& b, uint32_t chunk_size) {
   file_list->update_paths(file_list->begin(), file_list->end());
 }
 
-inline Path
+void
+DownloadConstructor::parse_file_entry(const Object& b, std::vector<FileList::split_type>& split_list, int64_t& torrent_size) {
+  Path path;
+
+  if (b.has_key_list("path"))
+    path = create_path(b.get_key_list("path"));
+
+  if (path.empty())
+    throw input_error("Bad torrent file, an entry has no valid filename.");
+
+  int64_t length = b.get_key_value("length");
+
+  if (length < 0 || length > std::numeric_limits<int64_t>::max() - torrent_size)
+    throw input_error("Bad torrent file, invalid length for file.");
+
+  torrent_size += length;
+
+  int attr_flags = 0;
+
+  if (b.has_key_string("attr")) {
+    if (b.get_key_string("attr").find('p') != std::string::npos)
+      attr_flags |= File::flag_attr_padding;
+  }
+
+  split_list.emplace_back(length, std::move(path), attr_flags);
+}
+
+void
+DownloadConstructor::parse_file_entry_raw(const raw_bencode& b, std::vector<FileList::split_type>& split_list, int64_t& torrent_size) {
+  if (!b.is_raw_map())
+    throw bencode_error("Bad torrent file, file entry is not a dictionary.");
+
+  Path    path;
+  Object  length_object;
+  int     attr_flags = 0;
+
+  raw_map_for_each(b.as_raw_map(), [&](const raw_string& key, const raw_bencode& value) {
+      if (raw_bencode_equal_c_str(key, "path") && value.is_raw_list())
+        path = create_path_raw(value.as_raw_list());
+
+      else if (raw_bencode_equal_c_str(key, "length"))
+        object_read_bencode_c(value.begin(), value.end(), &length_object);
+
+      else if (raw_bencode_equal_c_str(key, "attr") && value.is_raw_string() &&
+               std::find(value.as_raw_string().begin(), value.as_raw_string().end(), 'p') != value.as_raw_string().end())
+        attr_flags |= File::flag_attr_padding;
+    });
+
+  if (path.empty())
+    throw input_error("Bad torrent file, an entry has no valid filename.");
+
+  if (!length_object.is_value())
+    throw bencode_error("Bad torrent file, file entry has no length.");
+
+  int64_t length = length_object.as_value();
+
+  if (length < 0 || length > std::numeric_limits<int64_t>::max() - torrent_size)
+    throw input_error("Bad torrent file, invalid length for file.");
+
+  torrent_size += length;
+
+  split_list.emplace_back(length, std::move(path), attr_flags);
+}
+
+Path
 DownloadConstructor::create_path(const Object::list_type& plist) {
   // Make sure we are given a proper file path.
   if (plist.empty())
@@ -252,49 +320,45 @@ DownloadConstructor::create_path(const Object::list_type& plist) {
   Path p;
 
   for (const auto& path : plist)
-    p.push_back(path.as_string());
+    p.push_back_element(m_path_pool.intern(object_string_view(path)));
 
   return p;
 }
 
+Path
+DownloadConstructor::create_path_raw(const raw_list& plist) {
+  Path p;
+
+  raw_list_for_each(plist, [this, &p](const raw_bencode& element) {
+      if (!element.is_raw_string())
+        throw input_error("Bad torrent file, \"path\" has zero entries or a zero length entry.");
+
+      auto str = element.as_raw_string();
+      auto view = std::string_view(str.data(), str.size());
+
+      if (!is_valid_path_element(view))
+        throw input_error("Bad torrent file, \"path\" has zero entries or a zero length entry.");
+
+      p.push_back_element(m_path_pool.intern(view));
+    });
+
+  if (p.empty())
+    throw input_error("Bad torrent file, \"path\" has zero entries.");
+
+  return p;
+}
+
+// Expects exactly the 32 characters of a base32 SHA1, returns the position after the separating
+// '&' or NULL if invalid.
 static const char*
 parse_base32_sha1(const char* pos, const char* end, HashString& hash) {
-  HashString::iterator hashItr = hash.begin();
+  const char* last = std::find(pos, end, '&');
 
-  static constexpr int base_shift = 8+8-5;
-  int shift = base_shift;
-  uint16_t decoded = 0;
-
-  while (pos != end) {
-    char c = *pos++;
-    uint16_t value;
-
-    if (c >= 'A' && c <= 'Z')
-      value = c - 'A';
-    else if (c >= 'a' && c <= 'z')
-      value = c - 'a';
-    else if (c >= '2' && c <= '7')
-      value = 26 + c - '2';
-    else if (c == '&')
-      break;
-    else
-      return NULL;
-
-    decoded |= (value << shift);
-    if (shift <= 8) {
-      // Too many characters for a base32 SHA1.
-      if (hashItr == hash.end())
-        return NULL;
-
-      *hashItr++ = (decoded >> 8);
-      decoded <<= 8;
-      shift += 3;
-    } else {
-      shift -= 5;
-    }
-  }
+  if (last - pos != static_cast<ptrdiff_t>(utils::codec_base32_size(HashString::size_data)) ||
+      !utils::codec_decode_base32(pos, last - pos, hash.data()))
+    return NULL;
 
-  return hashItr != hash.end() || shift != base_shift ? NULL : pos;
+  return last == end ? last : last + 1;
 }
 
 void
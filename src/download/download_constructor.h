@@ -2,8 +2,11 @@
 #define LIBTORRENT_PARSE_DOWNLOAD_CONSTRUCTOR_H
 
 #include <list>
+#include <string_view>
+#include <vector>
 
 #include "torrent/object.h"
+#include "torrent/data/file_list.h"
 
 namespace torrent {
 
@@ -28,14 +31,22 @@ private:
   void                add_tracker_single(const Object& b, int group);
 
   static bool         is_valid_path_element(const Object& b);
+  static bool         is_valid_path_element(std::string_view str);
   static bool         is_invalid_path_element(const Object& b) { return !is_valid_path_element(b); }
 
   void                parse_single_file(const Object& b, uint32_t chunkSize);
   void                parse_multi_files(const Object& b, uint32_t chunkSize);
 
-  static Path         create_path(const Object::list_type& plist);
+  void                parse_file_entry(const Object& b, std::vector<FileList::split_type>& split_list, int64_t& torrent_size);
+  void                parse_file_entry_raw(const raw_bencode& b, std::vector<FileList::split_type>& split_list, int64_t& torrent_size);
+
+  Path                create_path(const Object::list_type& plist);
+  Path                create_path_raw(const raw_list& plist);
 
   DownloadWrapper*    m_download{};
+
+  // Shares the storage of path elements repeated between files.
+  string_utf8_pool    m_path_pool;
 };
 
 } // namespace torrent
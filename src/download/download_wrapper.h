@@ -1,8 +1,11 @@
 #ifndef LIBTORRENT_DOWNLOAD_WRAPPER_H
 #define LIBTORRENT_DOWNLOAD_WRAPPER_H
 
+#include <string_view>
+
 #include "data/chunk_handle.h"
 #include "download_main.h"
+#include "torrent/object_raw_bencode.h"
 
 namespace torrent {
 
@@ -41,12 +44,22 @@ public:
   Object*             bencode()                               { return m_bencode.get(); }
   void                set_bencode(Object* o)                  { m_bencode.reset(o); }
 
+  // Keeps the buffer alive for raw views in the bencode object.
+  void                set_bencode_source(std::shared_ptr<const std::string> s) { m_bencode_source = std::move(s); }
+
+  // The original bytes of the info dictionary within the bencode source, empty if not retained.
+  const raw_bencode&  info_span() const                       { return m_info_span; }
+  void                set_info_span(raw_bencode span)         { m_info_span = span; }
+
   HashQueue*          hash_queue()                            { return m_hash_queue; }
   void                set_hash_queue(HashQueue* q)            { m_hash_queue = q; }
 
-  const std::string&  complete_hash()                            { return m_hash; }
-  const char*         chunk_hash(unsigned int index)             { return m_hash.c_str() + 20 * index; }
-  void                set_complete_hash(const std::string& hash) { m_hash = hash; }
+  std::string_view    complete_hash() const                      { return m_hash; }
+  const char*         chunk_hash(unsigned int index)             { return m_hash.data() + 20 * index; }
+
+  // Views must point into the retained bencode source, anything else is copied.
+  void                set_complete_hash(std::string hash)        { m_hash_storage = std::move(hash); m_hash = m_hash_storage; }
+  void                set_complete_hash_view(std::string_view hash) { m_hash_storage.clear(); m_hash = hash; }
 
   int                 connection_type() const                 { return m_connectionType; }
   void                set_connection_type(int t)              { m_connectionType = t; }
@@ -72,11 +85,14 @@ private:
   void                finished_download();
 
   std::unique_ptr<DownloadMain> m_main;
+  std::shared_ptr<const std::string> m_bencode_source;
+  raw_bencode                   m_info_span;
   std::unique_ptr<Object>       m_bencode;
   std::unique_ptr<HashTorrent>  m_hash_checker;
   HashQueue*                    m_hash_queue;
 
-  std::string         m_hash;
+  std::string_view    m_hash;
+  std::string         m_hash_storage;
 
   int                 m_connectionType{0};
 };
@@ -0,0 +1,150 @@
+#include "config.h"
+
+#include "download/endgame.h"
+
+#include <algorithm>
+
+#include "protocol/peer_chunks.h"
+#include "protocol/peer_connection_base.h"
+#include "torrent/bitfield.h"
+#include "torrent/data/block.h"
+#include "torrent/data/block_list.h"
+#include "torrent/data/block_transfer.h"
+#include "torrent/data/transfer_list.h"
+
+namespace torrent {
+
+Endgame::Endgame()
+  : m_slot_peer_rate(&Endgame::peer_rate) {
+}
+
+void
+Endgame::clear() {
+  m_index.clear();
+}
+
+void
+Endgame::rebuild(TransferList* transfer_list) {
+  m_index.clear();
+
+  for (BlockList* block_list : *transfer_list)
+    add_blocks(block_list);
+
+  sort();
+}
+
+void
+Endgame::insert(BlockList* block_list) {
+  add_blocks(block_list);
+  sort();
+}
+
+// Called before the block list is deleted, the Block pointers of its
+// entries are about to become invalid.
+void
+Endgame::erase(BlockList* block_list) {
+  std::erase_if(m_index, [block_list](const value_type& v) { return v.second->parent() == block_list; });
+}
+
+void
+Endgame::delegate(std::vector<BlockTransfer*>& transfers, uint32_t max_pieces, PeerChunks* peer_chunks) {
+  PeerInfo* peer_info = peer_chunks->peer_info();
+  uint32_t  rate      = m_slot_peer_rate(peer_info);
+  bool      changed   = false;
+
+  for (auto& [time, block] : m_index) {
+    if (transfers.size() >= max_pieces)
+      break;
+
+    uint32_t peer_time = estimate_time(block->piece().length(), rate);
+
+    // The index is sorted by descending time, so no later block would
+    // be completed sooner by this peer.
+    if (time != time_unknown && peer_time >= time)
+      break;
+
+    if (block->is_finished() || block->size_not_stalled() >= max_transfers)
+      continue;
+
+    if (block->parent()->priority() == PRIORITY_OFF || !peer_chunks->bitfield()->get(block->index()))
+      continue;
+
+    uint32_t current = estimate_block_time(block);
+
+    if (current != time) {
+      time    = current;
+      changed = true;
+    }
+
+    if (current != time_unknown && peer_time >= current)
+      continue;
+
+    BlockTransfer* transfer = block->insert(peer_info);
+
+    if (transfer == nullptr)
+      continue;
+
+    transfers.push_back(transfer);
+
+    time    = std::min(time, peer_time);
+    changed = true;
+  }
+
+  if (changed)
+    sort();
+}
+
+uint32_t
+Endgame::peer_rate(PeerInfo* peer_info) {
+  if (peer_info == nullptr || peer_info->connection() == nullptr)
+    return 0;
+
+  return peer_info->connection()->c_peer_chunks()->download_throttle()->rate()->rate();
+}
+
+uint32_t
+Endgame::estimate_time(uint32_t length, uint32_t rate) {
+  if (rate == 0)
+    return time_unknown;
+
+  return std::min<uint64_t>(uint64_t{length} * 1000 / rate, time_unknown - 1);
+}
+
+uint32_t
+Endgame::estimate_block_time(const Block* block) const {
+  uint32_t time = time_unknown;
+
+  for (auto transfer : *block->transfers()) {
+    if (transfer->is_erased() || transfer->stall() != 0)
+      continue;
+
+    uint32_t remaining = transfer->piece().length() - transfer->position();
+    time = std::min(time, estimate_time(remaining, m_slot_peer_rate(transfer->const_peer_info())));
+  }
+
+  for (auto transfer : *block->queued()) {
+    if (transfer->stall() != 0)
+      continue;
+
+    time = std::min(time, estimate_time(transfer->piece().length(), m_slot_peer_rate(transfer->const_peer_info())));
+  }
+
+  return time;
+}
+
+void
+Endgame::add_blocks(BlockList* block_list) {
+  for (auto& block : *block_list) {
+    if (!block.is_finished())
+      m_index.emplace_back(estimate_block_time(&block), &block);
+  }
+}
+
+void
+Endgame::sort() {
+  std::stable_sort(m_index.begin(), m_index.end(), [](const value_type& a, const value_type& b) {
+    return a.first > b.first;
+  });
+}
+
+} // namespace torrent
@@ -0,0 +1,72 @@
+#ifndef LIBTORRENT_DOWNLOAD_ENDGAME_H
+#define LIBTORRENT_DOWNLOAD_ENDGAME_H
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace torrent {
+
+class Block;
+class BlockList;
+class BlockTransfer;
+class PeerChunks;
+class PeerInfo;
+class TransferList;
+
+// Index of unfinished blocks used in endgame mode, ordered by the
+// estimated time in milliseconds until the fastest of their current
+// transfers completes. Blocks nobody is making progress on come
+// first.
+//
+// Duplicate requests are only handed to peers that are expected to
+// download the whole block before its existing transfers finish. The
+// remaining transfers get canceled by Block::completed(...) as soon
+// as one of them lands.
+//
+// Block lists are added and removed as the transfer list inserts and
+// erases them. The estimate of a block is refreshed whenever delegate
+// looks at it, and lowered as soon as a duplicate is handed out, so
+// the next peer sees the new estimate.
+
+class Endgame {
+public:
+  using value_type = std::pair<uint32_t, Block*>;
+  using index_type = std::vector<value_type>;
+  using slot_rate  = std::function<uint32_t(PeerInfo*)>;
+
+  static constexpr uint32_t     time_unknown  = ~uint32_t();
+  static constexpr unsigned int max_transfers = 4;
+
+  Endgame();
+
+  const index_type&   index() const { return m_index; }
+
+  void                clear();
+  void                rebuild(TransferList* transfer_list);
+
+  void                insert(BlockList* block_list);
+  void                erase(BlockList* block_list);
+
+  void                delegate(std::vector<BlockTransfer*>& transfers, uint32_t max_pieces, PeerChunks* peer_chunks);
+
+  // Download rate of a peer in bytes per second, defaults to peer_rate.
+  slot_rate&          slot_peer_rate() { return m_slot_peer_rate; }
+
+  static uint32_t     peer_rate(PeerInfo* peer_info);
+  static uint32_t     estimate_time(uint32_t length, uint32_t rate);
+
+  uint32_t            estimate_block_time(const Block* block) const;
+
+private:
+  void                add_blocks(BlockList* block_list);
+  void                sort();
+
+  index_type          m_index;
+  slot_rate           m_slot_peer_rate;
+};
+
+} // namespace torrent
+
+#endif
@@ -6,6 +6,7 @@
 #include <arpa/inet.h>
 
 #include "torrent/net/socket_address.h"
+#include "torrent/utils/codec.h"
 
 namespace torrent {
 
@@ -63,34 +64,38 @@ AddressList::parse_address_normal(const Object::list_type& b) {
 
 void
 AddressList::parse_address_compact(raw_string s) {
-  if (sizeof(const SocketAddressCompact) != 6)
-    throw internal_error("ConnectionList::AddressList::parse_address_compact(...) bad struct size.");
+  size_t offset = size();
 
-  std::copy(reinterpret_cast<const SocketAddressCompact*>(s.data()),
-            reinterpret_cast<const SocketAddressCompact*>(s.data() + s.size() - s.size() % sizeof(SocketAddressCompact)),
-            std::back_inserter(*this));
+  resize(offset + utils::codec_compact_inet_count(s.size()));
+  utils::codec_decode_compact_inet(s.data(), s.size(), data() + offset);
 }
 
 void
-AddressList::parse_address_compact_ipv6(const std::string& s) {
-  if (sizeof(const SocketAddressCompact6) != 18)
-    throw internal_error("ConnectionList::AddressList::parse_address_compact_ipv6(...) bad struct size.");
+AddressList::parse_address_compact_ipv6(raw_string s) {
+  size_t offset = size();
 
-  std::copy(reinterpret_cast<const SocketAddressCompact6*>(s.c_str()),
-            reinterpret_cast<const SocketAddressCompact6*>(s.c_str() + s.size() - s.size() % sizeof(SocketAddressCompact6)),
-            std::back_inserter(*this));
+  resize(offset + utils::codec_compact_inet6_count(s.size()));
+  utils::codec_decode_compact_inet6(s.data(), s.size(), data() + offset);
 }
 
+// Entries are compact IPv4 ("6:") or IPv6 ("18:") addresses, as in DHT get_peers replies.
 void
 AddressList::parse_address_bencode(raw_list s) {
-  if (sizeof(const SocketAddressCompact) != 6)
+  if (sizeof(const SocketAddressCompact) != 6 || sizeof(const SocketAddressCompact6) != 18)
     throw internal_error("AddressList::parse_address_bencode(...) bad struct size.");
 
-  for (auto itr = s.begin(); itr + 2 + sizeof(SocketAddressCompact) <= s.end(); itr += sizeof(SocketAddressCompact)) {
-    if (*itr++ != '6' || *itr++ != ':')
-      break;
+  for (auto itr = s.begin(); itr != s.end(); ) {
+    if (itr + 2 + sizeof(SocketAddressCompact) <= s.end() && itr[0] == '6' && itr[1] == ':') {
+      insert(end(), *reinterpret_cast<const SocketAddressCompact*>(itr + 2));
+      itr += 2 + sizeof(SocketAddressCompact);
+
+    } else if (itr + 3 + sizeof(SocketAddressCompact6) <= s.end() && itr[0] == '1' && itr[1] == '8' && itr[2] == ':') {
+      insert(end(), *reinterpret_cast<const SocketAddressCompact6*>(itr + 3));
+      itr += 3 + sizeof(SocketAddressCompact6);
 
-    insert(end(), *reinterpret_cast<const SocketAddressCompact*>(itr));
+    } else {
+      break;
+    }
   }
 }
 
@@ -21,6 +21,7 @@ public:
 
   void                parse_address_compact(raw_string s);
   void                parse_address_compact(const std::string& s);
+  void                parse_address_compact_ipv6(raw_string s);
   void                parse_address_compact_ipv6(const std::string& s);
 };
 
@@ -29,6 +30,11 @@ AddressList::parse_address_compact(const std::string& s) {
   return parse_address_compact(raw_string(s.data(), s.size()));
 }
 
+inline void
+AddressList::parse_address_compact_ipv6(const std::string& s) {
+  return parse_address_compact_ipv6(raw_string(s.data(), s.size()));
+}
+
 // Move somewhere else.
 struct [[gnu::packed]] SocketAddressCompact {
   SocketAddressCompact() = default;
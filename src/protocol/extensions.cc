@@ -4,6 +4,7 @@
 
 #include <cstdarg>
 #include <cstdio>
+#include <memory>
 
 #include "manager.h"
 #include "download/download_main.h"
@@ -364,20 +365,30 @@ ProtocolExtension::send_metadata_piece(size_t piece) {
     return;
   }
 
-  // These messages will be rare, so we'll just build the
-  // metadata here instead of caching it uselessly.
-  auto buffer = new char[metadataSize];
-  object_write_bencode_c(object_write_to_buffer, NULL, object_buffer_t(buffer, buffer + metadataSize), 
-                         &(*manager->download_manager()->find(m_download->info()))->bencode()->get_key("info"));
+  auto wrapper = *manager->download_manager()->find(m_download->info());
+
+  // Serve the retained source bytes if available, else these messages will be rare, so we'll just
+  // build the metadata here instead of caching it uselessly.
+  std::unique_ptr<char[]> buffer;
+  const char*             metadata = wrapper->info_span().data();
+
+  if (wrapper->info_span().is_empty()) {
+    buffer.reset(new char[metadataSize]);
+    object_write_bencode_c(object_write_to_buffer, NULL, object_buffer_t(buffer.get(), buffer.get() + metadataSize),
+                           &wrapper->bencode()->get_key("info"));
+    metadata = buffer.get();
+
+  } else if (wrapper->info_span().size() != metadataSize) {
+    throw internal_error("ProtocolExtension::send_metadata_piece() info span does not match metadata size.");
+  }
 
   // data: { "msg_type" => 1, "piece" => ..., "total_size" => ... } followed by piece data (outside of dictionary)
   size_t length = piece == pieceEnd - 1 ? m_download->info()->metadata_size() % metadata_piece_size : metadata_piece_size;
   m_pendingType = UT_METADATA;
   m_pending = build_bencode((2 * sizeof(size_t)) + length + 120, "d8:msg_typei1e5:piecei%zue10:total_sizei%zuee", piece, metadataSize);
 
-  memcpy(m_pending.end(), buffer + (piece << metadata_piece_shift), length);
+  memcpy(m_pending.end(), metadata + (piece << metadata_piece_shift), length);
   m_pending.set(m_pending.data(), m_pending.end() + length, m_pending.owned());
-  delete [] buffer;
 }
 
 bool
@@ -76,7 +76,8 @@ public:
   void                unset_local_enabled(int t);
   void                set_remote_supported(int t)      { m_flags |= flag_remote_supported_base << t; }
 
-  // General information about peer from extension handshake.
+  // General information about peer from extension handshake, zero if
+  // the peer did not send 'reqq'.
   uint32_t            max_queue_length() const         { return m_maxQueueLength; }
 
   // Handle reading extension data from peer.
@@ -124,7 +125,7 @@ private:
   // HANDSHAKE.
   uint8_t             m_idMap[extension_count];
 
-  uint32_t            m_maxQueueLength;
+  uint32_t            m_maxQueueLength{0};
 
   // Set HANDSHAKE as enabled and supported. Those bits should not be
   // touched.
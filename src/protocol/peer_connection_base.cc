@@ -920,6 +920,8 @@ PeerConnectionBase::try_request_pieces() {
   if (request_list()->queued_empty())
     m_down_stall = 0;
 
+  request_list()->set_max_queue_length(m_extensions->max_queue_length());
+
   uint32_t pipeSize = request_list()->calculate_pipe_size(m_peer_chunks.download_throttle()->rate()->rate());
 
   // Don't start requesting if we can't do it in large enough chunks.
@@ -86,6 +86,13 @@ RequestList::delegate(uint32_t maxPieces) {
 
   instrumentation_update(INSTRUMENTATION_TRANSFER_REQUESTS_DELEGATED, transfers.size());
 
+  // Only sample the round-trip time when the pipe is empty, as the
+  // time spent in the peer's queue would otherwise be included.
+  if (!m_rtt_sample_piece && m_transfer == nullptr && pipe_size() == 0) {
+    m_rtt_sample_time = torrent::this_thread::cached_time();
+    m_rtt_sample_piece = transfers.front()->piece();
+  }
+
   for (auto transfer : transfers) {
     m_queues.push_back(bucket_queued, transfer);
     pieces.push_back(&transfer->piece());
@@ -99,14 +106,21 @@ RequestList::delegate(uint32_t maxPieces) {
 
 void
 RequestList::stall_initial() {
+  m_rtt_sample_piece.reset();
+
   queue_bucket_for_all_in_queue(m_queues, bucket_queued, &Block::stalled);
   m_queues.move_all_to(bucket_queued, bucket_stalled);
   queue_bucket_for_all_in_queue(m_queues, bucket_unordered, &Block::stalled);
   m_queues.move_all_to(bucket_unordered, bucket_stalled);
 }
 
+// The peer stopped responding to our requests, so the old latency
+// estimate can no longer be trusted.
 void
 RequestList::stall_prolonged() {
+  m_rtt = std::chrono::microseconds{};
+  m_rtt_sample_piece.reset();
+
   if (m_transfer != nullptr)
     Block::stalled(m_transfer);
 
@@ -124,6 +138,7 @@ RequestList::choked() {
   // updated within a short timespan?
 
   m_last_choke = torrent::this_thread::cached_time();
+  m_rtt_sample_piece.reset();
 
   if (m_queues.queue_empty(bucket_queued) && m_queues.queue_empty(bucket_unordered))
     return;
@@ -204,6 +219,11 @@ RequestList::downloading(const Piece& piece) {
 
   instrumentation_update(INSTRUMENTATION_TRANSFER_REQUESTS_DOWNLOADING, 1);
 
+  if (m_rtt_sample_piece && m_rtt_sample_piece->index() == piece.index() && m_rtt_sample_piece->offset() == piece.offset()) {
+    update_rtt(torrent::this_thread::cached_time() - m_rtt_sample_time);
+    m_rtt_sample_piece.reset();
+  }
+
   std::pair<int, queues_type::iterator> itr =
     queue_bucket_find_if_in_any(m_queues, request_list_same_piece(piece));
 
@@ -326,23 +346,49 @@ RequestList::is_interested_in_active() const {
   return std::any_of(list->begin(), list->end(), [this](auto transfer) { return m_peer_chunks->bitfield()->get(transfer->index()); });
 }
 
+// The base pipe size is a function of the download rate alone. When
+// the latency is known, and we're not in endgame, the pipe is grown
+// to twice the bandwidth-delay product in blocks so that the rate can
+// keep increasing on high latency links.
 uint32_t
 RequestList::calculate_pipe_size(uint32_t rate) {
-  // Change into KB.
-  rate /= 1024;
+  uint32_t size;
+  uint32_t rate_kb = rate / 1024;
 
   if (!m_delegator->get_aggressive()) {
-    if (rate < 20)
-      return rate + 2;
+    if (rate_kb < 20)
+      size = rate_kb + 2;
     else
-      return rate / 5 + 18;
+      size = rate_kb / 5 + 18;
+
+    if (m_rtt != std::chrono::microseconds{}) {
+      uint64_t bdp = uint64_t{rate} * m_rtt.count() / 1000000 / Delegator::block_size;
+
+      size = std::max<uint64_t>(size, 2 * bdp + 2);
+    }
 
   } else {
-    if (rate < 10)
-      return rate / 5 + 1;
+    if (rate_kb < 10)
+      size = rate_kb / 5 + 1;
     else
-      return rate / 10 + 2;
+      size = rate_kb / 10 + 2;
   }
+
+  if (m_max_queue_length != 0)
+    size = std::min(size, m_max_queue_length);
+
+  return size;
+}
+
+void
+RequestList::update_rtt(std::chrono::microseconds sample) {
+  if (sample > rtt_max_sample)
+    return;
+
+  if (m_rtt == std::chrono::microseconds{})
+    m_rtt = std::max(sample, std::chrono::microseconds{1});
+  else
+    m_rtt = std::max((m_rtt * 7 + sample) / 8, std::chrono::microseconds{1});
 }
 
 } // namespace torrent
@@ -40,6 +40,10 @@ public:
   static constexpr std::chrono::microseconds timeout_choked_received{60s};
   static constexpr std::chrono::microseconds timeout_process_unordered{60s};
 
+  // Samples above this are assumed to include peer-side queueing or
+  // stalls, and are ignored.
+  static constexpr std::chrono::microseconds rtt_max_sample{10s};
+
   RequestList();
   ~RequestList();
 
@@ -80,6 +84,14 @@ public:
   uint32_t             pipe_size() const;
   uint32_t             calculate_pipe_size(uint32_t rate);
 
+  // Smoothed request-to-first-byte latency, zero if not yet measured.
+  std::chrono::microseconds rtt() const                  { return m_rtt; }
+
+  // Limit on outstanding requests advertised by the peer, zero if
+  // unlimited.
+  uint32_t             max_queue_length() const          { return m_max_queue_length; }
+  void                 set_max_queue_length(uint32_t l)  { m_max_queue_length = l; }
+
   Delegator*           delegator()                       { return m_delegator; }
   void                 set_delegator(Delegator* d)       { m_delegator = d; }
 
@@ -97,6 +109,8 @@ private:
   void                 prepare_process_unordered(queues_type::iterator itr);
   void                 delay_process_unordered();
 
+  void                 update_rtt(std::chrono::microseconds sample);
+
   Delegator*           m_delegator{};
   PeerChunks*          m_peer_chunks{};
 
@@ -110,6 +124,11 @@ private:
   std::chrono::microseconds m_last_unchoke{};
   size_t                    m_last_unordered_position{0};
 
+  std::chrono::microseconds m_rtt{};
+  std::chrono::microseconds m_rtt_sample_time{};
+  std::optional<Piece>      m_rtt_sample_piece;
+  uint32_t                  m_max_queue_length{0};
+
   torrent::system::SchedulerEntry m_delay_remove_choked;
   torrent::system::SchedulerEntry m_delay_process_unordered;
 };
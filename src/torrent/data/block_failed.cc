@@ -0,0 +1,41 @@
+#include "config.h"
+
+#include "block_failed.h"
+
+#include "torrent/exceptions.h"
+#include "utils/instrumentation.h"
+
+namespace torrent {
+
+size_t BlockFailed::m_memory_usage = 0;
+size_t BlockFailed::m_max_memory   = 32 << 20;
+
+BlockFailed::~BlockFailed() {
+  for (const auto& entry : *this) {
+    if (entry.data == nullptr)
+      continue;
+
+    m_memory_usage -= m_length;
+    instrumentation_update(INSTRUMENTATION_MEMORY_BLOCK_FAILED_USAGE, -static_cast<int64_t>(m_length));
+  }
+}
+
+char*
+BlockFailed::retain_data(iterator itr) {
+  if (itr->data != nullptr)
+    throw internal_error("BlockFailed::retain_data(...) entry already has data.");
+
+  if (m_memory_usage + m_length > m_max_memory) {
+    instrumentation_update(INSTRUMENTATION_MEMORY_BLOCK_FAILED_SKIPPED, 1);
+    return nullptr;
+  }
+
+  itr->data.reset(new char[m_length]);
+
+  m_memory_usage += m_length;
+  instrumentation_update(INSTRUMENTATION_MEMORY_BLOCK_FAILED_USAGE, m_length);
+
+  return itr->data.get();
+}
+
+} // namespace torrent
@@ -2,15 +2,29 @@
 #define LIBTORRENT_BLOCK_FAILED_H
 
 #include <algorithm>
-#include <functional>
+#include <memory>
 #include <vector>
 #include <torrent/common.h>
+#include <torrent/hash_string.h>
 
 namespace torrent {
 
-class BlockFailed : public std::vector<std::pair<char*, uint32_t> > {
+// Each distinct version of a block received for a piece that failed its hash check is identified
+// by the SHA-1 digest of its data, with the number of times it was received.
+//
+// A copy of the data is only kept while the total retained by all BlockFailed instances is below
+// 'max_memory', it is needed to retry the piece with the most popular versions but not to find
+// the peers that sent bad data.
+
+struct BlockFailedEntry {
+  HashString              hash;
+  uint32_t                count{};
+  std::unique_ptr<char[]> data;
+};
+
+class BlockFailed : public std::vector<BlockFailedEntry> {
 public:
-  using base_type = std::vector<std::pair<char*, uint32_t>>;
+  using base_type = std::vector<BlockFailedEntry>;
 
   using base_type::value_type;
   using base_type::reference;
@@ -31,11 +45,13 @@ public:
 
   static constexpr uint32_t invalid_index = ~uint32_t();
 
-  BlockFailed() = default;
+  BlockFailed(uint32_t length) : m_length(length) {}
   ~BlockFailed();
   BlockFailed(const BlockFailed&) = delete;
   BlockFailed& operator=(const BlockFailed&) = delete;
 
+  uint32_t            length() const                    { return m_length; }
+
   size_type           current() const                   { return m_current; }
   iterator            current_iterator()                { return begin() + m_current; }
   reverse_iterator    current_reverse_iterator()        { return reverse_iterator(begin() + m_current + 1); }
@@ -44,19 +60,34 @@ public:
   void                set_current(iterator itr)         { m_current = itr - begin(); }
   void                set_current(reverse_iterator itr) { m_current = itr.base() - begin() - 1; }
 
+  iterator            find(const HashString& hash);
+
   iterator            max_element();
   reverse_iterator    reverse_max_element();
 
+  iterator            insert(const HashString& hash);
+
+  // Allocates the entry's data buffer of 'length()' bytes for the caller to fill, returns
+  // nullptr if over the memory cap.
+  char*               retain_data(iterator itr);
+
+  static size_t       memory_usage()                    { return m_memory_usage; }
+  static size_t       max_memory()                      { return m_max_memory; }
+  static void         set_max_memory(size_t size)       { m_max_memory = size; }
+
 private:
-  static void         delete_entry(value_type e)                    { delete [] e.first; }
-  static bool         compare_entries(value_type e1, value_type e2) { return e1.second < e2.second; }
+  static bool         compare_entries(const value_type& e1, const value_type& e2) { return e1.count < e2.count; }
+
+  static size_t       m_memory_usage;
+  static size_t       m_max_memory;
 
+  uint32_t            m_length;
   size_type           m_current{invalid_index};
 };
 
-inline
-BlockFailed::~BlockFailed() {
-  std::for_each(begin(), end(), &BlockFailed::delete_entry);
+inline BlockFailed::iterator
+BlockFailed::find(const HashString& hash) {
+  return std::find_if(begin(), end(), [&hash](const value_type& e) { return e.hash == hash; });
 }
 
 inline BlockFailed::iterator
@@ -69,6 +100,12 @@ BlockFailed::reverse_max_element() {
   return std::max_element(rbegin(), rend(), &BlockFailed::compare_entries);
 }
 
+inline BlockFailed::iterator
+BlockFailed::insert(const HashString& hash) {
+  base_type::push_back(value_type{hash, 1, nullptr});
+  return end() - 1;
+}
+
 } // namespace torrent
 
 #endif
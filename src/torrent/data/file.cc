@@ -118,7 +118,7 @@ File::set_match_depth(File* left, File* right) {
     if (itrLeft == left->path()->end() || itrRight == right->path()->end())
       break;
 
-    if (itrLeft->str() != itrRight->str())
+    if (!itrLeft->is_same_storage(*itrRight) && itrLeft->str() != itrRight->str())
       break;
 
     itrLeft++;
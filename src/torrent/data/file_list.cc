@@ -202,15 +202,13 @@ FileList::split(iterator position, split_type* first, split_type* last) {
 
   uint64_t offset = old_file->offset();
   size_type index = std::distance(begin(), position);
-  size_type length = std::distance(first, last);
 
-  // This is inefficient, but the simplest way to do it with unique_ptr vector i could find.
-  for (size_type i = 0; i < length - 1; i++)
-    base_type::insert(begin() + index, nullptr);
+  // Rebuild the list rather than inserting in place, as splitting the
+  // initial file of large torrents would otherwise be quadratic.
+  base_type files;
+  files.reserve(size_files() + std::distance(first, last) - 1);
 
-  position = begin() + index;
-
-  auto itr = position;
+  std::move(begin(), position, std::back_inserter(files));
 
   while (first != last) {
     auto new_file = std::make_unique<File>();
@@ -218,20 +216,24 @@ FileList::split(iterator position, split_type* first, split_type* last) {
     new_file->set_offset(offset);
     new_file->set_size_bytes(std::get<0>(*first));
     new_file->set_range(m_chunk_size);
-    *new_file->mutable_path() = std::get<1>(*first);
+    *new_file->mutable_path() = std::move(std::get<1>(*first));
     new_file->set_flags(std::get<2>(*first));
 
     offset += std::get<0>(*first);
-    *itr = std::move(new_file);
+    files.push_back(std::move(new_file));
 
-    itr++;
     first++;
   }
 
+  size_type last_index = files.size();
+
+  std::move(position + 1, end(), std::back_inserter(files));
+  base_type::swap(files);
+
   if (offset != old_file->offset() + old_file->size_bytes())
     throw internal_error("FileList::split(...) split size does not match the old size.", data()->hash());
 
-  return iterator_range(position, itr);
+  return iterator_range(begin() + index, begin() + last_index);
 }
 
 FileList::iterator
@@ -613,6 +615,15 @@ FileList::create_chunk_part(FileList::iterator itr, uint64_t offset, uint32_t le
   return mc;
 }
 
+// Files are ordered by offset, so the file containing 'position' is
+// the first with an end past it. Zero length files are skipped.
+FileList::iterator
+FileList::find_position(iterator first, uint64_t position) {
+  return std::partition_point(first, end(), [position](const value_type& file) {
+      return file->offset() + file->size_bytes() <= position;
+    });
+}
+
 Chunk*
 FileList::create_chunk(uint64_t offset, uint32_t length, bool hashing, int prot) {
   if (offset + length > m_torrent_size)
@@ -620,9 +631,7 @@ FileList::create_chunk(uint64_t offset, uint32_t length, bool hashing, int prot)
 
   auto chunk = std::make_unique<Chunk>();
 
-  auto itr = std::find_if(begin(), end(), [offset](const value_type& file) {
-      return file->is_valid_position(offset);
-    });
+  auto itr = find_position(begin(), offset);
 
   for (; length != 0; ++itr) {
     if (itr == end())
@@ -692,8 +701,13 @@ FileList::mark_completed(uint32_t index) {
 
 FileList::iterator
 FileList::inc_completed(iterator firstItr, uint32_t index) {
-  firstItr     = std::find_if(firstItr, end(), [index](value_type& file) { return index < file->range_second(); });
-  auto lastItr = std::find_if(firstItr, end(), [index](value_type& file) { return index+1 < file->range_second(); });
+  // Zero length files make 'range_second()' non-monotonic, so only
+  // skip ahead by offset before the linear search.
+  auto position = static_cast<uint64_t>(index) * chunk_size();
+
+  firstItr     = std::find_if(find_position(firstItr, position), end(), [index](value_type& file) { return index < file->range_second(); });
+  auto lastItr = std::find_if(std::max(firstItr, find_position(firstItr, position + chunk_size())), end(),
+                              [index](value_type& file) { return index+1 < file->range_second(); });
 
   if (firstItr == end())
     throw internal_error("FileList::inc_completed() first == m_entryList->end().", data()->hash());
@@ -8,6 +8,7 @@
 #include <set>
 
 #include "data/chunk.h"
+#include "data/chunk_iterator.h"
 #include "peer/peer_info.h"
 
 #include "block_failed.h"
@@ -15,6 +16,7 @@
 #include "block_list.h"
 #include "exceptions.h"
 #include "piece.h"
+#include "utils/sha1.h"
 
 namespace torrent {
 
@@ -38,6 +40,9 @@ TransferList::clear() {
     m_slot_canceled(block_list->index());
   }
   for (const auto& block_list : *this) {
+    if (m_slot_erased)
+      m_slot_erased(block_list);
+
     delete block_list;
   }
 
@@ -53,7 +58,12 @@ TransferList::insert(const Piece& piece, uint32_t blockSize) {
 
   m_slot_queued(piece.index());
 
-  return base_type::insert(end(), blockList);
+  auto itr = base_type::insert(end(), blockList);
+
+  if (m_slot_inserted)
+    m_slot_inserted(blockList);
+
+  return itr;
 }
 
 // TODO: Create a destructor to ensure all blocklists have been cleared/invaldiated?
@@ -63,6 +73,9 @@ TransferList::erase(iterator itr) {
   if (itr == end())
     throw internal_error("TransferList::erase(...) itr == m_chunks.end().");
 
+  if (m_slot_erased)
+    m_slot_erased(*itr);
+
   delete *itr;
 
   return base_type::erase(itr);
@@ -116,16 +129,21 @@ TransferList::hash_succeeded(uint32_t index, Chunk* chunk) {
   erase(blockListItr);
 }
 
-struct transfer_list_compare_data {
-  transfer_list_compare_data(Chunk* chunk, const Piece& p) : m_chunk(chunk), m_piece(p) { }
+static HashString
+transfer_list_hash_block(Sha1& sha1, Chunk* chunk, const Piece& piece) {
+  HashString    hash;
+  ChunkIterator itr(chunk, piece.offset(), piece.offset() + piece.length());
 
-  bool operator () (BlockFailed::value_type failed) const {
-    return m_chunk->compare_buffer(failed.first, m_piece.offset(), m_piece.length());
-  }
+  sha1.init();
 
-  Chunk* m_chunk;
-  Piece  m_piece;
-};
+  do {
+    Chunk::data_type data = itr.data();
+    sha1.update(data.first, data.second);
+  } while (itr.next());
+
+  sha1.final_c(hash.data());
+  return hash;
+}
 
 void
 TransferList::hash_failed(uint32_t index, Chunk* chunk) {
@@ -150,12 +168,12 @@ TransferList::hash_failed(uint32_t index, Chunk* chunk) {
     if (promoted > 0 || promoted < (*blockListItr)->size()) {
       // Retry with the most popular blocks.
       (*blockListItr)->set_attempt(1);
-      retry_most_popular(*blockListItr, chunk);
 
       // Also consider various other schemes, like using blocks from
       // only/mainly one peer.
 
-      return;
+      if (retry_most_popular(*blockListItr, chunk))
+        return;
     }
   }
 
@@ -173,15 +191,17 @@ TransferList::hash_failed(uint32_t index, Chunk* chunk) {
 unsigned int
 TransferList::update_failed(BlockList* blockList, Chunk* chunk) {
   unsigned int promoted = 0;
+  Sha1         sha1;
 
   blockList->inc_failed();
 
   for (auto& transfer : *blockList) {
 
     if (transfer.failed_list() == NULL)
-      transfer.set_failed_list(new BlockFailed());
+      transfer.set_failed_list(new BlockFailed(transfer.piece().length()));
 
-    auto failedItr = std::find_if(transfer.failed_list()->begin(), transfer.failed_list()->end(), transfer_list_compare_data(chunk, transfer.piece()));
+    auto hash      = transfer_list_hash_block(sha1, chunk, transfer.piece());
+    auto failedItr = transfer.failed_list()->find(hash);
 
     // TODO: If we get the different data from same peer, disconnect and mark that peer as
     // bad. (review code to make sure the peer gets disconnected)
@@ -191,12 +211,7 @@ TransferList::update_failed(BlockList* blockList, Chunk* chunk) {
 
     if (failedItr == transfer.failed_list()->end()) {
       // We've never encountered this data before, make a new entry.
-      auto buffer = new char[transfer.piece().length()];
-
-      chunk->to_buffer(buffer, transfer.piece().offset(), transfer.piece().length());
-
-      transfer.failed_list()->emplace_back(buffer, 1);
-      failedItr = transfer.failed_list()->end() - 1;
+      failedItr = transfer.failed_list()->insert(hash);
 
       // Count how many new data sets?
 
@@ -206,10 +221,19 @@ TransferList::update_failed(BlockList* blockList, Chunk* chunk) {
 
       auto maxItr = transfer.failed_list()->max_element();
 
-      if (maxItr->second == failedItr->second && maxItr != (transfer.failed_list()->reverse_max_element().base() - 1))
+      if (maxItr->count == failedItr->count && maxItr != (transfer.failed_list()->reverse_max_element().base() - 1))
         promoted++;
 
-      failedItr->second++;
+      failedItr->count++;
+    }
+
+    // Only needed if this becomes the most popular version, retry
+    // on entries that were over the memory cap the last time.
+    if (failedItr->data == nullptr) {
+      char* buffer = transfer.failed_list()->retain_data(failedItr);
+
+      if (buffer != nullptr)
+        chunk->to_buffer(buffer, transfer.piece().offset(), transfer.piece().length());
     }
 
     transfer.failed_list()->set_current(failedItr);
@@ -222,11 +246,12 @@ TransferList::update_failed(BlockList* blockList, Chunk* chunk) {
 void
 TransferList::mark_failed_peers(BlockList* blockList, Chunk* chunk) {
   std::set<PeerInfo*> badPeers;
+  Sha1                sha1;
 
   for (auto& block : *blockList) {
     // This chunk data is good, set it as current and
     // everyone who sent something else is a bad peer.
-    block.failed_list()->set_current(std::find_if(block.failed_list()->begin(), block.failed_list()->end(), transfer_list_compare_data(chunk, block.piece())));
+    block.failed_list()->set_current(block.failed_list()->find(transfer_list_hash_block(sha1, chunk, block.piece())));
 
     for (auto& transfer : *block.transfers())
       if (transfer->failed_index() != block.failed_list()->current() && transfer->failed_index() != ~uint32_t())
@@ -266,27 +291,38 @@ TransferList::mark_and_disconnect_if_single_peer(BlockList* block_list) {
 
 // Copy the stored data to the chunk from the failed entries with
 // largest reference counts.
-void
+//
+// Returns false without modifying the chunk if any of the entries
+// had no data retained due to the memory cap.
+bool
 TransferList::retry_most_popular(BlockList* blockList, Chunk* chunk) {
   for (auto& block : *blockList) {
-
     auto failedItr = block.failed_list()->reverse_max_element();
 
     if (failedItr == block.failed_list()->rend())
       throw internal_error("TransferList::retry_most_popular(...) No failed list entry found.");
 
+    if (failedItr != block.failed_list()->current_reverse_iterator() && failedItr->data == nullptr)
+      return false;
+  }
+
+  for (auto& block : *blockList) {
+
+    auto failedItr = block.failed_list()->reverse_max_element();
+
     // The data is the same, so no need to copy.
     if (failedItr == block.failed_list()->current_reverse_iterator())
       continue;
 
     // Change the leader to the currently held buffer?
 
-    chunk->from_buffer(failedItr->first, block.piece().offset(), block.piece().length());
+    chunk->from_buffer(failedItr->data.get(), block.piece().offset(), block.piece().length());
 
     block.failed_list()->set_current(failedItr);
   }
 
   m_slot_completed(blockList->index());
+  return true;
 }
 
 } // namespace torrent
@@ -57,24 +57,31 @@ public:
 
   using slot_chunk_index = std::function<void(uint32_t)>;
   using slot_peer_info   = std::function<void(PeerInfo*)>;
+  using slot_block_list  = std::function<void(BlockList*)>;
 
   slot_chunk_index&   slot_canceled()  { return m_slot_canceled; }
   slot_chunk_index&   slot_completed() { return m_slot_completed; }
   slot_chunk_index&   slot_queued()    { return m_slot_queued; }
   slot_peer_info&     slot_corrupt()   { return m_slot_corrupt; }
 
+  // Called after a block list is inserted and before it is deleted, optional.
+  slot_block_list&    slot_inserted()  { return m_slot_inserted; }
+  slot_block_list&    slot_erased()    { return m_slot_erased; }
+
 private:
   static unsigned int update_failed(BlockList* blockList, Chunk* chunk);
 
   void                mark_failed_peers(BlockList* blockList, Chunk* chunk);
   void                mark_and_disconnect_if_single_peer(BlockList* blockList);
 
-  void                retry_most_popular(BlockList* blockList, Chunk* chunk);
+  bool                retry_most_popular(BlockList* blockList, Chunk* chunk);
 
   slot_chunk_index    m_slot_canceled;
   slot_chunk_index    m_slot_completed;
   slot_chunk_index    m_slot_queued;
   slot_peer_info      m_slot_corrupt;
+  slot_block_list     m_slot_inserted;
+  slot_block_list     m_slot_erased;
 
   completed_list_type m_completedList;
 
@@ -111,12 +111,11 @@ Object::merge_copy(const Object& object, uint32_t skip_mask, uint32_t maxDepth)
     for (const auto& map : object.as_map()) {
       destItr = std::find_if(destItr, dest.end(), [&map](const auto& v) { return map.first <= v.first; });
 
-      if (map.first < destItr->first)
-        // destItr remains valid and pointing to the next possible
-        // position.
-        dest.insert(destItr, map);
+      if (destItr == dest.end() || map.first < destItr->first)
+        // Continue from the entry following the new one.
+        destItr = std::next(dest.insert(destItr, map));
       else
-        destItr->second.merge_copy(map.second, maxDepth - 1);
+        destItr->second.merge_copy(map.second, skip_mask, maxDepth - 1);
     }
 
 //   } else if (object.is_list()) {
@@ -73,10 +73,12 @@ public:
   Object(const raw_list& r)    : m_flags(TYPE_RAW_LIST) { new (&_raw_list()) raw_list(r); }
   Object(const raw_map& r)     : m_flags(TYPE_RAW_MAP) { new (&_raw_map()) raw_map(r); }
 
-  Object() {}
+  Object() : t_storage{} {}
   ~Object() { clear(); }
   Object(const Object& b);
+  Object(Object&& b) noexcept;
   Object& operator=(const Object& b);
+  Object& operator=(Object&& b) noexcept;
 
   // TODO: Move this out of the class namespace, call them
   // make_object_.
@@ -218,6 +220,9 @@ public:
   bool                check(map_type::const_iterator itr, type_type t) const;
   void                check_throw(type_type t) const;
 
+  // Takes the contents of 'b', which must be left uninitialized by the caller.
+  void                move_construct(Object& b) noexcept;
+
   template <typename T> void check_value_throw(const char* err_msg) const;
 
   uint32_t            m_flags{TYPE_NONE};
@@ -255,8 +260,11 @@ public:
     raw_map       t_raw_map;
   };
 
+  // 't_storage' spans the whole union, and is zeroed so a default or moved-into Object never has
+  // uninitialized bytes.
   union {
     pod_types     t_pod;
+    char          t_storage[sizeof(dict_key_type)];
 
     value_type    t_value;
     string_type   t_string;
@@ -304,6 +312,7 @@ public:
 
   union {
     pod_types t_pod;
+    char      t_storage[sizeof(dict_key_type)];
     char      t_string[sizeof(string_type)];
     char      t_list[sizeof(list_type)];
     char      t_dict_key[sizeof(dict_key_type)];
@@ -311,6 +320,10 @@ public:
 #endif
 };
 
+static_assert(sizeof(Object::dict_key_type) >= sizeof(Object::string_type) &&
+              sizeof(Object::dict_key_type) >= sizeof(Object::list_type),
+              "Object::t_storage must span the whole union.");
+
 inline
 Object::Object(const Object& b) :
     m_flags(b.m_flags & (mask_type | mask_public)) {
@@ -331,6 +344,52 @@ Object::Object(const Object& b) :
   }
 }
 
+// Moves keep the internal flags, as containers relocating their elements must not lose them.
+inline
+Object::Object(Object&& b) noexcept :
+    t_storage{} {
+  move_construct(b);
+}
+
+inline Object&
+Object::operator=(Object&& b) noexcept {
+  if (&b == this)
+    return *this;
+
+  // 'b' might be owned by this object.
+  Object tmp(std::move(b));
+
+  clear();
+  move_construct(tmp);
+
+  return *this;
+}
+
+inline void
+Object::move_construct(Object& b) noexcept {
+  m_flags = b.m_flags;
+
+  switch (type()) {
+  case TYPE_STRING:
+    new (&_string()) string_type(std::move(b._string()));
+    b._string().~string_type();
+    break;
+  case TYPE_LIST:
+    new (&_list()) list_type(std::move(b._list()));
+    b._list().~list_type();
+    break;
+  case TYPE_DICT_KEY:
+    new (&_dict_key()) dict_key_type(std::move(b._dict_key()));
+    b._dict_key().~dict_key_type();
+    break;
+  default:
+    t_pod = b.t_pod;
+    break;
+  }
+
+  b.m_flags = TYPE_NONE;
+}
+
 inline Object
 Object::create_empty(type_type t) {
   switch (t) {
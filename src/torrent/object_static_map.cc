@@ -2,6 +2,7 @@
 
 #include "torrent/object_static_map.h"
 
+#include "torrent/exceptions.h"
 #include "utils/functional.h"
 
 namespace torrent {
@@ -33,4 +34,89 @@ find_key_match(const static_map_mapping_type* first, const static_map_mapping_ty
   return static_map_key_search_result(first, 0);
 }
 
+static bool
+is_key_path_end(const char* pos) {
+  return pos[0] == '\0' || pos[0] == '*' || (pos[0] == ':' && pos[1] == ':') || (pos[0] == '[' && pos[1] == ']');
+}
+
+static_map_key_index::static_map_key_index(const static_map_mapping_type* first, const static_map_mapping_type* last) :
+  m_first(first),
+  m_last(last) {
+
+  if (std::distance(first, last) > UINT16_MAX)
+    throw internal_error("static_map_key_index: too many keys.");
+
+  size_t table_size = 8;
+
+  while (table_size < static_cast<size_t>(std::distance(first, last)) * 4)
+    table_size *= 2;
+
+  // Key lists are small, so a collision free seed is usually found within a few tries.
+  while (true) {
+    for (uint32_t seed = 0; seed != 64; seed++)
+      if (build(seed, table_size))
+        return;
+
+    table_size *= 2;
+  }
+}
+
+static_map_key_search_result
+static_map_key_index::find(const char* key_first, const char* key_last) const {
+  auto length = std::distance(key_first, key_last);
+
+  if (m_slots.empty() || length == 0 || length >= static_cast<ptrdiff_t>(static_map_mapping_type::max_key_size))
+    return static_map_key_search_result(m_first, 0);
+
+  const auto& slot = m_slots[hash(m_seed, key_first, key_last) & (m_slots.size() - 1)];
+
+  if (slot.length != length || std::memcmp(m_first[slot.index].key, key_first, length) != 0)
+    return static_map_key_search_result(m_first, 0);
+
+  return static_map_key_search_result(m_first + slot.index, length);
+}
+
+// FNV-1a with the seed mixed into the offset basis.
+uint32_t
+static_map_key_index::hash(uint32_t seed, const char* first, const char* last) {
+  uint32_t value = 2166136261u ^ (seed * 0x9e3779b9u);
+
+  for (; first != last; first++)
+    value = (value ^ static_cast<uint8_t>(*first)) * 16777619u;
+
+  return value ^ (value >> 15);
+}
+
+bool
+static_map_key_index::build(uint32_t seed, size_t table_size) {
+  m_seed = seed;
+  m_slots.assign(table_size, slot_type{0, 0});
+
+  for (auto itr = m_first; itr != m_last; itr++) {
+    for (unsigned int length = 1; length < static_map_mapping_type::max_key_size; length++) {
+      if (!is_key_path_end(itr->key + length)) {
+        if (itr->key[length] == '\0')
+          break;
+
+        continue;
+      }
+
+      auto& slot = m_slots[hash(seed, itr->key, itr->key + length) & (table_size - 1)];
+
+      if (slot.length == 0) {
+        slot.index  = std::distance(m_first, itr);
+        slot.length = length;
+
+      } else if (slot.length != length || std::memcmp(m_first[slot.index].key, itr->key, length) != 0) {
+        return false;
+      }
+
+      if (itr->key[length] != ':')
+        break;
+    }
+  }
+
+  return true;
+}
+
 } // namespace torrent
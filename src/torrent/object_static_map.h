@@ -3,6 +3,7 @@
 
 #include <cstring>
 #include <algorithm>
+#include <vector>
 #include <torrent/object.h>
 
 namespace torrent {
@@ -23,6 +24,44 @@ struct static_map_entry_type {
   torrent::Object object;
 };
 
+using static_map_key_search_result = std::pair<const static_map_mapping_type*, unsigned int>;
+
+// Perfect hash over every key path a mapping can be matched by, that is each prefix of a mapping
+// key followed by '\0', '*', '::' or '[]'. Paths shared by several mappings resolve to the first
+// one, same as a linear search from the start of the key list.
+//
+// The seed and table size are chosen when the index is built so that no two paths collide, and a
+// lookup is a single hash, probe and compare without allocating.
+
+class LIBTORRENT_EXPORT static_map_key_index {
+public:
+  static_map_key_index(const static_map_mapping_type* first, const static_map_mapping_type* last);
+
+  const static_map_mapping_type* first() const { return m_first; }
+  const static_map_mapping_type* last() const  { return m_last; }
+
+  size_t              size_table() const       { return m_slots.size(); }
+
+  // Returns '(first(), 0)' if not found, like find_key_match().
+  static_map_key_search_result find(const char* key_first, const char* key_last) const;
+
+private:
+  struct slot_type {
+    uint16_t          index;
+    uint8_t           length;
+  };
+
+  static uint32_t     hash(uint32_t seed, const char* first, const char* last);
+
+  bool                build(uint32_t seed, size_t table_size);
+
+  const static_map_mapping_type* m_first;
+  const static_map_mapping_type* m_last;
+
+  uint32_t            m_seed{};
+  std::vector<slot_type> m_slots;
+};
+
 template <typename tmpl_key_type, size_t tmpl_length>
 class static_map_type {
 public:
@@ -37,6 +76,12 @@ public:
   static constexpr size_t size = tmpl_length;
   static const key_list_type keys;
 
+  // Built on first use as the key lists are defined in the translation units of their users.
+  static const static_map_key_index& key_index() {
+    static const static_map_key_index index(keys, keys + size);
+    return index;
+  }
+
   entry_type*         values() { return m_values; }
   const entry_type*   values() const { return m_values; }
 
@@ -66,8 +111,6 @@ struct static_map_stack_type {
   Object::type_type obj_type;
 };
 
-using static_map_key_search_result = std::pair<const static_map_mapping_type*, unsigned int>;
-
 // Note that the key for both functions must be null-terminated at
 // 'key_last'.
 static_map_key_search_result
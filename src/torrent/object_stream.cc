@@ -275,6 +275,242 @@ object_read_bencode_c(const char* first, const char* last, Object* object, uint3
   throw torrent::bencode_error("Invalid bencode data.");
 }
 
+// Validates the bencode element, setting 'unordered' if any dictionary within it has keys that
+// are not sorted, without building any objects.
+static const char*
+object_read_bencode_view_skip_c(const char* first, const char* last, bool& unordered, uint32_t depth) {
+  if (first == last)
+    throw torrent::bencode_error("Invalid bencode data.");
+
+  switch (*first) {
+  case 'i': {
+    int64_t value;
+    first = object_read_bencode_c_value(first + 1, last, value);
+
+    if (first == last || *first++ != 'e')
+      break;
+
+    return first;
+  }
+  case 'l':
+    if (++depth >= 1024)
+      break;
+
+    first++;
+
+    while (first != last) {
+      if (*first == 'e')
+        return first + 1;
+
+      first = object_read_bencode_view_skip_c(first, last, unordered, depth);
+    }
+
+    break;
+
+  case 'd': {
+    if (++depth >= 1024)
+      break;
+
+    first++;
+
+    raw_string prev;
+    bool       has_prev = false;
+
+    while (first != last) {
+      if (*first == 'e')
+        return first + 1;
+
+      raw_string key = object_read_bencode_c_string(first, last);
+
+      if (has_prev && !std::lexicographical_compare(prev.begin(), prev.end(), key.begin(), key.end()))
+        unordered = true;
+
+      prev     = key;
+      has_prev = true;
+
+      first = object_read_bencode_view_skip_c(key.end(), last, unordered, depth);
+    }
+
+    break;
+  }
+  default:
+    return object_read_bencode_c_string(first, last).end();
+  }
+
+  throw torrent::bencode_error("Invalid bencode data.");
+}
+
+const char*
+object_read_bencode_view_c(const char* first, const char* last, Object* object, uint32_t view_depth, uint32_t depth) {
+  if (first == last)
+    throw torrent::bencode_error("Invalid bencode data.");
+
+  if ((*first == 'l' || *first == 'd') && depth >= view_depth) {
+    bool unordered = false;
+    const char* next = object_read_bencode_view_skip_c(first, last, unordered, depth);
+
+    if (*first == 'l')
+      *object = raw_list(first + 1, std::distance(first, next) - 2);
+    else
+      *object = raw_map(first + 1, std::distance(first, next) - 2);
+
+    if (unordered)
+      object->set_internal_flags(Object::flag_unordered);
+
+    return next;
+  }
+
+  switch (*first) {
+  case 'i':
+    return object_read_bencode_c(first, last, object, depth);
+
+  case 'l':
+    if (++depth >= 1024)
+      break;
+
+    first++;
+    *object = Object::create_list();
+
+    while (first != last) {
+      if (*first == 'e')
+        return first + 1;
+
+      auto& obj = object->as_list().emplace_back();
+      first = object_read_bencode_view_c(first, last, &obj, view_depth, depth);
+
+      if (obj.flags() & Object::flag_unordered)
+        object->set_internal_flags(Object::flag_unordered);
+    }
+
+    break;
+
+  case 'd': {
+    if (++depth >= 1024)
+      break;
+
+    first++;
+    *object = Object::create_map();
+
+    Object::string_type prev;
+
+    while (first != last) {
+      if (*first == 'e')
+        return first + 1;
+
+      raw_string raw_str = object_read_bencode_c_string(first, last);
+      first = raw_str.end();
+
+      Object::string_type str = raw_str.as_string();
+
+      if (str <= prev && !object->as_map().empty())
+        object->set_internal_flags(Object::flag_unordered);
+
+      Object* value = &object->as_map()[str];
+      first = object_read_bencode_view_c(first, last, value, view_depth, depth);
+
+      if (value->flags() & Object::flag_unordered)
+        object->set_internal_flags(Object::flag_unordered);
+
+      str.swap(prev);
+    }
+
+    break;
+  }
+
+  default: {
+    raw_string raw_str = object_read_bencode_c_string(first, last);
+    *object = raw_str;
+
+    return raw_str.end();
+  }
+  }
+
+  object->clear();
+  throw torrent::bencode_error("Invalid bencode data.");
+}
+
+void
+object_materialize(Object* object) {
+  switch (object->type()) {
+  case Object::TYPE_RAW_BENCODE: {
+    raw_bencode raw = object->as_raw_bencode();
+
+    if (raw.is_empty()) {
+      object->clear();
+      break;
+    }
+
+    Object tmp;
+    object_read_bencode_c(raw.begin(), raw.end(), &tmp);
+    object->swap(tmp);
+    break;
+  }
+  case Object::TYPE_RAW_STRING:
+    *object = object->as_raw_string().as_string();
+    break;
+
+  case Object::TYPE_RAW_LIST: {
+    raw_list raw = object->as_raw_list();
+    Object   tmp = Object::create_list();
+
+    for (const char* itr = raw.begin(); itr != raw.end(); )
+      itr = object_read_bencode_c(itr, raw.end(), &tmp.as_list().emplace_back());
+
+    object->swap(tmp);
+    break;
+  }
+  case Object::TYPE_RAW_MAP: {
+    raw_map  raw = object->as_raw_map();
+    uint32_t flags = object->flags() & Object::flag_unordered;
+    Object   tmp = Object::create_map();
+
+    for (const char* itr = raw.begin(); itr != raw.end(); ) {
+      raw_string key = object_read_bencode_c_string(itr, raw.end());
+      itr = object_read_bencode_c(key.end(), raw.end(), &tmp.as_map()[key.as_string()]);
+    }
+
+    object->swap(tmp);
+    object->set_internal_flags(flags);
+    break;
+  }
+  case Object::TYPE_LIST:
+    for (auto& obj : object->as_list())
+      object_materialize(&obj);
+    break;
+
+  case Object::TYPE_MAP:
+    for (auto& [key, obj] : object->as_map())
+      object_materialize(&obj);
+    break;
+
+  default:
+    break;
+  }
+}
+
+raw_bencode
+object_read_bencode_span_c(const char* first, const char* last, const char* key) {
+  if (first == last || *first != 'd')
+    throw torrent::bencode_error("Invalid bencode data.");
+
+  first++;
+
+  while (first != last && *first != 'e') {
+    raw_string  raw_key = object_read_bencode_c_string(first, last);
+    const char* next    = object_read_bencode_skip_c(raw_key.end(), last);
+
+    if (raw_bencode_equal_c_str(raw_key, key))
+      return raw_bencode(raw_key.end(), std::distance(raw_key.end(), next));
+
+    first = next;
+  }
+
+  if (first == last)
+    throw torrent::bencode_error("Invalid bencode data.");
+
+  return raw_bencode();
+}
+
 static bool object_is_not_digit(char c) { return c < '0' || c > '9'; }
 
 const char*
@@ -367,13 +603,47 @@ object_read_bencode_raw_c(const char* first, const char* last, torrent::Object*
 }
 
 // Would be nice to have a straight stream to hash conversion.
+namespace {
+
+struct object_sha1_size {
+  Sha1     sha;
+  uint64_t size{};
+};
+
+object_buffer_t
+object_write_to_sha1_size(void* data, object_buffer_t buffer) {
+  auto state = static_cast<object_sha1_size*>(data);
+
+  state->sha.update(buffer.first, std::distance(buffer.first, buffer.second));
+  state->size += std::distance(buffer.first, buffer.second);
+
+  return buffer;
+}
+
+} // namespace
+
 std::string
-object_sha1(const Object* object) {
-  Sha1 sha;
+object_sha1(const Object* object, uint64_t* size) {
+  object_sha1_size state;
   char buffer[1024];
 
+  state.sha.init();
+  object_write_bencode_c(&object_write_to_sha1_size, &state, object_buffer_t(buffer, buffer + 1024), object);
+  state.sha.final_c(buffer);
+
+  if (size != nullptr)
+    *size = state.size;
+
+  return std::string(buffer, 20);
+}
+
+std::string
+object_sha1(const raw_bencode& raw) {
+  Sha1 sha;
+  char buffer[20];
+
   sha.init();
-  object_write_bencode_c(&object_write_to_sha1, &sha, object_buffer_t(buffer, buffer + 1024), object);
+  sha.update(raw.data(), raw.size());
   sha.final_c(buffer);
 
   return std::string(buffer, 20);
@@ -628,8 +898,7 @@ const char*
 static_map_read_bencode_c(const char* first,
                          const char* last,
                          static_map_entry_type* entry_values,
-                         const static_map_mapping_type* first_key,
-                         const static_map_mapping_type* last_key) {
+                         const static_map_key_index& key_index) {
   // Temp hack... validate that we got valid bencode data...
 //   {
 //     torrent::Object obj;
@@ -650,6 +919,9 @@ static_map_read_bencode_c(const char* first,
   static_map_stack_type* stack_itr = stack;
   stack_itr->clear();
 
+  const static_map_mapping_type* first_key = key_index.first();
+  const static_map_mapping_type* last_key  = key_index.last();
+
   char current_key[static_map_mapping_type::max_key_size + 2] = "";
 
   while (first != last) {
@@ -680,9 +952,13 @@ static_map_read_bencode_c(const char* first,
     memcpy(current_key + stack_itr->next_key, raw_key.data(), raw_key.size());
     current_key[stack_itr->next_key + raw_key.size()] = '\0';
 
-    // Locate the right key. Optimize this by remembering previous
-    // position...
-    static_map_key_search_result key_search = find_key_match(first_key, last_key, current_key);
+    // Keys before 'first_key' have already been read, e.g. duplicate
+    // list entries, so fall back to searching from there.
+    static_map_key_search_result key_search =
+      key_index.find(current_key, current_key + stack_itr->next_key + raw_key.size());
+
+    if (key_search.second != 0 && key_search.first < first_key)
+      key_search = find_key_match(first_key, last_key, current_key);
 
     // We're not interest in this object, skip it.
     if (key_search.second == 0) {
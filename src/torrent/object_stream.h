@@ -2,14 +2,16 @@
 #define LIBTORRENT_OBJECT_STREAM_H
 
 #include <iosfwd>
+#include <iterator>
 #include <string>
 #include <torrent/common.h>
+#include <torrent/object_raw_bencode.h>
 
 namespace torrent {
 
-class raw_string;
-
-std::string object_sha1(const Object* object) LIBTORRENT_EXPORT;
+// Optionally returns the size of the bencoded object, which is hashed in the same pass.
+std::string object_sha1(const Object* object, uint64_t* size = nullptr) LIBTORRENT_EXPORT;
+std::string object_sha1(const raw_bencode& raw) LIBTORRENT_EXPORT;
 
 raw_string  object_read_bencode_c_string(const char* first, const char* last) LIBTORRENT_EXPORT;
 
@@ -20,6 +22,42 @@ void        object_read_bencode(std::istream* input, Object* object, uint32_t de
 const char* object_read_bencode_c(const char* first, const char* last, Object* object, uint32_t depth = 0) LIBTORRENT_EXPORT;
 const char* object_read_bencode_skip_c(const char* first, const char* last) LIBTORRENT_EXPORT;
 
+// Zero-copy parsing, strings are stored as raw_string and lists/dictionaries at or below
+// 'view_depth' as raw_list/raw_map views into the source buffer, which must outlive the object.
+//
+// Dictionary keys of the containers above 'view_depth' are still copied. Use object_materialize
+// to replace all views with regular objects.
+const char* object_read_bencode_view_c(const char* first, const char* last, Object* object, uint32_t view_depth = 2, uint32_t depth = 0) LIBTORRENT_EXPORT;
+void        object_materialize(Object* object) LIBTORRENT_EXPORT;
+
+// Returns the source bytes of the value for 'key' in the bencoded dictionary, or an empty
+// raw_bencode if missing. Used to hash and serve the info dictionary without re-encoding it.
+raw_bencode object_read_bencode_span_c(const char* first, const char* last, const char* key) LIBTORRENT_EXPORT;
+
+// Iterate over the elements of raw views without building objects.
+template <typename Func>
+inline void
+raw_list_for_each(const raw_list& list, Func func) {
+  for (const char* itr = list.begin(); itr != list.end(); ) {
+    const char* next = object_read_bencode_skip_c(itr, list.end());
+
+    func(raw_bencode(itr, std::distance(itr, next)));
+    itr = next;
+  }
+}
+
+template <typename Func>
+inline void
+raw_map_for_each(const raw_map& map, Func func) {
+  for (const char* itr = map.begin(); itr != map.end(); ) {
+    raw_string  key  = object_read_bencode_c_string(itr, map.end());
+    const char* next = object_read_bencode_skip_c(key.end(), map.end());
+
+    func(key, raw_bencode(key.end(), std::distance(key.end(), next)));
+    itr = next;
+  }
+}
+
 std::istream& operator >> (std::istream& input, Object& object) LIBTORRENT_EXPORT;
 std::ostream& operator << (std::ostream& output, const Object& object) LIBTORRENT_EXPORT;
 
@@ -51,6 +89,7 @@ template<typename tmpl_key_type, size_t tmpl_length>
 class static_map_type;
 struct static_map_mapping_type;
 struct static_map_entry_type;
+class  static_map_key_index;
 
 // Convert buffer to static key map. Inlined because we don't want
 // a separate wrapper function for each template argument.
@@ -58,7 +97,7 @@ template<typename tmpl_key_type, size_t tmpl_length>
 inline const char*
 static_map_read_bencode(const char* first, const char* last,
                        static_map_type<tmpl_key_type, tmpl_length>& object) {
-  return static_map_read_bencode_c(first, last, object.values(), object.keys, object.keys + object.size);
+  return static_map_read_bencode_c(first, last, object.values(), object.key_index());
 }
 
 template <typename tmpl_key_type, size_t tmpl_length>
@@ -72,8 +111,7 @@ const char*
 static_map_read_bencode_c(const char* first,
                          const char* last,
                          static_map_entry_type* entry_values,
-                         const static_map_mapping_type* first_key,
-                         const static_map_mapping_type* last_key) LIBTORRENT_EXPORT;
+                         const static_map_key_index& key_index) LIBTORRENT_EXPORT;
 
 object_buffer_t
 static_map_write_bencode_c_wrap(object_write_t writeFunc,
@@ -30,6 +30,9 @@ public:
   void               insert_path(iterator pos, const std::string& path);
   void               push_back(const std::string& path);
 
+  // Appends a single element without splitting on '/'.
+  void               push_back_element(const string_utf8& element) { base_type::push_back(element); }
+
   // Return the path as a string with '/' deliminator. The deliminator
   // is only inserted between path elements.
   std::string        as_string() const;
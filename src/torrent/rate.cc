@@ -7,10 +7,23 @@ namespace torrent {
 
 inline void
 Rate::discard_old() const {
-  while (!m_container.empty() && m_container.back().first < this_thread::cached_seconds().count() - m_span) {
-    m_current -= m_container.back().second;
-    m_container.pop_back();
+  auto now = static_cast<timer_type>(this_thread::cached_seconds().count());
+
+  if (now < m_span)
+    return;
+
+  timer_type oldest_slot = (now - m_span) / m_width;
+
+  while (m_first_slot < oldest_slot && m_first_slot <= m_last_slot) {
+    auto& bucket = m_buckets[m_first_slot % bucket_count];
+
+    m_current -= bucket;
+    bucket = 0;
+    m_first_slot++;
   }
+
+  if (m_first_slot < oldest_slot)
+    m_first_slot = oldest_slot;
 }
 
 Rate::rate_type
@@ -20,6 +33,20 @@ Rate::rate() const {
   return m_current / m_span;
 }
 
+void
+Rate::set_span(timer_type s) {
+  if (s <= 0)
+    throw internal_error("Rate::set_span(s) received a non-positive span.");
+
+  m_span = s;
+
+  // The window spans at most 'span / width + 1' slots, so use one
+  // bucket less than we have to make sure it fits in the ring.
+  m_width = (s + bucket_count - 2) / (bucket_count - 1);
+
+  reset_rate();
+}
+
 void
 Rate::insert(rate_type bytes) {
   discard_old();
@@ -27,13 +54,28 @@ Rate::insert(rate_type bytes) {
   if (m_current > (rate_type{1} << 40) || bytes > (rate_type{1} << 28))
     throw internal_error("Rate::insert(bytes) received out-of-bounds values..");
 
-  if (m_container.empty() || m_container.front().first != this_thread::cached_seconds().count())
-    m_container.emplace_front(this_thread::cached_seconds().count(), bytes);
-  else
-    m_container.front().second += bytes;
+  auto slot = static_cast<timer_type>(this_thread::cached_seconds().count()) / m_width;
+
+  // Buckets between the last slot and the new one have already been
+  // cleared by discard_old(), as they alias slots outside the span.
+  if (slot > m_last_slot)
+    m_last_slot = slot;
+
+  if (m_first_slot > m_last_slot)
+    m_first_slot = m_last_slot;
+
+  m_buckets[m_last_slot % bucket_count] += bytes;
 
   m_total += bytes;
   m_current += bytes;
 }
 
+void
+Rate::reset_rate() {
+  m_buckets.fill(0);
+  m_current = 0;
+  m_first_slot = 0;
+  m_last_slot = 0;
+}
+
 } // namespace torrent
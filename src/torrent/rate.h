@@ -37,14 +37,20 @@
 #ifndef LIBTORRENT_UTILS_RATE_H
 #define LIBTORRENT_UTILS_RATE_H
 
-#include <deque>
+#include <array>
 #include <torrent/common.h>
 
 namespace torrent {
 
 // Keep the current rate count up to date for each call to rate() and
 // insert(...). This requires a mutable since rate() can be const, but
-// is justified as we avoid iterating the deque for each call.
+// is justified as we avoid iterating the buckets for each call.
+//
+// Samples are accumulated in a fixed ring of buckets, each covering
+// 'bucket_width()' seconds, so that insert and rate are O(1) and no
+// memory is allocated. The oldest bucket is dropped once its last
+// second falls outside the span, which may cause the rate to include
+// up to 'bucket_width() - 1' seconds more than the span.
 
 class LIBTORRENT_EXPORT Rate {
 public:
@@ -52,10 +58,11 @@ public:
   using rate_type  = uint64_t;
   using total_type = uint64_t;
 
-  using value_type = std::pair<timer_type, rate_type>;
-  using queue_type = std::deque<value_type>;
+  static constexpr unsigned int bucket_count = 16;
+
+  using bucket_list = std::array<rate_type, bucket_count>;
 
-  Rate(timer_type span) :  m_span(span) {}
+  Rate(timer_type span)                                       { set_span(span); }
 
   // Bytes per second.
   rate_type           rate() const;
@@ -64,13 +71,17 @@ public:
   total_type          total() const                           { return m_total; }
   void                set_total(total_type bytes)             { m_total = bytes; }
 
-  // Interval in seconds used to calculate the rate.
+  // Interval in seconds used to calculate the rate. Changing the span
+  // resets the rate.
   timer_type          span() const                            { return m_span; }
-  void                set_span(timer_type s)                  { m_span = s; }
+  void                set_span(timer_type s);
+
+  // Interval in seconds covered by each bucket.
+  timer_type          bucket_width() const                    { return m_width; }
 
   void                insert(rate_type bytes);
 
-  void                reset_rate()                            { m_current = 0; m_container.clear(); }
+  void                reset_rate();
   
   bool                operator <  (Rate& r) const             { return rate() < r.rate(); }
   bool                operator >  (Rate& r) const             { return rate() > r.rate(); }
@@ -85,11 +96,17 @@ public:
 private:
   inline void         discard_old() const;
 
-  mutable queue_type  m_container;
+  mutable bucket_list m_buckets{};
 
   mutable rate_type   m_current{0};
   total_type          m_total{0};
   timer_type          m_span;
+  timer_type          m_width;
+
+  // Range of bucket slots, in units of 'm_width' seconds, that may
+  // hold non-zero values.
+  mutable timer_type  m_first_slot{0};
+  timer_type          m_last_slot{0};
 };
 
 } // namespace torrent
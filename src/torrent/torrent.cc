@@ -3,7 +3,10 @@
 #include "torrent/torrent.h"
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
 #include <random>
+#include <thread>
 #include <curl/curl.h>
 
 #include "manager.h"
@@ -125,39 +128,78 @@ Throttle* up_throttle_global()   { return manager->upload_throttle(); }
 const Rate* down_rate()          { return manager->download_throttle()->rate(); }
 const Rate* up_rate()            { return manager->upload_throttle()->rate(); }
 
-Download
-download_add(Object* object, uint32_t tracker_key) {
-  auto download = std::make_unique<DownloadWrapper>();
+namespace {
+
+struct download_prepared {
+  std::unique_ptr<DownloadWrapper> download;
+  DownloadConstructor              ctor;
+  std::string                      info_hash;
+  uint64_t                         metadata_size{};
+};
 
-  DownloadConstructor ctor;
+// Parses the torrent and computes the info hash. Only touches the new download, so it may run
+// on worker threads.
+void
+download_prepare(Object* object, download_prepared& prepared) {
+  auto download = prepared.download.get();
 
-  ctor.set_download(download.get());
-  ctor.initialize(*object);
+  prepared.ctor.set_download(download);
+  prepared.ctor.initialize(*object);
 
-  std::string infoHash;
-  if (download->info()->is_meta_download())
-    infoHash = object->get_key("info").get_key("pieces").as_string();
-  else
-    infoHash = object_sha1(&object->get_key("info"));
+  // Hash the original bytes when retained, else the info dictionary is encoded once for both the
+  // hash and the metadata size.
+  if (download->info()->is_meta_download()) {
+    const auto& pieces = object->get_key("info").get_key("pieces");
+    prepared.info_hash = pieces.is_raw_string() ? pieces.as_raw_string().as_string() : pieces.as_string();
 
-  if (manager->download_manager()->find(infoHash) != manager->download_manager()->end())
-    throw input_error("Info hash already used by another torrent.");
+  } else if (!download->info_span().is_empty()) {
+    prepared.info_hash = object_sha1(download->info_span());
+    prepared.metadata_size = download->info_span().size();
 
-  if (!download->info()->is_meta_download()) {
-    char buffer[1024];
-    uint64_t metadata_size = 0;
-    object_write_bencode_c(&object_write_to_size, &metadata_size, object_buffer_t(buffer, buffer + sizeof(buffer)), &object->get_key("info"));
-    download->main()->set_metadata_size(metadata_size);
+  } else {
+    prepared.info_hash = object_sha1(&object->get_key("info"), &prepared.metadata_size);
   }
+}
+
+// Everything outside the info dictionary is materialized as clients modify it, e.g. for resume
+// data, while the info dictionary keeps its views into 'source'.
+void
+download_prepare_source(Object* object, std::shared_ptr<const std::string> source, DownloadWrapper* download) {
+  if (source == nullptr || !object->is_map())
+    throw input_error("Invalid torrent bencode source.");
+
+  for (auto& [key, value] : object->as_map())
+    if (key != "info")
+      object_materialize(&value);
+
+  auto info_span = object_read_bencode_span_c(source->data(), source->data() + source->size(), "info");
+
+  if (!info_span.is_raw_map())
+    throw input_error("Invalid torrent bencode source, missing info dictionary.");
+
+  download->set_bencode_source(std::move(source));
+  download->set_info_span(info_span);
+}
+
+// Adds the prepared download to the manager, must be called from the main thread.
+Download
+download_commit(Object* object, download_prepared& prepared, uint32_t tracker_key) {
+  auto& download = prepared.download;
+
+  if (manager->download_manager()->find(prepared.info_hash) != manager->download_manager()->end())
+    throw input_error("Info hash already used by another torrent.");
+
+  if (!download->info()->is_meta_download())
+    download->main()->set_metadata_size(prepared.metadata_size);
 
   std::string local_id = PEER_NAME + generate_random(20 - std::string(PEER_NAME).size());
 
   download->set_hash_queue(ThreadMain::thread_main()->hash_queue());
-  download->initialize(infoHash, local_id, tracker_key);
+  download->initialize(prepared.info_hash, local_id, tracker_key);
 
   // Add trackers, etc, after setting the info hash so that log
   // entries look sane.
-  ctor.parse_tracker(*object);
+  prepared.ctor.parse_tracker(*object);
 
   // Default PeerConnection factory functions.
   download->main()->connection_list()->slot_new_connection(&createPeerConnectionDefault);
@@ -171,6 +213,119 @@ download_add(Object* object, uint32_t tracker_key) {
   return Download(download.release());
 }
 
+struct download_batch_item {
+  download_prepared       prepared;
+  std::unique_ptr<Object> object;
+  std::exception_ptr      exception;
+  bool                    failed{};
+};
+
+// Failed downloads are kept in the item, as DownloadWrapper must be destroyed on the main thread.
+void
+download_batch_prepare(download_batch_entry& entry, download_batch_item& item) {
+  try {
+    if (entry.source == nullptr)
+      throw input_error("Invalid torrent bencode source.");
+
+    const char* first = entry.source->data();
+    const char* last  = entry.source->data() + entry.source->size();
+
+    item.object = std::make_unique<Object>();
+    object_read_bencode_view_c(first, last, item.object.get());
+
+    item.prepared.download = std::make_unique<DownloadWrapper>();
+
+    download_prepare_source(item.object.get(), entry.source, item.prepared.download.get());
+    download_prepare(item.object.get(), item.prepared);
+
+    if (!entry.resume_source.empty())
+      object_read_bencode_c(entry.resume_source.data(), entry.resume_source.data() + entry.resume_source.size(), &entry.resume);
+
+  } catch (const local_error& e) {
+    entry.error = e.what();
+    item.failed = true;
+
+  } catch (...) {
+    item.exception = std::current_exception();
+    item.failed = true;
+  }
+}
+
+} // namespace
+
+Download
+download_add(Object* object, uint32_t tracker_key) {
+  download_prepared prepared;
+  prepared.download = std::make_unique<DownloadWrapper>();
+
+  download_prepare(object, prepared);
+  return download_commit(object, prepared, tracker_key);
+}
+
+Download
+download_add(Object* object, std::shared_ptr<const std::string> source, uint32_t tracker_key) {
+  download_prepared prepared;
+  prepared.download = std::make_unique<DownloadWrapper>();
+
+  download_prepare_source(object, std::move(source), prepared.download.get());
+  download_prepare(object, prepared);
+  return download_commit(object, prepared, tracker_key);
+}
+
+void
+download_add_batch(std::vector<download_batch_entry>& entries, unsigned int threads) {
+  if (entries.empty())
+    return;
+
+  if (threads == 0)
+    threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+  threads = std::min<size_t>(threads, entries.size());
+
+  std::vector<download_batch_item> items(entries.size());
+  std::atomic<size_t>              next_index{0};
+
+  auto worker = [&] {
+      size_t index;
+
+      while ((index = next_index++) < entries.size())
+        download_batch_prepare(entries[index], items[index]);
+    };
+
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+
+  for (unsigned int i = 1; i < threads; i++)
+    workers.emplace_back(worker);
+
+  worker();
+
+  for (auto& thread : workers)
+    thread.join();
+
+  for (auto& item : items)
+    if (item.exception)
+      std::rethrow_exception(item.exception);
+
+  for (size_t index = 0; index != entries.size(); index++) {
+    auto& entry = entries[index];
+    auto& item  = items[index];
+
+    if (item.failed) {
+      item.prepared.download.reset();
+      continue;
+    }
+
+    try {
+      entry.download = download_commit(item.object.get(), item.prepared, entry.tracker_key);
+      item.object.release();
+
+    } catch (const local_error& e) {
+      entry.error = e.what();
+    }
+  }
+}
+
 void
 download_remove(Download d) {
   manager->cleanup_download(d.ptr());
@@ -2,9 +2,12 @@
 #define LIBTORRENT_TORRENT_H
 
 #include <list>
+#include <memory>
 #include <string>
+#include <vector>
 #include <torrent/common.h>
 #include <torrent/download.h>
+#include <torrent/object.h>
 
 namespace torrent {
 
@@ -38,8 +41,32 @@ using DList = std::list<Download>;
 //
 // Might consider redesigning that...
 Download            download_add(Object* s, uint32_t tracker_key) LIBTORRENT_EXPORT;
+
+// Takes an Object parsed with 'object_read_bencode_view_c' from 'source', the info dictionary
+// keeps referencing the buffer which is released with the download.
+Download            download_add(Object* s, std::shared_ptr<const std::string> source, uint32_t tracker_key) LIBTORRENT_EXPORT;
 void                download_remove(Download d) LIBTORRENT_EXPORT;
 
+struct download_batch_entry {
+  // The torrent file and optionally its bencoded resume data.
+  std::shared_ptr<const std::string> source;
+  std::string                        resume_source;
+  uint32_t                           tracker_key{};
+
+  // On success 'download' is valid and 'resume' holds the parsed resume data, else 'error' is
+  // set.
+  Download                           download;
+  Object                             resume;
+  std::string                        error;
+};
+
+// Parses, validates and hashes the torrents on 'threads' worker threads, zero uses the number
+// of cores, then adds them to the download manager from the calling thread in input order.
+//
+// Torrents are parsed as with 'object_read_bencode_view_c' and the bencode objects are owned by
+// the downloads. Must be called from the main thread.
+void                download_add_batch(std::vector<download_batch_entry>& entries, unsigned int threads = 0) LIBTORRENT_EXPORT;
+
 // Add all downloads to dlist. The client is responsible for clearing
 // it before the call.
 void                download_list(DList& dlist) LIBTORRENT_EXPORT;
@@ -2,6 +2,8 @@
 
 #include "dht_controller.h"
 
+#include <algorithm>
+
 #include "dht/dht_router.h"
 #include "src/manager.h"
 #include "torrent/exceptions.h"
@@ -31,7 +33,7 @@ DhtController::is_valid() {
 bool
 DhtController::is_active() {
   auto lock = std::lock_guard(m_lock);
-  return m_router && m_router->is_active();
+  return m_router && (m_router->is_active() || m_router6->is_active());
 }
 
 bool
@@ -56,7 +58,14 @@ DhtController::initialize(const Object& dht_cache) {
   LT_LOG("initializing", 0);
 
   try {
-    m_router = std::make_unique<DhtRouter>(dht_cache);
+    auto router  = std::make_unique<DhtRouter>(dht_cache, AF_INET);
+    auto router6 = std::make_unique<DhtRouter>(dht_cache, AF_INET6, &router->id());
+
+    apply_limits(router.get());
+    apply_limits(router6.get());
+
+    m_router  = std::move(router);
+    m_router6 = std::move(router6);
 
   } catch (const torrent::local_error& e) {
     LT_LOG("initialization failed : %s", e.what());
@@ -77,15 +86,23 @@ DhtController::start() {
 
   LT_LOG("starting : port:%d", port);
 
+  // Either family may be unavailable, the DHT runs as long as one of them starts.
   try {
     m_router->start(port);
-    m_port = port;
+  } catch (const torrent::local_error& e) {
+    LT_LOG("start failed : inet : %s", e.what());
+  }
 
+  try {
+    m_router6->start(port);
   } catch (const torrent::local_error& e) {
-    LT_LOG("start failed : %s", e.what());
-    return false;
+    LT_LOG("start failed : inet6 : %s", e.what());
   }
 
+  if (!m_router->is_active() && !m_router6->is_active())
+    return false;
+
+  m_port = port;
   return true;
 }
 
@@ -99,6 +116,7 @@ DhtController::stop() {
   LT_LOG("stopping", 0);
 
   m_router->stop();
+  m_router6->stop();
   m_port = 0;
 }
 
@@ -112,16 +130,51 @@ void
 DhtController::add_bootstrap_node(std::string host, int port) {
   auto lock = std::lock_guard(m_lock);
 
-  if (m_router)
-    m_router->add_bootstrap_contact(std::move(host), port);
+  if (!m_router)
+    return;
+
+  m_router->add_bootstrap_contact(host, port);
+  m_router6->add_bootstrap_contact(host, port);
 }
 
 void
 DhtController::add_node(const sockaddr* sa, int port) {
   auto lock = std::lock_guard(m_lock);
 
-  if (m_router)
-    m_router->contact(sa, port);
+  if (!m_router)
+    return;
+
+  m_router->contact(sa, port);
+  m_router6->contact(sa, port);
+}
+
+void
+DhtController::set_peer_limits(unsigned int max_per_torrent, size_t max_total) {
+  auto lock = std::lock_guard(m_lock);
+
+  m_max_peers_per_torrent = max_per_torrent;
+  m_max_peers_total       = max_total;
+
+  if (m_router == nullptr)
+    return;
+
+  apply_limits(m_router.get());
+  apply_limits(m_router6.get());
+}
+
+void
+DhtController::set_announce_limits(unsigned int query_rate, unsigned int query_burst, unsigned int max_active) {
+  auto lock = std::lock_guard(m_lock);
+
+  m_announce_query_rate  = query_rate;
+  m_announce_query_burst = query_burst;
+  m_announce_max_active  = max_active;
+
+  if (m_router == nullptr)
+    return;
+
+  apply_limits(m_router.get());
+  apply_limits(m_router6.get());
 }
 
 Object*
@@ -131,7 +184,10 @@ DhtController::store_cache(Object* container) {
   if (!m_router)
     throw internal_error("DhtController::store_cache() called but DHT not initialized.");
 
-  return m_router->store_cache(container);
+  m_router->store_cache(container);
+  m_router6->store_cache(container);
+
+  return container;
 }
 
 DhtController::statistics_type
@@ -141,7 +197,30 @@ DhtController::get_statistics() {
   if (!m_router)
     throw internal_error("DhtController::get_statistics() called but DHT not initialized.");
 
-  return m_router->get_statistics();
+  auto stats = m_router->get_statistics();
+
+  if (!m_router6->is_active())
+    return stats;
+
+  auto stats6 = m_router6->get_statistics();
+
+  stats.cycle             = std::max(stats.cycle, stats6.cycle);
+  stats.queries_received += stats6.queries_received;
+  stats.queries_sent     += stats6.queries_sent;
+  stats.replies_received += stats6.replies_received;
+  stats.errors_received  += stats6.errors_received;
+  stats.errors_caught    += stats6.errors_caught;
+  stats.queries_dropped  += stats6.queries_dropped;
+
+  stats.num_nodes6        = stats6.num_nodes;
+  stats.num_buckets6      = stats6.num_buckets;
+  stats.num_peers6        = stats6.num_peers;
+  stats.max_peers6        = stats6.max_peers;
+  stats.num_trackers6     = stats6.num_trackers;
+  stats.peers_received6   = stats6.peers_received;
+  stats.memory_usage6     = stats6.memory_usage;
+
+  return stats;
 }
 
 void
@@ -152,6 +231,35 @@ DhtController::reset_statistics() {
     throw internal_error("DhtController::reset_statistics() called but DHT not initialized.");
 
   m_router->reset_statistics();
+  m_router6->reset_statistics();
+}
+
+// The IPv4 router reports the announce status to the tracker, unless only the IPv6 router is
+// running.
+DhtRouter*
+DhtController::primary_router() {
+  if (!m_router->is_active() && m_router6->is_active())
+    return m_router6.get();
+
+  return m_router.get();
+}
+
+void
+DhtController::apply_limits(DhtRouter* router) {
+  if (m_max_peers_per_torrent != 0)
+    router->peer_store()->set_max_peers(m_max_peers_per_torrent);
+
+  if (m_max_peers_total != 0)
+    router->peer_store()->set_max_total(m_max_peers_total);
+
+  auto scheduler = router->server()->announce_scheduler();
+
+  if (m_announce_query_rate != 0 || m_announce_query_burst != 0)
+    scheduler->set_query_limit(m_announce_query_rate != 0 ? m_announce_query_rate : scheduler->query_rate(),
+                               m_announce_query_burst != 0 ? m_announce_query_burst : scheduler->query_burst());
+
+  if (m_announce_max_active != 0)
+    scheduler->set_max_active(m_announce_max_active);
 }
 
 // We don't care about the tracker or download being deleted as that's a rare edge-case that's
@@ -167,7 +275,11 @@ DhtController::announce(const HashString& info_hash, std::weak_ptr<TrackerDht> w
       if (!m_router)
         throw internal_error("DhtController::announce() called but DHT not initialized.");
 
-      m_router->announce(info_hash, weak_tracker);
+      auto primary = primary_router();
+
+      for (auto r : {m_router.get(), m_router6.get()})
+        if (r->is_active() || r == primary)
+          r->announce(info_hash, weak_tracker, r == primary);
     });
 }
 
@@ -180,6 +292,7 @@ DhtController::cancel_announce(const HashString& info_hash, std::weak_ptr<Tracke
         throw internal_error("DhtController::cancel_announce() called but DHT not initialized.");
 
       m_router->cancel_announce(info_hash, weak_tracker);
+      m_router6->cancel_announce(info_hash, weak_tracker);
     });
 }
 
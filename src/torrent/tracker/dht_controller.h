@@ -19,13 +19,16 @@ public:
     // Cycle; 0=inactive, 1=initial bootstrapping, 2 and up=normal operation
     unsigned int       cycle{};
 
-    // DHT query statistics.
+    // DHT query statistics, for both address families.
     unsigned int       queries_received{};
     unsigned int       queries_sent{};
     unsigned int       replies_received{};
     unsigned int       errors_received{};
     unsigned int       errors_caught{};
 
+    // Queries dropped for exceeding the per source rate limits.
+    unsigned int       queries_dropped{};
+
     // DHT node info.
     unsigned int       num_nodes{};
     unsigned int       num_buckets{};
@@ -34,6 +37,21 @@ public:
     unsigned int       num_peers{};
     unsigned int       max_peers{};
     unsigned int       num_trackers{};
+
+    // Peers received in get_peers replies, and approximate memory used by the
+    // routing table and tracked peers.
+    uint64_t           peers_received{};
+    size_t             memory_usage{};
+
+    // The same for the IPv6 DHT (BEP 32), the fields above without the suffix
+    // are for IPv4. Zero if the IPv6 DHT is not running.
+    unsigned int       num_nodes6{};
+    unsigned int       num_buckets6{};
+    unsigned int       num_peers6{};
+    unsigned int       max_peers6{};
+    unsigned int       num_trackers6{};
+    uint64_t           peers_received6{};
+    size_t             memory_usage6{};
   };
 
   DhtController();
@@ -61,10 +79,19 @@ public:
   Object*             store_cache(Object* container);
 
   // Add a node by host (from a torrent file), or by address from explicit add_node
-  // command or the BT PORT message.
+  // command or the BT PORT message. Nodes are added to the DHT of their address
+  // family.
   void                add_bootstrap_node(std::string host, int port);
   void                add_node(const sockaddr* sa, int port);
 
+  // Limits the peers announced to us, per torrent and in total across all torrents. Zero keeps
+  // the default, the limits are kept when the DHT is re-initialized.
+  void                set_peer_limits(unsigned int max_per_torrent, size_t max_total);
+
+  // Limits the queries per second, burst size and concurrent lookups of the announce scheduler.
+  // Zero keeps the default, the limits are kept when the DHT is re-initialized.
+  void                set_announce_limits(unsigned int query_rate, unsigned int query_burst, unsigned int max_active);
+
   statistics_type     get_statistics();
   void                reset_statistics();
 
@@ -80,7 +107,19 @@ private:
   uint16_t            m_port{0};
   bool                m_receive_requests{true};
 
+  unsigned int        m_max_peers_per_torrent{};
+  size_t              m_max_peers_total{};
+
+  unsigned int        m_announce_query_rate{};
+  unsigned int        m_announce_query_burst{};
+  unsigned int        m_announce_max_active{};
+
+  DhtRouter*          primary_router();
+  void                apply_limits(DhtRouter* router);
+
+  // The IPv6 router is only started when there is an IPv6 bind address.
   std::unique_ptr<DhtRouter> m_router;
+  std::unique_ptr<DhtRouter> m_router6;
 };
 
 } // namespace torrent::tracker
@@ -1,18 +1,22 @@
 #include "config.h"
 
 #include <cassert>
+#include <limits>
 #include <utility>
 
 #include "torrent/download_info.h"
 #include "torrent/exceptions.h"
+#include "torrent/net/types.h"
 #include "torrent/tracker/manager.h"
 #include "torrent/tracker/tracker.h"
 #include "torrent/utils/log.h"
 #include "torrent/system/callbacks.h"
 #include "torrent/system/thread.h"
+#include "torrent/utils/random.h"
 #include "torrent/utils/string_manip.h"
 #include "tracker/tracker_controller.h"
 #include "tracker/tracker_list.h"
+#include "tracker/request_pacer.h"
 #include "tracker/tracker_worker.h"
 
 #define LT_LOG_TRACKER_EVENTS(log_fmt, ...)                             \
@@ -23,7 +27,13 @@
 
 namespace torrent::tracker {
 
-Manager::Manager() = default;
+Manager::Manager()
+  : m_pacing_interval(RequestPacer::default_interval),
+    m_pacing_jitter(RequestPacer::default_jitter),
+    m_pacer(std::make_unique<RequestPacer>()) {
+
+  m_task_paced.slot() = [this] { process_paced_requests(); };
+}
 
 // This doesn't ensure newly deleted torrents finish their stopped announce in case we shut down
 // immediately after, however this is an edge-case that's not worth adding complexity to handle.
@@ -31,6 +41,8 @@ Manager::Manager() = default;
 Manager::~Manager() {
   assert(std::this_thread::get_id() == tracker_thread::thread_id());
 
+  this_thread::scheduler()->erase(&m_task_paced);
+
   {
     auto guard = std::scoped_lock(m_lock);
 
@@ -41,6 +53,32 @@ Manager::~Manager() {
   process_delete_trackers();
 }
 
+std::chrono::microseconds
+Manager::pacing_interval() const {
+  auto guard = std::scoped_lock(m_lock);
+  return m_pacing_interval;
+}
+
+std::chrono::microseconds
+Manager::pacing_jitter() const {
+  auto guard = std::scoped_lock(m_lock);
+  return m_pacing_jitter;
+}
+
+void
+Manager::set_pacing(std::chrono::microseconds interval, std::chrono::microseconds jitter) {
+  if (interval < std::chrono::microseconds{} || jitter < std::chrono::microseconds{})
+    throw input_error("Tracker pacing interval and jitter must not be negative.");
+
+  if (jitter.count() > std::numeric_limits<uint32_t>::max())
+    throw input_error("Tracker pacing jitter is too large.");
+
+  auto guard = std::scoped_lock(m_lock);
+
+  m_pacing_interval = interval;
+  m_pacing_jitter   = jitter;
+}
+
 TrackerControllerWrapper
 Manager::add_controller(DownloadInfo* download_info, std::shared_ptr<TrackerController> controller) {
   assert(std::this_thread::get_id() == main_thread::thread_id());
@@ -84,14 +122,22 @@ Manager::send_event(tracker::Tracker& tracker, TrackerParams params, tracker::Tr
 
   auto weak_ptr = tracker.get_weak_ptr();
 
-  tracker_thread::thread()->callback(tracker.get_worker()->callback_id(), [weak_ptr, params, new_event]() {
+  tracker_thread::thread()->callback(tracker.get_worker()->callback_id(), [this, weak_ptr, params, new_event]() {
       auto tracker = weak_ptr.lock();
 
       if (tracker == nullptr)
         return;
 
       tracker->mark_starting_request();
-      tracker->send_event(params, new_event);
+
+      // Stopped events are sent immediately as they might be the last request before shutdown.
+      if (new_event == tracker::TrackerState::EVENT_STOPPED) {
+        cancel_paced_request(tracker.get());
+        tracker->send_event(params, new_event);
+        return;
+      }
+
+      pace_request(weak_ptr, [params, new_event](TrackerWorker* worker) { worker->send_event(params, new_event); });
     });
 }
 
@@ -101,13 +147,19 @@ Manager::send_scrape(tracker::Tracker& tracker, TrackerParams params) {
 
   auto weak_ptr = tracker.get_weak_ptr();
 
-  tracker_thread::thread()->callback(tracker.get_worker()->callback_id(), [weak_ptr, params]() {
+  tracker_thread::thread()->callback(tracker.get_worker()->callback_id(), [this, weak_ptr, params]() {
       auto tracker = weak_ptr.lock();
 
       if (tracker == nullptr)
         return;
 
-      tracker->send_scrape(params);
+      // UDP scrapes are batched per endpoint by UdpScraper.
+      if (tracker->type() == TRACKER_UDP) {
+        tracker->send_scrape(params);
+        return;
+      }
+
+      pace_request(weak_ptr, [params](TrackerWorker* worker) { worker->send_scrape(params); });
     });
 }
 
@@ -181,6 +233,8 @@ Manager::update_tracker(const Tracker& tracker) {
 
 void
 Manager::delete_tracker(Tracker tracker) {
+  cancel_request(tracker);
+
   auto guard = std::scoped_lock(m_lock);
 
   if (tracker.is_requesting_not_dht_scrape_disownable()) {
@@ -196,6 +250,9 @@ Manager::delete_tracker(Tracker tracker) {
 
 void
 Manager::delete_trackers(std::vector<Tracker>&& trackers) {
+  for (auto& tracker : trackers)
+    cancel_request(tracker);
+
   auto guard = std::scoped_lock(m_lock);
 
   for (auto& tracker : trackers) {
@@ -211,6 +268,94 @@ Manager::delete_trackers(std::vector<Tracker>&& trackers) {
   }
 }
 
+// Trackers deleted while their request was paced wait in 'm_trackers_to_wait' for it, so they
+// are updated once it is dropped.
+void
+Manager::cancel_request(const Tracker& tracker) {
+  auto weak_ptr = tracker.get_weak_ptr();
+
+  tracker_thread::thread()->callback([this, weak_ptr]() {
+      auto worker = weak_ptr.lock();
+
+      if (worker == nullptr || !cancel_paced_request(worker.get()))
+        return;
+
+      worker->clear_starting_request();
+      update_tracker(Tracker::from_weak_ptr(weak_ptr));
+    });
+}
+
+void
+Manager::pace_request(std::weak_ptr<TrackerWorker> weak_ptr, std::function<void (TrackerWorker*)>&& fn) {
+  assert(std::this_thread::get_id() == tracker_thread::thread_id());
+
+  auto worker = weak_ptr.lock();
+
+  if (worker == nullptr)
+    return;
+
+  if (worker->type() != TRACKER_HTTP && worker->type() != TRACKER_UDP) {
+    m_pacer->erase(worker.get());
+    return fn(worker.get());
+  }
+
+  {
+    auto guard = std::scoped_lock(m_lock);
+
+    m_pacer->set_interval(m_pacing_interval);
+    m_pacer->set_jitter(m_pacing_jitter);
+  }
+
+  // Workers that were deleted while waiting are skipped.
+  auto slot = [weak_ptr, fn]() {
+      auto worker = weak_ptr.lock();
+
+      if (worker == nullptr)
+        return;
+
+      {
+        auto guard = worker->lock_guard();
+
+        if (worker->state().is_deleted())
+          return;
+      }
+
+      fn(worker.get());
+    };
+
+  auto hostname = net::parse_uri_host_port(worker->info().url).first;
+
+  if (!m_pacer->insert(worker.get(), hostname, this_thread::cached_time(), std::move(slot)))
+    return fn(worker.get());
+
+  this_thread::scheduler()->update_wait_until(&m_task_paced, m_pacer->next_time());
+}
+
+bool
+Manager::cancel_paced_request(TrackerWorker* worker) {
+  assert(std::this_thread::get_id() == tracker_thread::thread_id());
+
+  return m_pacer->erase(worker);
+}
+
+size_t
+Manager::size_paced_requests() const {
+  assert(std::this_thread::get_id() == tracker_thread::thread_id());
+
+  return m_pacer->size();
+}
+
+void
+Manager::process_paced_requests() {
+  assert(std::this_thread::get_id() == tracker_thread::thread_id());
+
+  for (auto& slot : m_pacer->pop_due(this_thread::cached_time()))
+    slot();
+
+  if (!m_pacer->empty())
+    this_thread::scheduler()->update_wait_until(&m_task_paced, m_pacer->next_time());
+}
+
 void
 Manager::process_delete_trackers() {
   assert(std::this_thread::get_id() == tracker_thread::thread_id());
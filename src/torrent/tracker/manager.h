@@ -3,9 +3,13 @@
 #ifndef LIBTORRENT_TRACKER_MANAGER_H
 #define LIBTORRENT_TRACKER_MANAGER_H
 
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <string>
 #include <vector>
+#include <torrent/system/scheduler.h>
 #include <torrent/tracker/tracker.h>
 #include <torrent/tracker/wrappers.h>
 
@@ -15,17 +19,30 @@ class TrackerWorker;
 
 namespace torrent::tracker {
 
+class RequestPacer;
+
 class LIBTORRENT_EXPORT Manager {
 public:
   Manager();
   ~Manager();
 
+  // Announces and HTTP scrapes to the same tracker host are sent at most once per 'interval', with
+  // up to 'jitter' added to those that get delayed. An interval of zero disables pacing.
+  //
+  // Thread-safe, changes apply to requests made afterwards.
+
+  std::chrono::microseconds pacing_interval() const;
+  std::chrono::microseconds pacing_jitter() const;
+
+  void                set_pacing(std::chrono::microseconds interval, std::chrono::microseconds jitter);
+
 protected:
   friend class torrent::DownloadMain;
   friend class torrent::DownloadWrapper;
   friend class torrent::TrackerList;
   friend class torrent::TrackerWorker;
   friend class torrent::ThreadTracker;
+  friend class Tracker;
 
   // TODO: Add flag to indicate we're shutting down, and delete all disownable trackers.
 
@@ -48,17 +65,36 @@ protected:
   void                delete_tracker(Tracker tracker);
   void                delete_trackers(std::vector<Tracker>&& trackers);
 
+  // Drops the paced request of a tracker that is disabled or deleted, so it is never sent.
+  void                cancel_request(const Tracker& tracker);
+
+  // Tracker thread:
+  //
+  // A newer request replaces any paced request for the worker.
+
+  void                pace_request(std::weak_ptr<TrackerWorker> weak_ptr, std::function<void (TrackerWorker*)>&& fn);
+  bool                cancel_paced_request(TrackerWorker* worker);
+
+  size_t              size_paced_requests() const;
+
 private:
   Manager(const Manager&) = delete;
   Manager& operator=(const Manager&) = delete;
 
   void                process_delete_trackers();
+  void                process_paced_requests();
 
-  std::mutex          m_lock;
+  mutable std::mutex  m_lock;
 
   std::set<TrackerControllerWrapper> m_controllers;
   std::vector<Tracker>               m_trackers_to_wait;
   std::vector<Tracker>               m_trackers_to_delete;
+
+  std::chrono::microseconds          m_pacing_interval;
+  std::chrono::microseconds          m_pacing_jitter;
+
+  std::unique_ptr<RequestPacer>      m_pacer;
+  system::SchedulerEntry             m_task_paced;
 };
 
 } // namespace torrent::tracker
@@ -2,6 +2,8 @@
 
 #include "torrent/tracker/tracker.h"
 
+#include "torrent/tracker/manager.h"
+#include "tracker/thread_tracker.h"
 #include "tracker/tracker_dht.h"
 #include "tracker/tracker_worker.h"
 #include "torrent/runtime/network_manager.h"
@@ -177,9 +179,7 @@ Tracker::disable() {
     m_worker->m_state.m_flags &= ~tracker::TrackerState::flag_enabled;
   }
 
-  // TODO: This should be called through manager? It works atm as the trackers are all running on main
-  // thread.
-  // m_worker->close();
+  tracker_thread::manager()->cancel_request(*this);
 
   if (m_worker->m_slot_disabled)
     m_worker->m_slot_disabled();
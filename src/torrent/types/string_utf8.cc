@@ -2,18 +2,88 @@
 
 #include "string_utf8.h"
 
+#include <atomic>
+#include <mutex>
+
 #include "torrent/object.h"
 #include "torrent/utils/string_manip.h"
 
 namespace torrent {
 
+namespace {
+
+struct encoding_cache {
+  std::once_flag hex_flag;
+  std::once_flag base64_flag;
+
+  std::string    hex;
+  std::string    base64;
+};
+
+} // namespace
+
+// Copies of a string_utf8 may be used from different threads. Few strings are ever encoded, so
+// the cache is allocated on first use and installed atomically, and its strings are only written
+// once through their once_flag.
+struct string_utf8::value_type : public string_utf8::value_base {
+  ~value_type() { delete m_cache.load(std::memory_order_relaxed); }
+
+  encoding_cache* cache() const;
+
+  mutable std::atomic<encoding_cache*> m_cache{};
+};
+
+encoding_cache*
+string_utf8::value_type::cache() const {
+  auto current = m_cache.load(std::memory_order_acquire);
+
+  if (current != nullptr)
+    return current;
+
+  auto created = std::make_unique<encoding_cache>();
+
+  if (!m_cache.compare_exchange_strong(current, created.get(), std::memory_order_acq_rel, std::memory_order_acquire))
+    return current;
+
+  return created.release();
+}
+
 void
 string_utf8::reset(const std::string& str) {
-  m_hex.clear();
-  m_base64.clear();
+  if (str.empty()) {
+    m_value.reset();
+    return;
+  }
 
-  m_str     = str;
-  m_is_utf8 = utils::is_valid_utf8(str);
+  auto value = std::make_shared<value_type>();
+  value->str     = str;
+  value->is_utf8 = utils::is_valid_utf8(str);
+
+  m_value = std::move(value);
+}
+
+const std::string&
+string_utf8::hex() const {
+  if (m_value == nullptr)
+    return empty_string();
+
+  auto value = static_cast<const value_type*>(m_value.get());
+  auto cache = value->cache();
+
+  std::call_once(cache->hex_flag, [value, cache] { cache->hex = utils::transform_to_hex_str(value->str); });
+  return cache->hex;
+}
+
+const std::string&
+string_utf8::base64() const {
+  if (m_value == nullptr)
+    return empty_string();
+
+  auto value = static_cast<const value_type*>(m_value.get());
+  auto cache = value->cache();
+
+  std::call_once(cache->base64_flag, [value, cache] { cache->base64 = utils::transform_to_base64(value->str); });
+  return cache->base64;
 }
 
 Object
@@ -34,7 +104,7 @@ string_utf8::object_base64() const {
 
 Object
 string_utf8::object_as_binary() const {
-  auto obj = Object(m_str);
+  auto obj = Object(str());
   obj.set_flags(Object::flag_as_binary);
 
   return obj;
@@ -58,48 +128,57 @@ string_utf8::object_base64_as_binary() const {
 
 Object
 string_utf8::object_utf8_or_hex() const {
-  if (!m_is_utf8) {
+  if (!is_utf8()) {
     auto obj = Object(hex());
     obj.set_flags(Object::flag_hex | Object::flag_as_binary);
 
     return obj;
   }
 
-  return Object(m_str);
+  return Object(str());
 }
 
 Object
 string_utf8::object_utf8_or_base64() const {
-  if (!m_is_utf8) {
+  if (!is_utf8()) {
     auto obj = Object(base64());
     obj.set_flags(Object::flag_base64 | Object::flag_as_binary);
 
     return obj;
   }
 
-  return Object(m_str);
+  return Object(str());
 }
 
 Object
 string_utf8::object_utf8_or_as_binary() const {
-  if (!m_is_utf8) {
-    auto obj = Object(m_str);
+  if (!is_utf8()) {
+    auto obj = Object(str());
     obj.set_flags(Object::flag_as_binary);
 
     return obj;
   }
 
-  return Object(m_str);
+  return Object(str());
 }
 
-void
-string_utf8::reset_hex() const {
-  m_hex = utils::transform_to_hex_str(m_str);
+const std::string&
+string_utf8::empty_string() {
+  static const std::string empty;
+  return empty;
 }
 
-void
-string_utf8::reset_base64() const {
-  m_base64 = utils::transform_to_base64(m_str);
+const string_utf8&
+string_utf8_pool::intern(std::string_view str) {
+  auto itr = m_strings.find(str);
+
+  if (itr != m_strings.end())
+    return itr->second;
+
+  auto             value = string_utf8::from_string(std::string(str));
+  std::string_view key   = value.str();
+
+  return m_strings.emplace(key, std::move(value)).first->second;
 }
 
 } // namespace torrent
@@ -1,11 +1,17 @@
 #ifndef LIBTORRENT_TORRENT_TYPES_STRING_UTF8_H
 #define LIBTORRENT_TORRENT_TYPES_STRING_UTF8_H
 
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <torrent/common.h>
 
 namespace torrent {
 
+// The string is immutable and shared between copies, so paths of large torrents only keep one
+// copy of each distinct component when built through string_utf8_pool.
+
 class LIBTORRENT_EXPORT string_utf8 {
 public:
   string_utf8() = default;
@@ -20,7 +26,7 @@ public:
   const std::string& str() const;
   const char*        c_str() const;
 
-  // Generates a cached encoded strings, not thread-safe.
+  // Encoded on first use and cached in the value shared with copies, thread-safe.
   const std::string& hex() const;
   const std::string& base64() const;
 
@@ -38,22 +44,39 @@ public:
 
   void               reset(const std::string& str);
 
+  // Compares the shared storage, equal strings may still have different storage.
+  bool               is_same_storage(const string_utf8& other) const { return m_value == other.m_value; }
+
 private:
-  void               reset_hex() const;
-  void               reset_base64() const;
+  struct value_base {
+    std::string         str;
+    bool                is_utf8{true};
+  };
+
+  // Adds the lazily allocated encoded string caches, defined in string_utf8.cc.
+  struct value_type;
+
+  static const std::string& empty_string();
 
-  bool               m_is_utf8{true};
+  std::shared_ptr<const value_base> m_value;
+};
+
+class LIBTORRENT_EXPORT string_utf8_pool {
+public:
+  const string_utf8& intern(std::string_view str);
 
-  std::string         m_str;
+  size_t             size() const { return m_strings.size(); }
+  void               clear()      { m_strings.clear(); }
 
-  mutable std::string m_hex;
-  mutable std::string m_base64;
+private:
+  // Keys point to the storage of the mapped string.
+  std::unordered_map<std::string_view, string_utf8> m_strings;
 };
 
-inline bool               string_utf8::empty() const   { return m_str.empty(); }
-inline bool               string_utf8::is_utf8() const { return m_is_utf8; }
-inline const std::string& string_utf8::str() const     { return m_str; }
-inline const char*        string_utf8::c_str() const   { return m_str.c_str(); }
+inline bool               string_utf8::empty() const   { return m_value == nullptr; }
+inline bool               string_utf8::is_utf8() const { return m_value == nullptr || m_value->is_utf8; }
+inline const std::string& string_utf8::str() const     { return m_value != nullptr ? m_value->str : empty_string(); }
+inline const char*        string_utf8::c_str() const   { return str().c_str(); }
 
 inline string_utf8
 string_utf8::from_string(const std::string& str) {
@@ -63,22 +86,6 @@ string_utf8::from_string(const std::string& str) {
   return result;
 }
 
-inline const std::string&
-string_utf8::hex() const  {
-  if (!m_str.empty() && m_hex.empty())
-    reset_hex();
-
-  return m_hex;
-}
-
-inline const std::string&
-string_utf8::base64() const  {
-  if (!m_str.empty() && m_base64.empty())
-    reset_base64();
-
-  return m_base64;
-}
-
 } // namespace torrent
 
 #endif
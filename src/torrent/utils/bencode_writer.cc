@@ -0,0 +1,211 @@
+#include "config.h"
+
+#include "torrent/utils/bencode_writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iterator>
+#include <sys/uio.h>
+
+#include "torrent/exceptions.h"
+#include "torrent/object.h"
+
+namespace torrent::utils {
+
+namespace {
+
+object_buffer_t
+bencode_write_to_string(void* data, object_buffer_t buffer) {
+  static_cast<std::string*>(data)->append(buffer.first, buffer.second);
+  return buffer;
+}
+
+std::string
+bencode_encode_entry(const std::string& key, const Object* value, uint32_t skip_mask) {
+  char        buffer[1024];
+  std::string result = std::to_string(key.size()) + ':' + key;
+
+  object_write_bencode_c(&bencode_write_to_string, &result, object_buffer_t(buffer, buffer + sizeof(buffer)), value, skip_mask);
+  return result;
+}
+
+} // namespace
+
+BencodeWriter::~BencodeWriter() = default;
+
+void
+BencodeWriter::write(const Object* object, uint32_t skip_mask) {
+  object_write_bencode_c(&write_next, this, next_buffer(), object, skip_mask);
+}
+
+void
+BencodeWriter::write_raw(const char* data, size_t length) {
+  while (length != 0) {
+    auto   buffer = next_buffer();
+    size_t len    = std::min<size_t>(length, std::distance(buffer.first, buffer.second));
+
+    std::memcpy(buffer.first, data, len);
+    m_buffers.back().used += len;
+    m_size += len;
+
+    data   += len;
+    length -= len;
+  }
+}
+
+// Entries are encoded with their key so cached entries are copied with a single write.
+
+void
+BencodeWriter::write_incremental(const std::string& id, const Object* object, uint32_t skip_mask) {
+  if (!object->is_map() || object->flags() & skip_mask) {
+    m_cache.erase(id);
+    write(object, skip_mask);
+    return;
+  }
+
+  auto&       old_cache = m_cache[id];
+  entry_cache new_cache;
+
+  write_raw("d", 1);
+
+  for (const auto& [key, value] : object->as_map()) {
+    if (value.is_empty() || value.flags() & skip_mask)
+      continue;
+
+    if (value.flags() & Object::flag_session_data) {
+      auto encoded = bencode_encode_entry(key, &value, skip_mask);
+      write_raw(encoded.data(), encoded.size());
+      continue;
+    }
+
+    std::string encoded;
+    auto        itr = old_cache.find(key);
+
+    if (itr != old_cache.end())
+      encoded = std::move(itr->second);
+    else
+      encoded = bencode_encode_entry(key, &value, skip_mask);
+
+    write_raw(encoded.data(), encoded.size());
+    new_cache.emplace(key, std::move(encoded));
+  }
+
+  write_raw("e", 1);
+
+  old_cache.swap(new_cache);
+}
+
+bool
+BencodeWriter::flush(int fd) {
+  size_t index = 0;
+
+  while (true) {
+    while (index != m_buffers.size() && m_buffers[index].position == m_buffers[index].used)
+      index++;
+
+    if (index == m_buffers.size())
+      break;
+
+    iovec  iov[64];
+    size_t count = 0;
+
+    for (; count != std::size(iov) && index + count != m_buffers.size(); count++) {
+      auto& buffer = m_buffers[index + count];
+
+      iov[count].iov_base = buffer.data.get() + buffer.position;
+      iov[count].iov_len  = buffer.used - buffer.position;
+    }
+
+    ssize_t result = ::writev(fd, iov, count);
+
+    if (result == -1) {
+      if (errno == EINTR)
+        continue;
+
+      release_buffers(index);
+      return false;
+    }
+
+    auto written = static_cast<size_t>(result);
+
+    for (; written != 0; index++) {
+      auto&  buffer = m_buffers[index];
+      size_t len    = std::min(written, buffer.used - buffer.position);
+
+      buffer.position += len;
+      written         -= len;
+      m_size          -= len;
+
+      if (buffer.position != buffer.used)
+        break;
+    }
+  }
+
+  release_buffers(index);
+  return true;
+}
+
+void
+BencodeWriter::clear() {
+  release_buffers(m_buffers.size());
+  m_size = 0;
+}
+
+std::string
+BencodeWriter::str() const {
+  std::string result;
+  result.reserve(m_size);
+
+  for (const auto& buffer : m_buffers)
+    result.append(buffer.data.get() + buffer.position, buffer.used - buffer.position);
+
+  return result;
+}
+
+// Called with the range filled since the last call, the data is already in place so only the
+// counters need updating.
+
+object_buffer_t
+BencodeWriter::write_next(void* data, object_buffer_t buffer) {
+  auto  writer = static_cast<BencodeWriter*>(data);
+  auto& back   = writer->m_buffers.back();
+
+  if (buffer.first != back.data.get() + back.used)
+    throw internal_error("BencodeWriter::write_next() called with an unexpected buffer.");
+
+  back.used      += std::distance(buffer.first, buffer.second);
+  writer->m_size += std::distance(buffer.first, buffer.second);
+
+  return writer->next_buffer();
+}
+
+object_buffer_t
+BencodeWriter::next_buffer() {
+  if (m_buffers.empty() || m_buffers.back().used == buffer_size) {
+    buffer_type buffer;
+
+    if (m_pool.empty()) {
+      buffer.data.reset(new char[buffer_size]);
+    } else {
+      buffer.data = std::move(m_pool.back());
+      m_pool.pop_back();
+    }
+
+    m_buffers.push_back(std::move(buffer));
+  }
+
+  auto& back = m_buffers.back();
+  return object_buffer_t(back.data.get() + back.used, back.data.get() + buffer_size);
+}
+
+void
+BencodeWriter::release_buffers(size_t count) {
+  for (size_t i = 0; i != count; i++)
+    if (m_pool.size() < pool_size)
+      m_pool.push_back(std::move(m_buffers[i].data));
+
+  m_buffers.erase(m_buffers.begin(), m_buffers.begin() + count);
+}
+
+} // namespace torrent::utils
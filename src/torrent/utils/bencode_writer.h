@@ -0,0 +1,80 @@
+#ifndef LIBTORRENT_TORRENT_UTILS_BENCODE_WRITER_H
+#define LIBTORRENT_TORRENT_UTILS_BENCODE_WRITER_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <torrent/common.h>
+#include <torrent/object_stream.h>
+
+// Streaming bencode writer for saving session state, serializing directly into pooled large
+// buffers and writing them out with a single writev per batch.
+//
+// Any number of objects may be written back to back before flushing, e.g. all resume data into
+// one file or as records appended to a log.
+//
+// The incremental mode keeps the encoded top-level dictionary entries of each document, and only
+// re-encodes entries flagged 'flag_session_data' or not seen in the previous write. Clients must
+// flag entries that change, or erase the document from the cache.
+
+namespace torrent::utils {
+
+class LIBTORRENT_EXPORT BencodeWriter {
+public:
+  static constexpr size_t buffer_size = 64 << 10;
+  static constexpr size_t pool_size   = 4;
+
+  BencodeWriter() = default;
+  ~BencodeWriter();
+
+  bool                empty() const        { return m_size == 0; }
+  size_t              size() const         { return m_size; }
+  size_t              size_buffers() const { return m_buffers.size(); }
+  size_t              size_pool() const    { return m_pool.size(); }
+  size_t              size_cache() const   { return m_cache.size(); }
+
+  void                write(const Object* object, uint32_t skip_mask = 0);
+  void                write_raw(const char* data, size_t length);
+
+  void                write_incremental(const std::string& id, const Object* object, uint32_t skip_mask = 0);
+
+  void                erase_cache(const std::string& id) { m_cache.erase(id); }
+  void                clear_cache()                      { m_cache.clear(); }
+
+  // Returns false with errno set on write errors, the data not yet written is kept.
+  bool                flush(int fd);
+
+  // Discards buffered data, returning the buffers to the pool.
+  void                clear();
+
+  // Copies the buffered data, mainly for testing.
+  std::string         str() const;
+
+private:
+  BencodeWriter(const BencodeWriter&) = delete;
+  BencodeWriter& operator=(const BencodeWriter&) = delete;
+
+  struct buffer_type {
+    std::unique_ptr<char[]> data;
+    size_t                  position{};
+    size_t                  used{};
+  };
+
+  using entry_cache = std::map<std::string, std::string>;
+
+  static object_buffer_t write_next(void* data, object_buffer_t buffer);
+
+  object_buffer_t     next_buffer();
+  void                release_buffers(size_t count);
+
+  std::vector<buffer_type> m_buffers;
+  std::vector<std::unique_ptr<char[]>> m_pool;
+  size_t              m_size{};
+
+  std::map<std::string, entry_cache> m_cache;
+};
+
+} // namespace torrent::utils
+
+#endif
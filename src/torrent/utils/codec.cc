@@ -0,0 +1,177 @@
+#include "config.h"
+
+#include "torrent/utils/codec.h"
+
+#include <array>
+#include <cstring>
+
+#include "torrent/exceptions.h"
+
+namespace torrent::utils {
+
+namespace {
+
+constexpr char hex_chars[]    = "0123456789ABCDEF";
+constexpr char base32_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+constexpr uint8_t invalid_value = 0xff;
+
+// Two output characters per input byte.
+constexpr auto hex_encode_table = [] {
+    std::array<uint16_t, 256> table{};
+
+    for (unsigned int i = 0; i < 256; i++) {
+      uint8_t chars[2] = { static_cast<uint8_t>(hex_chars[i >> 4]), static_cast<uint8_t>(hex_chars[i & 0xf]) };
+      table[i] = chars[0] | (chars[1] << 8);
+    }
+
+    return table;
+  }();
+
+constexpr auto hex_decode_table = [] {
+    std::array<uint8_t, 256> table{};
+
+    for (auto& value : table)
+      value = invalid_value;
+
+    for (unsigned int i = 0; i < 10; i++)
+      table['0' + i] = i;
+
+    for (unsigned int i = 0; i < 6; i++) {
+      table['A' + i] = 10 + i;
+      table['a' + i] = 10 + i;
+    }
+
+    return table;
+  }();
+
+constexpr auto base32_decode_table = [] {
+    std::array<uint8_t, 256> table{};
+
+    for (auto& value : table)
+      value = invalid_value;
+
+    for (unsigned int i = 0; i < 26; i++) {
+      table['A' + i] = i;
+      table['a' + i] = i;
+    }
+
+    for (unsigned int i = 0; i < 6; i++)
+      table['2' + i] = 26 + i;
+
+    return table;
+  }();
+
+} // namespace
+
+// The table entries are stored little-endian so the two characters can be copied as one word.
+
+void
+codec_encode_hex(const void* src, size_t length, char* dst) {
+  auto first = static_cast<const uint8_t*>(src);
+
+  for (size_t i = 0; i != length; i++) {
+    uint16_t chars = hex_encode_table[first[i]];
+
+    dst[2 * i]     = static_cast<char>(chars & 0xff);
+    dst[2 * i + 1] = static_cast<char>(chars >> 8);
+  }
+}
+
+bool
+codec_decode_hex(const char* src, size_t length, void* dst) {
+  if (length % 2 != 0)
+    return false;
+
+  auto    first  = reinterpret_cast<const uint8_t*>(src);
+  auto    result = static_cast<uint8_t*>(dst);
+  uint8_t error  = 0;
+
+  for (size_t i = 0; i != length / 2; i++) {
+    uint8_t high = hex_decode_table[first[2 * i]];
+    uint8_t low  = hex_decode_table[first[2 * i + 1]];
+
+    error |= high | low;
+    result[i] = (high << 4) | (low & 0xf);
+  }
+
+  return !(error & 0xf0);
+}
+
+void
+codec_encode_base32(const void* src, size_t length, char* dst) {
+  if (length % 5 != 0)
+    throw internal_error("codec_encode_base32() length is not a multiple of 5 bytes.");
+
+  auto first = static_cast<const uint8_t*>(src);
+
+  for (size_t i = 0; i != length; i += 5, dst += 8) {
+    uint64_t value = 0;
+
+    for (size_t j = 0; j != 5; j++)
+      value = (value << 8) | first[i + j];
+
+    for (int j = 7; j >= 0; j--, value >>= 5)
+      dst[j] = base32_chars[value & 0x1f];
+  }
+}
+
+bool
+codec_decode_base32(const char* src, size_t length, void* dst) {
+  if (length % 8 != 0)
+    return false;
+
+  auto    first  = reinterpret_cast<const uint8_t*>(src);
+  auto    result = static_cast<uint8_t*>(dst);
+  uint8_t error  = 0;
+
+  for (size_t i = 0; i != length; i += 8, result += 5) {
+    uint64_t value = 0;
+
+    for (size_t j = 0; j != 8; j++) {
+      uint8_t c = base32_decode_table[first[i + j]];
+
+      error |= c;
+      value = (value << 5) | (c & 0x1f);
+    }
+
+    for (int j = 4; j >= 0; j--, value >>= 8)
+      result[j] = static_cast<uint8_t>(value);
+  }
+
+  return !(error & 0xe0);
+}
+
+// The destination is fully written so callers may pass uninitialized storage.
+
+size_t
+codec_decode_compact_inet(const char* src, size_t length, sa_inet_union* dst) {
+  size_t count = codec_compact_inet_count(length);
+
+  for (size_t i = 0; i != count; i++, src += 6) {
+    std::memset(&dst[i], 0, sizeof(sa_inet_union));
+
+    dst[i].inet.sin_family = AF_INET;
+    std::memcpy(&dst[i].inet.sin_addr.s_addr, src, 4);
+    std::memcpy(&dst[i].inet.sin_port, src + 4, 2);
+  }
+
+  return count;
+}
+
+size_t
+codec_decode_compact_inet6(const char* src, size_t length, sa_inet_union* dst) {
+  size_t count = codec_compact_inet6_count(length);
+
+  for (size_t i = 0; i != count; i++, src += 18) {
+    std::memset(&dst[i], 0, sizeof(sa_inet_union));
+
+    dst[i].inet6.sin6_family = AF_INET6;
+    std::memcpy(&dst[i].inet6.sin6_addr, src, 16);
+    std::memcpy(&dst[i].inet6.sin6_port, src + 16, 2);
+  }
+
+  return count;
+}
+
+} // namespace torrent::utils
@@ -0,0 +1,40 @@
+#ifndef LIBTORRENT_TORRENT_UTILS_CODEC_H
+#define LIBTORRENT_TORRENT_UTILS_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <torrent/common.h>
+#include <torrent/net/types.h>
+
+// Table driven codecs for the encodings found in hot parsing paths; hex for info-hashes and log
+// output, base32 for magnet links, and the raw binary compact peer/node addresses from trackers,
+// PEX and DHT.
+//
+// Decoding validates the whole input before returning, invalid characters are accumulated
+// rather than checked per byte.
+
+namespace torrent::utils {
+
+// Hex uses uppercase on output and accepts either case on input.
+void                codec_encode_hex(const void* src, size_t length, char* dst) LIBTORRENT_EXPORT;
+bool                codec_decode_hex(const char* src, size_t length, void* dst) LIBTORRENT_EXPORT;
+
+// RFC 4648 base32 without padding. Encoding throws internal_error unless 'length' of the input
+// is a multiple of 5 bytes, decoding fails unless it is a multiple of 8 characters.
+void                codec_encode_base32(const void* src, size_t length, char* dst) LIBTORRENT_EXPORT;
+bool                codec_decode_base32(const char* src, size_t length, void* dst) LIBTORRENT_EXPORT;
+
+constexpr size_t    codec_hex_size(size_t length)    { return length * 2; }
+constexpr size_t    codec_base32_size(size_t length) { return (length / 5) * 8; }
+
+// Compact addresses are network order address followed by the port, 6 bytes for inet and 18 for
+// inet6. Trailing partial records are ignored, returns the number of addresses written.
+size_t              codec_decode_compact_inet(const char* src, size_t length, sa_inet_union* dst) LIBTORRENT_EXPORT;
+size_t              codec_decode_compact_inet6(const char* src, size_t length, sa_inet_union* dst) LIBTORRENT_EXPORT;
+
+constexpr size_t    codec_compact_inet_count(size_t length)  { return length / 6; }
+constexpr size_t    codec_compact_inet6_count(size_t length) { return length / 18; }
+
+} // namespace torrent::utils
+
+#endif
@@ -2,6 +2,9 @@
 
 #include "resume.h"
 
+#include <optional>
+#include <vector>
+
 #include "data/file.h"
 #include "data/file_list.h"
 #include "data/transfer_list.h"
@@ -17,6 +20,7 @@
 #include "torrent/tracker/tracker.h"
 #include "torrent/utils/file_stat.h"
 #include "torrent/utils/log.h"
+#include "torrent/utils/resume_store.h"
 #include "tracker/tracker_list.h"
 
 #define LT_LOG_LOAD(log_fmt, ...)                                       \
@@ -34,6 +38,103 @@
 
 namespace torrent {
 
+// Applies the saved 'mtime' of a file, an empty value means the file should be handled as if
+// the torrent was new.
+static void
+resume_load_file_mtime(Download download, FileList::iterator listItr, std::optional<int64_t> mtime) {
+  FileList* fileList = download.file_list();
+
+  unsigned int file_index = std::distance(fileList->begin(), listItr);
+
+  utils::FileStat fs;
+
+  if (!mtime.has_value()) {
+    LT_LOG_LOAD_FILE("no mtime found, file:create|resize range:clear|recheck", 0);
+
+    // If 'mtime' is erased, it means we should start hashing and
+    // downloading the file as if it was a new torrent.
+    (*listItr)->set_flags(File::flag_create_queued | File::flag_resize_queued);
+
+    download.update_range(Download::update_range_recheck | Download::update_range_clear,
+                          (*listItr)->range().first, (*listItr)->range().second);
+    return;
+  }
+
+  int64_t mtimeValue = *mtime;
+  bool    fileExists = fs.update(fileList->root_dir() + (*listItr)->path()->as_string());
+
+  // The default action when we have 'mtime' is not to create nor
+  // resize the file.
+  (*listItr)->unset_flags(File::flag_create_queued | File::flag_resize_queued);
+
+  if (mtimeValue == ~int64_t{0} || mtimeValue == ~int64_t{1}) {
+    // If 'mtime' is ~0 it means we haven't gotten around to
+    // creating the file.
+    //
+    // Else if it is ~1 it means the file doesn't exist nor do we
+    // want to create it.
+    //
+    // When 'mtime' is ~2 we need to recheck the hash without
+    // creating the file. It will just fail on the mtime check
+    // later, so we don't need to handle it explicitly.
+
+    if (mtimeValue == ~int64_t{0}) {
+      LT_LOG_LOAD_FILE("file not created by client, file:create|resize range:clear|(recheck)", 0);
+      (*listItr)->set_flags(File::flag_create_queued | File::flag_resize_queued);
+    } else {
+      LT_LOG_LOAD_FILE("do not create file, file:- range:clear|(recheck)", 0);
+    }
+
+    // Ensure the bitfield range is cleared so that stray resume
+    // data doesn't get counted.
+    download.update_range(Download::update_range_clear | (fileExists ? Download::update_range_recheck : 0),
+                          (*listItr)->range().first, (*listItr)->range().second);
+    return;
+  }
+
+  // If the file is the wrong size, queue resize and clear resume
+  // data for that file.
+  if (static_cast<uint64_t>(fs.size()) != (*listItr)->size_bytes()) {
+    if (fs.size() == 0) {
+      LT_LOG_LOAD_FILE("zero-length file found, file:resize range:clear|recheck", 0);
+    } else {
+      LT_LOG_LOAD_FILE("file has the wrong size, file:resize range:clear|recheck", 0);
+    }
+
+    (*listItr)->set_flags(File::flag_resize_queued);
+    download.update_range(Download::update_range_clear | Download::update_range_recheck,
+                          (*listItr)->range().first, (*listItr)->range().second);
+    return;
+  }
+
+  // An 'mtime' of ~3 means the resume data was written while the
+  // torrent was actively downloading, and thus we need to recheck
+  // chunks that might not have been completely written to disk.
+  //
+  // This gets handled below, so just skip to the next file.
+  if (mtimeValue == ~int64_t{3}) {
+    LT_LOG_LOAD_FILE("file was downloading", 0);
+    return;
+  }
+
+  // An 'mtime' of ~2 indicates that the resume data was made by an
+  // old rtorrent version which does not include 'uncertain_pieces'
+  // field, and thus can't be relied upon.
+  //
+  // If the 'mtime' is an actual mtime we check to see if it matches
+  // the file, else clear the range. This should be set only for
+  // files that have completed and got no indices in
+  // TransferList::completed_list().
+  if (mtimeValue == ~int64_t{2} || mtimeValue != fs.modified_time()) {
+    LT_LOG_LOAD_FILE("resume data doesn't include uncertain pieces, range:clear|recheck", 0);
+    download.update_range(Download::update_range_clear | Download::update_range_recheck,
+                          (*listItr)->range().first, (*listItr)->range().second);
+    return;
+  }
+
+  LT_LOG_LOAD_FILE("no recheck needed", 0);
+}
+
 void
 resume_load_progress(Download download, const Object& object) {
   if (!object.has_key_list("files")) {
@@ -59,98 +160,81 @@ resume_load_progress(Download download, const Object& object) {
     if ( (*listItr)->is_padding())
       continue;
 
-    unsigned int file_index = std::distance(fileList->begin(), listItr);
+    if (filesItr->has_key_value("mtime"))
+      resume_load_file_mtime(download, listItr, filesItr->get_key_value("mtime"));
+    else
+      resume_load_file_mtime(download, listItr, std::nullopt);
+  }
 
-    utils::FileStat fs;
+  resume_load_uncertain_pieces(download, object);
+}
 
-    if (!filesItr->has_key_value("mtime")) {
-      LT_LOG_LOAD_FILE("no mtime found, file:create|resize range:clear|recheck", 0);
+// Returns the 'mtime' value to save for a file, see resume_load_file_mtime for the special
+// values.
+static int64_t
+resume_save_file_mtime(Download download, FileList::iterator listItr) {
+  FileList*    fileList   = download.file_list();
+  unsigned int file_index = std::distance(fileList->begin(), listItr);
 
-      // If 'mtime' is erased, it means we should start hashing and
-      // downloading the file as if it was a new torrent.
-      (*listItr)->set_flags(File::flag_create_queued | File::flag_resize_queued);
+  utils::FileStat fs;
 
-      download.update_range(Download::update_range_recheck | Download::update_range_clear,
-                            (*listItr)->range().first, (*listItr)->range().second);
-      continue;
-    }
+  bool fileExists = fs.update(fileList->root_dir() + (*listItr)->path()->as_string());
 
-    int64_t mtimeValue = filesItr->get_key_value("mtime");
-    bool    fileExists = fs.update(fileList->root_dir() + (*listItr)->path()->as_string());
-
-    // The default action when we have 'mtime' is not to create nor
-    // resize the file.
-    (*listItr)->unset_flags(File::flag_create_queued | File::flag_resize_queued);
-
-    if (mtimeValue == ~int64_t{0} || mtimeValue == ~int64_t{1}) {
-      // If 'mtime' is ~0 it means we haven't gotten around to
-      // creating the file.
-      //
-      // Else if it is ~1 it means the file doesn't exist nor do we
-      // want to create it.
-      //
-      // When 'mtime' is ~2 we need to recheck the hash without
-      // creating the file. It will just fail on the mtime check
-      // later, so we don't need to handle it explicitly.
-
-      if (mtimeValue == ~int64_t{0}) {
-        LT_LOG_LOAD_FILE("file not created by client, file:create|resize range:clear|(recheck)", 0);
-        (*listItr)->set_flags(File::flag_create_queued | File::flag_resize_queued);
-      } else {
-        LT_LOG_LOAD_FILE("do not create file, file:- range:clear|(recheck)", 0);
-      }
+  if (!fileExists) {
 
-      // Ensure the bitfield range is cleared so that stray resume
-      // data doesn't get counted.
-      download.update_range(Download::update_range_clear | (fileExists ? Download::update_range_recheck : 0),
-                            (*listItr)->range().first, (*listItr)->range().second);
-      continue;
+    if ((*listItr)->is_create_queued()) {
+      // ~0 means the file still needs to be created.
+      LT_LOG_SAVE_FILE("file not created, create queued", 0);
+      return ~int64_t{0};
     }
 
-    // If the file is the wrong size, queue resize and clear resume
-    // data for that file.
-    if (static_cast<uint64_t>(fs.size()) != (*listItr)->size_bytes()) {
-      if (fs.size() == 0) {
-        LT_LOG_LOAD_FILE("zero-length file found, file:resize range:clear|recheck", 0);
-      } else {
-        LT_LOG_LOAD_FILE("file has the wrong size, file:resize range:clear|recheck", 0);
-      }
+    // ~1 means the file shouldn't be created.
+    LT_LOG_SAVE_FILE("file not created, create not queued", 0);
+    return ~int64_t{1};
 
-      (*listItr)->set_flags(File::flag_resize_queued);
-      download.update_range(Download::update_range_clear | Download::update_range_recheck,
-                            (*listItr)->range().first, (*listItr)->range().second);
-      continue;
-    }
+    //    } else if ((*listItr)->completed_chunks() == (*listItr)->size_chunks()) {
 
-    // An 'mtime' of ~3 means the resume data was written while the
-    // torrent was actively downloading, and thus we need to recheck
-    // chunks that might not have been completely written to disk.
-    //
-    // This gets handled below, so just skip to the next file.
-    if (mtimeValue == ~int64_t{3}) {
-      LT_LOG_LOAD_FILE("file was downloading", 0);
-      continue;
-    }
+  } else if (fileList->bitfield()->is_all_set()) {
+    // Currently only checking if we're finished. This needs to be
+    // smarter when it comes to downloading partial torrents, etc.
 
-    // An 'mtime' of ~2 indicates that the resume data was made by an
-    // old rtorrent version which does not include 'uncertain_pieces'
-    // field, and thus can't be relied upon.
-    //
-    // If the 'mtime' is an actual mtime we check to see if it matches
-    // the file, else clear the range. This should be set only for
-    // files that have completed and got no indices in
-    // TransferList::completed_list().
-    if (mtimeValue == ~int64_t{2} || mtimeValue != fs.modified_time()) {
-      LT_LOG_LOAD_FILE("resume data doesn't include uncertain pieces, range:clear|recheck", 0);
-      download.update_range(Download::update_range_clear | Download::update_range_recheck,
-                            (*listItr)->range().first, (*listItr)->range().second);
-      continue;
-    }
+    // This assumes the syncs are properly called before
+    // resume_save_progress gets called after finishing a torrent.
+    LT_LOG_SAVE_FILE("file completed, mtime:%" PRIi64, (int64_t)fs.modified_time());
+    return fs.modified_time();
 
-    LT_LOG_LOAD_FILE("no recheck needed", 0);
+  } else if (!download.info()->is_active()) {
+    // When stopped, all chunks should have received sync, thus the
+    // file's mtime will be correct. (We hope)
+    LT_LOG_SAVE_FILE("file inactive and assumed sync'ed, mtime:%" PRIi64, (int64_t)fs.modified_time());
+    return fs.modified_time();
   }
 
-  resume_load_uncertain_pieces(download, object);
+  // If the torrent isn't done and we've not shut down, then set
+  // 'mtime' to ~3 so as to indicate that the 'mtime' is not to be
+  // trusted, yet we have a partial bitfield for the file.
+  LT_LOG_SAVE_FILE("file actively downloading", 0);
+  return ~int64_t{3};
+}
+
+// Sorted indices of the chunks completed in the last 15 minutes, which might not have been
+// written to disk.
+static std::vector<uint32_t>
+resume_uncertain_chunks(Download download) {
+  const TransferList::completed_list_type& completedList = download.transfer_list()->completed_list();
+
+  auto itr = std::find_if(completedList.begin(), completedList.end(), [](const auto& v) {
+      return this_thread::cached_time() - 15min <= std::chrono::microseconds(v.first);
+    });
+
+  std::vector<uint32_t> buffer;
+  buffer.reserve(std::distance(itr, completedList.end()));
+
+  while (itr != completedList.end())
+    buffer.push_back((itr++)->second);
+
+  std::sort(buffer.begin(), buffer.end());
+  return buffer;
 }
 
 void
@@ -187,55 +271,13 @@ resume_save_progress(Download download, Object& object) {
   FileList* fileList = download.file_list();
 
   for (auto listItr = fileList->begin(), listLast = fileList->end(); listItr != listLast; ++listItr, ++filesItr) {
-    unsigned int file_index = std::distance(fileList->begin(), listItr);
-
     if (filesItr == files.end())
       filesItr = files.insert(filesItr, Object::create_map());
     else if (!filesItr->is_map())
       *filesItr = Object::create_map();
 
     filesItr->insert_key("completed", static_cast<int64_t>((*listItr)->completed_chunks()));
-
-    utils::FileStat fs;
-
-    bool fileExists = fs.update(fileList->root_dir() + (*listItr)->path()->as_string());
-
-    if (!fileExists) {
-
-      if ((*listItr)->is_create_queued()) {
-        // ~0 means the file still needs to be created.
-        filesItr->insert_key("mtime", ~int64_t{0});
-        LT_LOG_SAVE_FILE("file not created, create queued", 0);
-      } else {
-        // ~1 means the file shouldn't be created.
-        filesItr->insert_key("mtime", ~int64_t{1});
-        LT_LOG_SAVE_FILE("file not created, create not queued", 0);
-      }
-
-      //    } else if ((*listItr)->completed_chunks() == (*listItr)->size_chunks()) {
-
-    } else if (fileList->bitfield()->is_all_set()) {
-      // Currently only checking if we're finished. This needs to be
-      // smarter when it comes to downloading partial torrents, etc.
-
-      // This assumes the syncs are properly called before
-      // resume_save_progress gets called after finishing a torrent.
-      filesItr->insert_key("mtime", static_cast<int64_t>(fs.modified_time()));
-      LT_LOG_SAVE_FILE("file completed, mtime:%" PRIi64, (int64_t)fs.modified_time());
-
-    } else if (!download.info()->is_active()) {
-      // When stopped, all chunks should have received sync, thus the
-      // file's mtime will be correct. (We hope)
-      filesItr->insert_key("mtime", static_cast<int64_t>(fs.modified_time()));
-      LT_LOG_SAVE_FILE("file inactive and assumed sync'ed, mtime:%" PRIi64, (int64_t)fs.modified_time());
-
-    } else {
-      // If the torrent isn't done and we've not shut down, then set
-      // 'mtime' to ~3 so as to indicate that the 'mtime' is not to be
-      // trusted, yet we have a partial bitfield for the file.
-      filesItr->insert_key("mtime", ~int64_t{3});
-      LT_LOG_SAVE_FILE("file actively downloading", 0);
-    }
+    filesItr->insert_key("mtime", resume_save_file_mtime(download, listItr));
   }
 }
 
@@ -331,23 +373,11 @@ resume_save_uncertain_pieces(Download download, Object& object) {
   object.erase_key("uncertain_pieces");
   object.erase_key("uncertain_pieces.timestamp");
 
-  const TransferList::completed_list_type& completedList = download.transfer_list()->completed_list();
-
-  auto itr = std::find_if(completedList.begin(), completedList.end(), [](const auto& v) {
-      return this_thread::cached_time() - 15min <= std::chrono::microseconds(v.first);
-    });
+  std::vector<uint32_t> buffer = resume_uncertain_chunks(download);
 
-  if (itr == completedList.end())
+  if (buffer.empty())
     return;
 
-  std::vector<uint32_t> buffer;
-  buffer.reserve(std::distance(itr, completedList.end()));
-
-  while (itr != completedList.end())
-    buffer.push_back((itr++)->second);
-
-  std::sort(buffer.begin(), buffer.end());
-
   for (unsigned int& itr2 : buffer)
     itr2 = htonl(itr2);
 
@@ -559,4 +589,169 @@ resume_save_tracker_settings(Download download, Object& object) {
   }
 }
 
+//
+// ResumeStore:
+//
+
+static bool
+resume_store_is_valid_record(Download download, const utils::ResumeStore::record& record) {
+  FileList* fileList = download.file_list();
+
+  if (record.size_files() != fileList->size_files() || record.size_chunks() != fileList->size_chunks()) {
+    LT_LOG_LOAD_INVALID("resume store record does not match the torrent geometry", 0);
+    return false;
+  }
+
+  return true;
+}
+
+void
+resume_load_progress(Download download, utils::ResumeStore& store) {
+  auto record = store.find(download.info()->hash());
+
+  if (!record.is_valid() || !(record.flags() & utils::ResumeStore::flag_progress)) {
+    LT_LOG_LOAD("could not find progress in resume store", 0);
+    return;
+  }
+
+  if (!resume_store_is_valid_record(download, record))
+    return;
+
+  LT_LOG_LOAD("restoring bitfield from resume store", 0);
+  download.set_bitfield(record.bitfield(), record.bitfield() + record.size_bitfield());
+
+  FileList* fileList = download.file_list();
+
+  for (auto listItr = fileList->begin(), listLast = fileList->end(); listItr != listLast; ++listItr) {
+    if ((*listItr)->is_padding())
+      continue;
+
+    resume_load_file_mtime(download, listItr, record.file(std::distance(fileList->begin(), listItr)).mtime);
+  }
+
+  // Same-session loads are skipped as with the bencode 'uncertain_pieces'.
+  if (!(record.flags() & utils::ResumeStore::flag_uncertain)) {
+    LT_LOG_LOAD("no uncertain pieces marked", 0);
+    return;
+  }
+
+  if (record.uncertain_timestamp() >= static_cast<int64_t>(download.info()->load_date())) {
+    LT_LOG_LOAD_INVALID("invalid information on uncertain pieces", 0);
+    return;
+  }
+
+  const uint8_t* uncertain = record.uncertain();
+
+  for (uint32_t index = 0; index != record.size_chunks(); index++)
+    if (uncertain[index / 8] & (0x80 >> (index % 8)))
+      download.update_range(Download::update_range_recheck | Download::update_range_clear, index, index + 1);
+}
+
+void
+resume_save_progress(Download download, utils::ResumeStore& store) {
+  if (!download.is_hash_checked()) {
+    LT_LOG_SAVE("hash not checked, no progress saved", 0);
+    return;
+  }
+
+  download.sync_chunks();
+
+  // Dropping the progress flag makes the next load hash the whole torrent, as with the ~2
+  // 'mtime' of the bencode resume data.
+  if (!download.is_hash_checked()) {
+    LT_LOG_SAVE("sync failed, invalidating resume data", 0);
+
+    auto record = store.find(download.info()->hash());
+
+    if (record.is_valid())
+      record.unset_flags(utils::ResumeStore::flag_progress);
+
+    return;
+  }
+
+  FileList*       fileList = download.file_list();
+  const Bitfield* bitfield = fileList->bitfield();
+
+  auto record = store.insert(download.info()->hash(), fileList->size_chunks(), fileList->size_files());
+
+  if (bitfield->is_all_set() || bitfield->is_all_unset()) {
+    LT_LOG_SAVE("uniform bitfield, saving size only", 0);
+    record.set_uniform_bitfield(bitfield->is_all_set());
+  } else {
+    LT_LOG_SAVE("saving bitfield", 0);
+    record.set_bitfield(bitfield->begin());
+  }
+
+  for (auto listItr = fileList->begin(), listLast = fileList->end(); listItr != listLast; ++listItr) {
+    uint32_t index = std::distance(fileList->begin(), listItr);
+    auto     entry = record.file(index);
+
+    entry.completed = (*listItr)->completed_chunks();
+    entry.mtime     = resume_save_file_mtime(download, listItr);
+
+    record.set_file(index, entry);
+  }
+
+  std::vector<uint32_t> chunks = resume_uncertain_chunks(download);
+
+  if (chunks.empty()) {
+    record.set_flags(utils::ResumeStore::flag_progress);
+    record.unset_flags(utils::ResumeStore::flag_uncertain);
+    return;
+  }
+
+  std::vector<uint8_t> uncertain(record.size_bitfield());
+
+  for (auto index : chunks)
+    uncertain[index / 8] |= 0x80 >> (index % 8);
+
+  record.set_uncertain(this_thread::cached_seconds().count(), uncertain.data());
+  record.set_flags(utils::ResumeStore::flag_progress | utils::ResumeStore::flag_uncertain);
+}
+
+void
+resume_load_file_priorities(Download download, utils::ResumeStore& store) {
+  auto record = store.find(download.info()->hash());
+
+  if (!record.is_valid() || !(record.flags() & utils::ResumeStore::flag_priorities))
+    return;
+
+  if (!resume_store_is_valid_record(download, record))
+    return;
+
+  FileList* fileList = download.file_list();
+
+  for (auto listItr = fileList->begin(), listLast = fileList->end(); listItr != listLast; ++listItr) {
+    const auto& entry = record.file(std::distance(fileList->begin(), listItr));
+
+    if (entry.priority >= 0 && entry.priority <= PRIORITY_HIGH)
+      (*listItr)->set_priority(static_cast<priority_enum>(entry.priority));
+
+    if (entry.completed > (*listItr)->size_chunks()) {
+      LT_LOG_LOAD_INVALID("invalid completed chunks value: %" PRIu32 ", resetting to 0", entry.completed);
+      (*listItr)->set_completed_chunks(0);
+      continue;
+    }
+
+    (*listItr)->set_completed_chunks(entry.completed);
+  }
+}
+
+void
+resume_save_file_priorities(Download download, utils::ResumeStore& store) {
+  FileList* fileList = download.file_list();
+
+  auto record = store.insert(download.info()->hash(), fileList->size_chunks(), fileList->size_files());
+
+  for (auto listItr = fileList->begin(), listLast = fileList->end(); listItr != listLast; ++listItr) {
+    uint32_t index = std::distance(fileList->begin(), listItr);
+    auto     entry = record.file(index);
+
+    entry.priority = (*listItr)->priority();
+    record.set_file(index, entry);
+  }
+
+  record.set_flags(utils::ResumeStore::flag_priorities);
+}
+
 } // namespace torrent
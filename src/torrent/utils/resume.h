@@ -49,6 +49,10 @@
 
 namespace torrent {
 
+namespace utils {
+class ResumeStore;
+}
+
 // When saving resume data for a torrent that is currently active, set
 // 'onlyCompleted' to ensure that a crash, etc, will cause incomplete
 // files to be hashed.
@@ -75,6 +79,14 @@ void resume_save_addresses(Download download, Object& object) LIBTORRENT_EXPORT;
 void resume_load_tracker_settings(Download download, const Object& object) LIBTORRENT_EXPORT;
 void resume_save_tracker_settings(Download download, Object& object) LIBTORRENT_EXPORT;
 
+// Progress and file priorities can be kept in a ResumeStore instead of the bencode resume
+// data, the remaining state is still saved to an Object.
+void resume_load_progress(Download download, utils::ResumeStore& store) LIBTORRENT_EXPORT;
+void resume_save_progress(Download download, utils::ResumeStore& store) LIBTORRENT_EXPORT;
+
+void resume_load_file_priorities(Download download, utils::ResumeStore& store) LIBTORRENT_EXPORT;
+void resume_save_file_priorities(Download download, utils::ResumeStore& store) LIBTORRENT_EXPORT;
+
 } // namespace torrent
 
 #endif
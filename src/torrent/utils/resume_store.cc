@@ -0,0 +1,372 @@
+#include "config.h"
+
+#include "torrent/utils/resume_store.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "torrent/exceptions.h"
+
+namespace torrent::utils {
+
+ResumeStore::~ResumeStore() {
+  close();
+}
+
+uint64_t
+ResumeStore::size_used() const {
+  if (!is_open())
+    return 0;
+
+  return reinterpret_cast<const file_header*>(m_data)->size_used;
+}
+
+size_t
+ResumeStore::size_dirty() const {
+  size_t result = 0;
+
+  for (const auto& range : m_dirty)
+    result += range.second - range.first;
+
+  return result;
+}
+
+// Records after the first invalid header are dropped, as there is no way to tell where the next
+// valid one starts.
+
+void
+ResumeStore::open(const std::string& path) {
+  if (is_open())
+    throw internal_error("ResumeStore::open() called on an open store.");
+
+  m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+
+  if (m_fd == -1)
+    throw storage_error("could not open resume store '" + path + "': " + std::strerror(errno));
+
+  try {
+    struct stat st;
+
+    if (::fstat(m_fd, &st) == -1)
+      throw storage_error("could not stat resume store '" + path + "': " + std::strerror(errno));
+
+    auto file_size = static_cast<uint64_t>(st.st_size);
+
+    map(std::max<uint64_t>(file_size, min_file_size));
+
+    if (file_size < sizeof(file_header)) {
+      std::memset(m_data, 0, sizeof(file_header));
+
+      header()->magic     = magic;
+      header()->version   = version;
+      header()->size_used = sizeof(file_header);
+
+      mark_dirty(0, sizeof(file_header));
+      return;
+    }
+
+    if (header()->magic != magic || header()->version != version)
+      throw storage_error("invalid resume store header in '" + path + "'");
+
+    uint64_t offset = sizeof(file_header);
+    uint64_t last   = std::min(header()->size_used, file_size);
+
+    while (offset + sizeof(record_header) <= last) {
+      auto record = header_at(offset);
+
+      if (record->size < sizeof(record_header) || record->size % 8 != 0 || record->size > last - offset)
+        break;
+
+      if (!(record->flags & flag_used))
+        m_free.emplace(record->size, offset);
+      else if (record_size(record->size_chunks, record->size_files) > record->size)
+        break;
+      else
+        insert_scanned(std::string(record->hash, HashString::size_data), offset);
+
+      offset += record->size;
+    }
+
+    if (offset != header()->size_used) {
+      header()->size_used = offset;
+      mark_dirty(0, sizeof(file_header));
+    }
+
+  } catch (...) {
+    close();
+    throw;
+  }
+}
+
+void
+ResumeStore::close() {
+  if (!is_open())
+    return;
+
+  if (m_data != nullptr)
+    ::munmap(m_data, m_size_mapped);
+
+  ::close(m_fd);
+
+  m_fd          = -1;
+  m_data        = nullptr;
+  m_size_mapped = 0;
+
+  m_records.clear();
+  m_free.clear();
+  m_dirty.clear();
+}
+
+bool
+ResumeStore::sync(bool wait) {
+  static const auto page_size = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+
+  while (!m_dirty.empty()) {
+    auto first = m_dirty.front().first & ~(page_size - 1);
+    auto last  = m_dirty.front().second;
+
+    if (::msync(m_data + first, last - first, wait ? MS_SYNC : MS_ASYNC) == -1)
+      return false;
+
+    m_dirty.erase(m_dirty.front());
+  }
+
+  return true;
+}
+
+ResumeStore::record
+ResumeStore::find(const HashString& hash) {
+  auto itr = m_records.find(hash.str());
+
+  if (itr == m_records.end())
+    return record();
+
+  return record(this, itr->second);
+}
+
+ResumeStore::record
+ResumeStore::insert(const HashString& hash, uint32_t size_chunks, uint32_t size_files) {
+  if (!is_open())
+    throw internal_error("ResumeStore::insert() called on a closed store.");
+
+  auto itr = m_records.find(hash.str());
+
+  if (itr != m_records.end()) {
+    auto current = header_at(itr->second);
+
+    if (current->size_chunks == size_chunks && current->size_files == size_files)
+      return record(this, itr->second);
+
+    erase(hash);
+  }
+
+  uint64_t size = record_size(size_chunks, size_files);
+  uint64_t offset;
+  auto     free_itr = m_free.lower_bound(size);
+
+  if (free_itr != m_free.end()) {
+    offset = free_itr->second;
+    size   = free_itr->first;
+    m_free.erase(free_itr);
+
+  } else {
+    offset = header()->size_used;
+    reserve(offset + size);
+
+    header()->size_used = offset + size;
+    mark_dirty(0, sizeof(file_header));
+  }
+
+  std::memset(data(offset), 0, size);
+
+  auto current = header_at(offset);
+  current->flags       = flag_used;
+  current->size        = size;
+  current->size_chunks = size_chunks;
+  current->size_files  = size_files;
+  std::memcpy(current->hash, hash.data(), HashString::size_data);
+
+  mark_dirty(offset, size);
+
+  m_records[hash.str()] = offset;
+  return record(this, offset);
+}
+
+void
+ResumeStore::erase(const HashString& hash) {
+  auto itr = m_records.find(hash.str());
+
+  if (itr == m_records.end())
+    return;
+
+  auto current = header_at(itr->second);
+  current->flags = 0;
+
+  mark_dirty(itr->second, sizeof(record_header));
+  m_free.emplace(current->size, itr->second);
+  m_records.erase(itr);
+}
+
+// Keeps the last record if a hash is stored more than once.
+
+void
+ResumeStore::insert_scanned(std::string key, uint64_t offset) {
+  auto [itr, inserted] = m_records.try_emplace(std::move(key), offset);
+
+  if (inserted)
+    return;
+
+  auto previous = header_at(itr->second);
+  previous->flags = 0;
+
+  mark_dirty(itr->second, sizeof(record_header));
+  m_free.emplace(previous->size, itr->second);
+
+  itr->second = offset;
+}
+
+uint64_t
+ResumeStore::record_size(uint32_t size_chunks, uint32_t size_files) {
+  uint64_t size = sizeof(record_header) + uint64_t{size_files} * sizeof(file_entry) + 2 * ((uint64_t{size_chunks} + 7) / 8);
+
+  return (size + 7) & ~uint64_t{7};
+}
+
+// Pages written through the old mapping are already in the page cache, so the dirty ranges
+// remain valid for the new mapping.
+
+void
+ResumeStore::map(uint64_t size) {
+  struct stat st;
+
+  if (::fstat(m_fd, &st) == -1)
+    throw storage_error(std::string("could not stat resume store: ") + std::strerror(errno));
+
+  if (static_cast<uint64_t>(st.st_size) < size && ::ftruncate(m_fd, size) == -1)
+    throw storage_error(std::string("could not resize resume store: ") + std::strerror(errno));
+
+  auto ptr = static_cast<char*>(::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0));
+
+  if (ptr == MAP_FAILED)
+    throw storage_error(std::string("could not map resume store: ") + std::strerror(errno));
+
+  if (m_data != nullptr)
+    ::munmap(m_data, m_size_mapped);
+
+  m_data        = ptr;
+  m_size_mapped = size;
+}
+
+void
+ResumeStore::reserve(uint64_t size) {
+  if (size <= m_size_mapped)
+    return;
+
+  map(std::max(size, m_size_mapped * 2));
+}
+
+void
+ResumeStore::update(uint64_t offset, const void* src, size_t length) {
+  constexpr size_t block_size = 64;
+
+  auto dest   = data(offset);
+  auto source = static_cast<const char*>(src);
+
+  for (size_t pos = 0; pos < length; pos += block_size) {
+    size_t len = std::min(block_size, length - pos);
+
+    if (std::memcmp(dest + pos, source + pos, len) == 0)
+      continue;
+
+    std::memcpy(dest + pos, source + pos, len);
+    mark_dirty(offset + pos, len);
+  }
+}
+
+//
+// Record accessors:
+//
+
+ResumeStore::record_header*
+ResumeStore::record::header() const {
+  if (m_store == nullptr)
+    throw internal_error("ResumeStore::record used without a store.");
+
+  return m_store->header_at(m_offset);
+}
+
+uint32_t ResumeStore::record::flags() const       { return header()->flags; }
+uint32_t ResumeStore::record::size_chunks() const { return header()->size_chunks; }
+uint32_t ResumeStore::record::size_files() const  { return header()->size_files; }
+
+int64_t
+ResumeStore::record::uncertain_timestamp() const {
+  return header()->uncertain_timestamp;
+}
+
+const ResumeStore::file_entry&
+ResumeStore::record::file(uint32_t index) const {
+  if (index >= size_files())
+    throw internal_error("ResumeStore::record::file() index out of range.");
+
+  return *reinterpret_cast<const file_entry*>(m_store->data(files_offset() + uint64_t{index} * sizeof(file_entry)));
+}
+
+const uint8_t*
+ResumeStore::record::bitfield() const {
+  return reinterpret_cast<const uint8_t*>(m_store->data(bitfield_offset()));
+}
+
+const uint8_t*
+ResumeStore::record::uncertain() const {
+  return reinterpret_cast<const uint8_t*>(m_store->data(uncertain_offset()));
+}
+
+void
+ResumeStore::record::set_flags(uint32_t flags) {
+  uint32_t value = header()->flags | flags;
+  m_store->update(m_offset, &value, sizeof(value));
+}
+
+void
+ResumeStore::record::unset_flags(uint32_t flags) {
+  uint32_t value = header()->flags & ~(flags & ~flag_used);
+  m_store->update(m_offset, &value, sizeof(value));
+}
+
+void
+ResumeStore::record::set_file(uint32_t index, const file_entry& entry) {
+  if (index >= size_files())
+    throw internal_error("ResumeStore::record::set_file() index out of range.");
+
+  m_store->update(files_offset() + uint64_t{index} * sizeof(file_entry), &entry, sizeof(file_entry));
+}
+
+void
+ResumeStore::record::set_bitfield(const uint8_t* data) {
+  m_store->update(bitfield_offset(), data, size_bitfield());
+}
+
+void
+ResumeStore::record::set_uniform_bitfield(bool value) {
+  std::string data(size_bitfield(), value ? '\xff' : '\0');
+
+  if (value && size_chunks() % 8 != 0)
+    data.back() = static_cast<char>(0xff << (8 - size_chunks() % 8));
+
+  m_store->update(bitfield_offset(), data.data(), data.size());
+}
+
+void
+ResumeStore::record::set_uncertain(int64_t timestamp, const uint8_t* data) {
+  m_store->update(m_offset + offsetof(record_header, uncertain_timestamp), &timestamp, sizeof(timestamp));
+  m_store->update(uncertain_offset(), data, size_bitfield());
+}
+
+} // namespace torrent::utils
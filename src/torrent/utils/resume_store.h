@@ -0,0 +1,159 @@
+#ifndef LIBTORRENT_TORRENT_UTILS_RESUME_STORE_H
+#define LIBTORRENT_TORRENT_UTILS_RESUME_STORE_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <torrent/common.h>
+#include <torrent/hash_string.h>
+#include <torrent/utils/ranges.h>
+
+// Binary resume store holding the progress of all downloads in one memory-mapped file.
+//
+// Each download has a record with a fixed layout given its number of chunks and files:
+//
+//   record_header
+//   file_entry[size_files]
+//   bitfield[size_bitfield]
+//   uncertain[size_bitfield]      chunks that might not have been written to disk
+//
+// Records are updated in place and only the bytes that changed are marked dirty, so saving the
+// progress of a download touches the pages of the modified bitfield ranges. Opening the store is
+// a single mmap and a scan of the record headers.
+//
+// Values are stored in host byte order, the store is not meant to be shared between hosts.
+
+namespace torrent::utils {
+
+class LIBTORRENT_EXPORT ResumeStore {
+public:
+  static constexpr uint32_t magic           = 0x5352544c;  // "LTRS"
+  static constexpr uint32_t version         = 1;
+  static constexpr size_t   min_file_size   = 64 << 10;
+
+  static constexpr uint32_t flag_used       = 0x1;
+  static constexpr uint32_t flag_progress   = 0x2;
+  static constexpr uint32_t flag_uncertain  = 0x4;
+  static constexpr uint32_t flag_priorities = 0x8;
+
+  struct file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size_used;
+  };
+
+  struct record_header {
+    uint32_t flags;
+    uint32_t size;
+    char     hash[HashString::size_data];
+    uint32_t size_chunks;
+    uint32_t size_files;
+    uint32_t reserved;
+    int64_t  uncertain_timestamp;
+  };
+
+  // 'mtime' uses the same special values as the bencode resume data.
+  struct file_entry {
+    int64_t  mtime;
+    uint32_t completed;
+    int32_t  priority;
+  };
+
+  static_assert(sizeof(file_header) == 16);
+  static_assert(sizeof(record_header) == 48);
+  static_assert(sizeof(file_entry) == 16);
+
+  // Handle to a record, stays valid when the store is remapped but not after the record is
+  // erased.
+  class LIBTORRENT_EXPORT record {
+  public:
+    record() = default;
+    record(ResumeStore* store, uint64_t offset) : m_store(store), m_offset(offset) {}
+
+    bool                is_valid() const { return m_store != nullptr; }
+
+    uint32_t            flags() const;
+    uint32_t            size_chunks() const;
+    uint32_t            size_files() const;
+    uint32_t            size_bitfield() const { return (size_chunks() + 7) / 8; }
+
+    int64_t             uncertain_timestamp() const;
+
+    const file_entry&   file(uint32_t index) const;
+    const uint8_t*      bitfield() const;
+    const uint8_t*      uncertain() const;
+
+    void                set_flags(uint32_t flags);
+    void                unset_flags(uint32_t flags);
+
+    void                set_file(uint32_t index, const file_entry& entry);
+    void                set_bitfield(const uint8_t* data);
+    void                set_uniform_bitfield(bool value);
+    void                set_uncertain(int64_t timestamp, const uint8_t* data);
+
+  private:
+    record_header*      header() const;
+    uint64_t            files_offset() const     { return m_offset + sizeof(record_header); }
+    uint64_t            bitfield_offset() const  { return files_offset() + uint64_t{size_files()} * sizeof(file_entry); }
+    uint64_t            uncertain_offset() const { return bitfield_offset() + size_bitfield(); }
+
+    ResumeStore*        m_store{};
+    uint64_t            m_offset{};
+  };
+
+  ResumeStore() = default;
+  ~ResumeStore();
+
+  bool                is_open() const     { return m_fd != -1; }
+
+  size_t              size() const        { return m_records.size(); }
+  uint64_t            size_used() const;
+  uint64_t            size_mapped() const { return m_size_mapped; }
+  size_t              size_dirty() const;
+
+  // Invalid records at the end of the store, e.g. after a crash while growing, are discarded.
+  // Throws storage_error on failure.
+  void                open(const std::string& path);
+  void                close();
+
+  // Writes the dirty ranges back to disk.
+  bool                sync(bool wait = false);
+
+  record              find(const HashString& hash);
+
+  // Returns the existing record if it has the same geometry, else a new zeroed record.
+  record              insert(const HashString& hash, uint32_t size_chunks, uint32_t size_files);
+  void                erase(const HashString& hash);
+
+  static uint64_t     record_size(uint32_t size_chunks, uint32_t size_files);
+
+private:
+  ResumeStore(const ResumeStore&) = delete;
+  ResumeStore& operator=(const ResumeStore&) = delete;
+
+  char*               data(uint64_t offset)      { return m_data + offset; }
+  file_header*        header()                   { return reinterpret_cast<file_header*>(m_data); }
+  record_header*      header_at(uint64_t offset) { return reinterpret_cast<record_header*>(m_data + offset); }
+
+  void                map(uint64_t size);
+  void                reserve(uint64_t size);
+
+  void                insert_scanned(std::string key, uint64_t offset);
+
+  // Copies only the blocks that differ and marks them dirty.
+  void                update(uint64_t offset, const void* src, size_t length);
+  void                mark_dirty(uint64_t offset, size_t length) { m_dirty.insert(offset, offset + length); }
+
+  int                 m_fd{-1};
+  char*               m_data{};
+  uint64_t            m_size_mapped{};
+
+  std::unordered_map<std::string, uint64_t> m_records;
+  std::multimap<uint64_t, uint64_t>         m_free;
+  ranges<uint64_t>    m_dirty;
+};
+
+} // namespace torrent::utils
+
+#endif
@@ -2,11 +2,13 @@
 #define LIBTORRENT_TORRENT_UTILS_STRING_MANIP_H
 
 #include <exception>
+#include <iterator>
 #include <optional>
 #include <string>
 #include <string_view>
 #include <torrent/common.h>
 #include <torrent/exceptions.h>
+#include <torrent/utils/codec.h>
 
 namespace torrent::utils {
 
@@ -270,6 +272,12 @@ transform_to_hex(SrcItr src_first, SrcItr src_last, DestItr dst_first, DestItr d
   if (std::distance(src_first, src_last) * 2 != std::distance(dst_first, dst_last))
     throw internal_error("transform_to_hex() incorrect destination size");
 
+  if constexpr (std::contiguous_iterator<SrcItr> && std::contiguous_iterator<DestItr> &&
+                sizeof(std::iter_value_t<SrcItr>) == 1 && sizeof(std::iter_value_t<DestItr>) == 1) {
+    codec_encode_hex(std::to_address(src_first), std::distance(src_first, src_last), reinterpret_cast<char*>(std::to_address(dst_first)));
+    return dst_last;
+  }
+
   while (src_first != src_last) {
     if (dst_first == dst_last)
       break;
@@ -315,6 +323,13 @@ template <typename SrcItr>
 std::string
 transform_to_hex_str(SrcItr src_first, SrcItr src_last) {
   std::string dest;
+
+  if constexpr (std::contiguous_iterator<SrcItr> && sizeof(std::iter_value_t<SrcItr>) == 1) {
+    dest.resize(codec_hex_size(std::distance(src_first, src_last)));
+    codec_encode_hex(std::to_address(src_first), std::distance(src_first, src_last), dest.data());
+    return dest;
+  }
+
   dest.reserve(std::distance(src_first, src_last) * 2);
 
   while (src_first != src_last) {
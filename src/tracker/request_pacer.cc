@@ -0,0 +1,66 @@
+#include "config.h"
+
+#include "tracker/request_pacer.h"
+
+#include "torrent/exceptions.h"
+#include "torrent/utils/random.h"
+
+namespace torrent::tracker {
+
+bool
+RequestPacer::insert(const void* owner, const std::string& host, time_type now, slot_type&& slot) {
+  if (owner == nullptr)
+    throw internal_error("RequestPacer::insert() called with null owner.");
+
+  erase(owner);
+
+  if (m_interval == time_type{} || host.empty())
+    return false;
+
+  auto& next = m_host_next[host];
+
+  if (next <= now) {
+    next = now + m_interval;
+    return false;
+  }
+
+  auto jitter = time_type{};
+
+  if (m_jitter > time_type{})
+    jitter = time_type(random_uniform_uint32(0, m_jitter.count()));
+
+  m_owners[owner] = m_queue.emplace(next + jitter, request{owner, std::move(slot)});
+
+  next += m_interval;
+  return true;
+}
+
+bool
+RequestPacer::erase(const void* owner) {
+  auto itr = m_owners.find(owner);
+
+  if (itr == m_owners.end())
+    return false;
+
+  m_queue.erase(itr->second);
+  m_owners.erase(itr);
+  return true;
+}
+
+std::vector<RequestPacer::slot_type>
+RequestPacer::pop_due(time_type now) {
+  std::vector<slot_type> result;
+
+  while (!m_queue.empty() && m_queue.begin()->first <= now) {
+    m_owners.erase(m_queue.begin()->second.owner);
+
+    result.push_back(std::move(m_queue.begin()->second.slot));
+    m_queue.erase(m_queue.begin());
+  }
+
+  std::erase_if(m_host_next, [now](auto& host) { return host.second <= now; });
+
+  return result;
+}
+
+} // namespace torrent::tracker
@@ -0,0 +1,75 @@
+#ifndef LIBTORRENT_TRACKER_REQUEST_PACER_H
+#define LIBTORRENT_TRACKER_REQUEST_PACER_H
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "torrent/system/common.h"
+
+// Paces requests to the same tracker host. The first request to an idle host may be sent
+// immediately, following ones are queued 'interval' apart with up to 'jitter' added to each.
+//
+// Requests are identified by their owner, and a newer request replaces any queued request of the
+// same owner. An interval of zero disables pacing.
+
+namespace torrent::tracker {
+
+class RequestPacer {
+public:
+  using time_type = std::chrono::microseconds;
+  using slot_type = std::function<void ()>;
+
+  static constexpr time_type default_interval = 50ms;
+  static constexpr time_type default_jitter   = 500ms;
+
+  RequestPacer() = default;
+
+  time_type           interval() const                 { return m_interval; }
+  time_type           jitter() const                   { return m_jitter; }
+
+  // Changes only apply to requests inserted afterwards.
+  void                set_interval(time_type interval) { m_interval = interval; }
+  void                set_jitter(time_type jitter)     { m_jitter = jitter; }
+
+  // Returns false if the request may be sent now, in which case 'slot' is left untouched and the
+  // caller sends it.
+  bool                insert(const void* owner, const std::string& host, time_type now, slot_type&& slot);
+
+  // Returns true if a queued request was removed.
+  bool                erase(const void* owner);
+
+  // Removes the queued requests that are due, in order.
+  std::vector<slot_type> pop_due(time_type now);
+
+  bool                empty() const     { return m_queue.empty(); }
+  size_t              size() const      { return m_queue.size(); }
+  size_t              size_hosts() const { return m_host_next.size(); }
+
+  // Time of the earliest queued request, only valid if not empty.
+  time_type           next_time() const { return m_queue.begin()->first; }
+
+private:
+  RequestPacer(const RequestPacer&) = delete;
+  RequestPacer& operator=(const RequestPacer&) = delete;
+
+  struct request {
+    const void* owner;
+    slot_type   slot;
+  };
+
+  using queue_type = std::multimap<time_type, request>;
+
+  time_type           m_interval{default_interval};
+  time_type           m_jitter{default_jitter};
+
+  std::map<std::string, time_type>           m_host_next;
+  queue_type                                 m_queue;
+  std::map<const void*, queue_type::iterator> m_owners;
+};
+
+} // namespace torrent::tracker
+
+#endif // LIBTORRENT_TRACKER_REQUEST_PACER_H
@@ -5,6 +5,7 @@
 #include <cassert>
 
 #include "tracker/udp_router.h"
+#include "tracker/udp_scraper.h"
 #include "torrent/exceptions.h"
 #include "torrent/net/resolver.h"
 #include "torrent/runtime/network_config.h"
@@ -44,6 +45,8 @@ ThreadTracker::create_thread() {
   m_thread_tracker->m_tracker_manager    = std::make_unique<tracker::Manager>();
   m_thread_tracker->m_udp_inet_router    = std::make_unique<tracker::UdpRouter>();
   m_thread_tracker->m_udp_inet6_router   = std::make_unique<tracker::UdpRouter>();
+  m_thread_tracker->m_udp_scraper        = std::make_unique<tracker::UdpScraper>(m_thread_tracker->m_udp_inet_router.get(),
+                                                                                 m_thread_tracker->m_udp_inet6_router.get());
 }
 
 void
@@ -87,6 +90,7 @@ ThreadTracker::cleanup_thread() {
   cancel_callback(m_events_callback_id);
 
   m_tracker_manager.reset();
+  m_udp_scraper.reset();
 
   m_udp_inet_router->close();
   m_udp_inet6_router->close();
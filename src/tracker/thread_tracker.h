@@ -10,6 +10,7 @@ namespace tracker {
 
 class Manager;
 class UdpRouter;
+class UdpScraper;
 
 } // namespace tracker
 
@@ -34,6 +35,7 @@ public:
 
   auto                  udp_inet_router()         { return m_udp_inet_router.get(); }
   auto                  udp_inet6_router()        { return m_udp_inet6_router.get(); }
+  auto                  udp_scraper()             { return m_udp_scraper.get(); }
 
 protected:
   friend class Manager;
@@ -51,6 +53,7 @@ private:
   std::unique_ptr<tracker::Manager>   m_tracker_manager;
   std::unique_ptr<tracker::UdpRouter> m_udp_inet_router;
   std::unique_ptr<tracker::UdpRouter> m_udp_inet6_router;
+  std::unique_ptr<tracker::UdpScraper> m_udp_scraper;
 };
 
 } // namespace torrent
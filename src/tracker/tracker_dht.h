@@ -10,6 +10,8 @@
 
 namespace torrent {
 
+class DhtAnnounceScheduler;
+
 namespace dht {
 class DhtAnnounce;
 }
@@ -54,6 +56,7 @@ public:
   void                receive_progress(int replied, int contacted);
 
 protected:
+  friend class torrent::DhtAnnounceScheduler;
   friend class torrent::dht::DhtAnnounce;
 
   static void         add_event(std::weak_ptr<TrackerDht> weak_tracker, std::function<void (TrackerDht*)>&& event);
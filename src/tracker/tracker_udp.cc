@@ -11,6 +11,7 @@
 #include "torrent/utils/option_strings.h"
 #include "tracker/thread_tracker.h"
 #include "tracker/udp_router.h"
+#include "tracker/udp_scraper.h"
 
 #define LT_LOG(log_fmt, ...)                                            \
   lt_log_print_hash(LOG_TRACKER_REQUESTS, info().info_hash, "tracker_udp", "%p : " log_fmt, static_cast<TrackerWorker*>(this), __VA_ARGS__);
@@ -22,7 +23,7 @@
 namespace torrent::tracker {
 
 TrackerUdp::TrackerUdp(const TrackerInfo& raw_info, int flags) :
-  TrackerWorker(raw_info, flags) {
+  TrackerWorker(raw_info, flags | tracker::TrackerState::flag_scrapable) {
 
   if (info().key == 0)
     throw internal_error("TrackerUdp cannot be created with key 0.");
@@ -55,22 +56,60 @@ TrackerUdp::send_event(tracker::TrackerParams params, tracker::TrackerState::eve
   m_params     = params;
   m_send_state = new_state;
 
+  // The routers may fail a connection before returning, those errors are held back so that only
+  // one failure is reported once both families have been tried.
+  m_connecting = true;
+  m_connect_error.clear();
+
   connect_family(AF_INET);
   connect_family(AF_INET6);
 
+  m_connecting = false;
+
   LT_LOG("started announce : state:%s url:%s inet_tx:%u inet6_tx:%u",
          option_to_c_str_or_throw(OPTION_TRACKER_EVENT, new_state), info().url.c_str(),
          m_inet_state.transaction_id, m_inet6_state.transaction_id);
 
-  if (m_inet_state.transaction_id == 0 && m_inet6_state.transaction_id == 0)
+  if (m_inet_state.transaction_id == 0 && m_inet6_state.transaction_id == 0) {
+    if (!m_connect_error.empty())
+      return handle_setup_error(m_connect_error);
+
     return handle_setup_error("cannot send tracker event, no available network protocol(s)");
+  }
 
   update_requesting_state();
 }
 
+// Scrapes are handed to the shared UdpScraper, which batches them with other torrents using the
+// same tracker endpoint.
+
 void
 TrackerUdp::send_scrape([[maybe_unused]] tracker::TrackerParams params) {
-  throw internal_error("Tracker type UDP does not support scrape.");
+  if (m_requested_scrape || runtime::is_shutting_down())
+    return;
+
+  if (m_inet_state.transaction_id != 0 || m_inet6_state.transaction_id != 0)
+    return handle_scrape_setup_error("cannot send scrape, tracker is busy");
+
+  if (m_hostname.empty())
+    return handle_scrape_setup_error("cannot send scrape, hostname is empty");
+
+  if (m_port == 0)
+    return handle_scrape_setup_error("cannot send scrape, port is 0");
+
+  LT_LOG("scrape requested : url:%s", info().url.c_str());
+
+  lock_and_set_latest_event(tracker::TrackerState::EVENT_SCRAPE);
+
+  m_requested_scrape = true;
+
+  ThreadTracker::thread_tracker()->udp_scraper()->add(this, m_hostname, m_port, info().info_hash,
+                                                      [this](uint32_t seeders, uint32_t completed, uint32_t leechers) {
+                                                        process_scrape(seeders, completed, leechers);
+                                                      },
+                                                      [this](const std::string& msg) { process_scrape_failure(msg); });
+
+  update_requesting_state();
 }
 
 void
@@ -91,6 +130,11 @@ TrackerUdp::close_directly() {
 
   m_inet_state  = family_state{};
   m_inet6_state = family_state{};
+
+  if (m_requested_scrape) {
+    ThreadTracker::thread_tracker()->udp_scraper()->remove(this);
+    m_requested_scrape = false;
+  }
 }
 
 void
@@ -115,19 +159,22 @@ TrackerUdp::reset_family_with_error(int family, const std::string& msg) {
       return; // TODO: Should we throw?
 
     m_inet_state.transaction_id = 0;
-    m_inet_state.connection_id  = 0;
     break;
   case AF_INET6:
     if (m_inet6_state.transaction_id == 0)
       return; // TODO: Should we throw?
 
     m_inet6_state.transaction_id = 0;
-    m_inet6_state.connection_id  = 0;
     break;
   default:
     throw internal_error("TrackerUdp::reset_family_with_error() called with invalid address family.");
   }
 
+  if (m_connecting) {
+    m_connect_error = msg;
+    return;
+  }
+
   if (m_inet_state.transaction_id != 0 || m_inet6_state.transaction_id != 0)
     return; // TODO: Save message.
 
@@ -145,7 +192,7 @@ TrackerUdp::update_requesting_state() {
 
   state().m_flags &= ~tracker::TrackerState::flag_starting_request;
 
-  if (m_inet_state.transaction_id != 0 || m_inet6_state.transaction_id != 0)
+  if (m_inet_state.transaction_id != 0 || m_inet6_state.transaction_id != 0 || m_requested_scrape)
     state().m_flags |= tracker::TrackerState::flag_requesting;
   else
     state().m_flags &= ~tracker::TrackerState::flag_requesting;
@@ -185,12 +232,15 @@ TrackerUdp::connect_family(int family) {
   if (state_for_family(family).transaction_id != 0)
     throw internal_error("TrackerUdp::connect_family() called but transaction id is not 0.");
 
+  // The router does the connect handshake, and shares the connection id with other requests to
+  // the same endpoint.
   auto params = tracker::UdpRouter::connection_params{
-    [this, family](uint32_t id, auto& buffer)               { prepare_connect(family, id, buffer); },
-    [this, family](uint32_t id, auto& buffer)               { return process_connect(family, id, buffer); },
+    [this, family](uint32_t id, auto& buffer)               { prepare_announce(family, id, buffer); },
+    [this, family](uint32_t id, auto& buffer)               { return process_announce(family, id, buffer); },
     [this, family](uint32_t id, int errno_err, int gai_err) { handle_udp_error(family, id, errno_err, gai_err); },
     [this, family](uint32_t id)                             { state_for_family(family).transaction_id = id; },
-    nullptr,
+    [this, family](uint32_t id)                             { process_announce_packet_sent(family, id); },
+    true,
   };
 
   router_for_family(family)->connect(m_hostname, m_port, params);
@@ -218,52 +268,6 @@ TrackerUdp::process_header(int family, uint32_t action, buffer_type& buffer) {
   return 1;
 }
 
-void
-TrackerUdp::prepare_connect(int family, uint32_t id, buffer_type& buffer) {
-  if (state_for_family(family).transaction_id == 0)
-    throw internal_error("TrackerUdp::prepare_connect() called but transaction id is 0.");
-
-  if (id != state_for_family(family).transaction_id)
-    throw internal_error("TrackerUdp::prepare_connect() called with wrong transaction id.");
-
-  buffer.write_64(magic_connection_id);
-  buffer.write_32(0);
-  buffer.write_32(id);
-
-  LT_LOG_DUMP(buffer.begin(), buffer.size_end(), "prepare connect : family:%s id:%" PRIx32, system::sa_family_enum(family), id);
-}
-
-bool
-TrackerUdp::process_connect(int family, uint32_t id, buffer_type& buffer) {
-  LT_LOG_DUMP(buffer.begin(), buffer.size_end(), "process connect : family:%s id:%" PRIx32, system::sa_family_enum(family), id);
-
-  switch (process_header(family, 0, buffer)) {
-  case -1:
-    return false;
-  case 0:
-    return true;
-  };
-
-  if (buffer.size_end() < 16)
-    return handle_parse_error(family, id, "invalid connect response size");
-
-  state_for_family(family).connection_id = buffer.read_64();
-
-  if (state_for_family(family).connection_id == 0)
-    return handle_parse_error(family, id, "connection id is 0");
-
-  auto params = tracker::UdpRouter::connection_params{
-    [this, family](uint32_t id, auto& buffer)               { prepare_announce(family, id, buffer); },
-    [this, family](uint32_t id, auto& buffer)               { return process_announce(family, id, buffer); },
-    [this, family](uint32_t id, int errno_err, int gai_err) { handle_udp_error(family, id, errno_err, gai_err); },
-    [this, family](uint32_t id)                             { state_for_family(family).transaction_id = id; },
-    [this, family](uint32_t id)                             { process_announce_packet_sent(family, id); },
-  };
-
-  router_for_family(family)->transfer(id, params);
-  return true;
-}
-
 void
 TrackerUdp::prepare_announce(int family, uint32_t id, buffer_type& buffer) {
   if (state_for_family(family).transaction_id == 0)
@@ -272,7 +276,7 @@ TrackerUdp::prepare_announce(int family, uint32_t id, buffer_type& buffer) {
   if (id != state_for_family(family).transaction_id)
     throw internal_error("TrackerUdp::prepare_announce() called with wrong transaction id.");
 
-  buffer.write_64(state_for_family(family).connection_id);
+  buffer.write_64(router_for_family(family)->connection_id(id));
   buffer.write_32(1);
   buffer.write_32(state_for_family(family).transaction_id);
 
@@ -342,23 +346,19 @@ TrackerUdp::process_announce(int family, uint32_t id, buffer_type& buffer) {
 
   // TODO: This might not handle IPv4-mapped IPv6 addresses correctly.
 
+  raw_string peers(reinterpret_cast<const char*>(buffer.position()), buffer.remaining());
+
   switch (family) {
   case AF_INET:
-    std::copy(reinterpret_cast<const SocketAddressCompact*>(buffer.position()),
-              reinterpret_cast<const SocketAddressCompact*>(buffer.end() - buffer.remaining() % sizeof(SocketAddressCompact)),
-              std::back_inserter(l));
+    l.parse_address_compact(peers);
 
     m_inet_state.transaction_id = 0;
-    m_inet_state.connection_id  = 0;
     break;
 
   case AF_INET6:
-    std::copy(reinterpret_cast<const SocketAddressCompact6*>(buffer.position()),
-              reinterpret_cast<const SocketAddressCompact6*>(buffer.end() - buffer.remaining() % sizeof(SocketAddressCompact6)),
-              std::back_inserter(l));
+    l.parse_address_compact_ipv6(peers);
 
     m_inet6_state.transaction_id = 0;
-    m_inet6_state.connection_id  = 0;
     break;
 
   default:
@@ -395,7 +395,10 @@ TrackerUdp::process_announce_packet_sent(int family, [[maybe_unused]] uint32_t i
 }
 
 void
-TrackerUdp::process_error(int family, [[maybe_unused]] uint32_t id, buffer_type& buffer) {
+TrackerUdp::process_error(int family, uint32_t id, buffer_type& buffer) {
+  // The tracker might have rejected a stale connection id, so don't reuse it.
+  router_for_family(family)->clear_connection_id(id);
+
   std::string msg(buffer.position(), buffer.end());
 
   if (msg.empty())
@@ -404,6 +407,37 @@ TrackerUdp::process_error(int family, [[maybe_unused]] uint32_t id, buffer_type&
   reset_family_with_error(family, "tracker message: " + msg);
 }
 
+void
+TrackerUdp::process_scrape(uint32_t seeders, uint32_t completed, uint32_t leechers) {
+  m_requested_scrape = false;
+
+  {
+    auto guard = lock_guard();
+
+    state().m_scrape_complete   = seeders;
+    state().m_scrape_incomplete = leechers;
+    state().m_scrape_downloaded = completed;
+  }
+
+  LT_LOG("received scrape success : hostname:%s port:%u complete:%u incomplete:%u downloaded:%u",
+         m_hostname.c_str(), m_port, seeders, leechers, completed);
+
+  update_requesting_state();
+
+  m_slot_scrape_success();
+}
+
+void
+TrackerUdp::process_scrape_failure(const std::string& msg) {
+  m_requested_scrape = false;
+
+  LT_LOG("received scrape failure : hostname:%s port:%u : %s", m_hostname.c_str(), m_port, msg.c_str());
+
+  update_requesting_state();
+
+  m_slot_scrape_failure(msg);
+}
+
 void
 TrackerUdp::handle_setup_error(const std::string& msg) {
   LT_LOG("setup error : hostname:%s port:%u : %s", m_hostname.c_str(), m_port, msg.c_str());
@@ -417,6 +451,13 @@ TrackerUdp::handle_setup_error(const std::string& msg) {
   m_slot_failure(msg);
 }
 
+void
+TrackerUdp::handle_scrape_setup_error(const std::string& msg) {
+  LT_LOG("scrape setup error : url:%s : %s", info().url.c_str(), msg.c_str());
+
+  m_slot_scrape_failure(msg);
+}
+
 bool
 TrackerUdp::handle_parse_error(int family, [[maybe_unused]] uint32_t id, const std::string& msg) {
   reset_family_with_error(family, "parse error: " + msg);
@@ -1,13 +1,11 @@
 #ifndef LIBTORRENT_TRACKER_TRACKER_UDP_H
 #define LIBTORRENT_TRACKER_TRACKER_UDP_H
 
-#include "net/protocol_buffer.h"
 #include "tracker/tracker_worker.h"
+#include "tracker/udp_router.h"
 
 namespace torrent::tracker {
 
-class UdpRouter;
-
 class TrackerUdp : public TrackerWorker {
 public:
   TrackerUdp(const TrackerInfo& info, int flags = 0);
@@ -20,13 +18,10 @@ public:
   void                close() override;
 
 private:
-  static constexpr uint64_t magic_connection_id = 0x0000041727101980ll;
-
-  using buffer_type = ProtocolBuffer<512>;
+  using buffer_type = UdpRouter::buffer_type;
 
   struct family_state {
     uint32_t transaction_id{};
-    uint64_t connection_id{};
     bool     packet_sent{};
   };
 
@@ -44,16 +39,17 @@ private:
 
   int                 process_header(int family, uint32_t action, buffer_type& buffer);
 
-  void                prepare_connect(int family, uint32_t id, buffer_type& buffer);
-  bool                process_connect(int family, uint32_t id, buffer_type& buffer);
-
   void                prepare_announce(int family, uint32_t id, buffer_type& buffer);
   bool                process_announce(int family, uint32_t id, buffer_type& buffer);
   void                process_announce_packet_sent(int family, uint32_t id);
 
   void                process_error(int family, uint32_t id, buffer_type& buffer);
 
+  void                process_scrape(uint32_t seeders, uint32_t completed, uint32_t leechers);
+  void                process_scrape_failure(const std::string& msg);
+
   void                handle_setup_error(const std::string& msg);
+  void                handle_scrape_setup_error(const std::string& msg);
   bool                handle_parse_error(int family, uint32_t id, const std::string& msg);
   void                handle_udp_error(int family, uint32_t id, int errno_err, int gai_err);
 
@@ -62,6 +58,9 @@ private:
 
   TrackerParams       m_params;
   int                 m_send_state{};
+  bool                m_requested_scrape{};
+  bool                m_connecting{};
+  std::string         m_connect_error;
   family_state        m_inet_state{};
   family_state        m_inet6_state{};
 };
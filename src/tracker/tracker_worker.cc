@@ -28,6 +28,12 @@ TrackerWorker::mark_starting_request() {
   m_state.m_flags |= tracker::TrackerState::flag_starting_request;
 }
 
+void
+TrackerWorker::clear_starting_request() {
+  auto guard = lock_guard();
+  m_state.m_flags &= ~tracker::TrackerState::flag_starting_request;
+}
+
 void
 TrackerWorker::remove_events() {
   system::cancel_callback_and_wait(m_callback_id, main_thread::thread(), tracker_thread::thread());
@@ -70,6 +70,7 @@ protected:
   void                set_tracker_id_unsafe(const std::string& id);
 
   void                mark_starting_request();
+  void                clear_starting_request();
 
   auto&               callback_id()                         { return m_callback_id; }
   void                remove_events();
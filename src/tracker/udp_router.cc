@@ -94,6 +94,8 @@ UdpRouter::close() {
 
   this_thread::scheduler()->erase(&m_task_timeout);
 
+  m_endpoints.clear();
+
   // Check if we're running in unittests.
   if (this_thread::resolver() != nullptr && net_thread::thread() != nullptr)
     this_thread::resolver()->cancel(m_resolver_callback_id);
@@ -228,6 +230,37 @@ UdpRouter::disconnect(uint32_t id) {
   disconnect_unsafe(itr);
 }
 
+uint64_t
+UdpRouter::connection_id(uint32_t id) const {
+  auto address = connection_address(id);
+
+  if (address == nullptr)
+    return 0;
+
+  auto itr = m_endpoints.find(endpoint_key_for(address));
+
+  if (itr == m_endpoints.end())
+    return 0;
+
+  return itr->second.connection_id;
+}
+
+void
+UdpRouter::clear_connection_id(uint32_t id) {
+  auto address = connection_address(id);
+
+  if (address == nullptr)
+    return;
+
+  auto itr = m_endpoints.find(endpoint_key_for(address));
+
+  if (itr == m_endpoints.end())
+    return;
+
+  itr->second.connection_id = 0;
+  itr->second.expires       = std::chrono::seconds{};
+}
+
 UdpRouter::connection_map::iterator
 UdpRouter::connect_unsafe(c_sa_shared_ptr address, connection_params params) {
   assert(is_open());
@@ -259,6 +292,8 @@ UdpRouter::connect_unsafe(c_sa_shared_ptr address, connection_params params) {
   itr->second.failure     = std::move(params.failure);
   itr->second.packet_sent = std::move(params.packet_sent);
 
+  itr->second.use_connection_id = params.use_connection_id;
+
   params.connected(itr->first);
   return itr;
 }
@@ -274,6 +309,13 @@ UdpRouter::disconnect_unsafe(connection_map::iterator itr) {
 
   clear_timeout(&itr->second);
 
+  if (itr->second.waiting) {
+    auto endpoint_itr = m_endpoints.find(endpoint_key_for(itr->second.address.get()));
+
+    if (endpoint_itr != m_endpoints.end())
+      std::erase(endpoint_itr->second.waiting, itr->first);
+  }
+
   m_connections.erase(itr);
 }
 
@@ -288,6 +330,138 @@ UdpRouter::disconnect_failure_unsafe(connection_map::iterator itr, int errno_err
   failure_fn(id, errno_err, gai_err);
 }
 
+const sockaddr*
+UdpRouter::connection_address(uint32_t id) const {
+  auto itr = m_connections.find(id);
+
+  if (itr == m_connections.end())
+    throw internal_error("UdpRouter::connection_address() called with invalid connection ID.");
+
+  return itr->second.address.get();
+}
+
+UdpRouter::endpoint_key
+UdpRouter::endpoint_key_for(const sockaddr* sa) {
+  return endpoint_key{socket_address_key::from_sockaddr(sa), sa_port(sa)};
+}
+
+// Returns true if the endpoint has a valid connection id, else the connection is added to the
+// endpoint's waiting list.
+
+bool
+UdpRouter::wait_for_connection_id(uint32_t id, connection_info* info) {
+  auto  key      = endpoint_key_for(info->address.get());
+  auto& endpoint = m_endpoints[key];
+
+  if (endpoint.connection_id != 0 && endpoint.expires > this_thread::cached_seconds())
+    return true;
+
+  info->waiting = true;
+  endpoint.waiting.push_back(id);
+
+  if (endpoint.connect_id == 0)
+    start_endpoint_connect(key, info->address.get());
+
+  return false;
+}
+
+void
+UdpRouter::start_endpoint_connect(const endpoint_key& key, const sockaddr* address) {
+  auto params = connection_params{
+    [](uint32_t id, auto& buffer) {
+      buffer.write_64(magic_connection_id);
+      buffer.write_32(0);
+      buffer.write_32(id);
+    },
+    [this, key](uint32_t id, auto& buffer) { return process_endpoint_connect(key, id, buffer); },
+    [this, key]([[maybe_unused]] uint32_t id, int errno_err, int gai_err) {
+      auto& endpoint = m_endpoints[key];
+
+      endpoint.connect_id    = 0;
+      endpoint.failed_count++;
+      endpoint.backoff_until = this_thread::cached_seconds() + std::min(backoff_min * (1 << std::min(endpoint.failed_count - 1, 6u)), backoff_max);
+
+      release_endpoint_waiting(key, errno_err, gai_err);
+    },
+    [this, key](uint32_t id) { m_endpoints[key].connect_id = id; },
+    nullptr,
+  };
+
+  auto itr = connect_unsafe(sa_copy(address), params);
+
+  if (m_endpoints[key].backoff_until > this_thread::cached_seconds()) {
+    LT_LOG("connecting to endpoint in backoff, single attempt : address:%s id:%" PRIx32, sa_pretty_str(address).c_str(), itr->first);
+
+    itr->second.retry_count = max_retry_count - 1;
+  } else {
+    LT_LOG("connecting to endpoint : address:%s id:%" PRIx32, sa_pretty_str(address).c_str(), itr->first);
+  }
+
+  try_write_with_queues(itr->first, &itr->second);
+}
+
+bool
+UdpRouter::process_endpoint_connect(const endpoint_key& key, uint32_t id, buffer_type& buffer) {
+  if (buffer.size_end() < 8)
+    return true;
+
+  uint32_t action = buffer.read_32();
+
+  if (buffer.read_32() != id)
+    return true;
+
+  auto& endpoint = m_endpoints[key];
+
+  if (action == 3) {
+    endpoint.connect_id = 0;
+    release_endpoint_waiting(key, ECONNREFUSED, 0);
+    return false;
+  }
+
+  if (action != 0 || buffer.size_end() < 16)
+    return true;
+
+  uint64_t connection_id = buffer.read_64();
+
+  if (connection_id == 0)
+    return true;
+
+  endpoint.connection_id = connection_id;
+  endpoint.expires       = this_thread::cached_seconds() + connection_id_lifetime;
+  endpoint.connect_id    = 0;
+  endpoint.failed_count  = 0;
+  endpoint.backoff_until = std::chrono::seconds{};
+
+  release_endpoint_waiting(key, 0, 0);
+  return false;
+}
+
+// Sends, or fails if 'errno_err' or 'gai_err' is set, all the connections waiting for the endpoint
+// connection id.
+
+void
+UdpRouter::release_endpoint_waiting(const endpoint_key& key, int errno_err, int gai_err) {
+  auto waiting = std::move(m_endpoints[key].waiting);
+
+  m_endpoints[key].waiting.clear();
+
+  for (auto id : waiting) {
+    auto itr = m_connections.find(id);
+
+    if (itr == m_connections.end())
+      continue;
+
+    itr->second.waiting = false;
+
+    if (errno_err != 0 || gai_err != 0) {
+      disconnect_failure_unsafe(itr, errno_err, gai_err);
+      continue;
+    }
+
+    try_write_with_queues(id, &itr->second);
+  }
+}
+
 void
 UdpRouter::resolved_hostname(uint32_t id, uint16_t port, c_sin_shared_ptr& sin, int err, c_sin6_shared_ptr& sin6, int err6) {
   auto itr = m_connections.find(id);
@@ -349,6 +523,9 @@ bool
 UdpRouter::try_write_with_queues(uint32_t id, connection_info* info) {
   clear_timeout(info);
 
+  if (info->use_connection_id && !wait_for_connection_id(id, info))
+    return false;
+
   int err = try_write(id, info);
 
   if (err == EAGAIN) {
@@ -371,7 +548,7 @@ UdpRouter::try_write(uint32_t id, connection_info* info) {
   if (!is_open())
     throw internal_error("UdpRouter::try_write() called but router is not open.");
 
-  if (info->retry_count >= 3)
+  if (info->retry_count >= max_retry_count)
     throw internal_error("UdpRouter::try_write() called but retry_count is not 0.");
 
   int retries{};
@@ -517,7 +694,7 @@ UdpRouter::receive_timeout() {
 
     info->timeout_ptr = nullptr;
 
-    if (info->retry_count >= 3) {
+    if (info->retry_count >= max_retry_count) {
       disconnect_failure_unsafe(m_connections.find(id), ETIMEDOUT, 0);
       continue;
     }
@@ -580,7 +757,13 @@ UdpRouter::event_read() {
     if (!sa_equal(&from_sa.sa, itr->second.address.get()))
       continue;
 
-    if (!itr->second.process(transaction_id, m_buffer))
+    // The process callback may add or remove connections, so look up the transaction again.
+    if (itr->second.process(transaction_id, m_buffer))
+      continue;
+
+    itr = m_connections.find(transaction_id);
+
+    if (itr != m_connections.end())
       disconnect_unsafe(itr);
   }
 }
@@ -4,20 +4,24 @@
 #include <chrono>
 #include <deque>
 #include <functional>
+#include <map>
 #include <memory>
 #include <random>
 #include <tuple>
 #include <unordered_map>
+#include <vector>
 
 #include "net/protocol_buffer.h"
 #include "net/socket_datagram.h"
+#include "torrent/net/socket_address_key.h"
 #include "torrent/system/scheduler.h"
 
 namespace torrent::tracker {
 
 class UdpRouter : public SocketDatagram {
 public:
-  using buffer_type      = ProtocolBuffer<512>;
+  // Large enough for a full BEP 15 multi-hash scrape and announce replies with many peers.
+  using buffer_type      = ProtocolBuffer<2048>;
 
   using prepare_func     = std::function<void(uint32_t, buffer_type&)>;
   using process_func     = std::function<bool(uint32_t, buffer_type&)>;
@@ -32,6 +36,8 @@ public:
 
     connected_func      connected;
     packet_sent_func    packet_sent;
+
+    bool                use_connection_id{};
   };
 
   UdpRouter();
@@ -62,6 +68,29 @@ public:
 
   void                disconnect(uint32_t id);
 
+  // BEP 15 connection ids are cached per tracker endpoint. Connections with 'use_connection_id'
+  // set wait for the router to complete a connect handshake with the endpoint before their first
+  // write, only one handshake is in flight per endpoint and all waiting transactions are sent once
+  // it completes.
+  //
+  // A failed handshake only fails the connections waiting on it. The endpoint is then put in
+  // backoff, during which new connections still get a handshake but it is sent only once rather
+  // than retried, so an unresponsive tracker holds its requests for a single timeout.
+
+  static constexpr uint64_t             magic_connection_id    = 0x0000041727101980ll;
+  static constexpr std::chrono::seconds connection_id_lifetime = 60s;
+  static constexpr std::chrono::seconds backoff_min            = 60s;
+  static constexpr std::chrono::seconds backoff_max            = 3600s;
+
+  // Each attempt waits 15s longer than the previous, the connection fails after the last.
+  static constexpr unsigned int         max_retry_count        = 3;
+
+  // Returns the cached connection id of the endpoint for transaction 'id', or 0 if none.
+  uint64_t            connection_id(uint32_t id) const;
+  void                clear_connection_id(uint32_t id);
+
+  size_t              size_endpoints() const { return m_endpoints.size(); }
+
 private:
   UdpRouter(const UdpRouter&) = delete;
   UdpRouter& operator=(const UdpRouter&) = delete;
@@ -73,6 +102,20 @@ private:
   using write_queue_type   = std::deque<std::pair<uint32_t, connection_info*>>;
   using timeout_queue_type = std::deque<std::tuple<uint32_t, std::chrono::seconds, connection_info*>>;
 
+  struct endpoint_info {
+    uint64_t              connection_id{};
+    std::chrono::seconds  expires{};
+
+    uint32_t              connect_id{};
+    std::vector<uint32_t> waiting;
+
+    unsigned int          failed_count{};
+    std::chrono::seconds  backoff_until{};
+  };
+
+  using endpoint_key       = std::pair<socket_address_key, uint16_t>;
+  using endpoint_map       = std::map<endpoint_key, endpoint_info>;
+
   // TODO: Add itr to self in connection_map.
 
   struct connection_info {
@@ -87,6 +130,9 @@ private:
 
     unsigned int         retry_count{};
 
+    bool                 use_connection_id{};
+    bool                 waiting{};
+
     connection_info**    queue_ptr{};
     connection_info**    timeout_ptr{};
   };
@@ -97,6 +143,14 @@ private:
 
   int                 router_family() const;
 
+  const sockaddr*     connection_address(uint32_t id) const;
+  static endpoint_key endpoint_key_for(const sockaddr* sa);
+
+  bool                wait_for_connection_id(uint32_t id, connection_info* info);
+  void                start_endpoint_connect(const endpoint_key& key, const sockaddr* address);
+  bool                process_endpoint_connect(const endpoint_key& key, uint32_t id, buffer_type& buffer);
+  void                release_endpoint_waiting(const endpoint_key& key, int errno_err, int gai_err);
+
   void                resolved_hostname(uint32_t id, uint16_t port, c_sin_shared_ptr& sin, int err, c_sin6_shared_ptr& sin6, int err6);
 
   bool                try_write_with_queues(uint32_t id, connection_info* info);
@@ -123,6 +177,7 @@ private:
   connection_map        m_connections;
   write_queue_type      m_write_queue;
   timeout_queue_type    m_timeout_queue;
+  endpoint_map          m_endpoints;
 
   system::SchedulerEntry m_task_timeout;
 
@@ -0,0 +1,347 @@
+#include "config.h"
+
+#include "tracker/udp_scraper.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "torrent/exceptions.h"
+#include "torrent/net/types.h"
+#include "torrent/system/thread.h"
+#include "torrent/system/types.h"
+#include "torrent/utils/log.h"
+
+#define LT_LOG(log_fmt, ...)                                            \
+  lt_log_print_subsystem(LOG_TRACKER_REQUESTS, "udp-scraper", log_fmt, __VA_ARGS__);
+
+namespace torrent::tracker {
+
+UdpScraper::UdpScraper(UdpRouter* inet_router, UdpRouter* inet6_router)
+  : m_inet_router(inet_router),
+    m_inet6_router(inet6_router) {
+
+  m_task_flush.slot() = [this] { flush(); };
+}
+
+UdpScraper::~UdpScraper() {
+  if (m_task_flush.is_scheduled())
+    this_thread::scheduler()->erase(&m_task_flush);
+
+  for (auto& [local_id, batch] : m_batches)
+    if (batch.transaction_id != 0)
+      batch.router->disconnect(batch.transaction_id);
+}
+
+void
+UdpScraper::add(const void* owner, const std::string& hostname, uint16_t port, const HashString& hash,
+                success_func success, failure_func failure) {
+  if (owner == nullptr || hostname.empty() || port == 0)
+    throw internal_error("UdpScraper::add() called with invalid arguments.");
+
+  auto [owner_itr, inserted] = m_owners.emplace(owner, location{});
+
+  if (!inserted)
+    throw internal_error("UdpScraper::add() called for an owner with a request.");
+
+  auto pending_itr = m_pending.try_emplace(endpoint_key{hostname, port}).first;
+
+  owner_itr->second.pending_itr = pending_itr;
+  owner_itr->second.index       = pending_itr->second.size();
+
+  pending_itr->second.push_back(request{owner, hash, std::move(success), std::move(failure)});
+  m_size_pending++;
+
+  if (!m_task_flush.is_scheduled())
+    this_thread::scheduler()->wait_for_ceil_seconds(&m_task_flush, batch_delay);
+}
+
+// Removed requests are left as empty entries with no owner; pending ones are skipped by flush(),
+// while those already in flight are kept in place so the response offsets still line up. The
+// transaction is only dropped once no owners remain.
+
+void
+UdpScraper::remove(const void* owner) {
+  auto owner_itr = m_owners.find(owner);
+
+  if (owner_itr == m_owners.end())
+    return;
+
+  auto loc = owner_itr->second;
+  m_owners.erase(owner_itr);
+
+  if (loc.local_id == 0) {
+    loc.pending_itr->second[loc.index] = request{};
+
+    if (--m_size_pending == 0) {
+      m_pending.clear();
+      this_thread::scheduler()->erase(&m_task_flush);
+    }
+
+    return;
+  }
+
+  auto batch_itr = m_batches.find(loc.local_id);
+
+  if (batch_itr == m_batches.end())
+    throw internal_error("UdpScraper::remove() owner refers to an unknown batch.");
+
+  auto& r = batch_itr->second.requests[loc.index];
+
+  r.owner   = nullptr;
+  r.success = nullptr;
+  r.failure = nullptr;
+
+  if (--batch_itr->second.size_owners != 0)
+    return;
+
+  if (batch_itr->second.transaction_id != 0)
+    batch_itr->second.router->disconnect(batch_itr->second.transaction_id);
+
+  m_batches.erase(batch_itr);
+}
+
+// Numeric hostnames use the router of their address family, while names are resolved by the inet
+// router first and fall back to inet6 if that fails.
+
+UdpRouter*
+UdpScraper::select_router(const std::string& hostname) {
+  auto is_usable = [](UdpRouter* router) { return router != nullptr && router->is_open(); };
+  auto sa        = std::get<0>(sa_lookup_numeric(hostname, AF_UNSPEC));
+
+  if (sa != nullptr) {
+    auto router = sa->sa_family == AF_INET6 ? m_inet6_router : m_inet_router;
+    return is_usable(router) ? router : nullptr;
+  }
+
+  if (is_usable(m_inet_router))
+    return m_inet_router;
+
+  if (is_usable(m_inet6_router))
+    return m_inet6_router;
+
+  return nullptr;
+}
+
+UdpRouter*
+UdpScraper::fallback_router(const batch& b) {
+  if (b.router != m_inet_router || m_inet6_router == nullptr || !m_inet6_router->is_open())
+    return nullptr;
+
+  if (std::get<0>(sa_lookup_numeric(b.endpoint.first, AF_UNSPEC)) != nullptr)
+    return nullptr;
+
+  return m_inet6_router;
+}
+
+// Owners keep pointing into the moved pending lists until their batch is sent, so callbacks may
+// still remove them while earlier batches are being sent.
+
+void
+UdpScraper::flush() {
+  auto pending = std::move(m_pending);
+  m_pending.clear();
+
+  for (auto& [endpoint, requests] : pending) {
+    std::erase_if(requests, [](auto& r) { return r.owner == nullptr; });
+
+    for (size_t index = 0; index != requests.size(); index++)
+      m_owners.at(requests[index].owner).index = index;
+
+    auto first = requests.begin();
+
+    while (first != requests.end()) {
+      auto last = first + std::min<size_t>(std::distance(first, requests.end()), max_hashes);
+
+      send_batch(endpoint, std::vector<request>(std::make_move_iterator(first), std::make_move_iterator(last)));
+      first = last;
+    }
+  }
+}
+
+void
+UdpScraper::send_batch(const endpoint_key& endpoint, std::vector<request> requests) {
+  std::erase_if(requests, [](auto& r) { return r.owner == nullptr; });
+
+  if (requests.empty())
+    return;
+
+  m_size_pending -= requests.size();
+
+  auto router = select_router(endpoint.first);
+
+  if (router == nullptr) {
+    for (auto& r : requests)
+      m_owners.erase(r.owner);
+
+    for (auto& r : requests)
+      r.failure("no available network protocol(s)");
+
+    return;
+  }
+
+  if (++m_next_local_id == 0)
+    m_next_local_id++;
+
+  auto local_id = m_next_local_id;
+  auto& batch   = m_batches[local_id];
+
+  batch.endpoint    = endpoint;
+  batch.router      = router;
+  batch.size_owners = requests.size();
+  batch.requests    = std::move(requests);
+
+  for (size_t index = 0; index != batch.requests.size(); index++)
+    m_owners.at(batch.requests[index].owner) = location{local_id, {}, index};
+
+  connect_batch(local_id);
+}
+
+void
+UdpScraper::connect_batch(uint32_t local_id) {
+  auto& batch = m_batches.at(local_id);
+
+  LT_LOG("sending scrape : hostname:%s port:%u family:%s hashes:%zu",
+         batch.endpoint.first.c_str(), batch.endpoint.second,
+         system::sa_family_enum(batch.router->socket_address()->sa_family), batch.requests.size());
+
+  // The router may fail the connection, or silently ignore an incompatible numeric hostname,
+  // before returning.
+  batch.router->connect(batch.endpoint.first, batch.endpoint.second, make_params(local_id));
+
+  auto itr = m_batches.find(local_id);
+
+  if (itr != m_batches.end() && itr->second.transaction_id == 0)
+    finish_batch(itr, nullptr, "no compatible address for hostname");
+}
+
+UdpRouter::connection_params
+UdpScraper::make_params(uint32_t local_id) {
+  return UdpRouter::connection_params{
+    [this, local_id](uint32_t id, auto& buffer) { prepare(local_id, id, buffer); },
+    [this, local_id](uint32_t id, auto& buffer) { return process(local_id, id, buffer); },
+    [this, local_id]([[maybe_unused]] uint32_t id, int errno_err, int gai_err) {
+      auto itr = m_batches.find(local_id);
+
+      if (itr == m_batches.end())
+        return;
+
+      itr->second.transaction_id = 0;
+
+      if (gai_err != 0) {
+        if (auto router = fallback_router(itr->second)) {
+          itr->second.router = router;
+          return connect_batch(local_id);
+        }
+      }
+
+      if (errno_err != 0)
+        finish_batch(itr, nullptr, std::string("network error: ") + system::errno_enum(errno_err));
+      else if (gai_err != 0)
+        finish_batch(itr, nullptr, std::string("network error: ") + system::gai_enum_error(gai_err));
+      else
+        finish_batch(itr, nullptr, "network error: unknown error");
+    },
+    [this, local_id](uint32_t id) { m_batches.at(local_id).transaction_id = id; },
+    nullptr,
+    true,
+  };
+}
+
+void
+UdpScraper::prepare(uint32_t local_id, uint32_t id, buffer_type& buffer) {
+  auto itr = m_batches.find(local_id);
+
+  if (itr == m_batches.end() || itr->second.transaction_id != id)
+    throw internal_error("UdpScraper::prepare() called with invalid transaction id.");
+
+  buffer.write_64(itr->second.router->connection_id(id));
+  buffer.write_32(2);
+  buffer.write_32(id);
+
+  for (auto& r : itr->second.requests)
+    buffer.write_range(r.hash.begin(), r.hash.end());
+}
+
+bool
+UdpScraper::process(uint32_t local_id, uint32_t id, buffer_type& buffer) {
+  auto itr = m_batches.find(local_id);
+
+  if (itr == m_batches.end())
+    throw internal_error("UdpScraper::process() called for unknown batch.");
+
+  if (buffer.size_end() < 8)
+    return true;
+
+  uint32_t action         = buffer.read_32();
+  uint32_t transaction_id = buffer.read_32();
+
+  if (transaction_id != id)
+    return true;
+
+  auto router = itr->second.router;
+
+  switch (action) {
+  case 2:
+    finish_batch(itr, &buffer, "");
+    return false;
+
+  case 3: {
+    // The tracker might have rejected a stale connection id, so don't reuse it.
+    router->clear_connection_id(id);
+
+    std::string msg(buffer.position(), buffer.end());
+
+    if (msg.empty())
+      msg = "empty error message";
+
+    finish_batch(itr, nullptr, "tracker message: " + msg);
+    return false;
+  }
+  default:
+    return true;
+  }
+}
+
+// Removes the batch before calling the callbacks, responses are 12 bytes per info-hash in request
+// order.
+
+void
+UdpScraper::finish_batch(batch_map::iterator itr, buffer_type* buffer, const std::string& msg) {
+  auto requests = std::move(itr->second.requests);
+
+  m_batches.erase(itr);
+
+  for (auto& r : requests)
+    if (r.owner != nullptr)
+      m_owners.erase(r.owner);
+
+  if (buffer == nullptr) {
+    LT_LOG("scrape failed : hashes:%zu : %s", requests.size(), msg.c_str());
+
+    for (auto& r : requests)
+      if (r.failure)
+        r.failure(msg);
+
+    return;
+  }
+
+  LT_LOG("scrape received : hashes:%zu entries:%u", requests.size(), static_cast<unsigned int>(buffer->remaining() / 12));
+
+  for (auto& r : requests) {
+    if (buffer->remaining() < 12) {
+      if (r.failure)
+        r.failure("parse error: truncated scrape response");
+
+      continue;
+    }
+
+    uint32_t seeders   = buffer->read_32();
+    uint32_t completed = buffer->read_32();
+    uint32_t leechers  = buffer->read_32();
+
+    if (r.success)
+      r.success(seeders, completed, leechers);
+  }
+}
+
+} // namespace torrent::tracker
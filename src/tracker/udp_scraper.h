@@ -0,0 +1,106 @@
+#ifndef LIBTORRENT_TRACKER_UDP_SCRAPER_H
+#define LIBTORRENT_TRACKER_UDP_SCRAPER_H
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "torrent/hash_string.h"
+#include "torrent/system/scheduler.h"
+#include "tracker/udp_router.h"
+
+// Coalesces scrape requests for UDP trackers into BEP 15 multi-hash scrapes, with requests to the
+// same endpoint sent in batches of up to 'max_hashes' info-hashes per packet.
+//
+// Requests are identified by their owner, which is expected to be the TrackerUdp instance, and
+// only one request per owner is allowed. Owners are indexed by the location of their request, so
+// removal does not scan other requests.
+
+namespace torrent::tracker {
+
+class UdpScraper {
+public:
+  using success_func = std::function<void(uint32_t seeders, uint32_t completed, uint32_t leechers)>;
+  using failure_func = std::function<void(const std::string&)>;
+
+  // Keeps request and response within a typical 1500 byte MTU.
+  static constexpr unsigned int         max_hashes  = 74;
+  static constexpr std::chrono::seconds batch_delay = 2s;
+
+  UdpScraper(UdpRouter* inet_router, UdpRouter* inet6_router);
+  ~UdpScraper();
+
+  void                add(const void* owner, const std::string& hostname, uint16_t port, const HashString& hash,
+                          success_func success, failure_func failure);
+  void                remove(const void* owner);
+
+  size_t              size_pending() const  { return m_size_pending; }
+  size_t              size_batches() const  { return m_batches.size(); }
+
+private:
+  UdpScraper(const UdpScraper&) = delete;
+  UdpScraper& operator=(const UdpScraper&) = delete;
+
+  using buffer_type  = UdpRouter::buffer_type;
+  using endpoint_key = std::pair<std::string, uint16_t>;
+
+  struct request {
+    const void*  owner{};
+    HashString   hash;
+    success_func success;
+    failure_func failure;
+  };
+
+  struct batch {
+    endpoint_key         endpoint;
+    UdpRouter*           router{};
+    uint32_t             transaction_id{};
+    size_t               size_owners{};
+    std::vector<request> requests;
+  };
+
+  using pending_map = std::map<endpoint_key, std::vector<request>>;
+  using batch_map   = std::map<uint32_t, batch>;
+
+  // Pending requests have a 'local_id' of zero.
+  struct location {
+    uint32_t              local_id{};
+    pending_map::iterator pending_itr;
+    size_t                index{};
+  };
+
+  using owner_map = std::map<const void*, location>;
+
+  UdpRouter*          select_router(const std::string& hostname);
+  UdpRouter*          fallback_router(const batch& b);
+
+  void                flush();
+  void                send_batch(const endpoint_key& endpoint, std::vector<request> requests);
+  void                connect_batch(uint32_t local_id);
+
+  UdpRouter::connection_params make_params(uint32_t local_id);
+
+  void                prepare(uint32_t local_id, uint32_t id, buffer_type& buffer);
+  bool                process(uint32_t local_id, uint32_t id, buffer_type& buffer);
+
+  void                finish_batch(batch_map::iterator itr, buffer_type* buffer, const std::string& msg);
+
+  UdpRouter*          m_inet_router;
+  UdpRouter*          m_inet6_router;
+
+  uint32_t            m_next_local_id{};
+
+  pending_map         m_pending;
+  batch_map           m_batches;
+  owner_map           m_owners;
+
+  size_t              m_size_pending{};
+
+  system::SchedulerEntry m_task_flush;
+};
+
+} // namespace torrent::tracker
+
+#endif // LIBTORRENT_TRACKER_UDP_SCRAPER_H
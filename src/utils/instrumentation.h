@@ -16,6 +16,8 @@ enum instrumentation_enum {
   INSTRUMENTATION_MEMORY_CHUNK_COUNT,
   INSTRUMENTATION_MEMORY_HASHING_CHUNK_USAGE,
   INSTRUMENTATION_MEMORY_HASHING_CHUNK_COUNT,
+  INSTRUMENTATION_MEMORY_BLOCK_FAILED_USAGE,
+  INSTRUMENTATION_MEMORY_BLOCK_FAILED_SKIPPED,
 
   INSTRUMENTATION_MINCORE_INCORE_TOUCHED,
   INSTRUMENTATION_MINCORE_INCORE_NEW,
@@ -0,0 +1,76 @@
+#ifndef LIBTORRENT_UTILS_SIPHASH_H
+#define LIBTORRENT_UTILS_SIPHASH_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace torrent {
+
+// SipHash-2-4, a keyed pseudorandom function that is fast for short inputs. Used where a
+// secret keyed hash is needed but a cryptographic digest is not, e.g. DHT tokens.
+
+struct siphash_key {
+  uint64_t k0;
+  uint64_t k1;
+};
+
+namespace detail {
+
+inline uint64_t
+siphash_read_le(const uint8_t* data, size_t length) {
+  uint64_t value = 0;
+
+  for (size_t i = 0; i != length; i++)
+    value |= uint64_t{data[i]} << (8 * i);
+
+  return value;
+}
+
+} // namespace detail
+
+inline uint64_t
+siphash24(const siphash_key& key, const void* data, size_t length) {
+  uint64_t v0 = UINT64_C(0x736f6d6570736575) ^ key.k0;
+  uint64_t v1 = UINT64_C(0x646f72616e646f6d) ^ key.k1;
+  uint64_t v2 = UINT64_C(0x6c7967656e657261) ^ key.k0;
+  uint64_t v3 = UINT64_C(0x7465646279746573) ^ key.k1;
+
+  auto sip_round = [&]() {
+    v0 += v1; v1 = std::rotl(v1, 13); v1 ^= v0; v0 = std::rotl(v0, 32);
+    v2 += v3; v3 = std::rotl(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = std::rotl(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = std::rotl(v1, 17); v1 ^= v2; v2 = std::rotl(v2, 32);
+  };
+
+  auto first = static_cast<const uint8_t*>(data);
+  auto last  = first + (length & ~size_t{7});
+
+  for (; first != last; first += 8) {
+    uint64_t m = detail::siphash_read_le(first, 8);
+
+    v3 ^= m;
+    sip_round();
+    sip_round();
+    v0 ^= m;
+  }
+
+  uint64_t b = uint64_t{length} << 56 | detail::siphash_read_le(first, length & 7);
+
+  v3 ^= b;
+  sip_round();
+  sip_round();
+  v0 ^= b;
+
+  v2 ^= 0xff;
+  sip_round();
+  sip_round();
+  sip_round();
+  sip_round();
+
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+} // namespace torrent
+
+#endif
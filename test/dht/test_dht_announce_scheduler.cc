@@ -0,0 +1,231 @@
+#include "config.h"
+
+#include "test/dht/test_dht_announce_scheduler.h"
+
+#include <cstring>
+#include <vector>
+
+#include "dht/dht_announce_scheduler.h"
+#include "torrent/net/socket_address.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestDhtAnnounceScheduler);
+
+using torrent::DhtAnnounceScheduler;
+using torrent::HashString;
+using torrent::TrackerDht;
+using torrent::dht::DhtSearch;
+
+static HashString
+make_id(char c, char last = 0) {
+  HashString id;
+  std::memset(id.data(), c, id.size());
+  id[HashString::size_data - 1] = last;
+  return id;
+}
+
+// Distinct trackers for the scheduler, only their ownership is compared.
+static std::shared_ptr<TrackerDht>
+make_tracker() {
+  return std::shared_ptr<TrackerDht>(std::make_shared<int>(), nullptr);
+}
+
+void
+TestDhtAnnounceScheduler::test_order() {
+  DhtAnnounceScheduler scheduler;
+
+  for (char c : {0x30, 0x10, 0x20})
+    scheduler.push(make_id(c), {}, false);
+
+  CPPUNIT_ASSERT(scheduler.size() == 3);
+  CPPUNIT_ASSERT(scheduler.pop().info_hash == make_id(0x10));
+  CPPUNIT_ASSERT(scheduler.pop().info_hash == make_id(0x20));
+
+  // Announces behind the cursor wait until it wraps around.
+  scheduler.push(make_id(0x05), {}, false);
+  scheduler.push(make_id(0x40), {}, false);
+
+  CPPUNIT_ASSERT(scheduler.pop().info_hash == make_id(0x30));
+  CPPUNIT_ASSERT(scheduler.pop().info_hash == make_id(0x40));
+  CPPUNIT_ASSERT(scheduler.pop().info_hash == make_id(0x05));
+  CPPUNIT_ASSERT(scheduler.empty());
+
+  CPPUNIT_ASSERT_THROW(scheduler.pop(), torrent::internal_error);
+}
+
+void
+TestDhtAnnounceScheduler::test_merge_and_erase() {
+  DhtAnnounceScheduler scheduler;
+
+  auto tracker_1 = make_tracker();
+  auto tracker_2 = make_tracker();
+
+  scheduler.push(make_id(0x10), tracker_1, false);
+  scheduler.push(make_id(0x10), tracker_1, true);
+  scheduler.push(make_id(0x10), tracker_2, false);
+  scheduler.push(make_id(0x20), tracker_1, false);
+
+  CPPUNIT_ASSERT(scheduler.size() == 3);
+
+  scheduler.erase(make_id(0x10), tracker_2);
+  CPPUNIT_ASSERT(scheduler.size() == 2);
+
+  auto request = scheduler.pop();
+  CPPUNIT_ASSERT(request.info_hash == make_id(0x10));
+  CPPUNIT_ASSERT(request.report_status);
+
+  // An expired tracker erases all announces for the info hash.
+  scheduler.push(make_id(0x30), tracker_1, false);
+  scheduler.push(make_id(0x30), tracker_2, false);
+  scheduler.erase(make_id(0x30), std::weak_ptr<TrackerDht>());
+
+  CPPUNIT_ASSERT(scheduler.size() == 1);
+  CPPUNIT_ASSERT(scheduler.pop().info_hash == make_id(0x20));
+}
+
+void
+TestDhtAnnounceScheduler::test_budget() {
+  DhtAnnounceScheduler scheduler;
+  scheduler.set_query_limit(10, 20);
+
+  CPPUNIT_ASSERT(!scheduler.can_start(0));
+
+  scheduler.push(make_id(0x10), {}, false);
+
+  CPPUNIT_ASSERT(scheduler.can_start(0));
+  CPPUNIT_ASSERT(!scheduler.can_start(scheduler.max_active()));
+
+  for (int i = 0; i != 20; i++)
+    scheduler.use_query();
+
+  CPPUNIT_ASSERT(!scheduler.can_start(0));
+
+  m_main_thread->test_add_cached_time(1s);
+  CPPUNIT_ASSERT(scheduler.can_start(0));
+
+  // The budget can go negative, and is refilled no further than the burst size.
+  for (int i = 0; i != 30; i++)
+    scheduler.use_query();
+
+  m_main_thread->test_add_cached_time(2s);
+  CPPUNIT_ASSERT(!scheduler.can_start(0));
+
+  m_main_thread->test_add_cached_time(10s);
+  CPPUNIT_ASSERT(scheduler.can_start(0));
+
+  for (int i = 0; i != 20; i++)
+    scheduler.use_query();
+
+  CPPUNIT_ASSERT(!scheduler.can_start(0));
+}
+
+void
+TestDhtAnnounceScheduler::test_limits() {
+  DhtAnnounceScheduler scheduler;
+
+  CPPUNIT_ASSERT(scheduler.query_rate() == DhtAnnounceScheduler::default_query_rate);
+  CPPUNIT_ASSERT(scheduler.query_burst() == DhtAnnounceScheduler::default_query_burst);
+  CPPUNIT_ASSERT(scheduler.max_active() == DhtAnnounceScheduler::default_max_active);
+
+  CPPUNIT_ASSERT_THROW(scheduler.set_query_limit(0, 10), torrent::input_error);
+  CPPUNIT_ASSERT_THROW(scheduler.set_query_limit(10, 0), torrent::input_error);
+  CPPUNIT_ASSERT_THROW(scheduler.set_max_active(0), torrent::input_error);
+
+  scheduler.set_max_active(2);
+  scheduler.push(make_id(0x10), {}, false);
+
+  CPPUNIT_ASSERT(scheduler.can_start(1));
+  CPPUNIT_ASSERT(!scheduler.can_start(2));
+}
+
+// With the default limits a full reannounce of 20k torrents, at 26 queries and 4 seconds per
+// lookup, is started within the 30 minute interval.
+void
+TestDhtAnnounceScheduler::test_drain() {
+  constexpr unsigned int num_announces        = 20000;
+  constexpr unsigned int queries_per_announce = 26;
+  constexpr unsigned int lookup_seconds       = 4;
+  constexpr unsigned int interval_seconds     = 30 * 60;
+
+  DhtAnnounceScheduler scheduler;
+
+  for (unsigned int i = 0; i != num_announces; i++) {
+    HashString id;
+    std::memset(id.data(), 0, id.size());
+    std::memcpy(id.data(), &i, sizeof(i));
+
+    scheduler.push(id, {}, false);
+  }
+
+  std::vector<unsigned int> started(interval_seconds);
+  unsigned int              seconds = 0;
+
+  for (; seconds != interval_seconds && !scheduler.empty(); seconds++) {
+    // Lookups started in the previous 'lookup_seconds - 1' seconds are still running.
+    unsigned int active = 0;
+
+    for (unsigned int i = seconds - std::min(seconds, lookup_seconds - 1); i != seconds; i++)
+      active += started[i];
+
+    while (scheduler.can_start(active)) {
+      scheduler.pop();
+
+      for (unsigned int i = 0; i != queries_per_announce; i++)
+        scheduler.use_query();
+
+      active++;
+      started[seconds]++;
+    }
+
+    m_main_thread->test_add_cached_time(1s);
+  }
+
+  CPPUNIT_ASSERT(scheduler.empty());
+  CPPUNIT_ASSERT(seconds < interval_seconds);
+}
+
+void
+TestDhtAnnounceScheduler::test_seed() {
+  DhtAnnounceScheduler scheduler;
+
+  DhtSearch lookup(nullptr, make_id(0x5a));
+
+  for (char c : {0x5b, 0x58, 0x7f})
+    lookup.add_contact(make_id(c), torrent::sa_make_inet_h(0x0a000000 + c, 6881).get());
+
+  scheduler.add_result(lookup.target(), lookup.begin(), lookup.end());
+
+  // A lookup for a nearby target starts with the nodes found above.
+  DhtSearch nearby(nullptr, make_id(0x5a, 1));
+  scheduler.seed(&nearby);
+
+  CPPUNIT_ASSERT(nearby.size() == 3);
+  CPPUNIT_ASSERT(nearby.begin().node()->id() == make_id(0x5b));
+  CPPUNIT_ASSERT(torrent::sa_equal(nearby.begin().node()->address(), torrent::sa_make_inet_h(0x0a00005b, 6881).get()));
+
+  // Results expire.
+  m_main_thread->test_add_cached_time(std::chrono::seconds(DhtAnnounceScheduler::result_timeout + 1));
+
+  DhtSearch later(nullptr, make_id(0x5a, 2));
+  scheduler.seed(&later);
+
+  CPPUNIT_ASSERT(later.empty());
+}
+
+// Results are kept while the uptime is still less than the result timeout.
+void
+TestDhtAnnounceScheduler::test_seed_startup() {
+  // The test thread adds a year to the cached time, start ten seconds after the epoch instead.
+  m_main_thread->test_set_cached_time(10s - 365 * 24h);
+
+  DhtAnnounceScheduler scheduler;
+
+  DhtSearch lookup(nullptr, make_id(0x5a));
+  lookup.add_contact(make_id(0x5b), torrent::sa_make_inet_h(0x0a00005b, 6881).get());
+
+  scheduler.add_result(lookup.target(), lookup.begin(), lookup.end());
+
+  DhtSearch nearby(nullptr, make_id(0x5a, 1));
+  scheduler.seed(&nearby);
+
+  CPPUNIT_ASSERT(nearby.size() == 1);
+}
@@ -0,0 +1,24 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestDhtAnnounceScheduler : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestDhtAnnounceScheduler);
+
+  CPPUNIT_TEST(test_order);
+  CPPUNIT_TEST(test_merge_and_erase);
+  CPPUNIT_TEST(test_budget);
+  CPPUNIT_TEST(test_limits);
+  CPPUNIT_TEST(test_drain);
+  CPPUNIT_TEST(test_seed);
+  CPPUNIT_TEST(test_seed_startup);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_order();
+  void test_merge_and_erase();
+  void test_budget();
+  void test_limits();
+  void test_drain();
+  void test_seed();
+  void test_seed_startup();
+};
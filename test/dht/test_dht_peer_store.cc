@@ -0,0 +1,215 @@
+#include "config.h"
+
+#include "test/dht/test_dht_peer_store.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cmath>
+#include <cstring>
+
+#include "dht/dht_peer_store.h"
+#include "net/address_list.h"
+#include "torrent/net/socket_address.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestDhtPeerStore);
+
+using torrent::DhtPeerStore;
+using torrent::DhtTracker;
+using torrent::HashString;
+
+static HashString
+make_hash(char c) {
+  HashString hash;
+  std::memset(hash.data(), c, hash.size());
+  return hash;
+}
+
+static torrent::sa_unique_ptr
+inet(uint32_t addr) {
+  return torrent::sa_make_inet_h(addr, 0);
+}
+
+static torrent::sa_unique_ptr
+inet6(uint32_t addr) {
+  auto sa = torrent::sa_make_inet6();
+  auto sin6 = reinterpret_cast<sockaddr_in6*>(sa.get());
+
+  sin6->sin6_addr.s6_addr[0] = 0x20;
+  sin6->sin6_addr.s6_addr[1] = 0x01;
+  sin6->sin6_addr.s6_addr[2] = 0x0d;
+  sin6->sin6_addr.s6_addr[3] = 0xb8;
+
+  uint32_t addr_n = htonl(addr);
+  std::memcpy(sin6->sin6_addr.s6_addr + 12, &addr_n, sizeof(addr_n));
+
+  return sa;
+}
+
+void
+TestDhtPeerStore::test_add_peer() {
+  DhtTracker tracker(make_hash('a'), AF_INET);
+
+  for (uint32_t i = 0; i != 100; i++)
+    CPPUNIT_ASSERT(tracker.add_peer(inet(0x0a000000 + i).get(), 6881, false) == 1);
+
+  CPPUNIT_ASSERT(tracker.size() == 100);
+
+  // Reannounces update the existing entry.
+  for (uint32_t i = 0; i != 100; i++)
+    CPPUNIT_ASSERT(tracker.add_peer(inet(0x0a000000 + i).get(), 6882, false) == 0);
+
+  CPPUNIT_ASSERT(tracker.size() == 100);
+  CPPUNIT_ASSERT(tracker.add_peer(inet(0x0a0000ff).get(), 0, false) == 0);
+
+  auto peers = tracker.get_peers(200);
+  CPPUNIT_ASSERT(peers.size() == 100 * 8);
+
+  // When full, the oldest peer is replaced.
+  m_main_thread->test_add_cached_time(10s);
+
+  tracker.add_peer(inet(0x0a000000).get(), 6881, false);
+  CPPUNIT_ASSERT(tracker.add_peer(inet(0x0b000000).get(), 6881, false, 100) == 0);
+  CPPUNIT_ASSERT(tracker.size() == 100);
+
+  CPPUNIT_ASSERT(tracker.add_peer(inet(0x0b000000).get(), 6881, false, 100) == 0);
+  CPPUNIT_ASSERT(tracker.add_peer(inet(0x0a000000).get(), 6881, false, 100) == 0);
+  CPPUNIT_ASSERT(tracker.size() == 100);
+}
+
+void
+TestDhtPeerStore::test_add_peer6() {
+  DhtTracker tracker(make_hash('a'), AF_INET6);
+
+  for (uint32_t i = 0; i != 100; i++)
+    CPPUNIT_ASSERT(tracker.add_peer(inet6(i).get(), 6881, false) == 1);
+
+  for (uint32_t i = 0; i != 100; i++)
+    CPPUNIT_ASSERT(tracker.add_peer(inet6(i).get(), 6882, false) == 0);
+
+  CPPUNIT_ASSERT(tracker.size() == 100);
+
+  // Values are 18 byte compact addresses, "18:" prefixed.
+  auto peers = tracker.get_peers(10);
+  CPPUNIT_ASSERT(peers.size() == 10 * 21);
+  CPPUNIT_ASSERT(std::memcmp(peers.data(), "18:\x20\x01\x0d\xb8", 7) == 0);
+
+  torrent::AddressList address_list;
+  address_list.parse_address_bencode(peers);
+
+  CPPUNIT_ASSERT(address_list.size() == 10);
+
+  for (const auto& address : address_list) {
+    CPPUNIT_ASSERT(address.sa.sa_family == AF_INET6);
+    CPPUNIT_ASSERT(address.inet6.sin6_port == 6882);
+  }
+
+  m_main_thread->test_add_cached_time(31min);
+
+  CPPUNIT_ASSERT(tracker.prune(30 * 60) == 100);
+  CPPUNIT_ASSERT(tracker.empty());
+}
+
+void
+TestDhtPeerStore::test_prune() {
+  DhtTracker tracker(make_hash('a'), AF_INET);
+
+  for (uint32_t i = 0; i != 50; i++)
+    tracker.add_peer(inet(0x0a000000 + i).get(), 6881, false);
+
+  m_main_thread->test_add_cached_time(20min);
+
+  for (uint32_t i = 50; i != 80; i++)
+    tracker.add_peer(inet(0x0a000000 + i).get(), 6881, false);
+
+  for (uint32_t i = 0; i != 10; i++)
+    tracker.add_peer(inet(0x0a000000 + i).get(), 6881, false);
+
+  CPPUNIT_ASSERT(tracker.prune(30 * 60) == 0);
+  CPPUNIT_ASSERT(tracker.size() == 80);
+
+  m_main_thread->test_add_cached_time(15min);
+
+  CPPUNIT_ASSERT(tracker.prune(30 * 60) == 40);
+  CPPUNIT_ASSERT(tracker.size() == 40);
+
+  // Remaining peers are still found through the index.
+  for (uint32_t i = 0; i != 10; i++)
+    CPPUNIT_ASSERT(tracker.add_peer(inet(0x0a000000 + i).get(), 6881, false) == 0);
+
+  for (uint32_t i = 50; i != 80; i++)
+    CPPUNIT_ASSERT(tracker.add_peer(inet(0x0a000000 + i).get(), 6881, false) == 0);
+
+  CPPUNIT_ASSERT(tracker.size() == 40);
+
+  m_main_thread->test_add_cached_time(31min);
+
+  CPPUNIT_ASSERT(tracker.prune(30 * 60) == 40);
+  CPPUNIT_ASSERT(tracker.empty());
+}
+
+void
+TestDhtPeerStore::test_bloom_filters() {
+  DhtTracker tracker(make_hash('a'), AF_INET);
+
+  char seeds[DhtTracker::size_bloom];
+  char peers[DhtTracker::size_bloom];
+
+  // SHA-1 of 192.0.2.0 starts with 99 b1 80 e2.
+  tracker.add_peer(inet(0xc0000200).get(), 6881, true);
+  tracker.get_bloom_filters(seeds, peers);
+
+  unsigned int first  = 0xb199 % 2048;
+  unsigned int second = 0xe280 % 2048;
+
+  CPPUNIT_ASSERT(seeds[first / 8] & (1 << (first % 8)));
+  CPPUNIT_ASSERT(seeds[second / 8] & (1 << (second % 8)));
+  CPPUNIT_ASSERT(std::count(peers, peers + sizeof(peers), 0) == sizeof(peers));
+
+  for (uint32_t i = 1; i != 256; i++)
+    tracker.add_peer(inet(0xc0000200 + i).get(), 6881, false, 256);
+
+  tracker.get_bloom_filters(seeds, peers);
+
+  unsigned int zero_bits = 0;
+
+  for (auto c : peers)
+    for (int b = 0; b != 8; b++)
+      zero_bits += !(c & (1 << b));
+
+  // Estimate from BEP 33, with m = 2048 and k = 2.
+  double estimate = std::log(zero_bits / 2048.0) / (2 * std::log(1 - 1 / 2048.0));
+
+  CPPUNIT_ASSERT(estimate > 240 && estimate < 270);
+}
+
+void
+TestDhtPeerStore::test_eviction() {
+  DhtPeerStore store;
+  store.set_max_total(100);
+
+  for (char c = 'a'; c != 'e'; c++)
+    for (uint32_t i = 0; i != 30; i++)
+      store.add_peer(make_hash(c), inet(0x0a000000 + i).get(), 6881, false);
+
+  // 'a' was the least recently announced when 'd' pushed the total above 100.
+  CPPUNIT_ASSERT(store.size() == 3);
+  CPPUNIT_ASSERT(store.num_peers() == 90);
+  CPPUNIT_ASSERT(store.find(make_hash('a')) == nullptr);
+  CPPUNIT_ASSERT(store.find(make_hash('d')) != nullptr);
+
+  // Announcing to 'b' makes 'c' the oldest.
+  store.add_peer(make_hash('b'), inet(0x0b000000).get(), 6881, false);
+
+  for (uint32_t i = 0; i != 10; i++)
+    store.add_peer(make_hash('e'), inet(0x0a000000 + i).get(), 6881, false);
+
+  CPPUNIT_ASSERT(store.find(make_hash('c')) == nullptr);
+  CPPUNIT_ASSERT(store.find(make_hash('b')) != nullptr);
+  CPPUNIT_ASSERT(store.num_peers() == 71);
+
+  m_main_thread->test_add_cached_time(31min);
+  store.prune(30 * 60);
+
+  CPPUNIT_ASSERT(store.empty());
+  CPPUNIT_ASSERT(store.num_peers() == 0);
+}
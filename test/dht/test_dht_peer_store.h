@@ -0,0 +1,20 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestDhtPeerStore : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestDhtPeerStore);
+
+  CPPUNIT_TEST(test_add_peer);
+  CPPUNIT_TEST(test_add_peer6);
+  CPPUNIT_TEST(test_prune);
+  CPPUNIT_TEST(test_bloom_filters);
+  CPPUNIT_TEST(test_eviction);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_add_peer();
+  void test_add_peer6();
+  void test_prune();
+  void test_bloom_filters();
+  void test_eviction();
+};
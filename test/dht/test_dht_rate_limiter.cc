@@ -0,0 +1,99 @@
+#include "config.h"
+
+#include "test/dht/test_dht_rate_limiter.h"
+
+#include "dht/dht_rate_limiter.h"
+#include "torrent/net/socket_address.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestDhtRateLimiter);
+
+using torrent::DhtRateLimiter;
+
+static unsigned int
+admit_count(DhtRateLimiter& limiter, const sockaddr* sa, unsigned int count) {
+  unsigned int admitted = 0;
+
+  for (unsigned int i = 0; i != count; i++)
+    admitted += limiter.admit(sa);
+
+  return admitted;
+}
+
+static torrent::sa_unique_ptr
+inet6(uint8_t subnet, uint8_t host) {
+  auto sa = torrent::sa_make_inet6();
+  auto addr = reinterpret_cast<sockaddr_in6*>(sa.get())->sin6_addr.s6_addr;
+
+  addr[0]  = 0x20;
+  addr[1]  = 0x01;
+  addr[2]  = 0x0d;
+  addr[3]  = 0xb8;
+  addr[7]  = subnet;
+  addr[15] = host;
+
+  return sa;
+}
+
+void
+TestDhtRateLimiter::test_host_limit() {
+  DhtRateLimiter limiter;
+  limiter.set_host_limit(10, 50);
+
+  auto first  = torrent::sa_make_inet_h(0x0a000001, 6881);
+  auto second = torrent::sa_make_inet_h(0x0b000001, 6881);
+
+  CPPUNIT_ASSERT(admit_count(limiter, first.get(), 100) == 50);
+  CPPUNIT_ASSERT(admit_count(limiter, second.get(), 10) == 10);
+
+  // The port is not part of the source.
+  CPPUNIT_ASSERT(!limiter.admit(torrent::sa_make_inet_h(0x0a000001, 6882).get()));
+
+  m_main_thread->test_add_cached_time(1s);
+  CPPUNIT_ASSERT(admit_count(limiter, first.get(), 100) == 10);
+
+  m_main_thread->test_add_cached_time(2s);
+  CPPUNIT_ASSERT(admit_count(limiter, first.get(), 100) == 20);
+
+  m_main_thread->test_add_cached_time(1min);
+  CPPUNIT_ASSERT(admit_count(limiter, first.get(), 100) == 50);
+
+  limiter.clear();
+  CPPUNIT_ASSERT(admit_count(limiter, first.get(), 100) == 50);
+}
+
+void
+TestDhtRateLimiter::test_prefix_limit() {
+  DhtRateLimiter limiter;
+  limiter.set_host_limit(10, 50);
+  limiter.set_prefix_limit(50, 250);
+
+  unsigned int admitted = 0;
+
+  // Hosts in one /24 share the prefix limit.
+  for (uint32_t i = 0; i != 20; i++)
+    admitted += admit_count(limiter, torrent::sa_make_inet_h(0x0a000100 + i, 6881).get(), 20);
+
+  CPPUNIT_ASSERT(admitted == 250);
+
+  CPPUNIT_ASSERT(!limiter.admit(torrent::sa_make_inet_h(0x0a0001ff, 6881).get()));
+  CPPUNIT_ASSERT(limiter.admit(torrent::sa_make_inet_h(0x0a000201, 6881).get()));
+}
+
+void
+TestDhtRateLimiter::test_inet6() {
+  DhtRateLimiter limiter;
+  limiter.set_host_limit(10, 50);
+  limiter.set_prefix_limit(50, 100);
+
+  // Addresses in one /64 are a single host.
+  CPPUNIT_ASSERT(admit_count(limiter, inet6(1, 1).get(), 40) == 40);
+  CPPUNIT_ASSERT(admit_count(limiter, inet6(1, 2).get(), 40) == 10);
+
+  // Other /64s in the /48 share the prefix limit.
+  CPPUNIT_ASSERT(admit_count(limiter, inet6(2, 1).get(), 100) == 50);
+
+  auto other = inet6(1, 1);
+  reinterpret_cast<sockaddr_in6*>(other.get())->sin6_addr.s6_addr[5] = 1;
+
+  CPPUNIT_ASSERT(admit_count(limiter, other.get(), 100) == 50);
+}
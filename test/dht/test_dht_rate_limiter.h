@@ -0,0 +1,16 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestDhtRateLimiter : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestDhtRateLimiter);
+
+  CPPUNIT_TEST(test_host_limit);
+  CPPUNIT_TEST(test_prefix_limit);
+  CPPUNIT_TEST(test_inet6);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_host_limit();
+  void test_prefix_limit();
+  void test_inet6();
+};
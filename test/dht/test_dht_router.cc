@@ -0,0 +1,273 @@
+#include "config.h"
+
+#include "test/dht/test_dht_router.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "dht/dht_bucket.h"
+#include "dht/dht_router.h"
+#include "torrent/exceptions.h"
+#include "torrent/object.h"
+#include "torrent/net/socket_address.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestDhtRouter);
+
+using torrent::HashString;
+
+static HashString
+make_id(char c) {
+  HashString id;
+  std::memset(id.data(), c, id.size());
+  return id;
+}
+
+static HashString
+make_random_id(uint32_t& seed) {
+  HashString id;
+
+  for (auto& c : id) {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char>(seed >> 16);
+  }
+
+  return id;
+}
+
+// Router with our ID set to 0x5a.. and the given number of pseudo-random nodes loaded from the
+// cache, all of which were seen just now.
+static std::unique_ptr<torrent::DhtRouter>
+make_router(unsigned int count) {
+  torrent::Object cache = torrent::Object::create_map();
+  cache.insert_key("self_id", make_id(0x5a).str());
+
+  auto&    nodes = cache.insert_key("nodes", torrent::Object::create_map());
+  uint32_t seed  = 1;
+
+  for (unsigned int i = 0; i != count; i++) {
+    auto& node = nodes.insert_key(make_random_id(seed).str(), torrent::Object::create_map());
+
+    node.insert_key("i", int64_t{0x0a000000} + i);
+    node.insert_key("p", int64_t{6881});
+    node.insert_key("t", torrent::this_thread::cached_seconds().count());
+  }
+
+  return std::make_unique<torrent::DhtRouter>(cache);
+}
+
+// IPv6 router with the same nodes as above cached in "nodes6", with addresses in 2001:db8::/32.
+static std::unique_ptr<torrent::DhtRouter>
+make_router6(unsigned int count) {
+  torrent::Object cache = torrent::Object::create_map();
+  cache.insert_key("self_id", make_id(0x5a).str());
+
+  auto&    nodes = cache.insert_key("nodes6", torrent::Object::create_map());
+  uint32_t seed  = 1;
+
+  for (unsigned int i = 0; i != count; i++) {
+    auto& node = nodes.insert_key(make_random_id(seed).str(), torrent::Object::create_map());
+
+    std::string addr(16, '\0');
+    addr[0] = 0x20;
+    addr[1] = 0x01;
+    addr[2] = 0x0d;
+    addr[3] = static_cast<char>(0xb8);
+    addr[14] = static_cast<char>(i >> 8);
+    addr[15] = static_cast<char>(i);
+
+    node.insert_key("a", addr);
+    node.insert_key("p", int64_t{6881});
+    node.insert_key("t", torrent::this_thread::cached_seconds().count());
+  }
+
+  return std::make_unique<torrent::DhtRouter>(cache, AF_INET6);
+}
+
+static std::vector<HashString>
+stored_ids(const torrent::DhtRouter& router) {
+  torrent::Object cache = torrent::Object::create_map();
+  router.store_cache(&cache);
+
+  const auto& table = cache.get_key_string(router.family() == AF_INET6 ? "routing_table6" : "routing_table");
+  unsigned int node_size = router.family() == AF_INET6 ? torrent::DhtNode::size_cache6 : torrent::DhtNode::size_cache;
+
+  std::vector<HashString> ids;
+
+  for (size_t pos = 1; pos < table.size(); pos += node_size)
+    ids.push_back(*HashString::cast_from(table.data() + pos));
+
+  return ids;
+}
+
+void
+TestDhtRouter::test_prefix_length() {
+  HashString one = make_id(0);
+  HashString two = make_id(0);
+
+  CPPUNIT_ASSERT(torrent::dht_prefix_length(one, two) == 160);
+
+  two[0] = 0x80;
+  CPPUNIT_ASSERT(torrent::dht_prefix_length(one, two) == 0);
+
+  two[0] = 0x01;
+  CPPUNIT_ASSERT(torrent::dht_prefix_length(one, two) == 7);
+
+  two[0] = 0;
+  two[19] = 0x01;
+  CPPUNIT_ASSERT(torrent::dht_prefix_length(one, two) == 159);
+
+  two[5] = 0x10;
+  CPPUNIT_ASSERT(torrent::dht_prefix_length(one, two) == 43);
+}
+
+void
+TestDhtRouter::test_routing_table() {
+  auto router = make_router(1000);
+  auto stats  = router->get_statistics();
+  auto ids    = stored_ids(*router);
+
+  // Buckets far from our ID fill up and reject further nodes, while our own bucket splits.
+  CPPUNIT_ASSERT(stats.num_buckets > 5);
+  CPPUNIT_ASSERT(stats.num_nodes == ids.size());
+  CPPUNIT_ASSERT(stats.num_nodes <= stats.num_buckets * torrent::DhtBucket::num_nodes);
+  CPPUNIT_ASSERT(stats.num_nodes > (stats.num_buckets - 1) * torrent::DhtBucket::num_nodes / 2);
+
+  for (const auto& id : ids) {
+    auto node = router->get_node(id);
+
+    CPPUNIT_ASSERT(node != nullptr);
+    CPPUNIT_ASSERT(node->id() == id);
+    CPPUNIT_ASSERT(node->bucket()->is_in_range(id));
+  }
+
+  CPPUNIT_ASSERT(router->get_node(router->id()) == router.get());
+  CPPUNIT_ASSERT(router->get_node(make_id(0x33)) == nullptr);
+}
+
+void
+TestDhtRouter::test_closest_nodes() {
+  auto     router = make_router(1000);
+  auto     ids    = stored_ids(*router);
+  uint32_t seed   = 12345;
+
+  std::vector<HashString> targets{router->id(), make_id(0x00), make_id(0x5b), make_id(char(0xff)), ids.front()};
+
+  for (int i = 0; i != 20; i++)
+    targets.push_back(make_random_id(seed));
+
+  for (const auto& target : targets) {
+    char buffer[torrent::DhtRouter::size_closest_nodes];
+    auto nodes = router->get_closest_nodes(target, buffer);
+
+    auto expected = ids;
+    std::sort(expected.begin(), expected.end(), [&target](const HashString& a, const HashString& b) {
+        return torrent::dht::DhtSearch::is_closer(a, b, target);
+      });
+
+    CPPUNIT_ASSERT(nodes.size() == torrent::DhtRouter::size_closest_nodes);
+
+    for (unsigned int i = 0; i != torrent::DhtBucket::num_nodes; i++)
+      CPPUNIT_ASSERT(*HashString::cast_from(nodes.data() + i * 26) == expected[i]);
+  }
+}
+
+void
+TestDhtRouter::test_routing_table6() {
+  auto router = make_router6(1000);
+  auto stats  = router->get_statistics();
+  auto ids    = stored_ids(*router);
+
+  CPPUNIT_ASSERT(router->family() == AF_INET6);
+  CPPUNIT_ASSERT(stats.num_buckets > 5);
+  CPPUNIT_ASSERT(stats.num_nodes == ids.size());
+
+  // Both families get the same table for the same IDs.
+  auto router4 = make_router(1000);
+  CPPUNIT_ASSERT(stored_ids(*router4) == ids);
+
+  torrent::Object cache = torrent::Object::create_map();
+  router->store_cache(&cache);
+
+  CPPUNIT_ASSERT(!cache.has_key("routing_table"));
+  CPPUNIT_ASSERT(cache.get_key_string("routing_table6").size() == 1 + ids.size() * torrent::DhtNode::size_cache6);
+
+  // An IPv4 router ignores the IPv6 nodes.
+  CPPUNIT_ASSERT(torrent::DhtRouter(cache).get_statistics().num_nodes == 0);
+
+  char buffer[torrent::DhtRouter::size_closest_nodes6];
+  auto nodes = router->get_closest_nodes(make_id(0x00), buffer);
+
+  auto expected = ids;
+  std::sort(expected.begin(), expected.end(), [](const HashString& a, const HashString& b) {
+      return torrent::dht::DhtSearch::is_closer(a, b, make_id(0x00));
+    });
+
+  CPPUNIT_ASSERT(nodes.size() == torrent::DhtRouter::size_closest_nodes6);
+
+  for (unsigned int i = 0; i != torrent::DhtBucket::num_nodes; i++) {
+    CPPUNIT_ASSERT(*HashString::cast_from(nodes.data() + i * 38) == expected[i]);
+    CPPUNIT_ASSERT(std::memcmp(nodes.data() + i * 38 + 20, "\x20\x01\x0d\xb8", 4) == 0);
+    CPPUNIT_ASSERT(std::memcmp(nodes.data() + i * 38 + 36, "\x1a\xe1", 2) == 0);
+  }
+}
+
+void
+TestDhtRouter::test_cache() {
+  auto router = make_router(1000);
+  auto ids    = stored_ids(*router);
+
+  router->get_node(ids.front())->add_rtt_sample(std::chrono::milliseconds(40));
+  router->get_node(ids.front())->add_rtt_sample(std::chrono::milliseconds(80));
+
+  torrent::Object cache = torrent::Object::create_map();
+  router->store_cache(&cache);
+
+  CPPUNIT_ASSERT(cache.get_key_string("routing_table").size() == 1 + ids.size() * torrent::DhtNode::size_cache);
+
+  // A subset of the nodes is also written in the old format for downgrades, starting with those
+  // with a known round trip time.
+  const auto& legacy = cache.get_key_map("nodes");
+
+  CPPUNIT_ASSERT(legacy.size() == 64);
+  CPPUNIT_ASSERT(legacy.find(ids.front().str()) != legacy.end());
+  CPPUNIT_ASSERT(legacy.find(ids.front().str())->second.get_key_value("i") ==
+                 ntohl(reinterpret_cast<const sockaddr_in*>(router->get_node(ids.front())->address())->sin_addr.s_addr));
+
+  torrent::Object legacy_cache = torrent::Object::create_map();
+  legacy_cache.insert_key("self_id", cache.get_key("self_id"));
+  legacy_cache.insert_key("nodes", cache.get_key("nodes"));
+
+  CPPUNIT_ASSERT(torrent::DhtRouter(legacy_cache).get_statistics().num_nodes == 64);
+
+  m_main_thread->test_add_cached_time(std::chrono::hours(1));
+
+  torrent::DhtRouter loaded(cache);
+  auto               loaded_ids = stored_ids(loaded);
+
+  CPPUNIT_ASSERT(loaded.id() == router->id());
+  CPPUNIT_ASSERT(loaded_ids.size() == ids.size());
+  CPPUNIT_ASSERT(std::is_permutation(ids.begin(), ids.end(), loaded_ids.begin()));
+
+  for (const auto& id : ids) {
+    auto node   = router->get_node(id);
+    auto cached = loaded.get_node(id);
+
+    CPPUNIT_ASSERT(torrent::sa_equal(cached->address(), node->address()));
+    CPPUNIT_ASSERT(cached->last_seen() == node->last_seen());
+    CPPUNIT_ASSERT(cached->rtt() == node->rtt());
+    CPPUNIT_ASSERT(cached->is_questionable());
+  }
+
+  CPPUNIT_ASSERT(loaded.get_node(ids.front())->rtt() == 45);
+  CPPUNIT_ASSERT(loaded.get_node(ids.back())->rtt() == 0);
+
+  // Tables of an unknown version are ignored, truncated ones are rejected.
+  std::string table = cache.get_key_string("routing_table");
+
+  cache.insert_key("routing_table", std::string(1, 2) + table.substr(1));
+  CPPUNIT_ASSERT(torrent::DhtRouter(cache).get_statistics().num_nodes == 0);
+
+  cache.insert_key("routing_table", table.substr(0, table.size() - 1));
+  CPPUNIT_ASSERT_THROW(torrent::DhtRouter router_truncated(cache), torrent::bencode_error);
+}
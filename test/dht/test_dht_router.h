@@ -0,0 +1,20 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestDhtRouter : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestDhtRouter);
+
+  CPPUNIT_TEST(test_prefix_length);
+  CPPUNIT_TEST(test_routing_table);
+  CPPUNIT_TEST(test_closest_nodes);
+  CPPUNIT_TEST(test_routing_table6);
+  CPPUNIT_TEST(test_cache);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_prefix_length();
+  void test_routing_table();
+  void test_closest_nodes();
+  void test_routing_table6();
+  void test_cache();
+};
@@ -0,0 +1,153 @@
+#include "config.h"
+
+#include "test/dht/test_dht_search.h"
+
+#include <cstring>
+#include <vector>
+
+#include "dht/transactions/dht_search.h"
+#include "torrent/net/socket_address.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestDhtSearch);
+
+using torrent::HashString;
+using torrent::dht::DhtSearch;
+
+namespace {
+
+class test_search : public DhtSearch {
+public:
+  test_search(const HashString& target) : DhtSearch(nullptr, target) {}
+
+  using DhtSearch::node_status;
+};
+
+}
+
+static HashString
+make_id(char c) {
+  HashString id;
+  std::memset(id.data(), c, id.size());
+  return id;
+}
+
+static HashString
+make_random_id(uint32_t& seed) {
+  HashString id;
+
+  for (auto& c : id) {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char>(seed >> 16);
+  }
+
+  return id;
+}
+
+static bool
+add_contact(DhtSearch& search, const HashString& id) {
+  return search.add_contact(id, torrent::sa_make_inet_h(0x0a000001, 6881).get());
+}
+
+static bool
+is_sorted(DhtSearch& search) {
+  auto itr = search.begin();
+
+  if (itr == search.end())
+    return true;
+
+  for (auto next = itr; ++next != search.end(); itr = next)
+    if (!DhtSearch::is_closer(itr.node()->id(), next.node()->id(), search.target()))
+      return false;
+
+  return true;
+}
+
+void
+TestDhtSearch::test_add_contact() {
+  test_search search(make_id(0x33));
+  uint32_t    seed = 1;
+
+  CPPUNIT_ASSERT(search.empty());
+  CPPUNIT_ASSERT(search.begin() == search.end());
+
+  std::vector<HashString> ids;
+
+  for (unsigned int i = 0; i != 40; i++) {
+    ids.push_back(make_random_id(seed));
+    CPPUNIT_ASSERT(add_contact(search, ids.back()));
+  }
+
+  CPPUNIT_ASSERT(search.size() == 40);
+  CPPUNIT_ASSERT(is_sorted(search));
+
+  for (auto& id : ids)
+    CPPUNIT_ASSERT(!add_contact(search, id));
+
+  CPPUNIT_ASSERT(search.size() == 40);
+
+  CPPUNIT_ASSERT(add_contact(search, make_id(0x33)));
+  CPPUNIT_ASSERT(search.begin().node()->id() == make_id(0x33));
+  CPPUNIT_ASSERT(is_sorted(search));
+}
+
+void
+TestDhtSearch::test_full() {
+  test_search search(make_id(0x00));
+  uint32_t    seed = 2;
+
+  for (unsigned int i = 0; i != DhtSearch::max_candidates; i++)
+    add_contact(search, make_random_id(seed));
+
+  CPPUNIT_ASSERT(search.size() == DhtSearch::max_candidates);
+
+  // The farthest possible node is dropped, a closer one replaces the farthest.
+  CPPUNIT_ASSERT(!add_contact(search, make_id(0xff)));
+  CPPUNIT_ASSERT(add_contact(search, make_id(0x00)));
+
+  CPPUNIT_ASSERT(search.size() == DhtSearch::max_candidates);
+  CPPUNIT_ASSERT(search.begin().node()->id() == make_id(0x00));
+  CPPUNIT_ASSERT(is_sorted(search));
+
+  for (unsigned int i = 0; i != 1000; i++)
+    add_contact(search, make_random_id(seed));
+
+  CPPUNIT_ASSERT(search.size() == DhtSearch::max_candidates);
+  CPPUNIT_ASSERT(is_sorted(search));
+}
+
+void
+TestDhtSearch::test_get_contact() {
+  test_search search(make_id(0x00));
+  uint32_t    seed = 3;
+
+  for (unsigned int i = 0; i != 30; i++)
+    add_contact(search, make_random_id(seed));
+
+  std::vector<DhtSearch::const_accessor> contacts;
+
+  for (auto itr = search.get_contact(); itr != search.end(); itr = search.get_contact())
+    contacts.push_back(itr);
+
+  // Trimmed to the closest nodes, with the three closest being contacted.
+  CPPUNIT_ASSERT(search.size() == DhtSearch::max_contacts);
+  CPPUNIT_ASSERT(contacts.size() == 3);
+  CPPUNIT_ASSERT(contacts[0] == search.begin());
+  CPPUNIT_ASSERT(contacts[1] == ++search.begin());
+
+  for (auto& contact : contacts)
+    CPPUNIT_ASSERT(contact.node()->is_active());
+
+  search.node_status(contacts[0].node(), true);
+  search.node_status(contacts[1].node(), false);
+  search.node_status(contacts[2].node(), true);
+
+  CPPUNIT_ASSERT(search.num_contacted() == 3);
+  CPPUNIT_ASSERT(search.num_replied() == 2);
+
+  auto next = search.get_contact();
+
+  CPPUNIT_ASSERT(next != search.end());
+  CPPUNIT_ASSERT(next.node() == (++++++search.begin()).node());
+
+  search.node_status(next.node(), false);
+}
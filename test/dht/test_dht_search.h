@@ -0,0 +1,16 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestDhtSearch : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestDhtSearch);
+
+  CPPUNIT_TEST(test_add_contact);
+  CPPUNIT_TEST(test_full);
+  CPPUNIT_TEST(test_get_contact);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_add_contact();
+  void test_full();
+  void test_get_contact();
+};
@@ -0,0 +1,175 @@
+#include "config.h"
+
+#include "test/dht/test_dht_simulation.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "dht/dht_bucket.h"
+#include "test/helpers/dht_simulation.h"
+
+// The simulation opens loopback sockets and takes a while, so it is kept out of the default
+// registry and only runs with 'make check-dht-simulation' or TEST_NAME=dht_simulation.
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(TestDhtSimulation, "dht_simulation");
+
+// The network is kept small by default, set TEST_DHT_SIMULATION_NODES to run it with more nodes
+// and print the statistics of each phase.
+static unsigned int
+simulation_size() {
+  const char* size = std::getenv("TEST_DHT_SIMULATION_NODES");
+
+  return size != nullptr ? std::max(std::atoi(size), 2) : 32;
+}
+
+static void
+print_statistics(const char* phase, const DhtSimulation& simulation) {
+  if (std::getenv("TEST_DHT_SIMULATION_NODES") == nullptr)
+    return;
+
+  auto stats = simulation.statistics();
+
+  std::cout << std::endl << phase << ": nodes:" << simulation.size()
+            << (simulation.is_shared_host() ? " shared_host" : "")
+            << " simulated:" << stats.seconds << "s wall:" << stats.wall_seconds << "s"
+            << " queries:" << stats.queries_received << " replies:" << stats.replies_received
+            << " dropped:" << stats.queries_dropped << " peers:" << stats.peers_received
+            << " queries/s:" << stats.queries_per_second() << std::endl;
+}
+
+void
+TestDhtSimulation::test_bootstrap() {
+  DhtSimulation simulation(m_main_thread.get(), simulation_size());
+  simulation.start();
+
+  // Every node should fill at least a bucket's worth of its routing table.
+  CPPUNIT_ASSERT(simulation.run([&] { return simulation.min_nodes() >= torrent::DhtBucket::num_nodes; }, 10min));
+
+  print_statistics("bootstrap", simulation);
+
+  auto stats = simulation.statistics();
+
+  CPPUNIT_ASSERT(stats.replies_received != 0);
+  CPPUNIT_ASSERT(stats.queries_dropped == 0);
+}
+
+void
+TestDhtSimulation::test_announce() {
+  DhtSimulation simulation(m_main_thread.get(), simulation_size());
+  simulation.start();
+
+  CPPUNIT_ASSERT(simulation.run([&] { return simulation.min_nodes() >= torrent::DhtBucket::num_nodes; }, 10min));
+
+  // Announce storm, half the nodes announce a torrent each.
+  unsigned int                     half = simulation.size() / 2;
+  std::vector<torrent::HashString> hashes;
+
+  simulation.reset_statistics();
+
+  for (unsigned int i = 0; i != half; i++) {
+    hashes.push_back(simulation.random_id());
+    simulation.node(i)->announce(hashes.back(), {}, false);
+  }
+
+  simulation.run_for(1min);
+  print_statistics("announce", simulation);
+
+  unsigned int stored = 0;
+
+  for (const auto& hash : hashes)
+    for (unsigned int i = 0; i != simulation.size(); i++)
+      if (simulation.node(i)->get_tracker(hash) != nullptr) {
+        stored++;
+        break;
+      }
+
+  CPPUNIT_ASSERT(stored == hashes.size());
+
+  // Lookup storm, the other half search for the announced torrents and record how many rounds
+  // each took to receive peers.
+  std::vector<unsigned int> rounds_to_peers(half, ~0u);
+
+  simulation.reset_statistics();
+
+  for (unsigned int i = 0; i != half; i++)
+    simulation.node(half + i)->announce(hashes[i], {}, false);
+
+  simulation.run([&] {
+      unsigned int remaining = 0;
+
+      for (unsigned int i = 0; i != half; i++) {
+        if (rounds_to_peers[i] == ~0u && simulation.node(half + i)->get_statistics().peers_received != 0)
+          rounds_to_peers[i] = simulation.statistics().rounds;
+
+        remaining += rounds_to_peers[i] == ~0u;
+      }
+
+      return remaining == 0;
+    }, 1min);
+
+  print_statistics("get_peers", simulation);
+
+  CPPUNIT_ASSERT(std::find(rounds_to_peers.begin(), rounds_to_peers.end(), ~0u) == rounds_to_peers.end());
+
+  std::sort(rounds_to_peers.begin(), rounds_to_peers.end());
+
+  if (std::getenv("TEST_DHT_SIMULATION_NODES") != nullptr)
+    std::cout << "get_peers: p50 rounds:" << rounds_to_peers[half / 2]
+              << " p99 rounds:" << rounds_to_peers[half * 99 / 100] << std::endl;
+}
+
+// A single node announcing many torrents, as a client seeding a large number of torrents does.
+// The announces are paced by the announce scheduler and seeded by earlier lookups.
+void
+TestDhtSimulation::test_announce_many() {
+  DhtSimulation simulation(m_main_thread.get(), simulation_size());
+  simulation.start();
+
+  CPPUNIT_ASSERT(simulation.run([&] { return simulation.min_nodes() >= torrent::DhtBucket::num_nodes; }, 10min));
+
+  std::vector<torrent::HashString> hashes;
+
+  simulation.reset_statistics();
+
+  for (unsigned int i = 0; i != simulation.size(); i++) {
+    hashes.push_back(simulation.random_id());
+    simulation.node(0)->announce(hashes.back(), {}, false);
+  }
+
+  simulation.run_for(5min);
+  print_statistics("announce_many", simulation);
+
+  for (const auto& hash : hashes) {
+    unsigned int stored = 0;
+
+    for (unsigned int i = 1; i != simulation.size(); i++)
+      stored += simulation.node(i)->get_tracker(hash) != nullptr;
+
+    CPPUNIT_ASSERT(stored != 0);
+  }
+
+  if (std::getenv("TEST_DHT_SIMULATION_NODES") != nullptr)
+    std::cout << "announce_many: queries sent per announce:"
+              << static_cast<double>(simulation.node(0)->get_statistics().queries_sent) / hashes.size() << std::endl;
+}
+
+// A node restarted from its cache pings the cached nodes in batches instead of bootstrapping, and
+// has its routing table confirmed within seconds.
+void
+TestDhtSimulation::test_warm_start() {
+  DhtSimulation simulation(m_main_thread.get(), simulation_size());
+  simulation.start();
+
+  CPPUNIT_ASSERT(simulation.run([&] { return simulation.min_nodes() >= torrent::DhtBucket::num_nodes; }, 10min));
+
+  auto num_nodes = simulation.node(0)->get_statistics().num_nodes;
+
+  simulation.restart(0);
+  simulation.reset_statistics();
+
+  CPPUNIT_ASSERT(simulation.node(0)->get_statistics().num_nodes == num_nodes);
+  CPPUNIT_ASSERT(simulation.run([&] { return simulation.node(0)->get_statistics().replies_received >= num_nodes; }, 10s));
+
+  print_statistics("warm_start", simulation);
+}
@@ -0,0 +1,18 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestDhtSimulation : public TestFixtureWithMainNetTrackerThread {
+  CPPUNIT_TEST_SUITE(TestDhtSimulation);
+
+  CPPUNIT_TEST(test_bootstrap);
+  CPPUNIT_TEST(test_announce);
+  CPPUNIT_TEST(test_announce_many);
+  CPPUNIT_TEST(test_warm_start);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_bootstrap();
+  void test_announce();
+  void test_announce_many();
+  void test_warm_start();
+};
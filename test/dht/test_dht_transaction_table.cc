@@ -0,0 +1,121 @@
+#include "config.h"
+
+#include "test/dht/test_dht_transaction_table.h"
+
+#include <cstring>
+#include <vector>
+
+#include "dht/dht_transaction_table.h"
+#include "torrent/net/socket_address.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestDhtTransactionTable);
+
+using torrent::DhtTransaction;
+using torrent::DhtTransactionPing;
+using torrent::HashString;
+
+static HashString
+make_id(char c) {
+  HashString id;
+  std::memset(id.data(), c, id.size());
+  return id;
+}
+
+void
+TestDhtTransactionTable::test_insert_erase() {
+  torrent::DhtTransactionTable table;
+  std::vector<DhtTransaction*> transactions;
+
+  for (unsigned int i = 0; i != 500; i++) {
+    auto sa          = torrent::sa_make_inet_h(0x0a000000 + i, 6881);
+    auto transaction = table.emplace<DhtTransactionPing>(i, make_id('a'), sa.get());
+
+    CPPUNIT_ASSERT(transaction != nullptr);
+    CPPUNIT_ASSERT(transaction->transaction_id() == static_cast<int>(i & 0xff));
+    CPPUNIT_ASSERT(transaction->key() == DhtTransaction::key(sa.get(), i & 0xff));
+
+    transactions.push_back(transaction);
+  }
+
+  CPPUNIT_ASSERT(table.size() == 500);
+  CPPUNIT_ASSERT(table.capacity() == 512);
+
+  for (unsigned int i = 0; i < 500; i += 2)
+    table.erase(transactions[i]);
+
+  CPPUNIT_ASSERT(table.size() == 250);
+
+  for (unsigned int i = 0; i != 500; i++) {
+    auto sa = torrent::sa_make_inet_h(0x0a000000 + i, 6881);
+
+    if (i % 2 == 0) {
+      CPPUNIT_ASSERT(table.find(DhtTransaction::key(sa.get(), i & 0xff)) == nullptr);
+      CPPUNIT_ASSERT(!table.has_address(sa.get()));
+    } else {
+      CPPUNIT_ASSERT(table.find(DhtTransaction::key(sa.get(), i & 0xff)) == transactions[i]);
+      CPPUNIT_ASSERT(table.has_address(sa.get()));
+    }
+  }
+
+  // Freed slots are reused.
+  for (unsigned int i = 0; i < 500; i += 2)
+    table.emplace<DhtTransactionPing>(i, make_id('a'), torrent::sa_make_inet_h(0x0a000000 + i, 6881).get());
+
+  CPPUNIT_ASSERT(table.size() == 500);
+  CPPUNIT_ASSERT(table.capacity() == 512);
+
+  table.clear();
+
+  CPPUNIT_ASSERT(table.empty());
+  CPPUNIT_ASSERT(table.front_timeout() == nullptr);
+}
+
+void
+TestDhtTransactionTable::test_transaction_ids() {
+  torrent::DhtTransactionTable table;
+  auto sa = torrent::sa_make_inet_h(0x0a000001, 6881);
+
+  for (unsigned int i = 0; i != 256; i++) {
+    auto transaction = table.emplace<DhtTransactionPing>(250, make_id('a'), sa.get());
+
+    CPPUNIT_ASSERT(transaction != nullptr);
+    CPPUNIT_ASSERT(transaction->transaction_id() == static_cast<int>((250 + i) & 0xff));
+  }
+
+  CPPUNIT_ASSERT(table.emplace<DhtTransactionPing>(0, make_id('a'), sa.get()) == nullptr);
+  CPPUNIT_ASSERT(table.size() == 256);
+
+  table.erase(table.find(DhtTransaction::key(sa.get(), 3)));
+
+  auto transaction = table.emplace<DhtTransactionPing>(0, make_id('a'), sa.get());
+
+  CPPUNIT_ASSERT(transaction != nullptr);
+  CPPUNIT_ASSERT(transaction->transaction_id() == 3);
+}
+
+void
+TestDhtTransactionTable::test_timeouts() {
+  torrent::DhtTransactionTable table;
+  std::vector<DhtTransaction*> transactions;
+
+  for (unsigned int i = 0; i != 10; i++) {
+    transactions.push_back(table.emplace<DhtTransactionPing>(0, make_id('a'), torrent::sa_make_inet_h(0x0a000000 + i, 6881).get()));
+    m_main_thread->test_add_cached_time(1s);
+  }
+
+  CPPUNIT_ASSERT(table.front_quick_timeout() == nullptr);
+  CPPUNIT_ASSERT(table.front_timeout() == transactions[0]);
+
+  table.erase(transactions[0]);
+  table.erase(transactions[2]);
+
+  CPPUNIT_ASSERT(table.front_timeout() == transactions[1]);
+
+  table.erase(transactions[1]);
+
+  CPPUNIT_ASSERT(table.front_timeout() == transactions[3]);
+
+  table.erase_if([](DhtTransaction* t) { return t->address()->sa_family == AF_INET; });
+
+  CPPUNIT_ASSERT(table.empty());
+}
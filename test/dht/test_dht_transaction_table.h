@@ -0,0 +1,16 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestDhtTransactionTable : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestDhtTransactionTable);
+
+  CPPUNIT_TEST(test_insert_erase);
+  CPPUNIT_TEST(test_transaction_ids);
+  CPPUNIT_TEST(test_timeouts);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_insert_erase();
+  void test_transaction_ids();
+  void test_timeouts();
+};
@@ -0,0 +1,219 @@
+#include "config.h"
+
+#include "test/download/test_endgame.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "download/delegator.h"
+#include "download/endgame.h"
+#include "protocol/peer_chunks.h"
+#include "test/helpers/network.h"
+#include "torrent/data/block.h"
+#include "torrent/data/block_list.h"
+#include "torrent/data/block_transfer.h"
+#include "torrent/peer/peer_info.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestEndgame);
+
+namespace {
+
+constexpr uint32_t block_size = torrent::Delegator::block_size;
+
+// Peers with a fixed download rate, in bytes per second, and all pieces.
+struct test_peer {
+  test_peer(const char* address, uint32_t r) :
+      info(wrap_ai_get_first_sa(address, "5000").get()),
+      rate(r) {
+
+    chunks.set_peer_info(&info);
+    chunks.bitfield()->set_size_bits(8);
+    chunks.bitfield()->allocate();
+    chunks.bitfield()->set_all();
+  }
+
+  torrent::PeerInfo   info;
+  torrent::PeerChunks chunks;
+  uint32_t            rate;
+};
+
+struct test_delegator {
+  test_delegator() {
+    delegator.transfer_list()->slot_canceled() = [](auto) {};
+    delegator.transfer_list()->slot_queued()   = [](auto) {};
+
+    delegator.endgame()->slot_peer_rate() = [this](torrent::PeerInfo* peer_info) { return rates[peer_info]; };
+  }
+
+  ~test_delegator() {
+    for (auto transfer : transfers)
+      torrent::Block::release(transfer);
+
+    delegator.transfer_list()->clear();
+  }
+
+  void add_peer(test_peer& peer) { rates[&peer.info] = peer.rate; }
+
+  torrent::BlockList* insert(uint32_t index, uint32_t blocks) {
+    auto block_list = *delegator.transfer_list()->insert(torrent::Piece(index, 0, blocks * block_size), block_size);
+
+    block_list->set_priority(torrent::PRIORITY_NORMAL);
+    return block_list;
+  }
+
+  torrent::BlockTransfer* queue(torrent::Block* block, test_peer& peer) {
+    return transfers.emplace_back(block->insert(&peer.info));
+  }
+
+  std::vector<torrent::BlockTransfer*> delegate(test_peer& peer, uint32_t max_pieces = 16) {
+    std::vector<torrent::BlockTransfer*> result;
+
+    delegator.endgame()->delegate(result, max_pieces, &peer.chunks);
+    transfers.insert(transfers.end(), result.begin(), result.end());
+
+    return result;
+  }
+
+  torrent::Delegator                   delegator;
+  std::map<torrent::PeerInfo*, uint32_t> rates;
+  std::vector<torrent::BlockTransfer*> transfers;
+};
+
+} // namespace
+
+void
+TestEndgame::test_order() {
+  test_delegator td;
+  test_peer      slow("10.0.0.1", block_size);
+  test_peer      fast("10.0.0.2", block_size * 10);
+
+  td.add_peer(slow);
+  td.add_peer(fast);
+
+  auto block_list = td.insert(0, 4);
+  auto blocks     = &(*block_list)[0];
+
+  td.queue(&blocks[0], slow);
+  td.queue(&blocks[1], fast);
+
+  td.delegator.set_aggressive(true);
+
+  // Blocks without transfers first, then by descending estimated time.
+  auto& index = td.delegator.endgame()->index();
+
+  CPPUNIT_ASSERT(index.size() == 4);
+  CPPUNIT_ASSERT(index[0].first == torrent::Endgame::time_unknown && index[0].second == &blocks[2]);
+  CPPUNIT_ASSERT(index[1].first == torrent::Endgame::time_unknown && index[1].second == &blocks[3]);
+  CPPUNIT_ASSERT(index[2].first == 1000 && index[2].second == &blocks[0]);
+  CPPUNIT_ASSERT(index[3].first == 100 && index[3].second == &blocks[1]);
+}
+
+void
+TestEndgame::test_delegate() {
+  test_delegator td;
+  test_peer      slow("10.0.0.1", block_size);
+  test_peer      medium("10.0.0.2", block_size * 2);
+  test_peer      fast("10.0.0.3", block_size * 10);
+
+  td.add_peer(slow);
+  td.add_peer(medium);
+  td.add_peer(fast);
+
+  auto block_list = td.insert(0, 2);
+  auto blocks     = &(*block_list)[0];
+
+  td.queue(&blocks[0], slow);
+  td.queue(&blocks[1], slow);
+
+  td.delegator.set_aggressive(true);
+
+  // The medium peer finishes either block sooner, but is limited to max_pieces.
+  auto first = td.delegate(medium, 1);
+
+  CPPUNIT_ASSERT(first.size() == 1);
+  CPPUNIT_ASSERT(first[0]->block() == &blocks[0]);
+
+  // The index is updated as soon as the duplicate is handed out, so the next peer only gets the
+  // remaining slow block, and the medium peer is not handed its own block again.
+  auto& index = td.delegator.endgame()->index();
+
+  CPPUNIT_ASSERT(index[0].second == &blocks[1] && index[0].first == 1000);
+  CPPUNIT_ASSERT(index[1].second == &blocks[0] && index[1].first == 500);
+
+  auto second = td.delegate(medium);
+
+  CPPUNIT_ASSERT(second.size() == 1);
+  CPPUNIT_ASSERT(second[0]->block() == &blocks[1]);
+
+  // Nothing is left that the medium or slow peers would finish sooner, the fast peer gets both.
+  CPPUNIT_ASSERT(td.delegate(medium).empty());
+  CPPUNIT_ASSERT(td.delegate(slow).empty());
+  CPPUNIT_ASSERT(td.delegate(fast).size() == 2);
+  CPPUNIT_ASSERT(td.delegate(fast).empty());
+}
+
+void
+TestEndgame::test_delegate_unknown_rate() {
+  test_delegator td;
+  test_peer      slow("10.0.0.1", block_size);
+  test_peer      unknown("10.0.0.2", 0);
+
+  td.add_peer(slow);
+  td.add_peer(unknown);
+
+  auto block_list = td.insert(0, 2);
+  auto blocks     = &(*block_list)[0];
+
+  td.queue(&blocks[0], slow);
+  td.delegator.set_aggressive(true);
+
+  // A peer without a measured rate only gets blocks nobody is making progress on.
+  auto result = td.delegate(unknown);
+
+  CPPUNIT_ASSERT(result.size() == 1);
+  CPPUNIT_ASSERT(result[0]->block() == &blocks[1]);
+
+  // No more than max_transfers non-stalled transfers per block.
+  std::vector<std::unique_ptr<test_peer>> peers;
+
+  for (unsigned int i = 0; i != torrent::Endgame::max_transfers; i++) {
+    peers.push_back(std::make_unique<test_peer>(("10.0.1." + std::to_string(i + 1)).c_str(), block_size * 100 * (i + 1)));
+    td.add_peer(*peers.back());
+    td.delegate(*peers.back());
+  }
+
+  CPPUNIT_ASSERT(blocks[0].size_not_stalled() == torrent::Endgame::max_transfers);
+  CPPUNIT_ASSERT(blocks[1].size_not_stalled() == torrent::Endgame::max_transfers);
+}
+
+void
+TestEndgame::test_invalidation() {
+  test_delegator td;
+
+  td.insert(0, 2);
+
+  // Block lists are only followed in aggressive mode.
+  CPPUNIT_ASSERT(td.delegator.endgame()->index().empty());
+
+  td.delegator.set_aggressive(true);
+  CPPUNIT_ASSERT(td.delegator.endgame()->index().size() == 2);
+
+  auto block_list = td.insert(1, 3);
+  CPPUNIT_ASSERT(td.delegator.endgame()->index().size() == 5);
+
+  td.delegator.transfer_list()->erase(td.delegator.transfer_list()->find(0));
+
+  auto& index = td.delegator.endgame()->index();
+
+  CPPUNIT_ASSERT(index.size() == 3);
+  CPPUNIT_ASSERT(std::all_of(index.begin(), index.end(), [block_list](auto& v) { return v.second->parent() == block_list; }));
+
+  td.delegator.transfer_list()->clear();
+  CPPUNIT_ASSERT(td.delegator.endgame()->index().empty());
+
+  td.insert(2, 1);
+  td.delegator.set_aggressive(false);
+  CPPUNIT_ASSERT(td.delegator.endgame()->index().empty());
+}
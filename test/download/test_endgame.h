@@ -0,0 +1,18 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestEndgame : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestEndgame);
+
+  CPPUNIT_TEST(test_order);
+  CPPUNIT_TEST(test_delegate);
+  CPPUNIT_TEST(test_delegate_unknown_rate);
+  CPPUNIT_TEST(test_invalidation);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_order();
+  void test_delegate();
+  void test_delegate_unknown_rate();
+  void test_invalidation();
+};
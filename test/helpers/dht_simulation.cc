@@ -0,0 +1,189 @@
+#include "config.h"
+
+#include "test/helpers/dht_simulation.h"
+
+#include <algorithm>
+
+#include "test/helpers/test_main_thread.h"
+#include "torrent/net/fd.h"
+#include "torrent/object.h"
+#include "torrent/runtime/network_config.h"
+#include "torrent/runtime/network_manager.h"
+#include "torrent/system/poll.h"
+
+namespace {
+
+constexpr auto         round_step     = std::chrono::milliseconds(50);
+constexpr unsigned int max_round_poll = 64;
+
+// Far above what the whole network sends, for when every query comes from the same source.
+constexpr unsigned int shared_host_rate  = 1 << 15;
+constexpr unsigned int shared_host_burst = 1 << 15;
+
+// Only Linux routes all of 127.0.0.0/8 to loopback by default, BSD and macOS just have 127.0.0.1.
+bool
+has_loopback_net() {
+  int fd = torrent::fd_open_family(torrent::fd_flag_datagram, AF_INET);
+
+  if (fd == -1)
+    return false;
+
+  bool result = torrent::fd_bind(fd, torrent::sa_make_inet_h(0x7f000101, 0).get());
+
+  torrent::fd_close(fd);
+  return result;
+}
+
+} // namespace
+
+DhtSimulation::DhtSimulation(TestMainThread* main_thread, unsigned int size, uint32_t seed)
+  : m_main_thread(main_thread),
+    m_seed(seed),
+    m_shared_host(!has_loopback_net()) {
+
+  for (unsigned int i = 0; i != size; i++) {
+    auto id = random_id();
+
+    m_nodes.push_back(std::make_unique<torrent::DhtRouter>(torrent::Object::create_map(), AF_INET, &id));
+    m_addresses.emplace_back();
+  }
+}
+
+DhtSimulation::~DhtSimulation() {
+  for (auto& node : m_nodes)
+    node->stop();
+}
+
+void
+DhtSimulation::start() {
+  // Announces report the listen port, the simulated peers all use the DHT port.
+  torrent::runtime::network_manager()->set_listen_port(listen_port);
+
+  for (unsigned int i = 0; i != size(); i++)
+    start_node(i);
+
+  // Bootstrapping every node from the same node would overflow its socket buffer, as all the
+  // pings arrive before it gets to read them.
+  for (unsigned int i = 1; i != size(); i++) {
+    m_seed = m_seed * 1103515245 + 12345;
+    auto bootstrap = address((m_seed >> 16) % i);
+
+    m_nodes[i]->contact(bootstrap, torrent::sa_port(bootstrap));
+  }
+}
+
+void
+DhtSimulation::restart(unsigned int index) {
+  auto cache = torrent::Object::create_map();
+
+  m_nodes[index]->store_cache(&cache);
+  m_nodes[index]->stop();
+
+  m_nodes[index] = std::make_unique<torrent::DhtRouter>(cache, AF_INET);
+  start_node(index);
+}
+
+bool
+DhtSimulation::run(const std::function<bool ()>& pred, std::chrono::seconds limit) {
+  auto start = clock_type::now();
+  auto last  = m_rounds + limit / round_step;
+  bool done;
+
+  while (!(done = pred()) && m_rounds != last)
+    run_round();
+
+  m_wall_time += clock_type::now() - start;
+  return done;
+}
+
+void
+DhtSimulation::run_for(std::chrono::seconds duration) {
+  run([] { return false; }, duration);
+}
+
+unsigned int
+DhtSimulation::min_nodes() const {
+  unsigned int result = ~0u;
+
+  for (const auto& node : m_nodes)
+    result = std::min(result, node->get_statistics().num_nodes);
+
+  return result;
+}
+
+DhtSimulation::statistics_type
+DhtSimulation::statistics() const {
+  statistics_type result;
+
+  result.rounds       = m_rounds;
+  result.seconds      = std::chrono::duration<double>(m_rounds * round_step).count();
+  result.wall_seconds = std::chrono::duration<double>(m_wall_time).count();
+
+  for (const auto& node : m_nodes) {
+    auto stats = node->get_statistics();
+
+    result.queries_sent     += stats.queries_sent;
+    result.queries_received += stats.queries_received;
+    result.replies_received += stats.replies_received;
+    result.queries_dropped  += stats.queries_dropped;
+    result.peers_received   += stats.peers_received;
+  }
+
+  return result;
+}
+
+void
+DhtSimulation::reset_statistics() {
+  for (auto& node : m_nodes)
+    node->reset_statistics();
+
+  m_rounds    = 0;
+  m_wall_time = {};
+}
+
+torrent::HashString
+DhtSimulation::random_id() {
+  torrent::HashString id;
+
+  for (auto& c : id) {
+    m_seed = m_seed * 1103515245 + 12345;
+    c = static_cast<char>(m_seed >> 16);
+  }
+
+  return id;
+}
+
+void
+DhtSimulation::start_node(unsigned int index) {
+  auto previous_bind = torrent::runtime::network_config()->bind_inet_address();
+
+  auto host          = m_shared_host ? 0x7f000001 : 0x7f000001 + ((index + 1) << 8);
+
+  torrent::runtime::network_config()->set_bind_inet_address(torrent::sa_make_inet_h(host, 0).get());
+  m_nodes[index]->start(0);
+
+  torrent::runtime::network_config()->set_bind_inet_address(previous_bind.get());
+
+  auto server = m_nodes[index]->server();
+
+  if (m_shared_host) {
+    server->rate_limiter()->set_host_limit(shared_host_rate, shared_host_burst);
+    server->rate_limiter()->set_prefix_limit(shared_host_rate, shared_host_burst);
+  }
+
+  m_addresses[index] = torrent::sa_copy(torrent::fd_get_socket_name(server->file_descriptor()).get());
+}
+
+void
+DhtSimulation::run_round() {
+  // Loopback delivers datagrams as they are sent, so polling until nothing is ready handles the
+  // queries and replies that follow each other without waiting on a timeout.
+  for (unsigned int i = 0; i != max_round_poll; i++)
+    if (torrent::this_thread::poll()->do_poll(std::chrono::microseconds(0)) == 0)
+      break;
+
+  m_main_thread->test_add_cached_time(round_step);
+  m_main_thread->test_process_events_without_cached_time();
+
+  m_rounds++;
+}
@@ -0,0 +1,94 @@
+#ifndef LIBTORRENT_HELPER_DHT_SIMULATION_H
+#define LIBTORRENT_HELPER_DHT_SIMULATION_H
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "dht/dht_router.h"
+#include "torrent/net/socket_address.h"
+
+class TestMainThread;
+
+// Network of DHT nodes running in the test thread, each a DhtRouter with its own server socket
+// bound to an ephemeral port on loopback. Where all of 127.0.0.0/8 is usable every node gets its
+// own /24, so that the per source rate limits and transactions behave as they would with distinct
+// hosts.
+//
+// Otherwise all nodes share 127.0.0.1 with the rate limits raised. Nodes then only have a single
+// host's worth of transactions and pings with each other, which suits the small default network.
+//
+// The event loop is driven by run(), which polls the sockets and advances the cached time by a
+// fixed step per round, so protocol timeouts follow simulated time while the statistics also
+// record the wall clock time spent.
+
+class DhtSimulation {
+public:
+  using clock_type = std::chrono::steady_clock;
+
+  // The port reported by announces, nothing is bound to it.
+  static constexpr uint16_t listen_port = 6881;
+
+  struct statistics_type {
+    unsigned int        rounds{};
+    double              seconds{};        // Simulated time.
+    double              wall_seconds{};
+
+    uint64_t            queries_sent{};
+    uint64_t            queries_received{};
+    uint64_t            replies_received{};
+    uint64_t            queries_dropped{};
+    uint64_t            peers_received{};
+
+    double              queries_per_second() const { return wall_seconds > 0 ? queries_received / wall_seconds : 0; }
+  };
+
+  DhtSimulation(TestMainThread* main_thread, unsigned int size, uint32_t seed = 1);
+  ~DhtSimulation();
+
+  size_t              size() const                  { return m_nodes.size(); }
+  bool                is_shared_host() const        { return m_shared_host; }
+
+  torrent::DhtRouter* node(unsigned int index)      { return m_nodes[index].get(); }
+
+  // Only valid once the node is started.
+  const sockaddr*     address(unsigned int index)   { return m_addresses[index].get(); }
+
+  // Starts all nodes, and has each contact a random node started before it to bootstrap from.
+  void                start();
+
+  // Replaces the node with one loaded from its cache, started without contacting other nodes.
+  void                restart(unsigned int index);
+
+  // Runs rounds until 'pred' returns true or 'limit' of simulated time has passed, returns the
+  // value of the predicate.
+  bool                run(const std::function<bool ()>& pred, std::chrono::seconds limit);
+  void                run_for(std::chrono::seconds duration);
+
+  // Smallest routing table in the network.
+  unsigned int        min_nodes() const;
+
+  // Sum of the server statistics of all nodes, and the time spent in run() since the last
+  // reset.
+  statistics_type     statistics() const;
+  void                reset_statistics();
+
+  torrent::HashString random_id();
+
+private:
+  void                start_node(unsigned int index);
+  void                run_round();
+
+  TestMainThread*     m_main_thread;
+  uint32_t            m_seed;
+  bool                m_shared_host;
+
+  std::vector<std::unique_ptr<torrent::DhtRouter>> m_nodes;
+  std::vector<torrent::sa_unique_ptr>              m_addresses;
+
+  unsigned int        m_rounds{};
+  clock_type::duration m_wall_time{};
+};
+
+#endif
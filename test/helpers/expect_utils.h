@@ -1,13 +1,18 @@
-#ifndef LIBTORRENT_HELPER_EXPECT_UTILS_H
-#define LIBTORRENT_HELPER_EXPECT_UTILS_H
-
-#include "helpers/mock_function.h"
-
-#include <torrent/utils/random.h>
-
-inline void
-expect_random_uniform_uint16(uint16_t result, uint16_t first, uint16_t last) {
-  mock_expect(&torrent::random_uniform_uint16, result, first, last);
-}
-
-#endif
+#ifndef LIBTORRENT_HELPER_EXPECT_UTILS_H
+#define LIBTORRENT_HELPER_EXPECT_UTILS_H
+
+#include "helpers/mock_function.h"
+
+#include <torrent/utils/random.h>
+
+inline void
+expect_random_uniform_uint16(uint16_t result, uint16_t first, uint16_t last) {
+  mock_expect(&torrent::random_uniform_uint16, result, first, last);
+}
+
+inline void
+expect_random_uniform_uint32(uint32_t result, uint32_t first, uint32_t last) {
+  mock_expect(&torrent::random_uniform_uint32, result, first, last);
+}
+
+#endif
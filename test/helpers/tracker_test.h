@@ -16,7 +16,8 @@ public:
 
   bool                is_open() const          { return m_open; }
 
-  torrent::tracker_enum type() const override  { return (torrent::tracker_enum)(torrent::TRACKER_DHT + 1); }
+  torrent::tracker_enum type() const override  { return m_type; }
+  void                set_type(torrent::tracker_enum t) { m_type = t; }
 
   int                 requesting_state() const { return m_requesting_state; }
 
@@ -62,6 +63,8 @@ private:
   align_cacheline std::atomic<bool> m_busy{false};
   std::atomic<bool>   m_open{false};
   std::atomic<int>    m_requesting_state{-1};
+
+  torrent::tracker_enum m_type{static_cast<torrent::tracker_enum>(torrent::TRACKER_DHT + 1)};
 };
 
 inline
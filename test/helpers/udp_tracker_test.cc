@@ -0,0 +1,125 @@
+#include "config.h"
+
+#include "test/helpers/udp_tracker_test.h"
+
+#include <cerrno>
+#include <sys/socket.h>
+
+#include "torrent/exceptions.h"
+#include "torrent/net/fd.h"
+
+namespace {
+
+uint64_t
+read_be(const char* data, unsigned int size) {
+  uint64_t result{};
+
+  for (unsigned int i = 0; i != size; i++)
+    result = (result << 8) | static_cast<uint8_t>(data[i]);
+
+  return result;
+}
+
+void
+write_be(std::string& data, uint64_t value, unsigned int size) {
+  for (unsigned int i = size; i != 0; i--)
+    data.push_back(static_cast<char>(value >> ((i - 1) * 8)));
+}
+
+} // namespace
+
+UdpTrackerTest::UdpTrackerTest() {
+  m_fd = torrent::fd_open_family(torrent::fd_flag_datagram | torrent::fd_flag_nonblock, AF_INET);
+
+  if (m_fd == -1)
+    throw torrent::internal_error("UdpTrackerTest could not open socket.");
+
+  if (!torrent::fd_bind(m_fd, torrent::sa_make_inet_h(0x7f000001, 0).get()))
+    throw torrent::internal_error("UdpTrackerTest could not bind socket.");
+
+  m_port = torrent::sa_port(torrent::fd_get_socket_name(m_fd).get());
+}
+
+UdpTrackerTest::~UdpTrackerTest() {
+  torrent::fd_close(m_fd);
+}
+
+std::vector<UdpTrackerTest::packet>
+UdpTrackerTest::receive() {
+  std::vector<packet> result;
+
+  while (true) {
+    char             buffer[2048];
+    sockaddr_storage source{};
+    socklen_t        source_length = sizeof(source);
+
+    auto size = ::recvfrom(m_fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&source), &source_length);
+
+    if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return result;
+
+    if (size == -1)
+      throw torrent::internal_error("UdpTrackerTest::receive() recvfrom failed.");
+
+    if (size < 16)
+      continue;
+
+    packet p;
+    p.source         = torrent::sa_copy(reinterpret_cast<sockaddr*>(&source));
+    p.connection_id  = read_be(buffer, 8);
+    p.action         = read_be(buffer + 8, 4);
+    p.transaction_id = read_be(buffer + 12, 4);
+    p.payload.assign(buffer + 16, size - 16);
+
+    result.push_back(std::move(p));
+  }
+}
+
+void
+UdpTrackerTest::reply_connect(const packet& request, uint64_t connection_id) {
+  std::string data;
+  write_be(data, connection_id, 8);
+
+  send(request, action_connect, data);
+}
+
+// Replies with no peers.
+
+void
+UdpTrackerTest::reply_announce(const packet& request, uint32_t interval) {
+  std::string data;
+  write_be(data, interval, 4);
+  write_be(data, 0, 4);
+  write_be(data, 0, 4);
+
+  send(request, action_announce, data);
+}
+
+void
+UdpTrackerTest::reply_scrape(const packet& request, const std::vector<scrape_entry>& entries) {
+  std::string data;
+
+  for (auto [seeders, completed, leechers] : entries) {
+    write_be(data, seeders, 4);
+    write_be(data, completed, 4);
+    write_be(data, leechers, 4);
+  }
+
+  send(request, action_scrape, data);
+}
+
+void
+UdpTrackerTest::reply_error(const packet& request, const std::string& msg) {
+  send(request, action_error, msg);
+}
+
+void
+UdpTrackerTest::send(const packet& request, uint32_t action, const std::string& data) {
+  std::string buffer;
+  write_be(buffer, action, 4);
+  write_be(buffer, request.transaction_id, 4);
+  buffer += data;
+
+  if (::sendto(m_fd, buffer.data(), buffer.size(), 0, request.source.get(), torrent::sa_length(request.source.get())) == -1)
+    throw torrent::internal_error("UdpTrackerTest::send() sendto failed.");
+}
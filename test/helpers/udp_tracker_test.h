@@ -0,0 +1,55 @@
+#ifndef LIBTORRENT_HELPER_UDP_TRACKER_TEST_H
+#define LIBTORRENT_HELPER_UDP_TRACKER_TEST_H
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "torrent/net/socket_address.h"
+
+// BEP 15 tracker bound to an ephemeral port on 127.0.0.1, read and answered explicitly by the
+// test. Received datagrams are split into their request header and the remaining payload.
+
+class UdpTrackerTest {
+public:
+  struct packet {
+    torrent::sa_unique_ptr source;
+
+    uint64_t            connection_id{};
+    uint32_t            action{};
+    uint32_t            transaction_id{};
+    std::string         payload;
+  };
+
+  using scrape_entry = std::tuple<uint32_t, uint32_t, uint32_t>; // seeders, completed, leechers
+
+  static constexpr uint32_t action_connect = 0;
+  static constexpr uint32_t action_announce = 1;
+  static constexpr uint32_t action_scrape = 2;
+  static constexpr uint32_t action_error = 3;
+
+  UdpTrackerTest();
+  ~UdpTrackerTest();
+
+  const char*         hostname() const { return "127.0.0.1"; }
+  uint16_t            port() const     { return m_port; }
+
+  // Returns the datagrams received since the last call, never blocks.
+  std::vector<packet> receive();
+
+  void                reply_connect(const packet& request, uint64_t connection_id);
+  void                reply_announce(const packet& request, uint32_t interval);
+  void                reply_scrape(const packet& request, const std::vector<scrape_entry>& entries);
+  void                reply_error(const packet& request, const std::string& msg);
+
+private:
+  UdpTrackerTest(const UdpTrackerTest&) = delete;
+  UdpTrackerTest& operator=(const UdpTrackerTest&) = delete;
+
+  void                send(const packet& request, uint32_t action, const std::string& data);
+
+  int                 m_fd{-1};
+  uint16_t            m_port{};
+};
+
+#endif
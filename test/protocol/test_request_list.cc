@@ -263,3 +263,107 @@ TestRequestList::test_choke_unchoke_transfer() {
 
   CLEAR_TRANSFERS();
 }
+
+void
+TestRequestList::test_rtt_sample() {
+  SETUP_ALL(basic);
+
+  CPPUNIT_ASSERT(request_list->rtt() == 0us);
+
+  auto pieces = request_list->delegate(2);
+  CPPUNIT_ASSERT(pieces.size() == 2);
+  const torrent::Piece* piece_1 = pieces[0];
+  const torrent::Piece* piece_2 = pieces[1];
+
+  // Only the first request sent on an empty pipe is sampled.
+  test_main_thread->test_set_cached_time(200ms);
+  CPPUNIT_ASSERT(request_list->downloading(*piece_1));
+  CPPUNIT_ASSERT(request_list->rtt() == 200ms);
+  request_list->transfer()->adjust_position(piece_1->length());
+  request_list->finished();
+
+  test_main_thread->test_set_cached_time(1s);
+  CPPUNIT_ASSERT(request_list->downloading(*piece_2));
+  CPPUNIT_ASSERT(request_list->rtt() == 200ms);
+  request_list->transfer()->adjust_position(piece_2->length());
+  request_list->finished();
+
+  pieces = request_list->delegate(1);
+  CPPUNIT_ASSERT(pieces.size() == 1);
+
+  test_main_thread->test_set_cached_time(1s + 600ms);
+  CPPUNIT_ASSERT(request_list->downloading(*pieces[0]));
+  CPPUNIT_ASSERT(request_list->rtt() == (200ms * 7 + 600ms) / 8);
+  request_list->transfer()->adjust_position(pieces[0]->length());
+  request_list->finished();
+
+  VERIFY_QUEUE_SIZES(0, 0, 0, 0);
+
+  CLEAR_TRANSFERS();
+}
+
+void
+TestRequestList::test_rtt_stalled() {
+  SETUP_ALL(basic);
+
+  auto pieces = request_list->delegate(1);
+  CPPUNIT_ASSERT(pieces.size() == 1);
+
+  // Samples that have stalled are discarded.
+  request_list->stall_initial();
+
+  test_main_thread->test_set_cached_time(200ms);
+  CPPUNIT_ASSERT(request_list->downloading(*pieces[0]));
+  CPPUNIT_ASSERT(request_list->rtt() == 0us);
+  request_list->transfer()->adjust_position(pieces[0]->length());
+  request_list->finished();
+
+  pieces = request_list->delegate(1);
+  CPPUNIT_ASSERT(pieces.size() == 1);
+
+  test_main_thread->test_set_cached_time(400ms);
+  CPPUNIT_ASSERT(request_list->downloading(*pieces[0]));
+  CPPUNIT_ASSERT(request_list->rtt() == 200ms);
+  request_list->transfer()->adjust_position(pieces[0]->length());
+  request_list->finished();
+
+  request_list->stall_prolonged();
+  CPPUNIT_ASSERT(request_list->rtt() == 0us);
+
+  CLEAR_TRANSFERS();
+}
+
+void
+TestRequestList::test_pipe_size_bdp() {
+  SETUP_ALL(basic);
+
+  auto pieces = request_list->delegate(1);
+  CPPUNIT_ASSERT(pieces.size() == 1);
+
+  test_main_thread->test_set_cached_time(8s);
+  CPPUNIT_ASSERT(request_list->downloading(*pieces[0]));
+  CPPUNIT_ASSERT(request_list->rtt() == 8s);
+  request_list->transfer()->adjust_position(pieces[0]->length());
+  request_list->finished();
+
+  // 1 MiB/s with an 8 second latency needs 512 blocks in flight.
+  CPPUNIT_ASSERT(request_list->calculate_pipe_size(1024 * 0) == 2);
+  CPPUNIT_ASSERT(request_list->calculate_pipe_size(1024 * 1024) == 2 * 512 + 2);
+
+  // Aggressive mode ignores the latency.
+  delegator->set_aggressive(true);
+  CPPUNIT_ASSERT(request_list->calculate_pipe_size(1024 * 1024) == 1024 / 10 + 2);
+
+  CLEAR_TRANSFERS();
+}
+
+void
+TestRequestList::test_pipe_size_max_queue() {
+  SETUP_ALL(basic);
+
+  CPPUNIT_ASSERT(request_list->calculate_pipe_size(1024 * 1024) == 1024 / 5 + 18);
+
+  request_list->set_max_queue_length(100);
+  CPPUNIT_ASSERT(request_list->calculate_pipe_size(1024 * 0) == 2);
+  CPPUNIT_ASSERT(request_list->calculate_pipe_size(1024 * 1024) == 100);
+}
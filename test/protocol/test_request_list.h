@@ -11,6 +11,11 @@ class TestRequestList : public test_fixture {
   CPPUNIT_TEST(test_choke_unchoke_discard);
   CPPUNIT_TEST(test_choke_unchoke_transfer);
 
+  CPPUNIT_TEST(test_rtt_sample);
+  CPPUNIT_TEST(test_rtt_stalled);
+  CPPUNIT_TEST(test_pipe_size_bdp);
+  CPPUNIT_TEST(test_pipe_size_max_queue);
+
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -22,4 +27,9 @@ public:
   void test_choke_normal();
   void test_choke_unchoke_discard();
   void test_choke_unchoke_transfer();
+
+  void test_rtt_sample();
+  void test_rtt_stalled();
+  void test_pipe_size_bdp();
+  void test_pipe_size_max_queue();
 };
@@ -1,6 +1,7 @@
 #include "config.h"
 
 #include <array>
+#include <cstring>
 
 #include <torrent/object.h>
 #include <torrent/object_stream.h>
@@ -192,6 +193,49 @@ ObjectStaticMapTest::test_read_extensions() {
   CPPUNIT_ASSERT(static_map_read_bencode(test_ext, "d1:md6:ut_pexi0eee"));
 }
 
+static bool
+key_index_match(const torrent::static_map_key_index& index, const char* key, unsigned int position, unsigned int base) {
+  auto result = index.find(key, key + std::strlen(key));
+
+  return result.first == index.first() + position && result.second == base;
+}
+
+void
+ObjectStaticMapTest::test_key_index() {
+  const auto& index = test_map_type::key_index();
+
+  CPPUNIT_ASSERT(index.size_table() != 0);
+
+  // Each key path resolves to the first mapping it matches, the same as find_key_match.
+  const char* paths[] = { "d_a", "d_a::b", "d_a::c", "d_a::c::a", "d_a::d", "e", "s_a", "s_b", "v_a", "v_b" };
+
+  for (auto path : paths) {
+    auto expected = torrent::find_key_match(test_map_type::keys, test_map_type::keys + test_map_type::size, path);
+    auto result   = index.find(path, path + std::strlen(path));
+
+    CPPUNIT_ASSERT(expected.second != 0);
+    CPPUNIT_ASSERT(result == expected);
+  }
+
+  CPPUNIT_ASSERT(key_index_match(index, "d_a", 0, 3));
+  CPPUNIT_ASSERT(key_index_match(index, "d_a::c", 1, 6));
+  CPPUNIT_ASSERT(key_index_match(index, "e", 3, 1));
+
+  CPPUNIT_ASSERT(key_index_match(index, "", 0, 0));
+  CPPUNIT_ASSERT(key_index_match(index, "d", 0, 0));
+  CPPUNIT_ASSERT(key_index_match(index, "d_a:", 0, 0));
+  CPPUNIT_ASSERT(key_index_match(index, "e[]", 0, 0));
+  CPPUNIT_ASSERT(key_index_match(index, "s_c", 0, 0));
+  CPPUNIT_ASSERT(key_index_match(index, "v_a::b", 0, 0));
+
+  test_map_type test_map;
+  CPPUNIT_ASSERT(static_map_read_bencode(test_map, "d" "3:d_ad1:ci1e1:bi2ee" "1:eli3ei4ee" "3:v_bi5e" "e"));
+  CPPUNIT_ASSERT(test_map[key_d_a].as_value() == 2);
+  CPPUNIT_ASSERT(test_map[key_e_0].as_value() == 3);
+  CPPUNIT_ASSERT(test_map[key_e_1].as_value() == 4);
+  CPPUNIT_ASSERT(test_map[key_v_b].as_value() == 5);
+}
+
 template <typename map_type>
 bool static_map_write_bencode(map_type map, const char* original) {
   try {
@@ -8,6 +8,7 @@ class ObjectStaticMapTest : public CppUnit::TestFixture {
   CPPUNIT_TEST(test_write);
   CPPUNIT_TEST(test_read);
   CPPUNIT_TEST(test_read_extensions);
+  CPPUNIT_TEST(test_key_index);
 
   CPPUNIT_TEST(test_read_empty);
   CPPUNIT_TEST(test_read_single);
@@ -29,6 +30,7 @@ public:
   void test_read();
 
   void test_read_extensions();
+  void test_key_index();
 
   // Proper unit tests:
   void test_read_empty();
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <sstream>
 #include <cinttypes>
+#include <torrent/exceptions.h>
 #include <torrent/object.h>
 
 #include "object_stream_test.h"
@@ -195,3 +196,94 @@ ObjectStreamTest::test_write() {
   obj.as_map()["d"] = torrent::Object();
   CPPUNIT_ASSERT(object_write_bencode(obj, "d1:ai1e1:b4:test1:cl3:fooee"));
 }
+
+void
+ObjectStreamTest::test_read_view() {
+  const std::string src = "d4:infod5:filesld6:lengthi1e4:pathl1:aeee4:name4:test6:pieces3:xyze3:key5:valuee";
+
+  torrent::Object obj;
+  CPPUNIT_ASSERT(torrent::object_read_bencode_view_c(src.data(), src.data() + src.size(), &obj) == src.data() + src.size());
+
+  CPPUNIT_ASSERT(obj.is_map());
+  CPPUNIT_ASSERT(obj.get_key("key").is_raw_string());
+  CPPUNIT_ASSERT(obj.get_key("key").as_raw_string().as_string() == "value");
+
+  auto& info = obj.get_key("info");
+  CPPUNIT_ASSERT(info.is_map());
+  CPPUNIT_ASSERT(info.get_key("name").is_raw_string());
+  CPPUNIT_ASSERT(info.get_key("files").is_raw_list());
+
+  // Views must point into the source buffer.
+  CPPUNIT_ASSERT(info.get_key("pieces").as_raw_string().data() >= src.data());
+  CPPUNIT_ASSERT(info.get_key("pieces").as_raw_string().data() < src.data() + src.size());
+
+  int count = 0;
+  torrent::raw_list_for_each(info.get_key("files").as_raw_list(), [&count](const torrent::raw_bencode& entry) {
+      CPPUNIT_ASSERT(entry.is_raw_map());
+      count++;
+    });
+  CPPUNIT_ASSERT(count == 1);
+
+  // Writing views must reproduce the original bytes so info-hashes are unchanged.
+  char buffer[256];
+  char* last = torrent::object_write_bencode(buffer, buffer + sizeof(buffer), &obj).first;
+  CPPUNIT_ASSERT(std::string(buffer, last) == src);
+}
+
+void
+ObjectStreamTest::test_read_view_invalid() {
+  const std::string unordered = "d4:infod5:filesld1:bi1e1:ai2eeeee";
+  const std::string truncated = "d4:infod5:filesl4:ab";
+
+  torrent::Object obj;
+
+  // Unordered keys within a view are flagged rather than rejected.
+  torrent::object_read_bencode_view_c(unordered.data(), unordered.data() + unordered.size(), &obj);
+  CPPUNIT_ASSERT(obj.get_key("info").get_key("files").flags() & torrent::Object::flag_unordered);
+  CPPUNIT_ASSERT(obj.flags() & torrent::Object::flag_unordered);
+
+  CPPUNIT_ASSERT_THROW(torrent::object_read_bencode_view_c(truncated.data(), truncated.data() + truncated.size(), &obj),
+                       torrent::bencode_error);
+}
+
+void
+ObjectStreamTest::test_materialize() {
+  const std::string src = "d4:infod5:filesld6:lengthi1e4:pathl1:aeee4:name4:testee";
+
+  torrent::Object obj;
+  torrent::object_read_bencode_view_c(src.data(), src.data() + src.size(), &obj);
+  torrent::object_materialize(&obj);
+
+  auto& info = obj.get_key("info");
+  CPPUNIT_ASSERT(info.get_key("name").is_string());
+  CPPUNIT_ASSERT(info.get_key("name").as_string() == "test");
+  CPPUNIT_ASSERT(info.get_key("files").is_list());
+  CPPUNIT_ASSERT(info.get_key("files").as_list().front().get_key_value("length") == 1);
+  CPPUNIT_ASSERT(info.get_key("files").as_list().front().get_key_list("path").front().as_string() == "a");
+
+  char buffer[256];
+  char* last = torrent::object_write_bencode(buffer, buffer + sizeof(buffer), &obj).first;
+  CPPUNIT_ASSERT(std::string(buffer, last) == src);
+}
+
+void
+ObjectStreamTest::test_read_span() {
+  const std::string src = "d8:announce3:url4:infod6:lengthi1e4:name4:teste3:keyi1ee";
+  const char*       last = src.data() + src.size();
+
+  auto span = torrent::object_read_bencode_span_c(src.data(), last, "info");
+  CPPUNIT_ASSERT(span.is_raw_map());
+  CPPUNIT_ASSERT(std::string(span.data(), span.size()) == "d6:lengthi1e4:name4:teste");
+
+  // Hashing the span must match hashing the re-encoded object.
+  torrent::Object obj;
+  torrent::object_read_bencode_c(src.data(), last, &obj);
+
+  uint64_t size = 0;
+  CPPUNIT_ASSERT(torrent::object_sha1(span) == torrent::object_sha1(&obj.get_key("info"), &size));
+  CPPUNIT_ASSERT(size == span.size());
+
+  CPPUNIT_ASSERT(torrent::object_read_bencode_span_c(src.data(), last, "missing").is_empty());
+  CPPUNIT_ASSERT_THROW(torrent::object_read_bencode_span_c(src.data(), last - 1, "missing"), torrent::bencode_error);
+  CPPUNIT_ASSERT_THROW(torrent::object_read_bencode_span_c(src.data() + 1, last, "info"), torrent::bencode_error);
+}
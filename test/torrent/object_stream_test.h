@@ -13,6 +13,11 @@ class ObjectStreamTest : public CppUnit::TestFixture {
   CPPUNIT_TEST(test_read_skip);
   CPPUNIT_TEST(test_read_skip_invalid);
   CPPUNIT_TEST(test_write);
+
+  CPPUNIT_TEST(test_read_view);
+  CPPUNIT_TEST(test_read_view_invalid);
+  CPPUNIT_TEST(test_materialize);
+  CPPUNIT_TEST(test_read_span);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -27,5 +32,10 @@ public:
   void test_read_skip_invalid();
 
   void test_write();
+
+  void test_read_view();
+  void test_read_view_invalid();
+  void test_materialize();
+  void test_read_span();
 };
 
@@ -53,6 +53,12 @@ ObjectTest::test_flags() {
 
 void
 ObjectTest::test_merge() {
+  torrent::Object dest = create_bencode("d1:bi2e1:dd1:xi1eee");
+  torrent::Object src  = create_bencode("d1:ai1e1:dd1:yi2ee1:ei5ee");
+
+  dest.merge_copy(src);
+
+  CPPUNIT_ASSERT(compare_bencode(dest, "d1:ai1e1:bi2e1:dd1:xi1e1:yi2ee1:ei5ee"));
 }
 
 #define TEST_VALUE_A "i10e"
@@ -136,3 +142,77 @@ ObjectTest::test_create_normal() {
   CPPUNIT_ASSERT(torrent::object_create_normal(create_bencode_raw_list_c("i5ei6e")).as_list().back().as_value() == 6);
   CPPUNIT_ASSERT(torrent::object_create_normal(create_bencode_raw_map_c("1:ai2e1:bi3e")).as_map()["b"].as_value() == 3);
 }
+
+void
+ObjectTest::test_move_construct() {
+  torrent::Object src = create_bencode("d1:ai1e1:bl1:cee");
+  src.set_internal_flags(torrent::Object::flag_unordered);
+
+  torrent::Object dest(std::move(src));
+
+  CPPUNIT_ASSERT(src.is_empty());
+  CPPUNIT_ASSERT(dest.flags() & torrent::Object::flag_unordered);
+  CPPUNIT_ASSERT(compare_bencode(dest, "d1:ai1e1:bl1:cee"));
+
+  // Assigning from an object owned by the destination.
+  dest = std::move(dest.get_key("b"));
+  CPPUNIT_ASSERT(compare_bencode(dest, "l1:ce"));
+
+  torrent::Object str("test");
+  dest = std::move(str);
+  CPPUNIT_ASSERT(str.is_empty());
+  CPPUNIT_ASSERT(dest.as_string() == "test");
+}
+
+void
+ObjectTest::test_map() {
+  torrent::Object obj = torrent::Object::create_map();
+  auto& map = obj.as_map();
+
+  obj.insert_key("c", int64_t{3});
+  obj.insert_key("a", int64_t{1});
+  obj.insert_key("a_key_longer_than_the_inline_size", int64_t{4});
+  obj.insert_key("b", int64_t{2});
+
+  CPPUNIT_ASSERT(map.size() == 4);
+  CPPUNIT_ASSERT(compare_bencode(obj, "d1:ai1e33:a_key_longer_than_the_inline_sizei4e1:bi2e1:ci3ee"));
+
+  CPPUNIT_ASSERT(obj.has_key("b"));
+  CPPUNIT_ASSERT(!obj.has_key("d"));
+  CPPUNIT_ASSERT(obj.get_key_value("a_key_longer_than_the_inline_size") == 4);
+  CPPUNIT_ASSERT(map.find("") == map.end());
+
+  CPPUNIT_ASSERT(!obj.insert_preserve_any("a", int64_t{5}).second);
+  CPPUNIT_ASSERT(obj.get_key_value("a") == 1);
+
+  obj.erase_key("a");
+  obj.erase_key("missing");
+  CPPUNIT_ASSERT(map.size() == 3);
+  CPPUNIT_ASSERT(map.begin()->first == "a_key_longer_than_the_inline_size");
+  CPPUNIT_ASSERT(map.rbegin()->first == "c");
+
+  auto itr = map.insert(map.end(), torrent::Object::map_type::value_type("d", int64_t{6}));
+  CPPUNIT_ASSERT(itr->first == "d" && std::next(itr) == map.end());
+
+  // A wrong hint must not break the ordering.
+  map.insert(map.begin(), torrent::Object::map_type::value_type("bb", int64_t{7}));
+  CPPUNIT_ASSERT(compare_bencode(obj, "d33:a_key_longer_than_the_inline_sizei4e1:bi2e2:bbi7e1:ci3e1:di6ee"));
+}
+
+void
+ObjectTest::test_map_stability() {
+  torrent::Object obj = torrent::Object::create_map();
+
+  auto& b = obj.insert_key("b", int64_t{2});
+  auto& d = obj.insert_key("d", int64_t{4});
+
+  // Clients keep references to dictionary entries, these must survive changes to the dictionary.
+  for (int i = 0; i != 64; i++)
+    obj.insert_key("c" + std::to_string(i), int64_t{i});
+
+  obj.insert_key("a", int64_t{1});
+  obj.erase_key("c0");
+
+  CPPUNIT_ASSERT(&b == &obj.get_key("b") && b.as_value() == 2);
+  CPPUNIT_ASSERT(&d == &obj.get_key("d") && d.as_value() == 4);
+}
@@ -6,7 +6,11 @@ class ObjectTest : public CppUnit::TestFixture {
   CPPUNIT_TEST_SUITE(ObjectTest);
   CPPUNIT_TEST(test_basic);
   CPPUNIT_TEST(test_flags);
+  CPPUNIT_TEST(test_merge);
   CPPUNIT_TEST(test_swap_and_move);
+  CPPUNIT_TEST(test_move_construct);
+  CPPUNIT_TEST(test_map);
+  CPPUNIT_TEST(test_map_stability);
 
   CPPUNIT_TEST(test_create_normal);
   CPPUNIT_TEST_SUITE_END();
@@ -17,6 +21,9 @@ public:
   void test_merge();
 
   void test_swap_and_move();
+  void test_move_construct();
+  void test_map();
+  void test_map_stability();
 
   void test_create_normal();
 };
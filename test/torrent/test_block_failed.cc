@@ -0,0 +1,61 @@
+#include "config.h"
+
+#include "test_block_failed.h"
+
+#include "torrent/exceptions.h"
+#include "torrent/data/block_failed.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(test_block_failed);
+
+static torrent::HashString
+make_hash(char c) {
+  torrent::HashString hash;
+  hash.clear(c);
+  return hash;
+}
+
+void
+test_block_failed::test_entries() {
+  torrent::BlockFailed failed(16 << 10);
+
+  auto first = failed.insert(make_hash('a'));
+  failed.insert(make_hash('b'))->count = 3;
+  failed.insert(make_hash('c'))->count = 3;
+
+  CPPUNIT_ASSERT(failed.size() == 3);
+  CPPUNIT_ASSERT(first->count == 1);
+
+  CPPUNIT_ASSERT(failed.find(make_hash('b')) == failed.begin() + 1);
+  CPPUNIT_ASSERT(failed.find(make_hash('d')) == failed.end());
+
+  CPPUNIT_ASSERT(failed.max_element() == failed.begin() + 1);
+  CPPUNIT_ASSERT(failed.reverse_max_element() == failed.rbegin());
+}
+
+void
+test_block_failed::test_memory_cap() {
+  auto max_memory = torrent::BlockFailed::max_memory();
+  auto usage      = torrent::BlockFailed::memory_usage();
+
+  torrent::BlockFailed::set_max_memory(usage + (48 << 10));
+
+  {
+    torrent::BlockFailed failed(16 << 10);
+
+    for (char c = 'a'; c != 'e'; c++)
+      failed.insert(make_hash(c));
+
+    CPPUNIT_ASSERT(failed.retain_data(failed.begin()) != nullptr);
+    CPPUNIT_ASSERT(failed.retain_data(failed.begin() + 1) != nullptr);
+    CPPUNIT_ASSERT(failed.retain_data(failed.begin() + 2) != nullptr);
+    CPPUNIT_ASSERT(failed.retain_data(failed.begin() + 3) == nullptr);
+    CPPUNIT_ASSERT(failed[3].data == nullptr);
+
+    CPPUNIT_ASSERT(torrent::BlockFailed::memory_usage() == usage + (48 << 10));
+    CPPUNIT_ASSERT_THROW(failed.retain_data(failed.begin()), torrent::internal_error);
+  }
+
+  CPPUNIT_ASSERT(torrent::BlockFailed::memory_usage() == usage);
+
+  torrent::BlockFailed::set_max_memory(max_memory);
+}
@@ -0,0 +1,14 @@
+#include "helpers/test_fixture.h"
+
+class test_block_failed : public test_fixture {
+  CPPUNIT_TEST_SUITE(test_block_failed);
+
+  CPPUNIT_TEST(test_entries);
+  CPPUNIT_TEST(test_memory_cap);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_entries();
+  void test_memory_cap();
+};
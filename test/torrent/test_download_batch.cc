@@ -0,0 +1,174 @@
+#include "config.h"
+
+#include "test_download_batch.h"
+
+#include "manager.h"
+#include "runtime_manager.h"
+#include "thread_main.h"
+#include "download/download_wrapper.h"
+#include "test/helpers/mock_function.h"
+#include "torrent/download_info.h"
+#include "torrent/exceptions.h"
+#include "torrent/object_stream.h"
+#include "torrent/torrent.h"
+#include "torrent/download/download_manager.h"
+#include "tracker/thread_tracker.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(test_download_batch);
+
+namespace {
+
+// Single file torrent whose info hash only depends on 'name'.
+std::shared_ptr<const std::string>
+make_torrent(const std::string& name) {
+  return std::make_shared<const std::string>("d8:announce20:http://example.com/a"
+                                             "4:infod6:lengthi16384e4:name" + std::to_string(name.size()) + ":" + name +
+                                             "12:piece lengthi16384e6:pieces20:aaaaaaaaaaaaaaaaaaaaee");
+}
+
+std::vector<torrent::download_batch_entry>
+make_entries(const std::vector<std::shared_ptr<const std::string>>& sources) {
+  std::vector<torrent::download_batch_entry> entries(sources.size());
+
+  for (size_t i = 0; i != sources.size(); i++)
+    entries[i].source = sources[i];
+
+  return entries;
+}
+
+std::vector<std::string>
+download_names() {
+  std::vector<std::string> result;
+
+  for (auto download : *torrent::manager->download_manager())
+    result.push_back(download->info()->name().str());
+
+  return result;
+}
+
+} // namespace
+
+// Uses a real ThreadMain as downloads are added to its hash queue.
+
+void
+test_download_batch::setUp() {
+  test_fixture::setUp();
+  mock_redirect_defaults();
+
+  torrent::ThreadMain::create_thread();
+  torrent::RuntimeManager::initialize();
+  torrent::ThreadMain::thread_main()->init_thread();
+
+  torrent::ThreadTracker::create_thread();
+  torrent::tracker_thread::thread()->init_thread();
+  torrent::tracker_thread::thread()->start_thread();
+
+  torrent::manager = new torrent::Manager;
+}
+
+void
+test_download_batch::tearDown() {
+  while (!torrent::manager->download_manager()->empty())
+    torrent::download_remove(torrent::Download(*torrent::manager->download_manager()->begin()));
+
+  torrent::manager->cleanup();
+  delete torrent::manager;
+  torrent::manager = nullptr;
+
+  torrent::tracker_thread::thread()->stop_thread_wait();
+
+  torrent::RuntimeManager::cleanup();
+  torrent::ThreadTracker::destroy_thread();
+
+  delete torrent::ThreadMain::thread_main();
+
+  test_fixture::tearDown();
+}
+
+void
+test_download_batch::test_add() {
+  auto entries = make_entries({make_torrent("a"), make_torrent("b"), make_torrent("c")});
+  entries[1].resume_source = "d5:counti1ee";
+
+  torrent::download_add_batch(entries, 2);
+
+  for (auto& entry : entries) {
+    CPPUNIT_ASSERT(entry.error.empty());
+    CPPUNIT_ASSERT(entry.download.is_valid());
+  }
+
+  CPPUNIT_ASSERT(entries[0].download.info()->name().str() == "a");
+  CPPUNIT_ASSERT(entries[1].download.info()->name().str() == "b");
+  CPPUNIT_ASSERT(entries[2].download.info()->name().str() == "c");
+
+  CPPUNIT_ASSERT(entries[0].resume.is_empty());
+  CPPUNIT_ASSERT(entries[1].resume.get_key_value("count") == 1);
+
+  CPPUNIT_ASSERT(torrent::manager->download_manager()->size() == 3);
+
+  // Hashed the same as with 'download_add'.
+  auto source = make_torrent("a");
+  auto object = torrent::Object::create_map();
+  torrent::object_read_bencode_c(source->data(), source->data() + source->size(), &object);
+
+  CPPUNIT_ASSERT_THROW(torrent::download_add(&object, 0), torrent::input_error);
+}
+
+void
+test_download_batch::test_prepare_failed() {
+  auto entries = make_entries({make_torrent("a"),
+                               std::make_shared<const std::string>("d4:infod6:lengthi16384ee"),
+                               std::make_shared<const std::string>("not bencode"),
+                               nullptr,
+                               make_torrent("e")});
+  entries[4].resume_source = "d5:count";
+
+  torrent::download_add_batch(entries, 3);
+
+  CPPUNIT_ASSERT(entries[0].error.empty() && entries[0].download.is_valid());
+
+  for (size_t i = 1; i != entries.size(); i++) {
+    CPPUNIT_ASSERT(!entries[i].error.empty());
+    CPPUNIT_ASSERT(!entries[i].download.is_valid());
+  }
+
+  // Only the valid torrent was registered, and failed entries leave nothing behind in the
+  // manager.
+  CPPUNIT_ASSERT(download_names() == std::vector<std::string>{"a"});
+
+  auto retry = make_entries({make_torrent("e")});
+  torrent::download_add_batch(retry, 1);
+
+  CPPUNIT_ASSERT(retry[0].error.empty() && retry[0].download.is_valid());
+  CPPUNIT_ASSERT((download_names() == std::vector<std::string>{"a", "e"}));
+}
+
+void
+test_download_batch::test_commit_order() {
+  std::vector<std::shared_ptr<const std::string>> sources;
+
+  for (char c = 'a'; c <= 'p'; c++)
+    sources.push_back(make_torrent(std::string(1, c)));
+
+  // A duplicate is rejected in favor of the earlier entry, regardless of which worker prepared
+  // it first.
+  sources.insert(sources.begin() + 3, make_torrent("k"));
+
+  auto entries = make_entries(sources);
+  torrent::download_add_batch(entries, 4);
+
+  CPPUNIT_ASSERT(entries[3].download.is_valid());
+  CPPUNIT_ASSERT(entries[3].download.info()->name().str() == "k");
+
+  CPPUNIT_ASSERT(!entries[11].download.is_valid());
+  CPPUNIT_ASSERT(entries[11].error == "Info hash already used by another torrent.");
+
+  std::vector<std::string> expected;
+
+  for (auto& entry : entries)
+    if (entry.download.is_valid())
+      expected.push_back(entry.download.info()->name().str());
+
+  CPPUNIT_ASSERT(expected.size() == 16);
+  CPPUNIT_ASSERT(download_names() == expected);
+}
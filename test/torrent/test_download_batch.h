@@ -0,0 +1,19 @@
+#include "helpers/test_fixture.h"
+
+class test_download_batch : public test_fixture {
+  CPPUNIT_TEST_SUITE(test_download_batch);
+
+  CPPUNIT_TEST(test_add);
+  CPPUNIT_TEST(test_prepare_failed);
+  CPPUNIT_TEST(test_commit_order);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp() override;
+  void tearDown() override;
+
+  void test_add();
+  void test_prepare_failed();
+  void test_commit_order();
+};
@@ -0,0 +1,132 @@
+#include "config.h"
+
+#include "test/torrent/test_rate.h"
+
+#include "torrent/exceptions.h"
+#include "torrent/rate.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestRate);
+
+void
+TestRate::test_basic() {
+  m_main_thread->test_set_cached_time(0s);
+
+  torrent::Rate rate(60);
+
+  CPPUNIT_ASSERT(rate.rate() == 0);
+  CPPUNIT_ASSERT(rate.total() == 0);
+
+  rate.insert(600);
+  CPPUNIT_ASSERT(rate.rate() == 10);
+  CPPUNIT_ASSERT(rate.total() == 600);
+
+  m_main_thread->test_add_cached_time(30s);
+
+  rate.insert(600);
+  CPPUNIT_ASSERT(rate.rate() == 20);
+  CPPUNIT_ASSERT(rate.total() == 1200);
+
+  CPPUNIT_ASSERT_THROW(rate.insert((torrent::Rate::rate_type{1} << 28) + 1), torrent::internal_error);
+}
+
+void
+TestRate::test_span() {
+  CPPUNIT_ASSERT(torrent::Rate(1).bucket_width() == 1);
+  CPPUNIT_ASSERT(torrent::Rate(15).bucket_width() == 1);
+  CPPUNIT_ASSERT(torrent::Rate(30).bucket_width() == 2);
+  CPPUNIT_ASSERT(torrent::Rate(60).bucket_width() == 4);
+  CPPUNIT_ASSERT(torrent::Rate(600).bucket_width() == 40);
+
+  torrent::Rate rate(60);
+  rate.insert(600);
+
+  rate.set_span(30);
+  CPPUNIT_ASSERT(rate.span() == 30);
+  CPPUNIT_ASSERT(rate.bucket_width() == 2);
+  CPPUNIT_ASSERT(rate.rate() == 0);
+  CPPUNIT_ASSERT(rate.total() == 600);
+
+  CPPUNIT_ASSERT_THROW(rate.set_span(0), torrent::internal_error);
+}
+
+void
+TestRate::test_expire() {
+  m_main_thread->test_set_cached_time(0s);
+
+  torrent::Rate rate(60);
+
+  rate.insert(600);
+  m_main_thread->test_add_cached_time(30s);
+  rate.insert(600);
+
+  // The first bucket covers 4 seconds and is kept until its last
+  // second falls outside the span.
+  m_main_thread->test_add_cached_time(33s);
+  CPPUNIT_ASSERT(rate.rate() == 20);
+
+  m_main_thread->test_add_cached_time(1s);
+  CPPUNIT_ASSERT(rate.rate() == 10);
+
+  m_main_thread->test_add_cached_time(30s);
+  CPPUNIT_ASSERT(rate.rate() == 0);
+  CPPUNIT_ASSERT(rate.total() == 1200);
+}
+
+void
+TestRate::test_continuous() {
+  m_main_thread->test_set_cached_time(0s);
+
+  torrent::Rate rate(60);
+
+  for (int i = 0; i < 1000; i++) {
+    rate.insert(1000);
+
+    if (i >= 60) {
+      CPPUNIT_ASSERT(rate.rate() >= 1000);
+      CPPUNIT_ASSERT(rate.rate() <= 1000 * (60 + 4) / 60);
+    }
+
+    m_main_thread->test_add_cached_time(1s);
+  }
+
+  CPPUNIT_ASSERT(rate.total() == 1000 * 1000);
+}
+
+void
+TestRate::test_idle() {
+  m_main_thread->test_set_cached_time(0s);
+
+  torrent::Rate rate(30);
+
+  rate.insert(300);
+  CPPUNIT_ASSERT(rate.rate() == 10);
+
+  m_main_thread->test_add_cached_time(1000s);
+  CPPUNIT_ASSERT(rate.rate() == 0);
+
+  rate.insert(600);
+  CPPUNIT_ASSERT(rate.rate() == 20);
+
+  m_main_thread->test_add_cached_time(10000s);
+  rate.insert(900);
+  CPPUNIT_ASSERT(rate.rate() == 30);
+  CPPUNIT_ASSERT(rate.total() == 1800);
+}
+
+void
+TestRate::test_reset() {
+  m_main_thread->test_set_cached_time(0s);
+
+  torrent::Rate rate(60);
+
+  rate.insert(600);
+  rate.reset_rate();
+
+  CPPUNIT_ASSERT(rate.rate() == 0);
+  CPPUNIT_ASSERT(rate.total() == 600);
+
+  m_main_thread->test_add_cached_time(10s);
+
+  rate.insert(1200);
+  CPPUNIT_ASSERT(rate.rate() == 20);
+}
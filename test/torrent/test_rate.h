@@ -0,0 +1,22 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestRate : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestRate);
+
+  CPPUNIT_TEST(test_basic);
+  CPPUNIT_TEST(test_span);
+  CPPUNIT_TEST(test_expire);
+  CPPUNIT_TEST(test_continuous);
+  CPPUNIT_TEST(test_idle);
+  CPPUNIT_TEST(test_reset);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_basic();
+  void test_span();
+  void test_expire();
+  void test_continuous();
+  void test_idle();
+  void test_reset();
+};
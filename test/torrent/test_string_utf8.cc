@@ -0,0 +1,88 @@
+#include "config.h"
+
+#include "test_string_utf8.h"
+
+#include <thread>
+#include <vector>
+
+#include "torrent/path.h"
+#include "torrent/types/string_utf8.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(test_string_utf8);
+
+void
+test_string_utf8::test_basic() {
+  torrent::string_utf8 empty;
+
+  CPPUNIT_ASSERT(empty.empty());
+  CPPUNIT_ASSERT(empty.is_utf8());
+  CPPUNIT_ASSERT(empty.str().empty());
+  CPPUNIT_ASSERT(empty.hex().empty());
+
+  auto str = torrent::string_utf8::from_string("abc");
+
+  CPPUNIT_ASSERT(!str.empty());
+  CPPUNIT_ASSERT(str.is_utf8());
+  CPPUNIT_ASSERT(str.str() == "abc");
+  CPPUNIT_ASSERT(str.hex() == "616263");
+
+  auto copy = str;
+  copy.reset("\xff");
+
+  CPPUNIT_ASSERT(str.str() == "abc");
+  CPPUNIT_ASSERT(!copy.is_utf8());
+
+  copy.reset("");
+  CPPUNIT_ASSERT(copy.empty());
+}
+
+void
+test_string_utf8::test_pool() {
+  torrent::string_utf8_pool pool;
+  torrent::Path             first;
+  torrent::Path             second;
+
+  first.push_back_element(pool.intern("dir"));
+  first.push_back_element(pool.intern("a"));
+  second.push_back_element(pool.intern("dir"));
+  second.push_back_element(pool.intern("b"));
+
+  CPPUNIT_ASSERT(pool.size() == 3);
+  CPPUNIT_ASSERT(first.as_string() == "/dir/a");
+  CPPUNIT_ASSERT(second.as_string() == "/dir/b");
+
+  CPPUNIT_ASSERT(first.front().is_same_storage(second.front()));
+  CPPUNIT_ASSERT(!first.back().is_same_storage(second.back()));
+
+  pool.clear();
+
+  CPPUNIT_ASSERT(first.front().str() == "dir");
+}
+
+void
+test_string_utf8::test_shared_encode() {
+  auto str = torrent::string_utf8::from_string("\x01\xff shared");
+
+  std::vector<std::thread>        threads;
+  std::vector<const std::string*> hex_results(8);
+  std::vector<const std::string*> base64_results(8);
+
+  // Copies share the cached encodings, which are generated once even when first used from
+  // several threads.
+  for (unsigned int i = 0; i != 8; i++)
+    threads.emplace_back([copy = str, &hex_results, &base64_results, i] {
+        hex_results[i]    = &copy.hex();
+        base64_results[i] = &copy.base64();
+      });
+
+  for (auto& thread : threads)
+    thread.join();
+
+  for (unsigned int i = 0; i != 8; i++) {
+    CPPUNIT_ASSERT(hex_results[i] == &str.hex());
+    CPPUNIT_ASSERT(base64_results[i] == &str.base64());
+  }
+
+  CPPUNIT_ASSERT(str.hex() == "01FF20736861726564");
+  CPPUNIT_ASSERT(str.base64() == "Af8gc2hhcmVk");
+}
@@ -0,0 +1,16 @@
+#include "helpers/test_fixture.h"
+
+class test_string_utf8 : public test_fixture {
+  CPPUNIT_TEST_SUITE(test_string_utf8);
+
+  CPPUNIT_TEST(test_basic);
+  CPPUNIT_TEST(test_pool);
+  CPPUNIT_TEST(test_shared_encode);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_basic();
+  void test_pool();
+  void test_shared_encode();
+};
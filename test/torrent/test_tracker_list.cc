@@ -3,6 +3,8 @@
 #include "test/torrent/test_tracker_list.h"
 
 #include "net/address_list.h"
+#include "torrent/tracker/manager.h"
+#include "tracker/thread_tracker.h"
 #include "torrent/utils/uri_parser.h"
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TestTrackerList);
@@ -104,6 +106,38 @@ TestTrackerList::test_close() {
 
 // Test clear.
 
+// A disabled tracker drops its paced announce rather than sending it later.
+void
+TestTrackerList::test_disable_paced() {
+  TRACKER_LIST_SETUP();
+
+  auto tracker_0 = TrackerTest::new_tracker(&tracker_list, 0, "http://example.com/announce");
+  auto tracker_1 = TrackerTest::new_tracker(&tracker_list, 0, "http://example.com/announce.php");
+
+  TrackerTest::insert_tracker(&tracker_list, 0, tracker_0);
+  TrackerTest::insert_tracker(&tracker_list, 0, tracker_1);
+
+  TrackerTest::test_worker(tracker_0)->set_type(torrent::TRACKER_HTTP);
+  TrackerTest::test_worker(tracker_1)->set_type(torrent::TRACKER_HTTP);
+
+  torrent::tracker_thread::manager()->set_pacing(10min, 0us);
+
+  tracker_list.send_event(tracker_0, torrent::tracker::TrackerState::EVENT_STARTED);
+  tracker_list.send_event(tracker_1, torrent::tracker::TrackerState::EVENT_STARTED);
+
+  process_main_and_tracker(this);
+
+  CPPUNIT_ASSERT(TrackerTest::test_worker(tracker_0)->requesting_state() == torrent::tracker::TrackerState::EVENT_STARTED);
+  CPPUNIT_ASSERT(TrackerTest::test_worker(tracker_1)->requesting_state() == -1);
+  CPPUNIT_ASSERT(tracker_1.state().is_starting_request());
+
+  tracker_1.disable();
+  process_main_and_tracker(this);
+
+  CPPUNIT_ASSERT(TrackerTest::test_worker(tracker_1)->requesting_state() == -1);
+  CPPUNIT_ASSERT(!tracker_1.state().is_starting_request());
+}
+
 void
 TestTrackerList::test_tracker_flags() {
   TRACKER_LIST_SETUP();
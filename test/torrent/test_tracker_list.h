@@ -8,6 +8,7 @@ class TestTrackerList : public TestFixtureWithMainNetTrackerThread {
   CPPUNIT_TEST(test_basic);
   CPPUNIT_TEST(test_enable);
   CPPUNIT_TEST(test_close);
+  CPPUNIT_TEST(test_disable_paced);
 
   CPPUNIT_TEST(test_tracker_flags);
   CPPUNIT_TEST(test_find_url);
@@ -30,6 +31,7 @@ public:
   void test_basic();
   void test_enable();
   void test_close();
+  void test_disable_paced();
 
   void test_tracker_flags();
   void test_find_url();
@@ -0,0 +1,113 @@
+#include "config.h"
+
+#include "test_bencode_writer.h"
+
+#include <cstdio>
+#include <unistd.h>
+#include <torrent/object.h>
+#include <torrent/utils/bencode_writer.h>
+
+#include "torrent/object_test_utils.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(test_bencode_writer, "torrent/utils");
+
+void
+test_bencode_writer::test_write() {
+  torrent::utils::BencodeWriter writer;
+
+  CPPUNIT_ASSERT(writer.empty());
+
+  auto obj = create_bencode("d1:ai1e1:bl1:c1:dee");
+
+  writer.write(&obj);
+  writer.write(&obj);
+
+  CPPUNIT_ASSERT(writer.size() == 38);
+  CPPUNIT_ASSERT(writer.size_buffers() == 1);
+  CPPUNIT_ASSERT(writer.str() == "d1:ai1e1:bl1:c1:deed1:ai1e1:bl1:c1:dee");
+
+  writer.clear();
+
+  CPPUNIT_ASSERT(writer.empty());
+  CPPUNIT_ASSERT(writer.size_buffers() == 0);
+  CPPUNIT_ASSERT(writer.size_pool() == 1);
+}
+
+void
+test_bencode_writer::test_write_large() {
+  torrent::utils::BencodeWriter writer;
+
+  auto obj = torrent::Object::create_map();
+  obj.insert_key("data", std::string(torrent::utils::BencodeWriter::buffer_size * 2, 'x'));
+
+  writer.write(&obj);
+
+  CPPUNIT_ASSERT(writer.size_buffers() == 3);
+  CPPUNIT_ASSERT(writer.size() == torrent::utils::BencodeWriter::buffer_size * 2 + 15);
+  CPPUNIT_ASSERT(writer.str() == "d4:data131072:" + obj.get_key_string("data") + "e");
+}
+
+void
+test_bencode_writer::test_incremental() {
+  torrent::utils::BencodeWriter writer;
+
+  auto obj = create_bencode("d1:ai1e1:bi2ee");
+  obj.get_key("b").set_flags(torrent::Object::flag_session_data);
+
+  writer.write_incremental("id", &obj);
+  CPPUNIT_ASSERT(writer.str() == "d1:ai1e1:bi2ee");
+  CPPUNIT_ASSERT(writer.size_cache() == 1);
+
+  // Only entries flagged as session data are encoded again.
+  obj.get_key_value("a") = 3;
+  obj.get_key_value("b") = 4;
+  obj.insert_key("c", int64_t{5});
+
+  writer.clear();
+  writer.write_incremental("id", &obj);
+  CPPUNIT_ASSERT(writer.str() == "d1:ai1e1:bi4e1:ci5ee");
+
+  writer.erase_cache("id");
+  writer.clear();
+  writer.write_incremental("id", &obj);
+  CPPUNIT_ASSERT(writer.str() == "d1:ai3e1:bi4e1:ci5ee");
+
+  // Entries removed from the object are dropped from the cache.
+  obj.erase_key("a");
+
+  writer.clear();
+  writer.write_incremental("id", &obj);
+  CPPUNIT_ASSERT(writer.str() == "d1:bi4e1:ci5ee");
+}
+
+void
+test_bencode_writer::test_flush() {
+  torrent::utils::BencodeWriter writer;
+
+  auto obj = torrent::Object::create_map();
+  obj.insert_key("data", std::string(torrent::utils::BencodeWriter::buffer_size + 100, 'x'));
+
+  writer.write(&obj);
+  writer.write_raw("i1e", 3);
+
+  auto expected = writer.str();
+
+  FILE* file = std::tmpfile();
+  CPPUNIT_ASSERT(file != nullptr);
+
+  CPPUNIT_ASSERT(writer.flush(fileno(file)));
+  CPPUNIT_ASSERT(writer.empty());
+  CPPUNIT_ASSERT(writer.size_buffers() == 0);
+
+  std::string result(expected.size() + 1, '\0');
+  CPPUNIT_ASSERT(::pread(fileno(file), result.data(), result.size(), 0) == static_cast<ssize_t>(expected.size()));
+
+  result.resize(expected.size());
+  CPPUNIT_ASSERT(result == expected);
+
+  std::fclose(file);
+
+  writer.write_raw("i1e", 3);
+  CPPUNIT_ASSERT(!writer.flush(-1));
+  CPPUNIT_ASSERT(writer.size() == 3);
+}
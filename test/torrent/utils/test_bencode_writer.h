@@ -0,0 +1,18 @@
+#include "helpers/test_fixture.h"
+
+class test_bencode_writer : public test_fixture {
+  CPPUNIT_TEST_SUITE(test_bencode_writer);
+
+  CPPUNIT_TEST(test_write);
+  CPPUNIT_TEST(test_write_large);
+  CPPUNIT_TEST(test_incremental);
+  CPPUNIT_TEST(test_flush);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_write();
+  void test_write_large();
+  void test_incremental();
+  void test_flush();
+};
@@ -0,0 +1,97 @@
+#include "config.h"
+
+#include "test_codec.h"
+
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+#include <torrent/exceptions.h>
+#include <torrent/utils/codec.h>
+#include <torrent/utils/string_manip.h>
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(test_codec, "torrent/utils");
+
+using namespace torrent::utils;
+
+static const char hash_data[] = "\xC3\x44\xA3\xCE\x02\xB0\x67\x16\xA5\x15\xE5\x9A\x02\x77\x52\x4D\x20\x2C\xBB\xA2";
+static const char hash_hex[]  = "C344A3CE02B06716A515E59A0277524D202CBBA2";
+static const char hash_b32[]  = "YNCKHTQCWBTRNJIV4WNAE52SJUQCZO5C";
+
+void
+test_codec::test_hex() {
+  char encoded[40];
+  codec_encode_hex(hash_data, 20, encoded);
+  CPPUNIT_ASSERT(std::string(encoded, 40) == hash_hex);
+
+  std::string data(hash_data, 20);
+  CPPUNIT_ASSERT(transform_to_hex_str(data) == hash_hex);
+
+  char decoded[20];
+  CPPUNIT_ASSERT(codec_decode_hex(hash_hex, 40, decoded));
+  CPPUNIT_ASSERT(std::memcmp(decoded, hash_data, 20) == 0);
+
+  CPPUNIT_ASSERT(codec_decode_hex("c344a3ce", 8, decoded));
+  CPPUNIT_ASSERT(std::memcmp(decoded, hash_data, 4) == 0);
+
+  CPPUNIT_ASSERT(!codec_decode_hex("C344A3CG", 8, decoded));
+  CPPUNIT_ASSERT(!codec_decode_hex("C344A3C", 7, decoded));
+  CPPUNIT_ASSERT(!codec_decode_hex("C344 3CE", 8, decoded));
+}
+
+void
+test_codec::test_base32() {
+  char encoded[32];
+  codec_encode_base32(hash_data, 20, encoded);
+  CPPUNIT_ASSERT(std::string(encoded, 32) == hash_b32);
+
+  codec_encode_base32(hash_data, 0, encoded);
+  CPPUNIT_ASSERT_THROW(codec_encode_base32(hash_data, 19, encoded), torrent::internal_error);
+  CPPUNIT_ASSERT_THROW(codec_encode_base32(hash_data, 4, encoded), torrent::internal_error);
+
+  char decoded[20];
+  CPPUNIT_ASSERT(codec_decode_base32(hash_b32, 32, decoded));
+  CPPUNIT_ASSERT(std::memcmp(decoded, hash_data, 20) == 0);
+
+  std::string lower = hash_b32;
+  for (auto& c : lower)
+    c = std::tolower(c);
+
+  std::memset(decoded, 0, sizeof(decoded));
+  CPPUNIT_ASSERT(codec_decode_base32(lower.data(), 32, decoded));
+  CPPUNIT_ASSERT(std::memcmp(decoded, hash_data, 20) == 0);
+
+  CPPUNIT_ASSERT(!codec_decode_base32("YNCKHTQ1", 8, decoded));
+  CPPUNIT_ASSERT(!codec_decode_base32("YNCKHTQ=", 8, decoded));
+  CPPUNIT_ASSERT(!codec_decode_base32("YNCKHTQ", 7, decoded));
+}
+
+void
+test_codec::test_compact_inet() {
+  const char data[] = "\x0a\x00\x00\x01\x1a\xe1" "\xc0\xa8\x01\x02\x00\x50" "\x01\x02";
+
+  torrent::sa_inet_union addrs[3];
+  CPPUNIT_ASSERT(codec_decode_compact_inet(data, sizeof(data) - 1, addrs) == 2);
+
+  CPPUNIT_ASSERT(addrs[0].inet.sin_family == AF_INET);
+  CPPUNIT_ASSERT(ntohl(addrs[0].inet.sin_addr.s_addr) == 0x0a000001);
+  CPPUNIT_ASSERT(ntohs(addrs[0].inet.sin_port) == 6881);
+
+  CPPUNIT_ASSERT(addrs[1].inet.sin_family == AF_INET);
+  CPPUNIT_ASSERT(ntohl(addrs[1].inet.sin_addr.s_addr) == 0xc0a80102);
+  CPPUNIT_ASSERT(ntohs(addrs[1].inet.sin_port) == 80);
+}
+
+void
+test_codec::test_compact_inet6() {
+  const char data[] = "\x20\x01\x0d\xb8\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01\x1a\xe1" "\x00";
+
+  torrent::sa_inet_union addrs[2];
+  CPPUNIT_ASSERT(codec_decode_compact_inet6(data, sizeof(data) - 1, addrs) == 1);
+
+  in6_addr expected{};
+  ::inet_pton(AF_INET6, "2001:db8::1", &expected);
+
+  CPPUNIT_ASSERT(addrs[0].inet6.sin6_family == AF_INET6);
+  CPPUNIT_ASSERT(std::memcmp(&addrs[0].inet6.sin6_addr, &expected, sizeof(in6_addr)) == 0);
+  CPPUNIT_ASSERT(ntohs(addrs[0].inet6.sin6_port) == 6881);
+}
@@ -0,0 +1,18 @@
+#include "helpers/test_fixture.h"
+
+class test_codec : public test_fixture {
+  CPPUNIT_TEST_SUITE(test_codec);
+
+  CPPUNIT_TEST(test_hex);
+  CPPUNIT_TEST(test_base32);
+  CPPUNIT_TEST(test_compact_inet);
+  CPPUNIT_TEST(test_compact_inet6);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_hex();
+  void test_base32();
+  void test_compact_inet();
+  void test_compact_inet6();
+};
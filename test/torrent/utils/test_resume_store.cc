@@ -0,0 +1,191 @@
+#include "config.h"
+
+#include "test_resume_store.h"
+
+#include <cstring>
+#include <unistd.h>
+#include <torrent/exceptions.h>
+#include <torrent/utils/resume_store.h>
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(test_resume_store, "torrent/utils");
+
+using torrent::utils::ResumeStore;
+
+static torrent::HashString
+make_hash(char c) {
+  torrent::HashString hash;
+  std::memset(hash.data(), c, hash.size());
+  return hash;
+}
+
+void
+test_resume_store::setUp() {
+  test_fixture::setUp();
+
+  char path_template[] = "/tmp/libtorrent-resume-store.XXXXXX";
+  int  fd              = ::mkstemp(path_template);
+
+  CPPUNIT_ASSERT(fd != -1);
+  ::close(fd);
+  ::unlink(path_template);
+
+  m_path = path_template;
+}
+
+void
+test_resume_store::tearDown() {
+  ::unlink(m_path.c_str());
+  test_fixture::tearDown();
+}
+
+void
+test_resume_store::test_reopen() {
+  const uint8_t bitfield[] = { 0xa5, 0x0f, 0xc0 };
+
+  {
+    ResumeStore store;
+    store.open(m_path);
+
+    CPPUNIT_ASSERT(store.is_open());
+    CPPUNIT_ASSERT(store.size() == 0);
+    CPPUNIT_ASSERT(store.size_mapped() == ResumeStore::min_file_size);
+
+    auto record = store.insert(make_hash('a'), 18, 2);
+
+    record.set_bitfield(bitfield);
+    record.set_file(0, ResumeStore::file_entry{1234, 5, 1});
+    record.set_file(1, ResumeStore::file_entry{~int64_t{3}, 7, 2});
+    record.set_flags(ResumeStore::flag_progress);
+
+    store.insert(make_hash('b'), 9, 1).set_uniform_bitfield(true);
+
+    CPPUNIT_ASSERT(store.size() == 2);
+    CPPUNIT_ASSERT(store.sync(true));
+  }
+
+  ResumeStore store;
+  store.open(m_path);
+
+  CPPUNIT_ASSERT(store.size() == 2);
+  CPPUNIT_ASSERT(!store.find(make_hash('c')).is_valid());
+
+  auto record = store.find(make_hash('a'));
+
+  CPPUNIT_ASSERT(record.is_valid());
+  CPPUNIT_ASSERT(record.flags() == (ResumeStore::flag_used | ResumeStore::flag_progress));
+  CPPUNIT_ASSERT(record.size_chunks() == 18);
+  CPPUNIT_ASSERT(record.size_files() == 2);
+  CPPUNIT_ASSERT(std::memcmp(record.bitfield(), bitfield, sizeof(bitfield)) == 0);
+  CPPUNIT_ASSERT(record.file(0).mtime == 1234);
+  CPPUNIT_ASSERT(record.file(0).completed == 5);
+  CPPUNIT_ASSERT(record.file(1).mtime == ~int64_t{3});
+  CPPUNIT_ASSERT(record.file(1).priority == 2);
+
+  auto uniform = store.find(make_hash('b'));
+
+  CPPUNIT_ASSERT(uniform.bitfield()[0] == 0xff);
+  CPPUNIT_ASSERT(uniform.bitfield()[1] == 0x80);
+
+  // Same geometry returns the existing record.
+  CPPUNIT_ASSERT(store.insert(make_hash('a'), 18, 2).file(0).mtime == 1234);
+  CPPUNIT_ASSERT(store.insert(make_hash('a'), 19, 2).file(0).mtime == 0);
+}
+
+void
+test_resume_store::test_erase() {
+  ResumeStore store;
+  store.open(m_path);
+
+  store.insert(make_hash('a'), 1000, 10);
+  store.insert(make_hash('b'), 100, 1);
+
+  auto used = store.size_used();
+
+  store.erase(make_hash('a'));
+
+  CPPUNIT_ASSERT(store.size() == 1);
+  CPPUNIT_ASSERT(!store.find(make_hash('a')).is_valid());
+
+  // Smaller records reuse the freed space.
+  store.insert(make_hash('c'), 500, 5);
+
+  CPPUNIT_ASSERT(store.size_used() == used);
+
+  store.insert(make_hash('d'), 2000, 5);
+
+  CPPUNIT_ASSERT(store.size_used() > used);
+  CPPUNIT_ASSERT(store.sync(true));
+  store.close();
+
+  store.open(m_path);
+
+  CPPUNIT_ASSERT(store.size() == 3);
+  CPPUNIT_ASSERT(store.find(make_hash('b')).is_valid());
+  CPPUNIT_ASSERT(store.find(make_hash('c')).size_chunks() == 500);
+  CPPUNIT_ASSERT(store.find(make_hash('d')).size_chunks() == 2000);
+
+  // No free records remain, so this is appended.
+  store.insert(make_hash('a'), 1000, 10);
+  CPPUNIT_ASSERT(store.size() == 4);
+}
+
+void
+test_resume_store::test_dirty() {
+  ResumeStore store;
+  store.open(m_path);
+
+  auto record = store.insert(make_hash('a'), 8 * 4096, 1);
+
+  CPPUNIT_ASSERT(store.size_dirty() != 0);
+  CPPUNIT_ASSERT(store.sync(true));
+  CPPUNIT_ASSERT(store.size_dirty() == 0);
+
+  std::string bitfield(record.size_bitfield(), '\0');
+
+  record.set_bitfield(reinterpret_cast<const uint8_t*>(bitfield.data()));
+  CPPUNIT_ASSERT(store.size_dirty() == 0);
+
+  bitfield[2000] = '\x01';
+  record.set_bitfield(reinterpret_cast<const uint8_t*>(bitfield.data()));
+  CPPUNIT_ASSERT(store.size_dirty() == 64);
+
+  record.set_file(0, ResumeStore::file_entry{});
+  CPPUNIT_ASSERT(store.size_dirty() == 64);
+
+  CPPUNIT_ASSERT(store.sync());
+  CPPUNIT_ASSERT(store.size_dirty() == 0);
+}
+
+void
+test_resume_store::test_invalid() {
+  {
+    ResumeStore store;
+    store.open(m_path);
+    store.insert(make_hash('a'), 100, 1);
+    store.insert(make_hash('b'), 100, 1);
+    store.sync(true);
+  }
+
+  // Truncating the file drops the partial record.
+  CPPUNIT_ASSERT(::truncate(m_path.c_str(), sizeof(ResumeStore::file_header) + ResumeStore::record_size(100, 1) + 8) == 0);
+
+  {
+    ResumeStore store;
+    store.open(m_path);
+
+    CPPUNIT_ASSERT(store.size() == 1);
+    CPPUNIT_ASSERT(store.find(make_hash('a')).is_valid());
+    CPPUNIT_ASSERT(store.size_used() == sizeof(ResumeStore::file_header) + ResumeStore::record_size(100, 1));
+  }
+
+  CPPUNIT_ASSERT(::truncate(m_path.c_str(), 0) == 0);
+  CPPUNIT_ASSERT(::truncate(m_path.c_str(), 4096) == 0);
+
+  FILE* file = std::fopen(m_path.c_str(), "r+");
+  std::fputs("garbage!", file);
+  std::fclose(file);
+
+  ResumeStore store;
+  CPPUNIT_ASSERT_THROW(store.open(m_path), torrent::storage_error);
+  CPPUNIT_ASSERT(!store.is_open());
+}
@@ -0,0 +1,24 @@
+#include "helpers/test_fixture.h"
+
+class test_resume_store : public test_fixture {
+  CPPUNIT_TEST_SUITE(test_resume_store);
+
+  CPPUNIT_TEST(test_reopen);
+  CPPUNIT_TEST(test_erase);
+  CPPUNIT_TEST(test_dirty);
+  CPPUNIT_TEST(test_invalid);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp() override;
+  void tearDown() override;
+
+  void test_reopen();
+  void test_erase();
+  void test_dirty();
+  void test_invalid();
+
+private:
+  std::string m_path;
+};
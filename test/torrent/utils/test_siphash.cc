@@ -0,0 +1,29 @@
+#include "config.h"
+
+#include "test_siphash.h"
+
+#include "utils/siphash.h"
+
+CPPUNIT_TEST_SUITE_NAMED_REGISTRATION(test_siphash, "torrent/utils");
+
+// Test vectors from the reference implementation, key 00 01 .. 0f and message 00 01 .. up to
+// the given length.
+void
+test_siphash::test_vectors() {
+  torrent::siphash_key key{UINT64_C(0x0706050403020100), UINT64_C(0x0f0e0d0c0b0a0908)};
+
+  uint8_t message[16];
+
+  for (unsigned int i = 0; i != sizeof(message); i++)
+    message[i] = i;
+
+  CPPUNIT_ASSERT(torrent::siphash24(key, message, 0) == UINT64_C(0x726fdb47dd0e0e31));
+  CPPUNIT_ASSERT(torrent::siphash24(key, message, 4) == UINT64_C(0xcf2794e0277187b7));
+  CPPUNIT_ASSERT(torrent::siphash24(key, message, 8) == UINT64_C(0x93f5f5799a932462));
+  CPPUNIT_ASSERT(torrent::siphash24(key, message, 15) == UINT64_C(0xa129ca6149be45e5));
+  CPPUNIT_ASSERT(torrent::siphash24(key, message, 16) == UINT64_C(0x3f2acc7f57c29bdb));
+
+  torrent::siphash_key other{key.k0 ^ 1, key.k1};
+
+  CPPUNIT_ASSERT(torrent::siphash24(other, message, 15) != UINT64_C(0xa129ca6149be45e5));
+}
@@ -0,0 +1,12 @@
+#include "helpers/test_fixture.h"
+
+class test_siphash : public test_fixture {
+  CPPUNIT_TEST_SUITE(test_siphash);
+
+  CPPUNIT_TEST(test_vectors);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_vectors();
+};
@@ -0,0 +1,146 @@
+#include "config.h"
+
+#include "test/tracker/test_request_pacer.h"
+
+#include <string>
+#include <vector>
+
+#include "test/helpers/expect_utils.h"
+#include "tracker/request_pacer.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestRequestPacer);
+
+using torrent::tracker::RequestPacer;
+
+static int owners[8];
+
+static RequestPacer::slot_type
+record(std::vector<int>& result, int value) {
+  return [&result, value] { result.push_back(value); };
+}
+
+static void
+run_due(RequestPacer& pacer, std::chrono::microseconds now) {
+  for (auto& slot : pacer.pop_due(now))
+    slot();
+}
+
+void
+TestRequestPacer::test_immediate() {
+  RequestPacer pacer;
+  std::vector<int> sent;
+
+  CPPUNIT_ASSERT(!pacer.insert(&owners[0], "a.example", 10s, record(sent, 0)));
+  CPPUNIT_ASSERT(!pacer.insert(&owners[1], "b.example", 10s, record(sent, 1)));
+  CPPUNIT_ASSERT(!pacer.insert(&owners[2], "", 10s, record(sent, 2)));
+  CPPUNIT_ASSERT(pacer.empty());
+
+  expect_random_uniform_uint32(0, 0, RequestPacer::default_jitter.count());
+  CPPUNIT_ASSERT(pacer.insert(&owners[3], "a.example", 10s, record(sent, 3)));
+  CPPUNIT_ASSERT(pacer.size() == 1);
+
+  // Once the slots reserved for the host have passed, the next request is immediate.
+  pacer.erase(&owners[3]);
+  run_due(pacer, 10s + 2 * RequestPacer::default_interval);
+
+  CPPUNIT_ASSERT(pacer.size_hosts() == 0);
+  CPPUNIT_ASSERT(!pacer.insert(&owners[3], "a.example", 10s + 2 * RequestPacer::default_interval, record(sent, 3)));
+}
+
+void
+TestRequestPacer::test_order() {
+  RequestPacer pacer;
+  pacer.set_interval(100ms);
+  pacer.set_jitter(0ms);
+
+  std::vector<int> sent;
+
+  CPPUNIT_ASSERT(!pacer.insert(&owners[0], "a.example", 10s, record(sent, 0)));
+
+  for (int i = 1; i != 5; i++)
+    CPPUNIT_ASSERT(pacer.insert(&owners[i], "a.example", 10s, record(sent, i)));
+
+  CPPUNIT_ASSERT(!pacer.insert(&owners[5], "b.example", 10s, record(sent, 5)));
+  CPPUNIT_ASSERT(pacer.insert(&owners[6], "b.example", 10s, record(sent, 6)));
+
+  CPPUNIT_ASSERT(pacer.size() == 5);
+  CPPUNIT_ASSERT(pacer.next_time() == 10s + 100ms);
+
+  CPPUNIT_ASSERT(pacer.pop_due(10s + 99ms).empty());
+
+  run_due(pacer, 10s + 100ms);
+  CPPUNIT_ASSERT((sent == std::vector<int>{1, 6}));
+
+  run_due(pacer, 10s + 250ms);
+  CPPUNIT_ASSERT((sent == std::vector<int>{1, 6, 2}));
+
+  run_due(pacer, 10s + 400ms);
+  CPPUNIT_ASSERT((sent == std::vector<int>{1, 6, 2, 3, 4}));
+  CPPUNIT_ASSERT(pacer.empty());
+}
+
+void
+TestRequestPacer::test_replace() {
+  RequestPacer pacer;
+  pacer.set_jitter(0ms);
+
+  std::vector<int> sent;
+
+  CPPUNIT_ASSERT(!pacer.insert(&owners[0], "a.example", 10s, record(sent, 0)));
+  CPPUNIT_ASSERT(pacer.insert(&owners[1], "a.example", 10s, record(sent, 1)));
+  CPPUNIT_ASSERT(pacer.insert(&owners[1], "a.example", 10s, record(sent, 2)));
+  CPPUNIT_ASSERT(pacer.size() == 1);
+
+  run_due(pacer, 20s);
+
+  CPPUNIT_ASSERT((sent == std::vector<int>{2}));
+
+  CPPUNIT_ASSERT(!pacer.insert(&owners[1], "a.example", 20s, record(sent, 1)));
+  CPPUNIT_ASSERT(pacer.insert(&owners[2], "a.example", 20s, record(sent, 3)));
+
+  pacer.erase(&owners[2]);
+
+  CPPUNIT_ASSERT(pacer.empty());
+  CPPUNIT_ASSERT(pacer.pop_due(30s).empty());
+}
+
+void
+TestRequestPacer::test_jitter() {
+  RequestPacer pacer;
+  pacer.set_interval(50ms);
+  pacer.set_jitter(500ms);
+
+  std::vector<int> sent;
+
+  CPPUNIT_ASSERT(!pacer.insert(&owners[0], "a.example", 10s, record(sent, 0)));
+
+  // Jitter is added to the slot of each delayed request, without moving the following slots.
+  expect_random_uniform_uint32(400000, 0, 500000);
+  expect_random_uniform_uint32(0, 0, 500000);
+
+  CPPUNIT_ASSERT(pacer.insert(&owners[1], "a.example", 10s, record(sent, 1)));
+  CPPUNIT_ASSERT(pacer.next_time() == 10s + 450ms);
+
+  CPPUNIT_ASSERT(pacer.insert(&owners[2], "a.example", 10s, record(sent, 2)));
+  CPPUNIT_ASSERT(pacer.next_time() == 10s + 100ms);
+
+  run_due(pacer, 10s + 100ms);
+  CPPUNIT_ASSERT((sent == std::vector<int>{2}));
+
+  run_due(pacer, 10s + 450ms);
+  CPPUNIT_ASSERT((sent == std::vector<int>{2, 1}));
+}
+
+void
+TestRequestPacer::test_disabled() {
+  RequestPacer pacer;
+  pacer.set_interval(0ms);
+
+  std::vector<int> sent;
+
+  for (int i = 0; i != 8; i++)
+    CPPUNIT_ASSERT(!pacer.insert(&owners[i], "a.example", 10s, record(sent, i)));
+
+  CPPUNIT_ASSERT(pacer.empty());
+  CPPUNIT_ASSERT(pacer.size_hosts() == 0);
+}
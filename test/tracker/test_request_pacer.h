@@ -0,0 +1,20 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestRequestPacer : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestRequestPacer);
+
+  CPPUNIT_TEST(test_immediate);
+  CPPUNIT_TEST(test_order);
+  CPPUNIT_TEST(test_replace);
+  CPPUNIT_TEST(test_jitter);
+  CPPUNIT_TEST(test_disabled);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_immediate();
+  void test_order();
+  void test_replace();
+  void test_jitter();
+  void test_disabled();
+};
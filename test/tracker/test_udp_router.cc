@@ -0,0 +1,284 @@
+#include "config.h"
+
+#include "test/tracker/test_udp_router.h"
+
+#include <cerrno>
+#include <vector>
+
+#include "test/helpers/udp_tracker_test.h"
+#include "torrent/system/poll.h"
+#include "tracker/udp_router.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestUdpRouter);
+
+using torrent::tracker::UdpRouter;
+
+namespace {
+
+struct test_request {
+  uint32_t id{};
+  int      failures{};
+  int      errno_err{};
+  bool     processed{};
+};
+
+struct test_router : public UdpRouter {
+  test_router()  { open(AF_INET); }
+  ~test_router() { close(); }
+
+  void announce(test_request& request, const UdpTrackerTest& tracker) {
+    auto params = connection_params{
+      [this](uint32_t id, auto& buffer) {
+        buffer.write_64(connection_id(id));
+        buffer.write_32(UdpTrackerTest::action_announce);
+        buffer.write_32(id);
+      },
+      [&request](uint32_t, auto&) {
+        request.processed = true;
+        return false;
+      },
+      [&request](uint32_t, int errno_err, int) {
+        request.failures++;
+        request.errno_err = errno_err;
+      },
+      [&request](uint32_t id) { request.id = id; },
+      nullptr,
+      true,
+    };
+
+    connect(tracker.hostname(), tracker.port(), params);
+  }
+};
+
+std::vector<UdpTrackerTest::packet>
+receive_action(UdpTrackerTest& tracker, uint32_t action) {
+  std::vector<UdpTrackerTest::packet> result;
+
+  for (auto& p : tracker.receive())
+    if (p.action == action)
+      result.push_back(std::move(p));
+
+  return result;
+}
+
+void
+process_events(TestMainThread* main_thread) {
+  for (unsigned int i = 0; i != 64; i++)
+    if (torrent::this_thread::poll()->do_poll(0us) == 0)
+      break;
+
+  main_thread->test_process_events_without_cached_time();
+}
+
+void
+advance_time(TestMainThread* main_thread, std::chrono::seconds duration) {
+  main_thread->test_add_cached_time(duration);
+  process_events(main_thread);
+}
+
+} // namespace
+
+void
+TestUdpRouter::test_shared_handshake() {
+  UdpTrackerTest tracker;
+  test_router    router;
+
+  CPPUNIT_ASSERT(router.is_open());
+
+  test_request request_1;
+  test_request request_2;
+
+  router.announce(request_1, tracker);
+  router.announce(request_2, tracker);
+
+  CPPUNIT_ASSERT(router.size_endpoints() == 1);
+
+  auto connect = tracker.receive();
+
+  CPPUNIT_ASSERT(connect.size() == 1 && connect[0].action == UdpTrackerTest::action_connect);
+  CPPUNIT_ASSERT(connect[0].connection_id == UdpRouter::magic_connection_id);
+
+  tracker.reply_connect(connect[0], 0xabcd);
+  process_events(m_main_thread.get());
+
+  auto announces = tracker.receive();
+
+  CPPUNIT_ASSERT(announces.size() == 2);
+  CPPUNIT_ASSERT(announces[0].action == UdpTrackerTest::action_announce && announces[0].connection_id == 0xabcd);
+  CPPUNIT_ASSERT(announces[1].action == UdpTrackerTest::action_announce && announces[1].connection_id == 0xabcd);
+  CPPUNIT_ASSERT(announces[0].transaction_id == request_1.id);
+  CPPUNIT_ASSERT(announces[1].transaction_id == request_2.id);
+
+  // Requests made while the connection id is valid skip the handshake.
+  test_request request_3;
+  router.announce(request_3, tracker);
+
+  auto announce_3 = tracker.receive();
+
+  CPPUNIT_ASSERT(announce_3.size() == 1 && announce_3[0].action == UdpTrackerTest::action_announce);
+  CPPUNIT_ASSERT(announce_3[0].connection_id == 0xabcd);
+
+  tracker.reply_announce(announces[0], 1800);
+  tracker.reply_announce(announces[1], 1800);
+  tracker.reply_announce(announce_3[0], 1800);
+  process_events(m_main_thread.get());
+
+  CPPUNIT_ASSERT(request_1.processed && request_2.processed && request_3.processed);
+  CPPUNIT_ASSERT(request_1.failures == 0 && request_2.failures == 0 && request_3.failures == 0);
+}
+
+void
+TestUdpRouter::test_connection_id_expires() {
+  UdpTrackerTest tracker;
+  test_router    router;
+
+  test_request request_1;
+  router.announce(request_1, tracker);
+
+  auto connect = receive_action(tracker, UdpTrackerTest::action_connect);
+
+  CPPUNIT_ASSERT(connect.size() == 1);
+
+  tracker.reply_connect(connect[0], 0xabcd);
+  process_events(m_main_thread.get());
+
+  auto announce = receive_action(tracker, UdpTrackerTest::action_announce);
+
+  CPPUNIT_ASSERT(announce.size() == 1);
+
+  tracker.reply_announce(announce[0], 1800);
+  process_events(m_main_thread.get());
+
+  advance_time(m_main_thread.get(), UdpRouter::connection_id_lifetime);
+
+  test_request request_2;
+  router.announce(request_2, tracker);
+
+  connect = tracker.receive();
+
+  CPPUNIT_ASSERT(connect.size() == 1 && connect[0].action == UdpTrackerTest::action_connect);
+}
+
+void
+TestUdpRouter::test_handshake_timeout() {
+  UdpTrackerTest tracker;
+  UdpTrackerTest tracker_other;
+  test_router    router;
+
+  test_request request_1;
+  test_request request_2;
+  test_request request_other;
+
+  router.announce(request_1, tracker);
+  router.announce(request_2, tracker);
+  router.announce(request_other, tracker_other);
+
+  CPPUNIT_ASSERT(receive_action(tracker, UdpTrackerTest::action_connect).size() == 1);
+
+  // The other endpoint is unaffected by the unresponsive one.
+  auto connect_other = receive_action(tracker_other, UdpTrackerTest::action_connect);
+
+  CPPUNIT_ASSERT(connect_other.size() == 1);
+
+  tracker_other.reply_connect(connect_other[0], 0x1234);
+  process_events(m_main_thread.get());
+
+  auto announce_other = receive_action(tracker_other, UdpTrackerTest::action_announce);
+
+  CPPUNIT_ASSERT(announce_other.size() == 1);
+
+  tracker_other.reply_announce(announce_other[0], 1800);
+  process_events(m_main_thread.get());
+
+  CPPUNIT_ASSERT(request_other.processed);
+
+  // The handshake is retried with increasing timeouts before the waiting requests fail.
+  advance_time(m_main_thread.get(), 15s);
+  CPPUNIT_ASSERT(receive_action(tracker, UdpTrackerTest::action_connect).size() == 1);
+
+  advance_time(m_main_thread.get(), 30s);
+  CPPUNIT_ASSERT(receive_action(tracker, UdpTrackerTest::action_connect).size() == 1);
+
+  CPPUNIT_ASSERT(request_1.failures == 0 && request_2.failures == 0);
+
+  advance_time(m_main_thread.get(), 45s);
+  CPPUNIT_ASSERT(tracker.receive().empty());
+
+  CPPUNIT_ASSERT(request_1.failures == 1 && request_1.errno_err == ETIMEDOUT);
+  CPPUNIT_ASSERT(request_2.failures == 1 && request_2.errno_err == ETIMEDOUT);
+}
+
+void
+TestUdpRouter::test_handshake_error() {
+  UdpTrackerTest tracker;
+  test_router    router;
+
+  test_request request_1;
+  test_request request_2;
+
+  router.announce(request_1, tracker);
+  router.announce(request_2, tracker);
+
+  auto connect = receive_action(tracker, UdpTrackerTest::action_connect);
+
+  CPPUNIT_ASSERT(connect.size() == 1);
+
+  tracker.reply_error(connect[0], "denied");
+  process_events(m_main_thread.get());
+
+  CPPUNIT_ASSERT(request_1.failures == 1 && request_1.errno_err == ECONNREFUSED);
+  CPPUNIT_ASSERT(request_2.failures == 1 && request_2.errno_err == ECONNREFUSED);
+  CPPUNIT_ASSERT(tracker.receive().empty());
+}
+
+void
+TestUdpRouter::test_backoff() {
+  UdpTrackerTest tracker;
+  test_router    router;
+
+  test_request request_1;
+  router.announce(request_1, tracker);
+
+  advance_time(m_main_thread.get(), 15s);
+  advance_time(m_main_thread.get(), 30s);
+  advance_time(m_main_thread.get(), 45s);
+
+  CPPUNIT_ASSERT(receive_action(tracker, UdpTrackerTest::action_connect).size() == 3);
+  CPPUNIT_ASSERT(request_1.failures == 1);
+
+  // Requests made during backoff are not failed outright, they get a handshake that is only sent
+  // once.
+  test_request request_2;
+  router.announce(request_2, tracker);
+
+  CPPUNIT_ASSERT(request_2.failures == 0);
+  CPPUNIT_ASSERT(receive_action(tracker, UdpTrackerTest::action_connect).size() == 1);
+
+  advance_time(m_main_thread.get(), 44s);
+  CPPUNIT_ASSERT(request_2.failures == 0);
+
+  advance_time(m_main_thread.get(), 1s);
+  CPPUNIT_ASSERT(request_2.failures == 1 && request_2.errno_err == ETIMEDOUT);
+  CPPUNIT_ASSERT(tracker.receive().empty());
+
+  // A successful handshake clears the backoff.
+  test_request request_3;
+  router.announce(request_3, tracker);
+
+  auto connect = receive_action(tracker, UdpTrackerTest::action_connect);
+
+  CPPUNIT_ASSERT(connect.size() == 1);
+
+  tracker.reply_connect(connect[0], 0xabcd);
+  process_events(m_main_thread.get());
+
+  auto announce = receive_action(tracker, UdpTrackerTest::action_announce);
+
+  CPPUNIT_ASSERT(announce.size() == 1);
+  CPPUNIT_ASSERT(request_3.failures == 0);
+
+  tracker.reply_announce(announce[0], 1800);
+  process_events(m_main_thread.get());
+
+  CPPUNIT_ASSERT(request_3.processed);
+}
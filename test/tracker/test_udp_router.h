@@ -0,0 +1,20 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestUdpRouter : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestUdpRouter);
+
+  CPPUNIT_TEST(test_shared_handshake);
+  CPPUNIT_TEST(test_connection_id_expires);
+  CPPUNIT_TEST(test_handshake_timeout);
+  CPPUNIT_TEST(test_handshake_error);
+  CPPUNIT_TEST(test_backoff);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_shared_handshake();
+  void test_connection_id_expires();
+  void test_handshake_timeout();
+  void test_handshake_error();
+  void test_backoff();
+};
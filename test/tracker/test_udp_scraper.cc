@@ -0,0 +1,296 @@
+#include "config.h"
+
+#include "test/tracker/test_udp_scraper.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "test/helpers/udp_tracker_test.h"
+#include "torrent/system/poll.h"
+#include "tracker/udp_router.h"
+#include "tracker/udp_scraper.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TestUdpScraper);
+
+using torrent::tracker::UdpRouter;
+using torrent::tracker::UdpScraper;
+
+namespace {
+
+struct scrape_result {
+  bool        done{};
+  uint32_t    seeders{};
+  uint32_t    completed{};
+  uint32_t    leechers{};
+  std::string error;
+};
+
+// The scraper is destroyed before the router is closed, as it disconnects its transactions.
+struct test_scraper {
+  test_scraper() {
+    router.open(AF_INET);
+    scraper = std::make_unique<UdpScraper>(&router, nullptr);
+  }
+
+  ~test_scraper() {
+    scraper.reset();
+    router.close();
+  }
+
+  void add(scrape_result& result, const std::string& hostname, uint16_t port, const torrent::HashString& hash) {
+    scraper->add(&result, hostname, port, hash,
+                 [&result](uint32_t seeders, uint32_t completed, uint32_t leechers) {
+                   result = scrape_result{true, seeders, completed, leechers, ""};
+                 },
+                 [&result](const std::string& msg) {
+                   result = scrape_result{true, 0, 0, 0, msg};
+                 });
+  }
+
+  UdpRouter                   router;
+  std::unique_ptr<UdpScraper> scraper;
+};
+
+torrent::HashString
+make_hash(unsigned int index) {
+  auto hash = torrent::HashString::new_zero();
+
+  hash[0] = static_cast<char>(index >> 8);
+  hash[1] = static_cast<char>(index);
+  hash[19] = 'h';
+
+  return hash;
+}
+
+std::string
+make_hashes(unsigned int first, unsigned int last) {
+  std::string result;
+
+  for (unsigned int i = first; i != last; i++)
+    result += make_hash(i).str();
+
+  return result;
+}
+
+void
+process_events(TestMainThread* main_thread) {
+  for (unsigned int i = 0; i != 64; i++)
+    if (torrent::this_thread::poll()->do_poll(0us) == 0)
+      break;
+
+  main_thread->test_process_events_without_cached_time();
+}
+
+void
+flush_scraper(TestMainThread* main_thread) {
+  main_thread->test_add_cached_time(UdpScraper::batch_delay + 1s);
+  main_thread->test_process_events_without_cached_time();
+}
+
+} // namespace
+
+void
+TestUdpScraper::test_batch_endpoints() {
+  UdpTrackerTest tracker_a;
+  UdpTrackerTest tracker_b;
+  test_scraper   test;
+
+  CPPUNIT_ASSERT(test.router.is_open());
+
+  std::vector<scrape_result> results(5);
+
+  for (unsigned int i = 0; i != 3; i++)
+    test.add(results[i], tracker_a.hostname(), tracker_a.port(), make_hash(i));
+
+  for (unsigned int i = 3; i != 5; i++)
+    test.add(results[i], tracker_b.hostname(), tracker_b.port(), make_hash(i));
+
+  CPPUNIT_ASSERT(test.scraper->size_pending() == 5);
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 0);
+
+  flush_scraper(m_main_thread.get());
+
+  CPPUNIT_ASSERT(test.scraper->size_pending() == 0);
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 2);
+
+  auto connect_a = tracker_a.receive();
+  auto connect_b = tracker_b.receive();
+
+  CPPUNIT_ASSERT(connect_a.size() == 1 && connect_a[0].action == UdpTrackerTest::action_connect);
+  CPPUNIT_ASSERT(connect_b.size() == 1 && connect_b[0].action == UdpTrackerTest::action_connect);
+  CPPUNIT_ASSERT(connect_a[0].connection_id == UdpRouter::magic_connection_id);
+
+  tracker_a.reply_connect(connect_a[0], 0x1111);
+  tracker_b.reply_connect(connect_b[0], 0x2222);
+  process_events(m_main_thread.get());
+
+  auto scrape_a = tracker_a.receive();
+  auto scrape_b = tracker_b.receive();
+
+  CPPUNIT_ASSERT(scrape_a.size() == 1 && scrape_a[0].action == UdpTrackerTest::action_scrape);
+  CPPUNIT_ASSERT(scrape_b.size() == 1 && scrape_b[0].action == UdpTrackerTest::action_scrape);
+  CPPUNIT_ASSERT(scrape_a[0].connection_id == 0x1111);
+  CPPUNIT_ASSERT(scrape_b[0].connection_id == 0x2222);
+  CPPUNIT_ASSERT(scrape_a[0].payload == make_hashes(0, 3));
+  CPPUNIT_ASSERT(scrape_b[0].payload == make_hashes(3, 5));
+
+  tracker_a.reply_scrape(scrape_a[0], {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}});
+  tracker_b.reply_scrape(scrape_b[0], {{10, 11, 12}, {13, 14, 15}});
+  process_events(m_main_thread.get());
+
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 0);
+
+  for (unsigned int i = 0; i != 5; i++) {
+    CPPUNIT_ASSERT(results[i].done && results[i].error.empty());
+    CPPUNIT_ASSERT(results[i].seeders == i * 3 + 1);
+    CPPUNIT_ASSERT(results[i].completed == i * 3 + 2);
+    CPPUNIT_ASSERT(results[i].leechers == i * 3 + 3);
+  }
+}
+
+void
+TestUdpScraper::test_split_max_hashes() {
+  UdpTrackerTest tracker;
+  test_scraper   test;
+
+  const unsigned int count = UdpScraper::max_hashes * 2 + 1;
+
+  std::vector<scrape_result> results(count);
+
+  for (unsigned int i = 0; i != count; i++)
+    test.add(results[i], tracker.hostname(), tracker.port(), make_hash(i));
+
+  flush_scraper(m_main_thread.get());
+
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 3);
+
+  // The batches share the handshake with the endpoint.
+  auto connect = tracker.receive();
+
+  CPPUNIT_ASSERT(connect.size() == 1 && connect[0].action == UdpTrackerTest::action_connect);
+
+  tracker.reply_connect(connect[0], 0x1234);
+  process_events(m_main_thread.get());
+
+  auto scrapes = tracker.receive();
+
+  CPPUNIT_ASSERT(scrapes.size() == 3);
+  CPPUNIT_ASSERT(scrapes[0].payload == make_hashes(0, UdpScraper::max_hashes));
+  CPPUNIT_ASSERT(scrapes[1].payload == make_hashes(UdpScraper::max_hashes, UdpScraper::max_hashes * 2));
+  CPPUNIT_ASSERT(scrapes[2].payload == make_hashes(UdpScraper::max_hashes * 2, count));
+
+  unsigned int index = 0;
+
+  for (auto& scrape : scrapes) {
+    CPPUNIT_ASSERT(scrape.action == UdpTrackerTest::action_scrape);
+    CPPUNIT_ASSERT(scrape.connection_id == 0x1234);
+
+    std::vector<UdpTrackerTest::scrape_entry> entries;
+
+    for (unsigned int i = 0; i != scrape.payload.size() / 20; i++, index++)
+      entries.emplace_back(index, 0, 0);
+
+    tracker.reply_scrape(scrape, entries);
+  }
+
+  process_events(m_main_thread.get());
+
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 0);
+
+  for (unsigned int i = 0; i != count; i++)
+    CPPUNIT_ASSERT(results[i].done && results[i].error.empty() && results[i].seeders == i);
+}
+
+void
+TestUdpScraper::test_error() {
+  UdpTrackerTest tracker;
+  test_scraper   test;
+
+  std::vector<scrape_result> results(2);
+
+  for (unsigned int i = 0; i != 2; i++)
+    test.add(results[i], tracker.hostname(), tracker.port(), make_hash(i));
+
+  flush_scraper(m_main_thread.get());
+
+  auto connect = tracker.receive();
+
+  CPPUNIT_ASSERT(connect.size() == 1);
+
+  tracker.reply_connect(connect[0], 0x1234);
+  process_events(m_main_thread.get());
+
+  auto scrape = tracker.receive();
+
+  CPPUNIT_ASSERT(scrape.size() == 1);
+
+  tracker.reply_error(scrape[0], "overloaded");
+  process_events(m_main_thread.get());
+
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 0);
+
+  for (auto& result : results)
+    CPPUNIT_ASSERT(result.done && result.error == "tracker message: overloaded");
+}
+
+void
+TestUdpScraper::test_remove() {
+  UdpTrackerTest tracker;
+  test_scraper   test;
+
+  std::vector<scrape_result> results(3);
+
+  for (unsigned int i = 0; i != 3; i++)
+    test.add(results[i], tracker.hostname(), tracker.port(), make_hash(i));
+
+  test.scraper->remove(&results[1]);
+
+  CPPUNIT_ASSERT(test.scraper->size_pending() == 2);
+
+  flush_scraper(m_main_thread.get());
+
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 1);
+
+  // Removing an owner from a batch in flight keeps the batch until no owners remain.
+  test.scraper->remove(&results[0]);
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 1);
+
+  test.scraper->remove(&results[2]);
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 0);
+
+  auto connect = tracker.receive();
+
+  CPPUNIT_ASSERT(connect.size() == 1);
+
+  tracker.reply_connect(connect[0], 0x1234);
+  process_events(m_main_thread.get());
+
+  CPPUNIT_ASSERT(tracker.receive().empty());
+
+  for (auto& result : results)
+    CPPUNIT_ASSERT(!result.done);
+}
+
+void
+TestUdpScraper::test_select_router() {
+  UdpTrackerTest tracker;
+  test_scraper   test;
+
+  scrape_result result_inet;
+  scrape_result result_inet6;
+
+  test.add(result_inet, tracker.hostname(), tracker.port(), make_hash(0));
+  test.add(result_inet6, "::1", tracker.port(), make_hash(1));
+
+  flush_scraper(m_main_thread.get());
+
+  // Only the inet router is open, so the inet6 endpoint fails without using it.
+  CPPUNIT_ASSERT(result_inet6.done && result_inet6.error == "no available network protocol(s)");
+  CPPUNIT_ASSERT(!result_inet.done);
+  CPPUNIT_ASSERT(test.scraper->size_batches() == 1);
+
+  auto connect = tracker.receive();
+
+  CPPUNIT_ASSERT(connect.size() == 1);
+}
@@ -0,0 +1,20 @@
+#include "test/helpers/test_main_thread.h"
+
+class TestUdpScraper : public TestFixtureWithMainThread {
+  CPPUNIT_TEST_SUITE(TestUdpScraper);
+
+  CPPUNIT_TEST(test_batch_endpoints);
+  CPPUNIT_TEST(test_split_max_hashes);
+  CPPUNIT_TEST(test_error);
+  CPPUNIT_TEST(test_remove);
+  CPPUNIT_TEST(test_select_router);
+
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void test_batch_endpoints();
+  void test_split_max_hashes();
+  void test_error();
+  void test_remove();
+  void test_select_router();
+};